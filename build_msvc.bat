@@ -50,8 +50,29 @@ if /i "%1"=="release" (
 cl %CFLAGS% ^
   /I "%INC%" ^
   "%SRC%\main.cpp" ^
-  "%SRC%\serial_port.cpp" ^
+  "%SRC%\serial_port_win32.cpp" ^
   "%SRC%\tr3_protocol.cpp" ^
+  "%SRC%\tr3_frame.cpp" ^
+  "%SRC%\frame_parser.cpp" ^
+  "%SRC%\frame_scan.cpp" ^
+  "%SRC%\log.cpp" ^
+  "%SRC%\inventory_stream.cpp" ^
+  "%SRC%\inventory_pipeline.cpp" ^
+  "%SRC%\tag_tracker.cpp" ^
+  "%SRC%\capture.cpp" ^
+  "%SRC%\replay_transport.cpp" ^
+  "%SRC%\metrics.cpp" ^
+  "%SRC%\command_engine.cpp" ^
+  "%SRC%\command_batch.cpp" ^
+  "%SRC%\tag_memory.cpp" ^
+  "%SRC%\tag_journal.cpp" ^
+  "%SRC%\baud_negotiation.cpp" ^
+  "%SRC%\reader_profile.cpp" ^
+  "%SRC%\reader_discovery.cpp" ^
+  "%SRC%\run_options.cpp" ^
+  "%SRC%\inventory_output.cpp" ^
+  "%SRC%\port_watch_win32.cpp" ^
+  "%SRC%\mapped_file_win32.cpp" ^
   /link %LFLAGS% /OUT:%OUT_EXE%
 
 if errorlevel 1 (
@@ -0,0 +1,180 @@
+#pragma once
+// コルーチンによるリーダ操作（C++20・Linux / epoll。tr3_coro ターゲット）
+//   ・EventLoop は 1 スレッドで全リーダのシリアル fd とタイマを扱う（リーダ毎のスレッドは作らない）
+//   ・AsyncReader の操作は co_await で待つ。待っている間は他のリーダの処理が進む
+//   ・応答の照合は CommandEngine と同じ RequestState で行う。1 台につき同時に待てる要求は 1 つ
+//   ・1 台あたりの常駐メモリは受信バッファ（既定 1 KiB）と待ち中のコルーチンフレーム程度
+//
+// main.cpp の手順をそのまま書ける：
+//   tr3::Task<void> workflow(tr3::EventLoop& loop, tr3::AsyncReader& rd) {
+//       if ((co_await rd.rom_version()).empty()) co_return;
+//       tr3::ReaderModeRaw raw;
+//       if (co_await rd.read_mode(raw)) co_await rd.write_mode(raw, 0x00);
+//       for (;;) {
+//           auto r = co_await rd.inventory2(2000);
+//           co_await rd.buzzer(0x01, r.items.empty() ? 0x01 : 0x00);
+//           co_await loop.sleep_for(std::chrono::milliseconds(100));
+//       }
+//   }
+//   tr3::EventLoop loop; tr3::AsyncReader rd(loop, "/dev/ttyUSB0", 19200);
+//   rd.open(); loop.spawn(workflow(loop, rd)); loop.run();
+//
+// AsyncReader・タスクは EventLoop と同じスレッドで使い、EventLoop より先に破棄すること。
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "command_engine.hpp"
+#include "coro_task.hpp"
+#include "frame_parser.hpp"
+#include "serial_port.hpp"
+
+namespace tr3 {
+
+class AsyncReader;
+
+// ───────────────────────────────────
+// イベントループ
+// ───────────────────────────────────
+class EventLoop {
+public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    EventLoop();
+    ~EventLoop();   // 終わっていないタスクは破棄する
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool ok() const { return epfd_ >= 0; }
+    std::string last_error() const { return last_error_; }
+
+    // タスクを登録する（run() の中で開始する）
+    void spawn(Task<void> t);
+    // 全タスクが終わるか stop() されるまで回す
+    void run();
+    // 他スレッド・シグナルハンドラからも呼べる
+    void stop();
+
+    size_t live_tasks() const { return live_.size(); }
+
+    // co_await loop.sleep_for(ms)：::Sleep の代わり（他のタスクは止まらない）
+    auto sleep_for(std::chrono::milliseconds d) {
+        struct Awaiter {
+            EventLoop* loop;
+            time_point when;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop->add_timer(when, h, nullptr, 0); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this, clock::now() + d};
+    }
+
+private:
+    friend class AsyncReader;
+
+    struct Timer {
+        time_point              when;
+        uint64_t                seq;
+        std::coroutine_handle<> h;        // sleep_for
+        AsyncReader*            reader;   // 要求の期限（op が変わっていれば無視）
+        uint64_t                op;
+        bool operator>(const Timer& o) const { return when != o.when ? when > o.when : seq > o.seq; }
+    };
+
+    struct Driver;
+    static Driver drive(Task<void> t);
+
+    void     add_timer(time_point when, std::coroutine_handle<> h, AsyncReader* r, uint64_t op);
+    void     post(std::coroutine_handle<> h) { ready_.push_back(h); }
+    uint64_t next_op() { return ++op_seq_; }
+    bool     watch(AsyncReader* r, int fd);
+    void     unwatch(int fd);
+
+    int                                epfd_   = -1;
+    int                                wakefd_ = -1;
+    std::atomic<bool>                  stop_{false};
+    uint64_t                           seq_    = 0;
+    uint64_t                           op_seq_ = 0;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::vector<std::coroutine_handle<>> ready_;     // 次の周回で再開する
+    std::unordered_set<void*>          live_;        // 実行中のタスク（spawn の駆動コルーチン）
+    std::unordered_set<AsyncReader*>   readers_;     // 生存中のリーダ（期限タイマの宛先の確認）
+    std::string                        last_error_;
+};
+
+// ───────────────────────────────────
+// リーダ
+// ───────────────────────────────────
+struct AsyncReaderStats {
+    uint64_t requests    = 0;
+    uint64_t timeouts    = 0;
+    uint64_t nacks       = 0;
+    uint64_t unsolicited = 0;   // 応答待ちでないときに届いたフレーム（捨てる）
+    uint64_t bytes_rx    = 0;
+};
+
+class AsyncReader {
+public:
+    AsyncReader(EventLoop& loop, std::string port, uint32_t baud, size_t rx_capacity = 1024);
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    bool open();
+    void close();   // 待っている要求は Cancelled で再開する
+    bool is_open() const { return sp_.is_open(); }
+
+    // 要求を送り、応答・タイムアウトまで待つ。前の要求を待っている間に呼ぶと Cancelled
+    auto request(Command c) {
+        struct Awaiter {
+            AsyncReader* rd;
+            Command      cmd;
+            CommandReply reply;   // 待っている間はコルーチンフレーム内にあり、完了時に書き込まれる
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) { return rd->begin(std::move(cmd), h, &reply); }
+            CommandReply await_resume() { return std::move(reply); }
+        };
+        return Awaiter{this, std::move(c), {}};
+    }
+
+    // 同期 API（tr3_protocol.hpp）と同じ形の操作
+    Task<std::string>     rom_version(uint32_t timeout_ms = 600);     // 失敗時は空
+    Task<bool>            read_mode(ReaderModeRaw& out, uint32_t timeout_ms = 600);
+    Task<bool>            write_mode(const ReaderModeRaw& current, uint8_t new_mode, uint32_t timeout_ms = 600);
+    Task<bool>            buzzer(uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms = 600);
+    Task<InventoryResult> inventory2(uint32_t timeout_ms = 1500);
+
+    SerialPort&             port()        { return sp_; }
+    const AsyncReaderStats& stats() const { return stats_; }
+    std::string             last_error() const { return sp_.last_error(); }
+
+private:
+    friend class EventLoop;
+
+    bool begin(Command c, std::coroutine_handle<> h, CommandReply* out);   // false なら待たずに再開（out に結果）
+    void on_readable();
+    void on_deadline(uint64_t op, EventLoop::time_point now);
+    void finish(ReplyStatus st);
+    void arm_timer();
+
+    EventLoop&               loop_;
+    SerialPort               sp_;
+    FrameParser              parser_;
+    FrameParserStats         parser_last_;
+    RequestState             rq_;
+    std::coroutine_handle<>  waiter_;           // 応答を待っているコルーチン
+    CommandReply*            out_ = nullptr;    // waiter_ の結果の書き込み先
+    uint64_t                 op_  = 0;          // 要求の通し番号（ループ内で一意。古いタイマの判別）
+    EventLoop::time_point    armed_{};          // 登録済みタイマのうち最も早い時刻
+    AsyncReaderStats         stats_;
+};
+
+} // namespace tr3
@@ -0,0 +1,79 @@
+#pragma once
+// 通信速度の自動判定と切り替え
+//   ・probe_baud   : ポートを候補の速度で順に開き直し、ROM 要求に応答する速度を探す
+//   ・upgrade_baud : リーダの通信速度ビットを書き換えて最速（既定 115200）へ上げ、開き直して確かめる。
+//                    新しい速度で応答しなければ元の速度へ戻し、それも駄目なら全速度を探し直す
+// どちらもポート 1 本だけを触り共有状態を持たないので、複数ポートを別スレッドで同時に探索できる。
+//
+//   tr3::SerialPort sp(port, 19200);
+//   tr3::BaudProbeResult pr;
+//   if (tr3::probe_baud(sp, pr)) {                       // sp は見つかった速度で開いたまま
+//       tr3::ReaderModeRaw raw; tr3::ReaderModePretty pretty;
+//       tr3::read_reader_mode(sp, raw, pretty);
+//       tr3::BaudUpgradeResult ur;
+//       tr3::upgrade_baud(sp, raw, ur);                   // 失敗しても sp は通信できる速度で開いている
+//   }
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serial_port.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// 探索
+// ───────────────────────────────────
+// 探索順：hint（前回の速度など。0 なら無し）→ 19200（工場出荷値）→ 115200（upgrade_baud の既定の行き先）
+//         → 38400 → 9600。リーダの通信速度ビットで表せない速度（57600 など）は含めない
+std::vector<uint32_t> baud_probe_order(uint32_t hint = 0);
+
+// 開いているポートで ROM 要求を 1 回送り、正しい ACK が返るか確かめる（成功時 version に表示形式）
+//   速度違いの試行でログ・計測値（タイムアウト数）を汚さないよう、送受信ログと metrics() には記録しない
+//   stray には ACK までに届いた他のフレーム（自律動作モードの UID など）の数を返す
+bool ping_rom(Transport& sp, uint32_t timeout_ms, std::string* version = nullptr, size_t* stray = nullptr);
+
+struct BaudProbeResult {
+    bool                  ok = false;
+    uint32_t              baud = 0;        // 応答した速度
+    std::string           rom_version;
+    std::vector<uint32_t> tried;           // 試した順
+    uint32_t              elapsed_ms = 0;
+    std::string           error;
+};
+
+// 成功時 sp は応答した速度で開いたまま。失敗時は閉じて元の速度設定に戻す
+bool probe_baud(SerialPort& sp, BaudProbeResult& out, uint32_t hint = 0, uint32_t timeout_ms = 150);
+
+// ───────────────────────────────────
+// 切り替え
+// ───────────────────────────────────
+struct BaudUpgradeOptions {
+    uint32_t target         = 115200;
+    uint32_t settle_ms      = 50;     // 開き直してから最初の要求までの待ち（リーダ側の切り替え時間）
+    uint32_t verify_tries   = 3;      // 新しい速度での ROM 確認の回数
+    uint32_t verify_timeout = 150;
+    uint32_t measure_cycles = 3;      // 前後で Inventory2 を何回測るか（0 なら測らない）
+    uint32_t inventory_timeout_ms = 2000;
+};
+
+struct BaudUpgradeResult {
+    bool        ok        = false;   // target で通信できることを確かめた
+    bool        fell_back = false;   // 切り替えに失敗し、別の速度で通信を取り戻した
+    uint32_t    from      = 0;
+    uint32_t    to        = 0;       // 終了時に sp が開いている速度（0 = どの速度でも応答なし）
+    std::string error;
+    // Inventory2 1 回あたりの実測時間（ms。measure_cycles=0 なら 0）
+    double      cycle_ms_before = 0;
+    double      cycle_ms_after  = 0;
+    size_t      uids            = 0;  // 切り替え前の計測で見えたタグ数（理論値の計算用）
+};
+
+// current は read_reader_mode の結果（モード・各種設定パラメータは維持する）。sp は開いていること
+bool upgrade_baud(SerialPort& sp, const ReaderModeRaw& current, BaudUpgradeResult& out,
+                  const BaudUpgradeOptions& opt = {});
+
+// Inventory2 1 回の回線上の伝送時間（理論値・ms）：要求 + ACK + UID 応答 uids 件（8N1）
+double inventory_wire_ms(uint32_t baud, size_t uids);
+
+} // namespace tr3
@@ -0,0 +1,142 @@
+#pragma once
+// シリアル通信のバイナリキャプチャ（記録と読み出し）
+//
+// ファイル形式（リトルエンディアン、追記のみ）
+//   [CaptureFileHeader 32B]
+//   [CaptureChunkHeader 16B][記録...]  ← チャンク単位でまとめて書く
+//   [CaptureChunkHeader 16B][記録...]
+//   ...
+//   記録 = [CaptureRecordHeader 12B][生バイト len][0 埋めで 8 バイト境界まで]
+//
+// ・時刻はファイル先頭の単調時計（t0_mono_ns）からの経過 ns。壁時計は t0_wall_ns で対応付ける
+// ・チャンクは完成したものだけを書くので、途中で落ちても最後の未完チャンク以外は読める
+// ・読み出しはファイル全体をメモリマップし、記録をコピーせずに辿る
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+namespace tr3 {
+
+enum class CaptureDir : uint8_t { Tx = 0, Rx = 1 };   // Tx: ホスト→リーダ / Rx: リーダ→ホスト
+
+#pragma pack(push, 1)
+struct CaptureFileHeader {
+    char     magic[8];       // "TR3CAP\0\0"
+    uint16_t version;        // CAPTURE_VERSION
+    uint16_t reserved;
+    uint32_t baud;           // 記録時の回線速度（不明なら 0）
+    int64_t  t0_wall_ns;     // 記録開始時の壁時計（UNIX エポックからの ns）
+    int64_t  t0_mono_ns;     // 記録開始時の単調時計
+};
+struct CaptureChunkHeader {
+    uint32_t magic;          // CAPTURE_CHUNK_MAGIC
+    uint32_t bytes;          // このヘッダに続く記録部のバイト数
+    uint32_t records;        // 記録数
+    uint32_t reserved;
+};
+struct CaptureRecordHeader {
+    int64_t  t_ns;           // t0_mono_ns からの経過
+    uint8_t  dir;            // CaptureDir
+    uint8_t  reserved;
+    uint16_t len;            // 生バイト数
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureFileHeader)   == 32, "ファイル形式");
+static_assert(sizeof(CaptureChunkHeader)  == 16, "ファイル形式");
+static_assert(sizeof(CaptureRecordHeader) == 12, "ファイル形式");
+
+inline constexpr uint16_t CAPTURE_VERSION     = 1;
+inline constexpr uint32_t CAPTURE_CHUNK_MAGIC = 0x4B4E4843u;   // "CHNK"
+
+inline constexpr size_t capture_record_size(size_t len) {
+    return (sizeof(CaptureRecordHeader) + len + 7) & ~size_t(7);
+}
+
+struct CaptureStats {
+    uint64_t records = 0;
+    uint64_t bytes   = 0;   // 生バイトの合計
+    uint64_t chunks  = 0;   // ファイルへ書いたチャンク数
+};
+
+// ───────────────────────────────────
+// 記録（SerialPort::set_capture() で送受信経路に差し込む）
+//   record() はスレッド安全。チャンクが一杯になるか flush_interval 経過でファイルへ書く
+// ───────────────────────────────────
+class CaptureWriter {
+public:
+    explicit CaptureWriter(size_t chunk_bytes = 64 * 1024);
+    ~CaptureWriter() { close(); }
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    bool open(const std::string& path, uint32_t baud);
+    void close();
+    bool is_open() const { return fp_ != nullptr; }
+
+    void record(CaptureDir dir, const uint8_t* data, size_t n);
+    void flush();
+
+    // この時間以上書いていなければ、チャンクが一杯でなくても書き出す（0 で無効）
+    void set_flush_interval_ms(uint32_t ms) { flush_interval_ns_ = int64_t(ms) * 1000000; }
+
+    CaptureStats stats() const;
+    std::string  last_error() const { return last_error_; }
+
+private:
+    void flush_locked();
+
+    mutable std::mutex   mu_;
+    std::FILE*           fp_ = nullptr;
+    std::vector<uint8_t> chunk_;             // 先頭に CaptureChunkHeader 分の領域を取る
+    size_t               used_    = 0;       // 記録部の使用バイト数
+    uint32_t             nrec_    = 0;
+    int64_t              t0_mono_ = 0;
+    int64_t              last_flush_ns_     = 0;
+    int64_t              flush_interval_ns_ = 1000000000;
+    CaptureStats         stats_;
+    std::string          last_error_;
+};
+
+// ───────────────────────────────────
+// 読み出し（メモリマップ、記録はマップ上を直接指す）
+// ───────────────────────────────────
+struct CaptureRecord {
+    int64_t        t_ns = 0;
+    CaptureDir     dir  = CaptureDir::Rx;
+    const uint8_t* data = nullptr;
+    size_t         len  = 0;
+};
+
+class CaptureReader {
+public:
+    bool open(const std::string& path);
+    void close() { map_.close(); pos_ = chunk_end_ = 0; }
+
+    const CaptureFileHeader& header() const { return hdr_; }
+
+    // 次の記録。末尾または壊れたチャンクに達したら false
+    bool next(CaptureRecord& out);
+    // 先頭の記録へ戻る
+    void rewind() { pos_ = chunk_end_ = sizeof(CaptureFileHeader); }
+
+    // 読み終えた位置で末尾が欠けていた（書き込み途中で終了したファイル）
+    bool truncated() const { return truncated_; }
+
+    std::string last_error() const { return last_error_; }
+
+private:
+    MappedFile        map_;
+    CaptureFileHeader hdr_{};
+    size_t            pos_       = 0;
+    size_t            chunk_end_ = 0;
+    bool              truncated_ = false;
+    std::string       last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,84 @@
+#pragma once
+// コマンドの一括送信
+//   ・積んだ要求フレームを 1 本の連続バッファにまとめ、1 回の write（USB の送信 1 トランザクション）で送る
+//   ・リーダは受信した要求を順に処理するので、応答は積んだ順に照合する（CommandEngine と共通の InFlightRequests）
+//   ・送るきっかけ：バイト数・コマンド数の上限（add() で）、最初に積んでからの遅れ（add() / flush_if_due()）、
+//     明示の flush() / execute()
+//   ・I/O スレッドを持たない同期 API。応答は execute() がまとめて受ける
+//
+//   CommandBatcher b(sp);
+//   b.add(cmd_buzzer(0x01, 0x00));
+//   b.add(cmd_read_mode());
+//   b.add(cmd_inventory2(2000));
+//   auto replies = b.execute();                 // 送信 1 回、応答は add() した順
+//   InventoryResult inv; reply_inventory(replies[2], inv);
+//
+// リーダの受信バッファを溢れさせないよう、max_bytes は既定で控えめにしている。
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "command_engine.hpp"
+
+namespace tr3 {
+
+struct BatchPolicy {
+    size_t   max_bytes    = 128;   // これを超えるなら先に積んだ分を送る
+    size_t   max_commands = 8;     // この数に達したら送る
+    std::chrono::microseconds max_delay{0};   // 最初に積んでからの最大の遅れ（0 = 遅れでは送らない）
+};
+
+struct CommandBatchStats {
+    uint64_t commands = 0;
+    uint64_t writes   = 0;   // write() の回数
+    uint64_t bytes    = 0;
+    uint64_t by_size  = 0;   // バイト数・コマンド数の上限で送った回数
+    uint64_t by_delay = 0;   // 遅れで送った回数
+    uint64_t lost     = 0;   // 後続の応答が先に合致し、応答が失われたとみなした要求
+    uint64_t unsolicited = 0;   // どの要求にも合わず捨てたフレーム
+};
+
+class CommandBatcher {
+public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    explicit CommandBatcher(Transport& sp, BatchPolicy policy = {});
+
+    CommandBatcher(const CommandBatcher&) = delete;
+    CommandBatcher& operator=(const CommandBatcher&) = delete;
+
+    // 積む。戻り値は execute() の結果での位置。ポリシーに達したらその場で送る
+    size_t add(Command c);
+    // 積んだ分を 1 回の write で送る（応答は execute() で受ける）。送るものが無ければ true
+    bool flush();
+    // 最初に積んでから max_delay を過ぎていれば送る（呼び出し側の空き時間に呼ぶ）
+    bool flush_if_due(time_point now = clock::now());
+    // 残りを送り、全ての応答（またはタイムアウト）を待って add() した順に返す
+    std::vector<CommandReply> execute();
+
+    size_t queued() const { return queue_.size(); }          // 未送信
+    size_t in_flight() const { return in_flight_.size(); }   // 送信済み・応答待ち
+    const BatchPolicy&       policy() const { return policy_; }
+    const CommandBatchStats& stats() const { return stats_; }
+
+private:
+    struct Slot {
+        RequestState rq;
+        size_t       index = 0;   // results_ の位置
+    };
+
+    void complete(Slot& s, ReplyStatus st);
+
+    Transport&                sp_;
+    BatchPolicy               policy_;
+    std::deque<Slot>          queue_;        // 未送信
+    size_t                    queued_bytes_ = 0;
+    time_point                t_first_{};    // 未送信の先頭を積んだ時刻
+    InFlightRequests<Slot>    in_flight_;    // 送信済み・応答待ち（送信順）
+    std::vector<CommandReply> results_;
+    std::vector<uint8_t>      buf_;          // 送信用の連続バッファ（使い回す）
+    CommandBatchStats         stats_;
+};
+
+} // namespace tr3
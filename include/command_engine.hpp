@@ -0,0 +1,321 @@
+#pragma once
+// 非同期コマンドエンジン
+//   ・送信と受信を 1 本の I/O スレッドで行い、届いたフレームを応答待ちの要求へ振り分ける
+//   ・submit() はすぐ戻り、完了は future またはコールバック（I/O スレッドから呼ぶ）で受け取る
+//   ・リーダは要求を順に処理するので応答は送信順に届く。先頭の要求に合わないフレームは
+//     後続の送信済み要求とコマンド／詳細コードで照合し（合えば先頭の応答は失われたとみなす）、
+//     どれにも合わなければ要求外フレーム（自律動作モードの UID など）として別に渡す
+//   ・max_in_flight > 1 なら応答を待たずに続けて送る（リーダ側の受信バッファに積まれる）。
+//     そのとき送信枠に入る要求はまとめて 1 回の write で送る
+//
+// 動作中（start〜stop）は同じ Transport を他から使わないこと。
+//
+//   CommandEngine eng(sp);
+//   eng.start();
+//   auto f_mode = eng.submit(cmd_read_mode());
+//   auto f_inv  = eng.submit(cmd_inventory2());
+//   eng.submit(cmd_buzzer(0x01, 0x00), [](const CommandReply& r) { ... });
+//   InventoryResult inv; reply_inventory(f_inv.get(), inv);
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_queue.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// 要求
+// ───────────────────────────────────
+enum class Expect : uint8_t {
+    None,         // 応答なし（送信できたら完了。ブザーの応答なし指定など）
+    Ack,          // ACK 1 フレーム
+    Inventory2,   // ACK(F0, UID数) → UID数分の 0x49
+};
+
+inline constexpr int16_t ACK_ANY   = -1;   // ACK のデータ部を照合しない
+inline constexpr int16_t ACK_EMPTY = -2;   // データ部なしの ACK（ブザー）
+
+struct Command {
+    std::vector<uint8_t> frame;
+    Expect   expect     = Expect::Ack;
+    int16_t  ack_detail = ACK_ANY;   // ACK のデータ部先頭（詳細コード）。ACK_ANY / ACK_EMPTY
+    uint32_t timeout_ms = 600;
+};
+
+Command cmd_rom_version(uint32_t timeout_ms = 600);
+Command cmd_read_mode(uint32_t timeout_ms = 600);
+// current が短い（4 バイト未満）ときは frame が空になり、submit すると WriteError で完了する
+Command cmd_write_mode(const ReaderModeRaw& current, uint8_t new_mode, uint32_t timeout_ms = 600);
+Command cmd_buzzer(uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms = 600);
+Command cmd_inventory2(uint32_t timeout_ms = 1500);
+// ISO 15693 ブロック読み書き（アドレス指定）。指定が不正なら frame が空（WriteError で完了）
+Command cmd_read_blocks(const Uid& uid, uint8_t first, uint8_t count, uint32_t timeout_ms = 600);
+Command cmd_write_blocks(const Uid& uid, uint8_t first, uint8_t count, const uint8_t* data, size_t n,
+                         uint32_t timeout_ms = 600);
+
+// f が Expect::Ack の要求 c に対する ACK か（コマンドと詳細コードで照合。NACK は含まない）
+bool ack_matches(const Command& c, const FrameView& f);
+
+// ───────────────────────────────────
+// 応答
+// ───────────────────────────────────
+enum class ReplyStatus : uint8_t { Ok, Nack, Timeout, WriteError, Cancelled };
+const char* reply_status_name(ReplyStatus s);
+
+struct CommandReply {
+    ReplyStatus status    = ReplyStatus::Timeout;
+    uint8_t     cmd       = 0;                // 要求のコマンド
+    uint8_t     nack_code = 0;
+    std::chrono::microseconds rtt{0};         // 送信〜最初の応答フレーム
+    std::vector<uint8_t> frames;              // この要求に振り分けた受信フレーム（受信順に連結）
+
+    bool ok() const { return status == ReplyStatus::Ok; }
+
+    // 受信フレームを順に辿る
+    template <class F>
+    void each_frame(F&& fn) const {
+        for (size_t off = 0; off + HEADER_LEN <= frames.size();) {
+            const size_t n = HEADER_LEN + frames[off + IDX_LEN] + FOOTER_LEN;
+            fn(FrameView{frames.data() + off, n});
+            off += n;
+        }
+    }
+};
+
+// 応答の読み出し（同期 API と同じ形へ）
+bool reply_rom_version(const CommandReply& r, std::string& out);       // "1.00 S"
+bool reply_reader_mode(const CommandReply& r, ReaderModeRaw& out);
+bool reply_inventory(const CommandReply& r, InventoryResult& out);     // NACK・タイムアウトは error_message へ
+bool reply_blocks(const CommandReply& r, std::vector<uint8_t>& out);  // 読み出したブロックデータ
+
+// 要求外のフレーム（pop_unsolicited 用）
+struct UnsolicitedFrame {
+    std::array<uint8_t, MAX_FRAME> bytes{};
+    uint16_t size = 0;
+    std::chrono::steady_clock::time_point t_mono{};
+    FrameView view() const { return FrameView{bytes.data(), size}; }
+};
+
+// ───────────────────────────────────
+// 1 要求分の応答の照合と蓄積（I/O を持たない。CommandEngine と AsyncReader が共用）
+// ───────────────────────────────────
+struct RequestState {
+    using time_point = std::chrono::steady_clock::time_point;
+    enum class Match { No, More, Done };
+
+    Command      cmd;
+    CommandReply reply;
+    time_point   t_sent{}, deadline{}, t_last{};
+    int  expected  = -1;    // Inventory2：ACK で通知された UID 数
+    int  received  = 0;
+    bool responded = false;
+
+    RequestState() = default;
+    explicit RequestState(Command c);
+
+    void  on_sent(time_point now);                          // 送信時刻と期限
+    Match match(const FrameView& f) const;                  // この要求への応答か（NACK は含まない）
+    void  on_frame(const FrameView& f, time_point now);     // match() が No 以外のフレームを取り込む
+    void  on_nack(uint8_t code, const FrameView& f, time_point now);
+
+    // 次に expired() を見る時刻（期限、または Inventory2 の無通信ギャップ）
+    time_point wake_at(std::chrono::microseconds gap) const;
+    // 期限・無通信ギャップに達していれば完了時の状態を st に入れて true
+    bool expired(time_point now, std::chrono::microseconds gap, ReplyStatus& st) const;
+    // 途中まで受けた Inventory2（後続の応答が先に来たら UID の欠けとして Ok で閉じる）
+    bool partial_inventory() const { return responded && cmd.expect == Expect::Inventory2; }
+
+    // 状態を確定し、タイムアウト・インベントリの計測を加える
+    void finish(ReplyStatus st);
+};
+
+// 送信する要求フレームのログと計測／送信エラーのログと計測（InFlightRequests::send から）
+void note_request_sent(const RequestState& rq);
+void note_write_error();
+
+// ───────────────────────────────────
+// 送信済み要求の列（送信順。I/O を持たない。CommandEngine と CommandBatcher が共用）
+//   ・一括送信：積んだ要求のフレームを連結して 1 回の write で送る
+//   ・照合：NACK は先頭の要求へ。他は送信順に照合し、後続の要求に合えば先の要求の応答は失われたとみなす
+//     （途中まで受けた Inventory2 は UID の欠けとして Ok で閉じる）
+//   T は RequestState rq を持つ型（コールバックや結果の位置を添える）。完了は complete(T&, ReplyStatus) で知らせる
+// ───────────────────────────────────
+template <class T>
+class InFlightRequests {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    bool   empty() const { return q_.empty(); }
+    size_t size() const { return q_.size(); }
+    T&     front() { return q_.front(); }
+
+    // batch を送って空にする。応答なし・送信エラーの要求はその場で完了し、他は送信済みとして積む。
+    // tx は連結に使うバッファ（呼び出し後は送ったバイト列）。送るものが無ければ true
+    template <class Complete>
+    bool send(Transport& sp, std::deque<T>& batch, std::vector<uint8_t>& tx, Complete&& complete) {
+        tx.clear();
+        for (auto& p : batch) {
+            const auto& f = p.rq.cmd.frame;
+            if (f.empty()) continue;
+            note_request_sent(p.rq);
+            tx.insert(tx.end(), f.begin(), f.end());
+        }
+        const bool ok = tx.empty() || sp.write(tx.data(), tx.size());
+        if (!ok) note_write_error();
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& p : batch) {
+            if (p.rq.cmd.frame.empty() || !ok)   { complete(p, ReplyStatus::WriteError); continue; }
+            if (p.rq.cmd.expect == Expect::None) { complete(p, ReplyStatus::Ok); continue; }
+            p.rq.on_sent(now);
+            q_.push_back(std::move(p));
+        }
+        batch.clear();
+        return ok;
+    }
+
+    // 受信フレームを振り分ける。どの要求にも合わなければ false（要求外）。応答が失われた要求の数を lost へ足す
+    template <class Complete>
+    bool dispatch(const FrameView& f, time_point now, uint64_t& lost, Complete&& complete) {
+        // NACK には要求を特定する情報がないので、送信順で先頭の要求へ
+        NackResponse nack;
+        if (decode_nack(f, nack)) {
+            if (q_.empty()) return false;
+            T done = pop();
+            done.rq.on_nack(nack.code, f, now);
+            complete(done, ReplyStatus::Nack);
+            return true;
+        }
+        for (size_t i = 0; i < q_.size(); ++i) {
+            const auto r = q_[i].rq.match(f);
+            if (r == RequestState::Match::No) continue;
+
+            // 先に送った要求の応答（の残り）はもう届かない（リーダは順に処理する）
+            for (size_t k = 0; k < i; ++k) {
+                T prev = pop();
+                if (prev.rq.partial_inventory()) { complete(prev, ReplyStatus::Ok); continue; }
+                ++lost;
+                complete(prev, ReplyStatus::Timeout);
+            }
+            q_.front().rq.on_frame(f, now);
+            if (r == RequestState::Match::Done) {
+                T done = pop();
+                complete(done, ReplyStatus::Ok);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // 先頭から期限・無通信ギャップに達した要求を完了する
+    template <class Complete>
+    void expire(time_point now, std::chrono::microseconds gap, Complete&& complete) {
+        ReplyStatus st;
+        while (!q_.empty() && q_.front().rq.expired(now, gap, st)) {
+            T done = pop();
+            complete(done, st);
+        }
+    }
+
+    // 全部を st で完了する（停止・切断）
+    template <class Complete>
+    void complete_all(ReplyStatus st, Complete&& complete) {
+        while (!q_.empty()) {
+            T done = pop();
+            complete(done, st);
+        }
+    }
+
+private:
+    T pop() {
+        T t = std::move(q_.front());
+        q_.pop_front();
+        return t;
+    }
+
+    std::deque<T> q_;
+};
+
+// ───────────────────────────────────
+// エンジン
+// ───────────────────────────────────
+struct CommandEngineConfig {
+    size_t   max_in_flight        = 1;     // 応答待ちのまま続けて送る数（1 = 応答を受けてから次を送る）
+    uint32_t idle_poll_ms         = 1;     // 送信枠が空いているときの受信の区切り（wake() 非対応のトランスポートのみ。
+                                           // 対応していれば submit() が待ちを打ち切るので区切らない）
+    size_t   unsolicited_capacity = 256;   // pop_unsolicited 用のキュー容量
+};
+
+struct CommandEngineStats {
+    uint64_t submitted   = 0;
+    uint64_t completed   = 0;
+    uint64_t timeouts    = 0;
+    uint64_t nacks       = 0;
+    uint64_t lost        = 0;   // 後続の応答が先に合致し、応答が失われたとみなした要求
+    uint64_t unsolicited = 0;   // 要求外のフレーム
+    uint64_t dropped     = 0;   // キュー満杯で捨てた要求外フレーム
+};
+
+class CommandEngine {
+public:
+    using ReplyCallback       = std::function<void(const CommandReply&)>;
+    using UnsolicitedCallback = std::function<void(const FrameView&)>;
+
+    explicit CommandEngine(Transport& sp, CommandEngineConfig cfg = {});
+    ~CommandEngine() { stop(); }
+
+    CommandEngine(const CommandEngine&) = delete;
+    CommandEngine& operator=(const CommandEngine&) = delete;
+
+    // I/O スレッドを開始する。cb を渡すと要求外フレームを I/O スレッドから直接渡す（空なら pop_unsolicited）
+    bool start(UnsolicitedCallback cb = {});
+    // I/O スレッドを止め、未完了の要求を Cancelled で完了させる
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // 要求を積む。動作中でなければ（start 前・stop 後）積まずに Cancelled で完了する
+    std::future<CommandReply> submit(Command c);
+    void submit(Command c, ReplyCallback cb);
+
+    bool pop_unsolicited(UnsolicitedFrame& out) { return unsolicited_.pop(out); }
+
+    CommandEngineStats stats() const;
+
+private:
+    struct Pending {
+        RequestState  rq;
+        ReplyCallback cb;
+    };
+
+    void io_loop();
+    void complete(Pending& p, ReplyStatus st);
+    void to_unsolicited(const FrameView& f, std::chrono::steady_clock::time_point now);
+
+    Transport&                   sp_;
+    CommandEngineConfig          cfg_;
+    UnsolicitedCallback          unsolicited_cb_;
+    SpscQueue<UnsolicitedFrame>  unsolicited_;
+
+    std::mutex                   mu_;         // queue_ を守る
+    std::deque<Pending>          queue_;      // 未送信
+    std::atomic<size_t>          queued_{0};
+    InFlightRequests<Pending>    in_flight_;  // 送信済み・応答待ち（I/O スレッドのみが触る）
+    std::vector<uint8_t>         tx_;         // 連結した送信フレーム（I/O スレッドのみ）
+
+    std::thread                  th_;
+    std::atomic<bool>            running_{false};
+    std::atomic<bool>            stop_req_{false};
+    std::atomic<bool>            idle_wait_{false};   // I/O スレッドが新しい要求を受信しながら待っている
+    std::atomic<uint64_t>        n_submitted_{0}, n_completed_{0}, n_timeouts_{0}, n_nacks_{0},
+                                 n_lost_{0}, n_unsolicited_{0}, n_dropped_{0};
+};
+
+} // namespace tr3
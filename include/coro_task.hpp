@@ -0,0 +1,106 @@
+#pragma once
+// コルーチンのタスク型（C++20。tr3_coro ターゲットでのみ使う）
+//   ・Task<T> は co_await されるまで開始しない（遅延開始）
+//   ・完了すると待っていた側へ直接制御を移す（対称転送。再帰が深くなってもスタックを消費しない）
+//   ・最上位のタスクは EventLoop::spawn() で起動する
+//
+//   tr3::Task<int> twice(int v) { co_return v * 2; }
+//   tr3::Task<void> job() { int x = co_await twice(21); ... }
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace tr3 {
+
+template <class T> class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr      error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            auto c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+    void rethrow_if_failed() { if (error) std::rethrow_exception(error); }
+};
+
+template <class T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+    Task<T> get_return_object() noexcept;
+    template <class U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    T take() { rethrow_if_failed(); return std::move(*value); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take() { rethrow_if_failed(); }
+};
+
+} // namespace detail
+
+template <class T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using handle_type  = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(handle_type h) : h_(h) {}
+    Task(Task&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Task& operator=(Task&& o) noexcept {
+        if (this != &o) { if (h_) h_.destroy(); h_ = std::exchange(o.h_, {}); }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { if (h_) h_.destroy(); }
+
+    bool valid() const { return bool(h_); }
+
+    // co_await：子タスクを開始し、完了したら結果を返す
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type h;
+            bool await_ready() noexcept { return !h || h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                h.promise().continuation = caller;
+                return h;
+            }
+            T await_resume() { return h.promise().take(); }
+        };
+        return Awaiter{h_};
+    }
+
+private:
+    handle_type h_;
+};
+
+namespace detail {
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+} // namespace detail
+
+} // namespace tr3
@@ -0,0 +1,164 @@
+#pragma once
+// 読み取りイベントの共有メモリ配信（POSIX のみ：shm_open + mmap）
+//   発行側（EventRingPublisher）が 1 件 32 バイトのイベントをリングへ書き、同じ機械の複数のプロセスが
+//   EventRingSubscriber でそれぞれの速さで読む（WMS 連携・ダッシュボード・監査ログなど）。
+//
+//   ・発行側は購読側を一切待たない（ロック・システムコールなし）。遅い購読側は追い越され、
+//     次の読み出しで取りこぼした件数（lost）を知る
+//   ・スロットごとの seq で書き込み中・上書き済みを判定する（seqlock）。購読側は共有メモリ上の
+//     イベントをそのまま参照でき（peek）、使い終えてから上書きされていなかったかを確かめる（advance）
+//   ・発行側は 1 スレッドから呼ぶ（受信ループ）。購読側はプロセス・スレッドごとに 1 つ持つ
+//
+//   発行側（受信ループ）                        購読側（別プロセス）
+//   EventRingPublisher pub;                     EventRingSubscriber sub;
+//   pub.open("/tr3_events");                    sub.open("/tr3_events");
+//   pub.publish(0, run_inventory2(sp));         RingEvent e;
+//                                               while (sub.next(e)) use(e);   // 無ければ false（待たない）
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "tag_tracker.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+enum class RingEventKind : uint8_t { Read = 0, Arrive = 1, Depart = 2 };   // 読み取り／在席の開始・終了
+const char* ring_event_kind_name(RingEventKind k);
+
+struct RingEvent {
+    uint64_t seq;             // 発行順の通し番号（1 から）
+    int64_t  t_wall_ns;       // 壁時計（UNIX エポックからの ns）
+    uint32_t reader_id;
+    uint8_t  kind;            // RingEventKind
+    uint8_t  dsfid;
+    uint16_t reserved;
+    uint8_t  uid[8];          // MSB→LSB
+};
+static_assert(sizeof(RingEvent) == 32, "共有メモリの形式");
+
+// ───────────────────────────────────
+// 共有メモリの形式
+//   [EventRingHeader 128B][EventRingSlot 64B × capacity]
+// ───────────────────────────────────
+struct alignas(64) EventRingHeader {
+    char     magic[8];                // "TR3RING\0"
+    uint16_t version;                 // EVENT_RING_VERSION
+    uint16_t slot_size;               // sizeof(EventRingSlot)
+    uint32_t capacity;                // スロット数（2 の冪）
+    int64_t  created_wall_ns;
+    int64_t  publisher_pid;
+    std::atomic<uint32_t> state;      // EVENT_RING_LIVE / EVENT_RING_CLOSED
+    uint32_t reserved[7];
+    alignas(64) std::atomic<uint64_t> head;   // 発行済みの件数（= 最後の seq）。購読側はここだけを見に来る
+};
+
+struct alignas(64) EventRingSlot {
+    std::atomic<uint64_t> seq;        // 書き終えたイベントの seq（0 = 書き込み中）
+    uint64_t  reserved;
+    RingEvent ev;
+};
+
+static_assert(sizeof(EventRingHeader) == 128, "共有メモリの形式");
+static_assert(sizeof(EventRingSlot)   == 64,  "共有メモリの形式");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "プロセス間で共有するのでロックフリーが必要");
+
+inline constexpr uint16_t EVENT_RING_VERSION = 1;
+inline constexpr uint32_t EVENT_RING_LIVE    = 1;
+inline constexpr uint32_t EVENT_RING_CLOSED  = 2;
+
+// ───────────────────────────────────
+// 発行側
+// ───────────────────────────────────
+class EventRingPublisher {
+public:
+    EventRingPublisher() = default;
+    ~EventRingPublisher() { close(); }
+
+    EventRingPublisher(const EventRingPublisher&) = delete;
+    EventRingPublisher& operator=(const EventRingPublisher&) = delete;
+
+    // name は "/tr3_events" の形。同名が残っていれば作り直す（古いものを開いている購読側には閉じたと見える）。
+    // capacity は 2 の冪に切り上げる
+    bool open(const std::string& name, size_t capacity = 65536);
+    // 閉じたことを購読側へ知らせ、名前を消す
+    void close();
+    bool is_open() const { return hdr_ != nullptr; }
+
+    // t_wall_ns = 0 なら現在時刻
+    void publish(uint32_t reader_id, RingEventKind kind, const Uid& uid, uint8_t dsfid, int64_t t_wall_ns = 0);
+    // 1 サイクル分の UID を Read として出す（head の更新は最後に 1 回）
+    void publish(uint32_t reader_id, const InventoryResult& r, int64_t t_wall_ns = 0);
+    // TagTracker の到着・離脱を出す
+    void publish(uint32_t reader_id, const TagEvent& e, int64_t t_wall_ns = 0);
+
+    uint64_t    published() const { return seq_; }
+    size_t      capacity() const  { return size_t(mask_ + 1); }
+    std::string last_error() const { return last_error_; }
+
+private:
+    void write_slot(uint32_t reader_id, RingEventKind kind, const Uid& uid, uint8_t dsfid, int64_t t);
+
+    std::string      name_;
+    void*            base_  = nullptr;
+    size_t           bytes_ = 0;
+    EventRingHeader* hdr_   = nullptr;
+    EventRingSlot*   slots_ = nullptr;
+    uint64_t         mask_  = 0;
+    uint64_t         seq_   = 0;   // 最後に書いた seq
+    std::string      last_error_;
+};
+
+// ───────────────────────────────────
+// 購読側
+// ───────────────────────────────────
+struct EventRingStats {
+    uint64_t received = 0;   // 読めたイベント数
+    uint64_t lost     = 0;   // 追い越されて読めなかったイベント数
+    uint64_t overruns = 0;   // 追い越された回数
+};
+
+class EventRingSubscriber {
+public:
+    EventRingSubscriber() = default;
+    ~EventRingSubscriber() { close(); }
+
+    EventRingSubscriber(const EventRingSubscriber&) = delete;
+    EventRingSubscriber& operator=(const EventRingSubscriber&) = delete;
+
+    // from_oldest = false なら開いた後に出たイベントから、true ならリングに残っている最古から読む
+    bool open(const std::string& name, bool from_oldest = false);
+    void close();
+    bool is_open() const { return hdr_ != nullptr; }
+
+    // 次のイベントをコピーする。無ければ false（待たない）
+    bool next(RingEvent& out);
+
+    // 次のイベントを共有メモリ上のまま返す（コピーしない）。無ければ nullptr。
+    // 使い終えたら advance() を呼ぶ。advance() が false なら使っている間に上書きされていたので、結果を捨てる
+    const RingEvent* peek();
+    bool advance();
+
+    // 未読の件数（追い越された分を含む）
+    uint64_t lag() const;
+    // 発行側が閉じた・いなくなった（作り直された場合は開き直す）
+    bool publisher_gone() const;
+
+    const EventRingStats& stats() const { return stats_; }
+    std::string last_error() const { return last_error_; }
+
+private:
+    void skip_to(uint64_t seq);
+
+    void*                  base_  = nullptr;
+    size_t                 bytes_ = 0;
+    const EventRingHeader* hdr_   = nullptr;
+    const EventRingSlot*   slots_ = nullptr;
+    uint64_t               mask_  = 0;
+    uint64_t               next_  = 1;   // 次に読む seq
+    const EventRingSlot*   peeked_ = nullptr;
+    EventRingStats         stats_;
+    std::string            last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,53 @@
+#pragma once
+// TR3 受信フレームの逐次パーサ
+//   ・固定容量バッファ（確保は構築時の1回のみ）
+//   ・STX の探索・SUM の計算は frame_scan のベクトル化カーネルを使う
+//   ・取り出したフレームはバッファ内を指す FrameView で返す（コピーなし）
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "tr3_frame.hpp"
+#include "frame_scan.hpp"
+
+namespace tr3 {
+
+struct FrameParserStats {
+    uint64_t frames            = 0;  // 取り出したフレーム数
+    uint64_t resyncs           = 0;  // STX 以外のバイトを読み飛ばした回数
+    uint64_t bytes_discarded   = 0;  // 読み飛ばしたバイト数
+    uint64_t checksum_failures = 0;  // verify_frame 失敗（1バイト進めて再同期）
+    uint64_t overflows         = 0;  // 空きが無く未処理データを破棄した回数
+};
+
+class FrameParser {
+public:
+    explicit FrameParser(size_t capacity = 4096);
+
+    // 受信領域を直接渡す（read_some の書き込み先にする）
+    //   uint8_t* p = parser.prepare(room); n = sp.read_some(p, room, ...); parser.commit(n);
+    // prepare()/feed() はバッファを書き換えるため、それ以前に得た FrameView は無効になる
+    uint8_t* prepare(size_t& room);
+    void     commit(size_t n);
+
+    // 外部バッファからコピーして投入（戻り値=取り込んだバイト数）
+    size_t feed(const uint8_t* src, size_t n);
+
+    // 完全なフレームを1つ取り出す。無ければ false
+    bool next(FrameView& out);
+
+    // 完全なフレームを全て取り出す（parse_frames による一括処理）。
+    // 索引の offset は戻り値のポインタからの位置。次の prepare()/feed() まで有効
+    const uint8_t* next_batch(FrameIndex& out);
+
+    void   reset();
+    size_t buffered() const { return tail_ - head_; }
+    const FrameParserStats& stats() const { return stats_; }
+
+private:
+    std::vector<uint8_t> buf_;
+    size_t head_ = 0;   // 未処理データの先頭
+    size_t tail_ = 0;   // 未処理データの末尾（次の書き込み位置）
+    FrameParserStats stats_;
+};
+
+} // namespace tr3
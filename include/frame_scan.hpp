@@ -0,0 +1,68 @@
+#pragma once
+// 受信バイト列からのフレーム一括抽出と、その下請けのベクトル化カーネル
+//   ・STX の探索と SUM（8 ビット加算）の計算を SSE2 / AVX2 で行う（無ければスカラ）
+//   ・使う命令セットは初回使用時に CPU を見て決める（set_simd_level で下げられる）
+//   ・parse_frames() は FrameParser::next() と同じ規則（偽 STX は 1 バイト進めて再同期）で
+//     バッファ全体を走査し、見つけたフレームの位置を索引として返す
+//
+// FrameParser（受信経路）・tr3_capdump（オフライン処理）・tr3_bench が共用する。
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tr3_frame.hpp"
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// 命令セットの選択
+// ───────────────────────────────────
+enum class SimdLevel : uint8_t { Scalar, Sse2, Avx2 };
+
+SimdLevel simd_supported();              // この CPU で使える最上位
+SimdLevel simd_level();                  // 現在使っているもの
+SimdLevel set_simd_level(SimdLevel lv);  // 使えるものに丸めて設定し、設定後の値を返す（計測・検証用）
+const char* simd_level_name(SimdLevel lv);
+
+// ───────────────────────────────────
+// カーネル
+// ───────────────────────────────────
+// [p, p+n) で最初の b の位置。無ければ nullptr（memchr と同じ）
+const uint8_t* find_byte(const uint8_t* p, size_t n, uint8_t b);
+
+// [p, p+n) の 8 ビット加算（calc_sum の実体）
+uint8_t sum_bytes(const uint8_t* p, size_t n);
+
+// p から need バイトのフレームを検証する（ETX・CR・SUM）。
+// readable は p から読んでよいバイト数（need 以上）。余裕があれば 1 回のロードでまとめて計算する
+bool check_frame_at(const uint8_t* p, size_t need, size_t readable);
+
+// ───────────────────────────────────
+// 一括抽出
+// ───────────────────────────────────
+struct FrameRef {
+    uint32_t offset = 0;   // 走査したバッファ先頭からの位置
+    uint16_t size   = 0;
+};
+
+struct FrameScanStats {
+    uint64_t frames            = 0;
+    uint64_t resyncs           = 0;  // STX 以外のバイトを読み飛ばした回数
+    uint64_t bytes_discarded   = 0;
+    uint64_t checksum_failures = 0;  // 偽の STX（ETX/CR/SUM 不一致）
+};
+
+struct FrameIndex {
+    std::vector<FrameRef> frames;
+    size_t                consumed = 0;   // 処理済みの位置（以降は末尾の不完全なフレーム）
+    FrameScanStats        stats;
+
+    void clear() { frames.clear(); consumed = 0; stats = FrameScanStats{}; }
+    FrameView view(const uint8_t* base, size_t i) const { return FrameView{base + frames[i].offset, frames[i].size}; }
+};
+
+// data[0, n) を走査してフレームを out.frames へ追加する（out は呼び出し前に clear しておく）。
+// 戻り値は out.consumed。残り（n - consumed バイト）は次の受信と連結して再度渡す。
+// 4 GiB を超えるバッファは分割して渡すこと（offset が 32 ビット）。
+size_t parse_frames(const uint8_t* data, size_t n, FrameIndex& out);
+
+} // namespace tr3
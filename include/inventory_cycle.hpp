@@ -0,0 +1,53 @@
+#pragma once
+// Inventory2 1サイクル分の受信状態（フレームを1つずつ与えて完了を判定する）
+// I/O を持たないため、同期ループ・パイプライン・イベント駆動のどこからでも使える。
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+// Inventory2 要求フレーム（F0 40 01：全タグ・応答あり）。毎サイクル同じなのでコンパイル時に作る
+inline constexpr auto INV2_REQUEST = make_frame_fixed(ADDR_DEFAULT, CMD_INV2, DETAIL_INV2_F0, uint8_t(0x40), uint8_t(0x01));
+
+class Inventory2Cycle {
+public:
+    enum class State { Pending, Done, Nack };
+
+    void reset() {
+        result_.items.clear();
+        result_.error_message.clear();
+        result_.expected_count = 0;
+        expected_ = -1;
+        state_ = State::Pending;
+    }
+
+    // フレームを1つ処理し、サイクルの状態を返す
+    State on_frame(const FrameView& f) {
+        if (state_ != State::Pending) return state_;
+        Inventory2Ack ack;
+        InventoryItem it;
+        NackResponse  nack;
+        if (decode_inventory2_ack(f, ack)) {
+            expected_ = ack.count;
+            result_.expected_count = expected_;
+        } else if (decode_uid_frame(f, it)) {
+            result_.items.push_back(it);
+        } else if (decode_nack(f, nack)) {
+            result_.error_message = nack_message(nack.code);
+            return state_ = State::Nack;
+        }
+        if (expected_ >= 0 && int(result_.items.size()) >= expected_) state_ = State::Done;
+        return state_;
+    }
+
+    State state() const { return state_; }
+    int   expected() const { return expected_; }   // ACK 未受信なら -1
+    InventoryResult&       result()       { return result_; }
+    const InventoryResult& result() const { return result_; }
+
+private:
+    InventoryResult result_;
+    int   expected_ = -1;
+    State state_    = State::Pending;
+};
+
+} // namespace tr3
@@ -0,0 +1,55 @@
+#pragma once
+// 読み取り結果の出力（テキスト／CSV／JSON Lines／バイナリ）
+//   1 UID（または到着・離脱 1 件）を 1 記録として書く。整形はスタック上で行い、まとめて fwrite する。
+//   ・text   : 時刻 リーダ サイクル 種別 UID DSFID
+//   ・csv    : time,t_wall_ns,reader,cycle,kind,uid,dsfid（先頭に見出し行）
+//   ・jsonl  : {"t_wall_ns":..,"reader":..,"cycle":..,"kind":"read","uid":"E0..","dsfid":"00"}
+//   ・binary : JournalRecord（32 バイト・リトルエンディアン）を並べたもの。seq は出力順の通し番号
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "tag_journal.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+enum class OutputFormat : uint8_t { Text, Csv, Jsonl, Binary };
+enum class OutputEmit   : uint8_t { Reads, Presence, All };   // 読み取り／到着・離脱／両方
+
+bool        parse_output_format(const std::string& s, OutputFormat& out);
+const char* output_format_name(OutputFormat f);
+bool        parse_output_emit(const std::string& s, OutputEmit& out);
+const char* output_emit_name(OutputEmit e);
+
+class InventoryOutput {
+public:
+    InventoryOutput() = default;
+    ~InventoryOutput() { close(); }
+
+    InventoryOutput(const InventoryOutput&) = delete;
+    InventoryOutput& operator=(const InventoryOutput&) = delete;
+
+    // path が空か "-" なら標準出力
+    bool open(const std::string& path, OutputFormat fmt);
+    void close();
+
+    void write(uint32_t reader_id, uint64_t cycle, JournalKind kind, const Uid& uid, uint8_t dsfid, int64_t t_wall_ns);
+    void write(uint32_t reader_id, uint64_t cycle, const InventoryResult& r, int64_t t_wall_ns);
+    // 溜めた分を書き出す（サイクルごとに呼ぶ）。書けなかったら false（読み手が閉じたなど）
+    bool flush();
+
+    uint64_t    records() const { return seq_; }
+    std::string last_error() const { return last_error_; }
+
+private:
+    std::FILE*   fp_  = nullptr;
+    bool         own_ = false;
+    OutputFormat fmt_ = OutputFormat::Text;
+    std::string  buf_;
+    uint64_t     seq_ = 0;
+    int64_t      cached_sec_ = INT64_MIN;   // 時刻の整形は秒が変わったときだけ
+    char         prefix_[32] = {};
+    std::string  last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,68 @@
+#pragma once
+// パイプライン化した Inventory2 ループ
+//   ・ACK で通知された UID 数が揃った時点で次の Inventory2 を送信する（無通信待ちを行わない）
+//   ・結果のコールバックは次サイクルの送信後に呼ぶ（ホスト側処理とリーダ側処理を重ねる）
+//   ・ブザーは応答なし（response_type=0x00）で送りっぱなしにする
+//   ・サイクル毎のレイテンシ（送信→完了）をヒストグラムに記録する
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "latency_histogram.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+enum class BuzzerPolicy : uint8_t {
+    Off,        // 鳴らさない
+    OnRead,     // タグ1件以上で鳴らす
+    Always,     // 毎サイクル（0件は別の音）
+};
+
+struct PipelineConfig {
+    uint32_t     cycle_timeout_ms = 1500;      // 1 サイクルの上限（通常はフレーム数の完了か無通信ギャップで終わる）
+    uint32_t     drain_ms         = 50;        // 打ち切り後、これだけ無通信が続くまで受信を捨ててから次を送る
+    BuzzerPolicy buzzer           = BuzzerPolicy::Off;
+    uint8_t      sound_found      = 0x00;      // ピー
+    uint8_t      sound_none       = 0x01;      // ピッピッピ
+};
+
+struct PipelineStats {
+    uint64_t cycles   = 0;   // 完了したサイクル数（タイムアウト・NACK を含む）
+    uint64_t timeouts = 0;
+    uint64_t gap_ends = 0;   // フレームが欠け、無通信ギャップで終えたサイクル（タイムアウトには数えない）
+    uint64_t nacks    = 0;
+    uint64_t uids     = 0;
+    double   elapsed_s = 0.0;
+    LatencyHistogram latency_us;   // 送信→完了（マイクロ秒）
+
+    double cycles_per_sec() const { return elapsed_s > 0 ? double(cycles) / elapsed_s : 0.0; }
+    double uids_per_sec()   const { return elapsed_s > 0 ? double(uids)   / elapsed_s : 0.0; }
+};
+
+class InventoryPipeline {
+public:
+    // cycle は 1 始まり。result はコールバック中のみ有効（次サイクルで再利用する）
+    using CycleCallback = std::function<void(uint64_t cycle, const InventoryResult& result)>;
+
+    explicit InventoryPipeline(Transport& sp, PipelineConfig cfg = {});
+
+    // cycles 回実行する（0 なら stop() まで）。戻り値は今回の実行の統計
+    PipelineStats run(uint64_t cycles, const CycleCallback& cb = {});
+
+    // 別スレッドから停止を要求する
+    void stop() { stop_req_.store(true, std::memory_order_release); }
+
+private:
+    bool send_inventory();
+    void drain_input();   // 打ち切ったサイクルの遅れて届く残りを捨てる
+
+    Transport&        sp_;
+    PipelineConfig    cfg_;
+    FixedFrame<2>     buz_found_;
+    FixedFrame<2>     buz_none_;
+    std::atomic<bool> stop_req_{false};
+};
+
+} // namespace tr3
@@ -0,0 +1,74 @@
+#pragma once
+// 連続インベントリ（ストリーミング）
+// リーダを自律動作モード（オートスキャン／連続インベントリ／RDLOOP）へ切り替え、
+// 非同期に届く UID レスポンス（0x49）をバックグラウンドスレッドで解析して
+// コールバックまたは SPSC キューで受け渡す。stop() で元の動作モードへ戻す。
+//
+// ストリーミング中（start〜stop の間）は同じ Transport を他から使わないこと。
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include "spsc_queue.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+enum class StreamMode : uint8_t {
+    AutoScan            = 0x01,  // オートスキャンモード
+    ContinuousInventory = 0x50,  // 連続インベントリモード
+    RdLoop              = 0x58,  // RDLOOPモード
+};
+
+struct InventoryEvent {
+    InventoryItem item;
+    std::chrono::steady_clock::time_point t_mono;  // 受信時刻（単調時計）
+    std::chrono::system_clock::time_point t_wall;  // 受信時刻（壁時計）
+    uint64_t seq = 0;                              // ストリーム内の通し番号
+};
+
+struct InventoryStreamStats {
+    uint64_t uids    = 0;  // 受信した UID レスポンス数
+    uint64_t other   = 0;  // UID 以外のフレーム数
+    uint64_t dropped = 0;  // キュー満杯で捨てた数（キュー利用時のみ）
+};
+
+class InventoryStream {
+public:
+    using Callback = std::function<void(const InventoryEvent&)>;
+
+    explicit InventoryStream(Transport& sp, size_t queue_capacity = 1024);
+    ~InventoryStream() { stop(); }
+
+    InventoryStream(const InventoryStream&) = delete;
+    InventoryStream& operator=(const InventoryStream&) = delete;
+
+    // 現在の動作モードを読み取って保存し、mode へ切り替えて受信スレッドを開始する。
+    // cb を渡すと受信スレッドから直接呼ぶ。空なら pop() で取り出す。
+    bool start(StreamMode mode, Callback cb = {}, uint32_t timeout_ms = 600);
+
+    // 受信スレッドを止め、start 時の動作モードへ戻す（戻せたら true）
+    bool stop(uint32_t timeout_ms = 600);
+
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // キューから1件取り出す（コールバック未指定時）
+    bool pop(InventoryEvent& out) { return queue_.pop(out); }
+
+    InventoryStreamStats stats() const;
+
+private:
+    void rx_loop();
+
+    Transport&                 sp_;
+    SpscQueue<InventoryEvent>  queue_;
+    Callback                   cb_;
+    ReaderModeRaw              saved_;
+    std::thread                th_;
+    std::atomic<bool>          running_{false};
+    std::atomic<bool>          stop_req_{false};
+    std::atomic<uint64_t>      n_uids_{0}, n_other_{0}, n_dropped_{0};
+};
+
+} // namespace tr3
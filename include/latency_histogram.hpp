@@ -0,0 +1,94 @@
+#pragma once
+// 対数線形バケットのレイテンシヒストグラム（HDR Histogram 風）
+//   ・2 のべき乗区間をさらに SUB_BUCKETS 等分（相対誤差 ≒ 1/SUB_BUCKETS 以下）
+//   ・単位はマイクロ秒、上限 2^MAX_EXP us（約 71 分）で飽和
+//   ・固定長配列のみ。記録時に確保しない
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+
+namespace tr3 {
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS    = 3;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BITS;   // 8
+    static constexpr unsigned MAX_EXP     = 32;
+    static constexpr size_t   BUCKETS     = (MAX_EXP - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t us) {
+        ++counts_[index_of(us)];
+        ++count_;
+        sum_ += us;
+        min_ = std::min(min_, us);
+        max_ = std::max(max_, us);
+    }
+
+    // p: 0〜100。該当バケットの上端を返す（記録が無ければ 0）
+    uint64_t percentile(double p) const {
+        if (count_ == 0) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(double(count_) * p / 100.0 + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(upper_of(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min()   const { return count_ ? min_ : 0; }
+    uint64_t max()   const { return max_; }
+    double   mean()  const { return count_ ? double(sum_) / double(count_) : 0.0; }
+
+    void merge(const LatencyHistogram& o) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts_[i] += o.counts_[i];
+        count_ += o.count_; sum_ += o.sum_;
+        min_ = std::min(min_, o.min_); max_ = std::max(max_, o.max_);
+    }
+    void reset() { *this = LatencyHistogram{}; }
+
+    // バケット単位の読み書き（集計用の atomic 版からの写しや、出力に使う）
+    uint64_t bucket(size_t i) const { return counts_[i]; }
+    uint64_t sum() const { return sum_; }
+    void add_bucket(size_t i, uint64_t n) {
+        if (n == 0) return;
+        counts_[i] += n; count_ += n;
+        min_ = std::min(min_, i ? upper_of(i - 1) + 1 : uint64_t(0));   // 最小値はバケット下端で近似
+    }
+    void add_totals(uint64_t sum, uint64_t max) { sum_ += sum; max_ = std::max(max_, max); }
+
+    // バケット番号の計算（下位 SUB_BUCKETS 未満はそのまま、以降は指数＋上位ビット）
+    static size_t index_of(uint64_t v) {
+        if (v < SUB_BUCKETS) return size_t(v);
+        unsigned exp = 63u - unsigned(clz64(v));                   // v の最上位ビット位置
+        if (exp >= MAX_EXP) return BUCKETS - 1;
+        const unsigned shift = exp - SUB_BITS;
+        const size_t   sub   = size_t((v >> shift) & (SUB_BUCKETS - 1));
+        return size_t(exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+    static uint64_t upper_of(size_t i) {
+        if (i < SUB_BUCKETS) return uint64_t(i);
+        const unsigned exp   = unsigned(i / SUB_BUCKETS) + SUB_BITS - 1;
+        const uint64_t sub   = uint64_t(i % SUB_BUCKETS);
+        const unsigned shift = exp - SUB_BITS;
+        return ((uint64_t(SUB_BUCKETS) + sub + 1) << shift) - 1;
+    }
+
+private:
+    static int clz64(uint64_t v) {
+        int n = 0;
+        for (uint64_t bit = uint64_t(1) << 63; !(v & bit); bit >>= 1) ++n;
+        return n;
+    }
+
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_   = 0;
+    uint64_t min_   = std::numeric_limits<uint64_t>::max();
+    uint64_t max_   = 0;
+};
+
+} // namespace tr3
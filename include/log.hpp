@@ -0,0 +1,58 @@
+#pragma once
+// 非同期ログ
+//   ・送受信ループからは生データ（単調時刻・タグ・フレームのバイト列）をリングへ積むだけ
+//   ・時刻の整形・16進変換・出力はバックグラウンドスレッドで行う
+//   ・レベルは実行時に切り替え可能。無効なレベルは atomic の読み出し1回で戻る
+//   ・リングが満杯のときは書き込み側を待たせず、その記録を捨てて数える
+//
+// 既定レベルは環境変数 TR3_LOG（off / error / info / trace）、未指定なら trace。
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace tr3 {
+
+enum class LogLevel : uint8_t {
+    Off   = 0,
+    Error = 1,   // 送信エラー・NACK など
+    Info  = 2,   // コメント行（[cmt]）
+    Trace = 3,   // 送受信フレーム（[send] / [recv]）
+};
+
+enum class LogTag : uint8_t { Send, Recv, Cmt };
+
+struct LogStats {
+    uint64_t records = 0;   // 出力した記録数
+    uint64_t dropped = 0;   // リング満杯で捨てた記録数
+};
+
+namespace detail {
+extern std::atomic<uint8_t> g_log_level;
+}
+
+inline bool log_enabled(LogLevel lv) {
+    return uint8_t(lv) <= detail::g_log_level.load(std::memory_order_relaxed);
+}
+void     set_log_level(LogLevel lv);
+LogLevel log_level();
+// "off" / "error" / "info" / "trace" を読む（それ以外は false）
+bool     parse_log_level(const char* s, LogLevel& out);
+
+// 出力先（既定 stdout）。切り替え前に積まれた分は新しい出力先へ出る
+void set_log_sink(std::FILE* fp);
+
+// フレームを16進で記録する（Trace）
+void log_frame(LogTag tag, const uint8_t* data, size_t n);
+
+// 文字列を記録する（長すぎる分は切り詰める）
+void log_text(LogLevel lv, LogTag tag, const char* text, size_t n);
+inline void log_text(LogLevel lv, LogTag tag, const std::string& s) { log_text(lv, tag, s.data(), s.size()); }
+
+// ここまでに積まれた記録が出力し終わるまで待つ（画面表示と順序を揃えたいとき）
+void log_flush();
+
+LogStats log_stats();
+
+} // namespace tr3
@@ -0,0 +1,36 @@
+#pragma once
+// SimReader を同一プロセス内で直接つなぐトランスポート（pty・スレッドなし）
+//   write() で SimReader に渡した応答を、その場で受信データとして read_some() から返す。
+//   回線速度・処理遅延は模擬しないので、プロトコル層自身の処理速度の測定に使う。
+//
+// max_chunk を指定すると 1 回の read_some() で返すバイト数をその範囲で乱数的に区切る
+// （ドライバが細切れに返す状況の再現）。
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "sim_reader.hpp"
+#include "transport.hpp"
+
+namespace tr3 {
+
+class LoopbackTransport : public Transport {
+public:
+    explicit LoopbackTransport(const SimConfig& cfg, size_t max_chunk = 0)
+        : sim_(cfg), max_chunk_(max_chunk), rng_(cfg.seed) {}
+
+    using Transport::write;
+    bool write(const uint8_t* data, size_t n) override;
+    size_t read_some(uint8_t* dst, size_t cap, clock::time_point deadline) override;
+
+    SimReader&       sim()       { return sim_; }
+    const SimReader& sim() const { return sim_; }
+
+private:
+    SimReader            sim_;
+    std::vector<uint8_t> rx_;          // 未読の応答
+    size_t               rx_pos_ = 0;
+    size_t               max_chunk_;
+    std::mt19937         rng_;
+};
+
+} // namespace tr3
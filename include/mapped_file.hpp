@@ -0,0 +1,72 @@
+#pragma once
+// ファイルマップ（読み取り専用 MappedFile／固定長の読み書き MappedWriteFile）
+//   Windows : CreateFileMapping / MapViewOfFile（mapped_file_win32.cpp）
+//   POSIX   : mmap（mapped_file_posix.cpp）
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tr3 {
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return opened_; }
+
+    const uint8_t* data() const { return data_; }
+    size_t         size() const { return size_; }
+
+    std::string last_error() const { return last_error_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t         size_ = 0;
+    bool           opened_ = false;   // 0 バイトのファイルはマップせずに開いた扱い
+#ifdef _WIN32
+    void* file_    = nullptr;   // HANDLE
+    void* mapping_ = nullptr;   // HANDLE
+#endif
+    std::string last_error_;
+};
+
+// 読み書きのファイルマップ（作成時に size まで確保し、大きさは変えない）
+//   書き込みはマップ上へのメモリ書き込みだけ。ディスクへ確実に書くのは sync() を呼んだとき
+class MappedWriteFile {
+public:
+    MappedWriteFile() = default;
+    ~MappedWriteFile() { close(); }
+
+    MappedWriteFile(const MappedWriteFile&) = delete;
+    MappedWriteFile& operator=(const MappedWriteFile&) = delete;
+
+    // path を作り直して size バイト（0 埋め）を確保・マップする。マップしたままファイル名を変えてよい
+    bool create(const std::string& path, size_t size);
+    void close();
+    bool is_open() const { return data_ != nullptr; }
+
+    uint8_t* data() const { return data_; }
+    size_t   size() const { return size_; }
+
+    // [offset, offset + n) をディスクへ書き出し、終わるまで待つ
+    bool sync(size_t offset, size_t n);
+
+    std::string last_error() const { return last_error_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t   size_ = 0;
+#ifdef _WIN32
+    void* file_    = nullptr;   // HANDLE
+    void* mapping_ = nullptr;   // HANDLE
+#endif
+    std::string last_error_;
+};
+
+} // namespace tr3
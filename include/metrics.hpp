@@ -0,0 +1,158 @@
+#pragma once
+// 常時有効の計測（カウンタ・コマンド別レイテンシヒストグラム）
+//   ・記録は relaxed の atomic 加算のみ（ロックなし・確保なし）。どのスレッドからでも呼べる
+//   ・snapshot() は別スレッドから随時取得できる（各値は個別に一貫、全体の同時性は保証しない）
+//   ・Prometheus テキスト／JSON へ変換し、ファイルへ書き出せる（MetricsExporter で定期出力）
+//
+// コマンド別の集計対象: 0x4F（ROM／動作モード読み取り）, 0x4E（動作モード書き込み）,
+//                        0x42（ブザー）, 0x78（Inventory2）。それ以外は other にまとめる。
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "frame_parser.hpp"
+#include "latency_histogram.hpp"
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// ヒストグラム（LatencyHistogram と同じバケットを atomic で持つ）
+// ───────────────────────────────────
+class AtomicHistogram {
+public:
+    void record(uint64_t us) {
+        counts_[LatencyHistogram::index_of(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        while (us > m && !max_.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+    }
+    LatencyHistogram snapshot() const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKETS> counts_{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+inline constexpr std::array<uint8_t, 4> METRIC_COMMANDS = {0x4F, 0x4E, 0x42, 0x78};
+inline constexpr size_t METRIC_SLOTS = METRIC_COMMANDS.size() + 1;   // 末尾が other
+
+struct CommandMetricsSnapshot {
+    uint8_t          cmd      = 0;      // other は 0
+    uint64_t         requests = 0;
+    uint64_t         acks     = 0;
+    uint64_t         nacks    = 0;
+    uint64_t         timeouts = 0;
+    LatencyHistogram rtt_us;            // 送信〜応答（ACK/NACK）受信
+};
+
+struct MetricsSnapshot {
+    int64_t  wall_ms           = 0;     // 取得時刻（UNIX エポックからの ms）
+    uint64_t bytes_sent        = 0;
+    uint64_t bytes_received    = 0;
+    uint64_t write_errors      = 0;
+    uint64_t frames            = 0;
+    uint64_t resyncs           = 0;
+    uint64_t bytes_discarded   = 0;
+    uint64_t checksum_failures = 0;
+    uint64_t overflows         = 0;
+    uint64_t uids              = 0;     // Inventory2 で受信した UID 数
+    LatencyHistogram inventory_cycle_us;                  // Inventory2 の送信〜完了
+    std::array<uint64_t, 256> nack_codes{};               // NACK エラーコード別
+    std::array<CommandMetricsSnapshot, METRIC_SLOTS> commands{};
+};
+
+// ───────────────────────────────────
+// 記録
+// ───────────────────────────────────
+class Metrics {
+public:
+    void add_sent(size_t n)      { bytes_sent_.fetch_add(n, std::memory_order_relaxed); }
+    void add_received(size_t n)  { bytes_received_.fetch_add(n, std::memory_order_relaxed); }
+    void add_write_error()       { write_errors_.fetch_add(1, std::memory_order_relaxed); }
+    void add_uids(size_t n)      { uids_.fetch_add(n, std::memory_order_relaxed); }
+
+    // パーサの統計の増分を加える（前回加えた値を last に保持する）
+    void add_parser(const FrameParserStats& now, FrameParserStats& last);
+
+    void on_request(uint8_t cmd)                    { slot(cmd).requests.fetch_add(1, std::memory_order_relaxed); }
+    void on_ack(uint8_t cmd, uint64_t rtt_us)       { auto& s = slot(cmd); s.acks.fetch_add(1, std::memory_order_relaxed); s.rtt.record(rtt_us); }
+    void on_nack(uint8_t cmd, uint8_t code, uint64_t rtt_us) {
+        auto& s = slot(cmd);
+        s.nacks.fetch_add(1, std::memory_order_relaxed);
+        s.rtt.record(rtt_us);
+        nack_codes_[code].fetch_add(1, std::memory_order_relaxed);
+    }
+    void on_timeout(uint8_t cmd)                    { slot(cmd).timeouts.fetch_add(1, std::memory_order_relaxed); }
+    void on_inventory_cycle(uint64_t us)            { inventory_cycle_.record(us); }
+
+    MetricsSnapshot snapshot() const;
+    void reset();
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> requests{0}, acks{0}, nacks{0}, timeouts{0};
+        AtomicHistogram       rtt;
+    };
+    static size_t slot_index(uint8_t cmd) {
+        for (size_t i = 0; i < METRIC_COMMANDS.size(); ++i) if (METRIC_COMMANDS[i] == cmd) return i;
+        return METRIC_SLOTS - 1;
+    }
+    Slot& slot(uint8_t cmd) { return slots_[slot_index(cmd)]; }
+
+    std::atomic<uint64_t> bytes_sent_{0}, bytes_received_{0}, write_errors_{0};
+    std::atomic<uint64_t> frames_{0}, resyncs_{0}, bytes_discarded_{0}, checksum_failures_{0}, overflows_{0};
+    std::atomic<uint64_t> uids_{0};
+    AtomicHistogram       inventory_cycle_;
+    std::array<std::atomic<uint64_t>, 256>  nack_codes_{};
+    std::array<Slot, METRIC_SLOTS>          slots_{};
+};
+
+// プロセス全体で共有する計測値
+Metrics& metrics();
+
+// ───────────────────────────────────
+// 出力
+// ───────────────────────────────────
+enum class MetricsFormat : uint8_t { Prometheus, Json };
+
+std::string to_prometheus(const MetricsSnapshot& s);
+std::string to_json(const MetricsSnapshot& s);
+std::string metrics_text(MetricsFormat fmt);   // 現在値を取得して変換する
+
+// 一時ファイルへ書いてから置き換える（読み手が書きかけを見ない）
+bool write_metrics_file(const std::string& path, MetricsFormat fmt, std::string* err = nullptr);
+
+// 定期的にファイルへ書き出すスレッド
+class MetricsExporter {
+public:
+    MetricsExporter() = default;
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    bool start(std::string path, MetricsFormat fmt, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    void stop();   // 停止時に最後の 1 回を書く
+
+    std::string last_error() const;
+
+private:
+    void run();
+
+    std::string               path_;
+    MetricsFormat             fmt_ = MetricsFormat::Prometheus;
+    std::chrono::milliseconds interval_{1000};
+    std::thread               th_;
+    mutable std::mutex        mu_;
+    std::condition_variable   cv_;
+    bool                      quit_ = false;
+    std::string               last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,39 @@
+#pragma once
+// 計測値をローカルソケットで公開する（POSIX のみ：UNIX ドメインソケット）
+//   接続ごとに現在値を 1 回書いて閉じる。要求の内容は読まない。
+//     例: socat - UNIX-CONNECT:/tmp/tr3.sock
+//   受け付けは専用スレッドで行い、記録側（Metrics）には影響しない。
+#include <atomic>
+#include <string>
+#include <thread>
+#include "metrics.hpp"
+
+namespace tr3 {
+
+class MetricsSocketServer {
+public:
+    MetricsSocketServer() = default;
+    ~MetricsSocketServer() { stop(); }
+
+    MetricsSocketServer(const MetricsSocketServer&) = delete;
+    MetricsSocketServer& operator=(const MetricsSocketServer&) = delete;
+
+    bool start(const std::string& path, MetricsFormat fmt = MetricsFormat::Prometheus);
+    void stop();   // ソケットファイルも削除する
+
+    uint64_t    served() const { return served_.load(std::memory_order_relaxed); }
+    std::string last_error() const { return last_error_; }
+
+private:
+    void run();
+
+    std::string           path_;
+    MetricsFormat         fmt_    = MetricsFormat::Prometheus;
+    int                   fd_     = -1;
+    int                   wake_[2] = {-1, -1};   // stop() で accept 待ちを起こす
+    std::thread           th_;
+    std::atomic<uint64_t> served_{0};
+    std::string           last_error_;
+};
+
+} // namespace tr3
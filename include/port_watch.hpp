@@ -0,0 +1,34 @@
+#pragma once
+// シリアルポートの抜き差しの検出
+//   Linux   : inotify で /dev（ポートのあるディレクトリ）の作成・属性変更を待つ（port_watch_posix.cpp）
+//   Windows : QueryDosDevice でポート名の有無を短い間隔で確かめる（port_watch_win32.cpp）
+// 抜去は送受信側（Transport::disconnected()）で分かるので、ここでは再び現れるのを待つ。
+//
+//   tr3::PortWatcher w(sp.port_name());
+//   if (sp.disconnected()) { sp.close(); if (w.wait_present(std::chrono::seconds(30))) sp.open(); }
+#include <chrono>
+#include <string>
+
+namespace tr3 {
+
+class PortWatcher {
+public:
+    explicit PortWatcher(std::string port);
+    ~PortWatcher();
+
+    PortWatcher(const PortWatcher&) = delete;
+    PortWatcher& operator=(const PortWatcher&) = delete;
+
+    // デバイスが今あるか（POSIX では読み書きできる権限まで付いているか）
+    bool present() const;
+    // 現れるまで待つ（既にあれば即 true）。timeout を過ぎたら false
+    bool wait_present(std::chrono::milliseconds timeout);
+
+    const std::string& port() const { return port_; }
+
+private:
+    std::string port_;
+    int         fd_ = -1;   // inotify（Linux のみ）
+};
+
+} // namespace tr3
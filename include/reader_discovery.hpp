@@ -0,0 +1,52 @@
+#pragma once
+// リーダの自動検出（全シリアルポートを同時に探す）
+//   ・候補のポート（既定は enum_serial_ports() の全部）をポートごとのスレッドで同時に開き、
+//     probe_baud で ROM 要求（0x4F / 0x90）に応答する速度を探す。応答したら動作モードも読む
+//   ・1 ポートの中では速度を順に試すしかないが、ポート間は並行なので、全体の時間は
+//     「1 ポート分（速度の数 × probe_timeout_ms）」程度で済む（ポート数 × 速度の数 回待たない）
+//   ・プロファイルを渡すと、前回そのポートで使った速度から試す
+//
+//   auto found = tr3::discover_readers();
+//   for (const auto& r : found.readers) use(r.port, r.baud, r.rom_version, r.mode);
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "reader_profile.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+struct DiscoveryOptions {
+    std::vector<std::string> ports;               // 空なら enum_serial_ports()
+    uint32_t probe_timeout_ms = 150;              // 1 速度あたりの ROM 応答待ち
+    uint32_t mode_timeout_ms  = 300;              // 動作モードの読み取り
+    size_t   max_parallel     = 64;               // 同時に探すポート数の上限
+    const ProfileStore* profiles = nullptr;       // 前回の速度を先に試す（任意）
+};
+
+struct DiscoveredReader {
+    std::string   port;
+    uint32_t      baud = 0;
+    std::string   rom_version;
+    ReaderModeRaw mode;                           // 読めなかったら空（mode_ok = false）
+    bool          mode_ok    = false;
+    uint32_t      elapsed_ms = 0;                 // このポートの探索にかかった時間
+};
+
+struct DiscoveryFailure {
+    std::string port;
+    std::string error;
+};
+
+struct DiscoveryResult {
+    std::vector<DiscoveredReader> readers;        // 見つかったリーダ（ポートの並び順）
+    std::vector<DiscoveryFailure> failed;         // 開けない・応答しないポート
+    size_t   probed     = 0;                      // 探したポート数
+    uint32_t elapsed_ms = 0;                      // 全体の時間
+};
+
+// 全ポートを探し終えるまで戻らない。探索の間、各ポートは開かれ、終わると閉じる
+DiscoveryResult discover_readers(const DiscoveryOptions& opt = {});
+
+} // namespace tr3
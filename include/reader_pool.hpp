@@ -0,0 +1,102 @@
+#pragma once
+// 複数リーダの同時駆動（Linux / epoll）
+//   ・N 台のシリアルポートを 1 本の I/O スレッドで扱う（ポート毎のスレッドは作らない）
+//   ・各リーダの Inventory2 ループを状態機械として進め、受信は epoll、待ち時間は
+//     epoll_wait のタイムアウトで扱う（ビジーポーリングしない）
+//   ・全リーダの UID をリーダ ID・時刻付きの1本のストリームにまとめて渡す
+//   ・リーダ毎の稼働状態とスループットを別スレッドから参照できる
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+struct ReaderConfig {
+    std::string port;
+    uint32_t    baud             = 19200;
+    uint32_t    cycle_timeout_ms = 1500;   // 1 サイクルの上限（通常はフレーム数の完了か無通信ギャップで終わる）
+    uint32_t    interval_ms      = 0;      // サイクル間の休止（0=連続）
+    uint32_t    reconnect_ms     = 1000;   // 切断・オープン失敗時の再接続間隔
+    uint32_t    drain_ms         = 50;     // 打ち切り後、これだけ無通信が続くまで受信を捨ててから次を送る
+};
+
+struct PoolEvent {
+    uint32_t      reader_id = 0;
+    uint64_t      cycle     = 0;             // リーダ毎のサイクル番号（1 始まり）
+    InventoryItem item;
+    std::chrono::steady_clock::time_point t_mono;
+    std::chrono::system_clock::time_point t_wall;
+};
+
+struct ReaderHealth {
+    uint32_t    reader_id = 0;
+    std::string port;
+    bool        connected = false;
+    uint64_t    cycles    = 0;
+    uint64_t    uids      = 0;
+    uint64_t    timeouts  = 0;
+    uint64_t    gap_ends  = 0;      // フレームが欠け、無通信ギャップで終えたサイクル（タイムアウトには数えない）
+    uint64_t    nacks     = 0;
+    uint64_t    reconnects = 0;
+    uint64_t    bytes_rx  = 0;
+    uint64_t    checksum_failures = 0;
+    double      cycles_per_sec = 0.0;   // start() からの平均
+    double      uids_per_sec   = 0.0;
+    double      ms_since_last_cycle = -1.0;  // 直近の完了からの経過（未完了なら -1）
+};
+
+class ReaderPool {
+public:
+    using EventCallback = std::function<void(const PoolEvent&)>;
+
+    // cb は I/O スレッドから呼ばれる（重い処理はキュー等で別スレッドへ）
+    explicit ReaderPool(EventCallback cb);
+    ~ReaderPool();
+
+    ReaderPool(const ReaderPool&) = delete;
+    ReaderPool& operator=(const ReaderPool&) = delete;
+
+    // start() 前に追加する。戻り値はリーダ ID（0 始まり）
+    uint32_t add_reader(const ReaderConfig& cfg);
+
+    bool start();
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    size_t size() const { return readers_.size(); }
+    std::vector<ReaderHealth> health() const;
+
+    std::string last_error() const { return last_error_; }
+
+private:
+    struct Reader;
+    enum class CycleEnd { Complete, Gap, Timeout };   // Gap：フレームが欠けたまま無通信ギャップが空いた
+
+    void io_loop();
+    void try_open(Reader& r, std::chrono::steady_clock::time_point now);
+    void disconnect(Reader& r, std::chrono::steady_clock::time_point now);
+    void begin_cycle(Reader& r, std::chrono::steady_clock::time_point now);
+    void on_readable(Reader& r);
+    void update_due(Reader& r);   // 受信のたびに、サイクルを終える期限を決め直す
+    // Timeout：打ち切り。遅れて届く残りを捨て終えて（end_drain）から次を送る
+    void finish_cycle(Reader& r, std::chrono::steady_clock::time_point now, CycleEnd end = CycleEnd::Complete);
+    void end_drain(Reader& r, std::chrono::steady_clock::time_point now);
+
+    EventCallback                        cb_;
+    std::vector<std::unique_ptr<Reader>> readers_;
+    int                                  epfd_ = -1;
+    int                                  wakefd_ = -1;
+    std::thread                          th_;
+    std::atomic<bool>                    running_{false};
+    std::atomic<bool>                    stop_req_{false};
+    std::chrono::steady_clock::time_point t_start_;
+    std::string                          last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,56 @@
+#pragma once
+// リーダ毎の接続プロファイル（ポート・速度・ROM バージョン・動作モード）の保存と高速再接続
+//   ・起動時・再接続時は attach_cached() で ROM 要求 1 回だけ送り、同じリーダで設定が変わっていなければ
+//     動作モードの読み取り／書き込み／再読取りを省く
+//   ・電源の入れ直しで RAM の設定が戻った等で確認に失敗したら、呼び出し側で通常の手順（速度探索から）を行う
+//
+// 保存先は環境変数 TR3_PROFILE（未指定なら カレントディレクトリの tr3_reader.profile。空文字で無効）。
+// 1 行 1 台のタブ区切りテキスト：port, baud, ROM バージョン, 動作モード（16 進）, 保存時刻（UNIX 秒）
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serial_port.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+struct ReaderProfile {
+    std::string   port;
+    uint32_t      baud = 0;
+    std::string   rom_version;
+    ReaderModeRaw mode;           // 最後に確かめた動作モード（読み取り ACK のデータ部）
+    int64_t       saved_at = 0;   // UNIX 時刻（秒）
+};
+
+class ProfileStore {
+public:
+    explicit ProfileStore(std::string path) : path_(std::move(path)) {}
+
+    // ファイルが無ければ空のまま true。壊れた行は読み飛ばす
+    bool load();
+    // 一時ファイルへ書いてから置き換える（書き込み途中で落ちても前の内容が残る）
+    bool save();
+
+    const ReaderProfile* find(const std::string& port) const;
+    const ReaderProfile* latest() const;   // 最後に保存したもの（無ければ nullptr）
+    // 同じポートの記録は置き換える。saved_at は現在時刻にする
+    void put(ReaderProfile p);
+
+    bool enabled() const { return !path_.empty(); }
+    const std::string& path() const { return path_; }
+    std::string last_error() const { return last_error_; }
+
+private:
+    std::string                path_;
+    std::vector<ReaderProfile> items_;
+    std::string                last_error_;
+};
+
+// TR3_PROFILE の値（未指定なら "tr3_reader.profile"）
+std::string default_profile_path();
+
+// プロファイルの速度で開き、ROM 要求 1 回で同じリーダか確かめる。成功時 sp は開いたまま
+//   ROM バージョンが違う、ACK より前に UID などが届く（自律動作モードに戻っている）ときは false
+bool attach_cached(SerialPort& sp, const ReaderProfile& p, uint32_t timeout_ms = 100);
+
+} // namespace tr3
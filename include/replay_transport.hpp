@@ -0,0 +1,68 @@
+#pragma once
+// キャプチャの再生トランスポート
+//   capture.hpp の記録を読み、communicate() / run_inventory2() 等へ受信データとして返す。
+//   ・write() は記録中の次の送信（Tx）と突き合わせ、その時刻を再生の基準にする
+//   ・受信（Rx）は基準からの経過時間どおりに返す（Original）か、待たずに返す（Max）
+//   ・記録上まだ送信されていない位置に来たら、ホストが write() するまで受信なしとして扱う
+//
+// 単一スレッドから使うこと（write と read_some を別スレッドから呼ばない）。
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "capture.hpp"
+#include "transport.hpp"
+
+namespace tr3 {
+
+enum class ReplaySpeed : uint8_t {
+    Original,   // 記録時の受信間隔を再現する
+    Max,        // 待たずに返す（オフラインでの性能測定用）
+};
+
+struct ReplayStats {
+    uint64_t tx_matched    = 0;   // 記録と同じバイト列の送信
+    uint64_t tx_mismatched = 0;   // 記録と異なるバイト列の送信
+    uint64_t tx_unexpected = 0;   // 記録に対応する送信が残っていない
+    uint64_t rx_records    = 0;   // 返し終えた受信記録数
+};
+
+class ReplayTransport : public Transport {
+public:
+    ReplayTransport(std::string path, ReplaySpeed speed = ReplaySpeed::Original)
+        : path_(std::move(path)), speed_(speed) {}
+
+    bool open();
+    void rewind();                 // 先頭から再生し直す
+
+    using Transport::write;
+    bool write(const uint8_t* data, size_t n) override;
+    size_t read_some(uint8_t* dst, size_t cap, clock::time_point deadline) override;
+
+    uint32_t baud() const override { return reader_.header().baud; }
+
+    bool finished() const { return rx_pos_ >= recs_.size(); }
+    const ReplayStats& replay_stats() const { return rstats_; }
+    const CaptureReader& capture() const { return reader_; }
+    std::string last_error() const { return last_error_; }
+
+private:
+    clock::time_point due(const CaptureRecord& r) const {
+        return anchor_real_ + std::chrono::duration_cast<clock::duration>(
+                                  std::chrono::nanoseconds(r.t_ns - anchor_cap_ns_));
+    }
+
+    std::string                path_;
+    ReplaySpeed                speed_;
+    CaptureReader              reader_;
+    std::vector<CaptureRecord> recs_;          // 記録の索引（データはマップ上を指す）
+    size_t                     rx_pos_  = 0;   // 次に返す記録
+    size_t                     partial_ = 0;   // rx_pos_ の記録のうち返し済みのバイト数
+    size_t                     tx_pos_  = 0;   // 送信済みとみなした記録の次の位置
+    clock::time_point          anchor_real_{};
+    int64_t                    anchor_cap_ns_ = 0;
+    ReplayStats                rstats_;
+    std::string                last_error_;
+};
+
+} // namespace tr3
@@ -0,0 +1,53 @@
+#pragma once
+// 対話なしで動かすときの設定（コマンドライン・設定ファイル）
+//   tr3_usb --port /dev/ttyUSB0 --baud auto --rate 10 --format csv --output tags.csv
+//   tr3_usb --config /etc/tr3.conf [--format jsonl ...]   … ファイルを読んでから残りの引数で上書き
+//
+// 設定ファイルは 1 行 1 項目の "キー = 値"（# 以降は注釈）。キーは長いオプション名から -- を除いたもの。
+//   port = /dev/ttyUSB0
+//   baud = auto
+//   rate = 0            # 0 = 休まず連続
+//   format = jsonl
+//   journal = /var/lib/tr3/journal
+#include <cstdint>
+#include <string>
+#include "inventory_output.hpp"
+
+namespace tr3 {
+
+enum class BuzzerPolicy : uint8_t {
+    Never  = 0,   // 鳴らさない（既定。サイクルを詰めたいとき）
+    Found  = 1,   // タグがあったサイクルだけ「ピー」
+    Always = 2,   // 対話モードと同じ（あり「ピー」／なし・エラー「ピッピッピ」）
+};
+const char* buzzer_policy_name(BuzzerPolicy p);
+
+struct RunOptions {
+    std::string  port;                    // "auto" = 全ポートを同時に探す。空 = 前回のポート、駄目なら auto
+    uint32_t     baud        = 0;         // 0 = 自動（応答する速度を探し、最速へ切り替え）
+    uint64_t     cycles      = 0;         // 0 = 止めるまで
+    double       rate_hz     = 0;         // 1 秒あたりのサイクル数（0 = 休まず連続）
+    uint32_t     timeout_ms  = 2000;      // Inventory2 1 回の待ち
+    uint32_t     reader_id   = 0;         // 出力・ジャーナルに付けるリーダ番号
+    OutputFormat format      = OutputFormat::Text;
+    OutputEmit   emit        = OutputEmit::Reads;
+    std::string  output;                  // 空・"-" = 標準出力
+    BuzzerPolicy buzzer      = BuzzerPolicy::Never;
+    uint32_t     summary_sec = 10;        // 集計を標準エラーへ出す間隔（0 = 終了時だけ）
+    std::string  log;                     // off / error / info / trace（空 = TR3_LOG、未指定なら error）
+
+    // 空なら同名の環境変数（TR3_JOURNAL など）を使う
+    std::string  journal, events, capture, metrics, metrics_sock;
+};
+
+// argv[1..] を読む。--config があれば先にそのファイルを読み、残りの引数で上書きする。
+// --help なら help = true で戻る
+bool parse_run_args(int argc, char** argv, RunOptions& out, bool& help, std::string& error);
+// 設定ファイルを読んで out へ重ねる
+bool load_run_config(const std::string& path, RunOptions& out, std::string& error);
+// キー（-- を除いたオプション名）と値を 1 つ適用する
+bool apply_run_option(const std::string& key, const std::string& value, RunOptions& out, std::string& error);
+
+const char* run_usage();
+
+} // namespace tr3
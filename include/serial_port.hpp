@@ -1,32 +1,90 @@
 #pragma once
-// Windows 専用・簡易シリアルポートラッパ
+// 簡易シリアルポートラッパ
+//   Windows : Win32 API（serial_port_win32.cpp）
+//   POSIX   : termios（serial_port_posix.cpp）
+// どちらの実装を使うかは CMakeLists.txt で構成時に選択する
 #include <string>
 #include <vector>
 #include <chrono>
-#include <windows.h>
+#include <cstdint>
+#include "transport.hpp"
 
 namespace tr3 {
 
-class SerialPort {
+class CaptureWriter;
+
+class SerialPort : public Transport {
 public:
+#ifdef _WIN32
+    using native_handle_type = void*;   // HANDLE
+#else
+    using native_handle_type = int;     // ファイルディスクリプタ
+#endif
+
     SerialPort(std::string port_name, uint32_t baud)
-        : port_name_(std::move(port_name)), baud_(baud) {}
-    ~SerialPort() { close(); }
+        : port_name_(std::move(port_name)), baud_(baud) { open_wake(); }
+    ~SerialPort() override { close(); close_wake(); }
+
+    SerialPort(const SerialPort&) = delete;
+    SerialPort& operator=(const SerialPort&) = delete;
 
     bool open();
     void close();
-    bool write(const std::vector<uint8_t>& data);
+    bool is_open() const;
 
-    // 1バイト読み取り（個別タイムアウト）
-    bool read_byte(uint8_t& out, std::chrono::milliseconds per_byte_timeout);
+    using Transport::write;
+    bool write(const uint8_t* data, size_t n) override;
+    size_t read_some(uint8_t* dst, size_t cap, clock::time_point deadline) override;
+
+    const std::string& port_name() const { return port_name_; }
+    uint32_t baud() const override { return baud_; }
+    // 閉じている間だけ変更できる（次の open() から有効）。速度が変わるので学習済みの無通信ギャップは捨てる
+    bool set_baud(uint32_t baud) {
+        if (is_open()) { last_error_ = "ポートを開いたまま速度は変更できません"; return false; }
+        if (baud != baud_) gap_model().reset();
+        baud_ = baud;
+        return true;
+    }
+    native_handle_type native_handle() const { return h_; }
 
     std::string last_error() const { return last_error_; }
+    // 抜去などで送受信が致命的に失敗した（open() で解除）
+    bool disconnected() const override { return lost_; }
+
+#ifndef _WIN32
+    // POSIX は自己パイプを poll に加えて待ちを打ち切る（Win32 の ReadFile は打ち切れないので非対応）
+    void wake() override;
+    bool wakeable() const override { return wake_wr_ >= 0; }
+#endif
+
+    // 送受信したバイトをキャプチャへ記録する（nullptr で解除）。w はポートより長く生存させること
+    void set_capture(CaptureWriter* w) { capture_ = w; }
+
+protected:
+    void on_timings_changed() override;
 
 private:
+    void open_wake();    // wake() 用の資源（ポートの開閉とは別に、構築から破棄まで保持する）
+    void close_wake();
+
     std::string port_name_;
     uint32_t    baud_;
-    HANDLE      h_ = INVALID_HANDLE_VALUE;
+#ifdef _WIN32
+    native_handle_type h_ = reinterpret_cast<native_handle_type>(static_cast<intptr_t>(-1)); // INVALID_HANDLE_VALUE
+#else
+    native_handle_type h_ = -1;
+#endif
     std::string last_error_;
+    bool        lost_ = false;
+    CaptureWriter* capture_ = nullptr;
+#ifndef _WIN32
+    int         wake_rd_ = -1, wake_wr_ = -1;
+#endif
 };
 
+// 利用可能なシリアルポート名の列挙
+//   Windows : "COM1" 等
+//   POSIX   : "/dev/ttyUSB0", "/dev/ttyACM0" 等
+std::vector<std::string> enum_serial_ports();
+
 } // namespace tr3
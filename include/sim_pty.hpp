@@ -0,0 +1,58 @@
+#pragma once
+// SimReader を擬似端末（pty）上で動かす（POSIX のみ）
+// tr3_sim と tr3_bench が共用する。スレーブ側パスを SerialPort で開けば実機と同様に通信できる。
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include "sim_reader.hpp"
+
+namespace tr3 {
+
+struct PtySimOptions {
+    uint32_t baud       = 19200;  // 送信ペース（8N1 = 10 ビット/バイト）
+    bool     pace       = true;   // false ならボーレートによるペース制御をしない
+    uint32_t latency_us = 2000;   // コマンド受信から応答開始までの処理遅延
+    // 実機と同様に回線速度を照合する：クライアント側（スレーブ）の termios の速度がリーダの通信速度ビットと
+    // 違えば受信を捨てる。通信速度の書き込みで回線速度と送信ペースが切り替わる。初期値は baud から決める
+    bool     check_baud = false;
+};
+
+class PtySimulator {
+public:
+    PtySimulator(const SimConfig& cfg, const PtySimOptions& opt);
+    ~PtySimulator();
+
+    PtySimulator(const PtySimulator&) = delete;
+    PtySimulator& operator=(const PtySimulator&) = delete;
+
+    // pty を開いて応答スレッドを開始する
+    bool start();
+    void stop();
+
+    const std::string& slave_path() const { return slave_path_; }
+    const std::string& last_error() const { return last_error_; }
+
+    // stop() 後に参照すること（動作中は応答スレッドが更新する）
+    const SimReader& reader() const { return sim_; }
+    // check_baud 時に速度違いで捨てたバイト数（動作中も参照可）
+    uint64_t baud_mismatch_bytes() const { return mismatch_.load(std::memory_order_relaxed); }
+
+private:
+    void loop();
+    bool paced_write(const std::vector<uint8_t>& bytes);
+    bool line_matches() const;   // check_baud：クライアントの速度がリーダの通信速度と同じか
+
+    SimReader         sim_;
+    PtySimOptions     opt_;
+    int               master_ = -1;
+    int               keep_   = -1;   // スレーブ側を開いたままにする（EIO・エコー防止）
+    std::string       slave_path_;
+    std::string       last_error_;
+    std::thread       th_;
+    std::atomic<bool> stop_req_{false};
+    uint32_t          line_baud_ = 0;  // 送信ペース・照合に使う現在の回線速度
+    std::atomic<uint64_t> mismatch_{0};
+};
+
+} // namespace tr3
@@ -0,0 +1,88 @@
+#pragma once
+// TR3 リーダライタの模擬（シミュレータ）
+// 実機なしで tr3_protocol の送受信を試すための応答ロジック。I/O は持たず、
+// 受信バイト列を与えると返すべき応答バイト列を生成する（pty 等への接続は呼び出し側）。
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <unordered_map>
+#include <cstdint>
+#include "frame_parser.hpp"
+
+namespace tr3 {
+
+struct SimConfig {
+    size_t   tag_count       = 1;       // 視野内のタグ数（0〜1000）
+    uint32_t seed            = 1;       // UID 生成・ノイズ注入の乱数種
+    double   noise_rate      = 0.0;     // 応答フレームの前にゴミバイトを挿入する確率
+    double   sum_error_rate  = 0.0;     // 応答フレームの SUM を壊す確率
+    std::string rom_ascii    = "100S";  // ROM バージョン（ASCII。read_rom_version で "1.00 S"）
+    uint8_t  mode            = 0x00;    // 初期動作モード
+    uint8_t  flags           = 0x04;    // 初期の各種設定パラメータ（bit2=アンチコリジョン有効）
+    uint8_t  speed_bits      = 0x00;    // 通信速度ビット（bit6..7, 0b00=19200）
+    uint32_t scan_interval_ms = 50;     // 自律動作モードで UID を送出する周期
+    uint16_t tag_blocks      = 28;      // タグのユーザブロック数（ISO 15693 の読み書き用）
+    uint8_t  block_size      = 4;       // ブロック長（バイト）
+};
+
+struct SimStats {
+    uint64_t commands      = 0;  // 処理したコマンド数
+    uint64_t nacks         = 0;  // 返した NACK 数
+    uint64_t inventories   = 0;  // Inventory2 の実行回数
+    uint64_t uids_sent     = 0;  // 送出した UID フレーム数
+    uint64_t rx_sum_errors = 0;  // 受信側で検出した SUM エラー
+    uint64_t block_reads   = 0;  // ブロック読み出しコマンド数
+    uint64_t block_writes  = 0;  // ブロック書き込みコマンド数
+};
+
+class SimReader {
+public:
+    // Inventory2 の ACK で通知できる UID 数は 1 バイトのため、1 回の応答はこの数まで
+    static constexpr size_t MAX_UIDS_PER_CYCLE = 255;
+    static constexpr size_t MAX_TAGS           = 1000;
+
+    explicit SimReader(const SimConfig& cfg);
+
+    // ホストからの受信バイトを処理し、応答バイト列を out に追記する
+    void on_rx(const uint8_t* data, size_t n, std::vector<uint8_t>& out);
+
+    // 自律動作モード（オートスキャン／連続インベントリ／RDLOOP）なら周期毎に UID を out へ追記する
+    void on_tick(std::chrono::steady_clock::time_point now, std::vector<uint8_t>& out);
+    bool autonomous() const;
+    std::chrono::milliseconds scan_interval() const { return std::chrono::milliseconds(cfg_.scan_interval_ms); }
+
+    // 視野内のタグ数を変更（UID は seed から決定的に生成）
+    void set_tag_count(size_t n);
+
+    const std::vector<std::array<uint8_t, 8>>& tags() const { return tags_; }  // MSB→LSB
+    // タグ i のブロック b の先頭（範囲外は nullptr）
+    const uint8_t* block(size_t i, size_t b) const;
+    uint8_t mode() const { return mode_; }
+    uint8_t flags() const { return flags_; }
+    uint8_t speed_bits() const { return speed_bits_; }   // bit6..7（baud_from_speed_bits で bps へ）
+    const SimStats& stats() const { return stats_; }
+
+private:
+    void handle(const FrameView& f, std::vector<uint8_t>& out);
+    void emit(uint8_t cmd, const std::vector<uint8_t>& payload, std::vector<uint8_t>& out);
+    void emit_nack(uint8_t code, std::vector<uint8_t>& out);
+    void emit_uids(size_t n, std::vector<uint8_t>& out);
+    void handle_blocks(const FrameView& f, std::vector<uint8_t>& out);
+
+    SimConfig   cfg_;
+    FrameParser parser_;
+    std::mt19937 rng_;
+    std::vector<std::array<uint8_t, 8>> tags_;
+    size_t      next_tag_ = 0;   // タグが多い場合の巡回開始位置
+    std::vector<uint8_t> mem_;   // タグ順 × tag_blocks × block_size
+    std::unordered_map<uint64_t, size_t> index_;   // UID（MSB が上位）→ タグ番号
+    uint8_t     mode_;
+    uint8_t     flags_;
+    uint8_t     speed_bits_;
+    SimStats    stats_;
+    std::chrono::steady_clock::time_point next_scan_{};
+};
+
+} // namespace tr3
@@ -0,0 +1,50 @@
+#pragma once
+// 単一生産者・単一消費者のロックフリー固定長キュー
+//   ・push は生産者スレッドのみ、pop は消費者スレッドのみが呼ぶこと
+//   ・容量は 2 のべき乗に切り上げる。満杯なら push は false を返す（待たない）
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace tr3 {
+
+template <class T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+
+    bool push(T v) {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) > mask_) return false;   // 満杯
+        slots_[t & mask_] = std::move(v);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire)) return false;         // 空
+        out = std::move(slots_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};   // 消費者が進める
+    alignas(64) std::atomic<size_t> tail_{0};   // 生産者が進める
+};
+
+} // namespace tr3
@@ -0,0 +1,201 @@
+#pragma once
+// タグイベントのジャーナル（追記のみ・メモリマップしたセグメントファイル）
+//
+// ファイル形式（リトルエンディアン）
+//   DIR/<prefix><番号 8 桁>.seg … 作成時に segment_records 件分を確保した固定長ファイル
+//   [JournalSegmentHeader 64B][JournalRecord 32B × segment_records]
+//   DIR/<prefix>next.tmp       … コミットスレッドが先に作っておく予備。使い始めるときに番号を付けて改名する
+//
+// ・append() はマップ上へ 32 バイト書くだけで、システムコールを呼ばない（受信経路を止めない）
+// ・ディスクへの書き出しはコミットスレッドがまとめて行う（グループコミット）。
+//   前回から commit_interval 経過、または未コミットが commit_records 件に達したら msync する
+// ・セグメントが一杯になったら次へ切り替える。次のセグメントはコミットスレッドが先に作っておく。
+//   番号は使い始めたときに付けるので、番号順 = 書いた順。max_segments を超えたら古いものから消す
+// ・記録は seq（1 から通し番号）が期待どおりの間だけ有効とみなす。確保したままの 0 埋め部分や、
+//   コミット前に落ちて書きかけになった末尾は読み出しで自然に止まる。first_seq = 0 のセグメントは
+//   使い始める前のもので、記録を持たない
+//
+//   JournalWriter j;
+//   JournalOptions opt; opt.dir = "journal";
+//   if (!j.open(opt)) ...;
+//   j.append(/*reader_id=*/0, run_inventory2(sp));       // 受信経路から
+//   ...
+//   for (const auto& path : journal_segments("journal")) { JournalReader r; r.open(path); ... }
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapped_file.hpp"
+#include "tag_tracker.hpp"
+#include "tr3_protocol.hpp"
+
+namespace tr3 {
+
+enum class JournalKind : uint8_t { Read = 0, Arrive = 1, Depart = 2 };   // 読み取り／在席の開始・終了
+const char* journal_kind_name(JournalKind k);
+
+#pragma pack(push, 1)
+struct JournalSegmentHeader {
+    char     magic[8];        // "TR3JRNL\0"
+    uint16_t version;         // JOURNAL_VERSION
+    uint16_t record_size;     // sizeof(JournalRecord)
+    uint32_t reserved;
+    uint64_t segment;         // セグメント番号（ファイル名と同じ）
+    uint64_t first_seq;       // 先頭の記録の seq（0 = 未使用のセグメント）
+    uint64_t capacity;        // 確保した記録数
+    uint64_t committed;       // ディスクへ書き出し済みの記録数（コミットごとに更新）
+    int64_t  created_wall_ns; // 作成時の壁時計（UNIX エポックからの ns）
+    uint64_t reserved2;
+};
+struct JournalRecord {
+    uint64_t seq;             // 通し番号（0 = 未使用）
+    int64_t  t_wall_ns;       // 壁時計（UNIX エポックからの ns）
+    uint32_t reader_id;
+    uint8_t  kind;            // JournalKind
+    uint8_t  dsfid;
+    uint16_t reserved;
+    uint8_t  uid[8];          // MSB→LSB
+};
+#pragma pack(pop)
+
+static_assert(sizeof(JournalSegmentHeader) == 64, "ファイル形式");
+static_assert(sizeof(JournalRecord)        == 32, "ファイル形式");
+
+inline constexpr uint16_t JOURNAL_VERSION = 1;
+
+// ───────────────────────────────────
+// 書き込み
+// ───────────────────────────────────
+struct JournalOptions {
+    std::string dir             = "journal";
+    std::string prefix          = "tr3_";
+    size_t      segment_records = size_t(1) << 20;   // 1 セグメントの記録数（32 MiB）
+    size_t      max_segments    = 16;                // これを超えたら古いセグメントを消す（0 = 消さない）
+    std::chrono::milliseconds commit_interval{20};   // コミットの最大の遅れ
+    size_t      commit_records  = 8192;              // 未コミットがこの件数に達したらすぐコミット
+    bool        sync            = true;              // false なら msync せず OS の書き出しに任せる
+};
+
+struct JournalStats {
+    uint64_t appended  = 0;   // 書いた記録数
+    uint64_t committed = 0;   // ディスクへ書き出した記録数
+    uint64_t commits   = 0;   // コミット（msync）の回数
+    uint64_t segments  = 0;   // 作成したセグメント数
+    uint64_t removed   = 0;   // 古くなって消したセグメント数
+    uint64_t inline_rotations = 0;   // 次のセグメントが間に合わず append() の中で作った回数
+    uint64_t dropped   = 0;   // 開いていない・セグメントを作れず捨てた記録数
+    uint64_t max_commit_us = 0;      // 1 回のコミットにかかった最大時間
+};
+
+class JournalWriter {
+public:
+    JournalWriter() = default;
+    ~JournalWriter() { close(); }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // opt.dir を作り（既にあればそのまま）、既存の最後のセグメントの続きの番号・seq から書き始める。
+    // 落ちて残った未使用のセグメントは消す
+    bool open(const JournalOptions& opt);
+    // 残りをコミットして閉じる
+    void close();
+    bool is_open() const { return running_; }
+
+    // 記録を足す（スレッド安全）。t_wall_ns = 0 なら現在時刻
+    void append(uint32_t reader_id, JournalKind kind, const Uid& uid, uint8_t dsfid, int64_t t_wall_ns = 0);
+    // 1 サイクル分の UID を Read として足す
+    void append(uint32_t reader_id, const InventoryResult& r, int64_t t_wall_ns = 0);
+    // TagTracker の到着・離脱を足す
+    void append(uint32_t reader_id, const TagEvent& e, int64_t t_wall_ns = 0);
+
+    // ここまでに足した分をディスクへ書き出して戻る
+    bool commit();
+
+    JournalStats stats() const;
+    std::string  last_error() const;
+
+private:
+    struct Segment {
+        MappedWriteFile map;
+        std::string     path;
+        uint64_t        number = 0;
+        size_t          capacity = 0;
+        size_t          count  = 0;   // 書いた記録数（mu_）
+        size_t          synced = 0;   // 書き出した記録数（commit_mu_）
+        JournalSegmentHeader* header() { return reinterpret_cast<JournalSegmentHeader*>(map.data()); }
+        uint8_t*              records() { return map.data() + sizeof(JournalSegmentHeader); }
+    };
+    using SegmentPtr = std::shared_ptr<Segment>;
+
+    SegmentPtr create_segment(const std::string& path);
+    std::string segment_path(uint64_t number) const;
+    std::string spare_path() const;
+    bool       activate_locked(SegmentPtr seg);     // 番号を付けて cur_ にし、seq の起点を書く
+    bool       rotate_locked();
+    void       append_locked(JournalRecord rec);
+    void       commit_loop();
+    bool       commit_once();
+    bool       sync_segment(Segment& s, size_t upto);
+    void       remove_old();
+    void       set_error(const std::string& e);
+
+    JournalOptions          opt_;
+    mutable std::mutex      mu_;           // 下の cur_〜stats_ を守る
+    std::condition_variable cv_;
+    SegmentPtr              cur_, next_;
+    std::vector<SegmentPtr> retired_;      // 一杯になり、最後のコミット待ちのセグメント
+    uint64_t                next_seq_    = 1;
+    uint64_t                next_number_ = 0;   // 次に使い始めるセグメントの番号
+    size_t                  pending_     = 0;   // 未コミットの記録数（通知の判定用）
+    std::deque<std::string> files_;        // 消す順（古い順）のセグメント
+    JournalStats            stats_;
+    mutable std::mutex      err_mu_;
+    std::string             last_error_;
+
+    std::mutex              commit_mu_;    // コミットを 1 つずつにする
+    std::thread             th_;
+    bool                    running_  = false;
+    bool                    stop_req_ = false;
+};
+
+// ───────────────────────────────────
+// 読み出し（メモリマップ、先頭から順に）
+// ───────────────────────────────────
+class JournalReader {
+public:
+    bool open(const std::string& path);
+    void close() { map_.close(); pos_ = 0; }
+
+    const JournalSegmentHeader& header() const { return hdr_; }
+
+    // 次の記録。seq が途切れたら（未使用・書きかけ）false
+    bool next(JournalRecord& out);
+    // 使い始める前のセグメント（記録を持たない）
+    bool unused() const { return hdr_.first_seq == 0; }
+    void rewind() { pos_ = 0; }
+    size_t read_count() const { return pos_; }
+
+    std::string last_error() const { return last_error_; }
+
+private:
+    MappedFile           map_;
+    JournalSegmentHeader hdr_{};
+    size_t               pos_ = 0;   // 読んだ記録数
+    std::string          last_error_;
+};
+
+// dir 内のセグメントファイルを番号順に返す
+std::vector<std::string> journal_segments(const std::string& dir, const std::string& prefix = "tr3_");
+
+// セグメントを順に読み、1 記録 1 行の CSV（時刻,壁時計 ns,リーダ,種別,UID,DSFID,seq）で書き出す。書いた記録数を返す
+uint64_t export_journal_csv(const std::vector<std::string>& segments, std::FILE* out, std::string* error = nullptr);
+
+} // namespace tr3
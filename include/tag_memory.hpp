@@ -0,0 +1,125 @@
+#pragma once
+// タグメモリ（ISO 15693 のユーザブロック）の一括読み書き
+//   ・read_tag_blocks：インベントリで得た全 UID について同じ範囲のブロックを、アドレス指定の
+//     複数ブロック読み出しで読む。要求は CommandBatcher で max_commands 本ずつ 1 回の write にまとめる
+//   ・BlockCache：読んだブロックを UID と DSFID をキーに保持し、変わっていないタグは読み直さない
+//     （DSFID が変わったタグは記録を捨てて読み直す）。write_tag_blocks で書いた分も反映する
+//   ・他の装置が書き換えたことはここでは分からない。書き換える側で DSFID を変える運用にするか、
+//     max_age・invalidate() で読み直させる
+//
+// 読み出しの ACK にはタグを特定する情報がないので、応答は送信順で照合する。応答が 1 つ欠けると
+// 後続がずれるため、まとめて送った組にタイムアウトがあれば組ごと読み直す。
+//
+//   BlockCache cache;
+//   TagMemoryOptions opt; opt.first_block = 0; opt.block_count = 8;
+//   auto inv = run_inventory2(sp);
+//   for (const auto& t : read_tag_blocks(sp, inv, opt, &cache)) if (t.ok) use(t.uid, t.data);
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "command_batch.hpp"
+#include "tr3_protocol.hpp"
+#include "uid.hpp"
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// ブロックキャッシュ
+// ───────────────────────────────────
+struct BlockCacheStats {
+    uint64_t hits      = 0;   // 範囲が全て揃っていた
+    uint64_t misses    = 0;
+    uint64_t stale     = 0;   // DSFID の変化・max_age 経過で捨てた記録
+    uint64_t evictions = 0;   // 容量超過で追い出した記録
+};
+
+class BlockCache {
+public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    // max_age = 0 なら経過時間では捨てない
+    explicit BlockCache(size_t block_size = 4, size_t capacity = 4096,
+                        std::chrono::milliseconds max_age = std::chrono::milliseconds(0));
+
+    // first から count ブロックが揃っていれば out に連結して true
+    bool get(const Uid& uid, uint8_t dsfid, uint8_t first, size_t count, std::vector<uint8_t>& out,
+             time_point now = clock::now());
+    // count ブロック分（block_size × count バイト）を記録する。DSFID が変わっていれば古い分は捨てる
+    void put(const Uid& uid, uint8_t dsfid, uint8_t first, const uint8_t* data, size_t count,
+             time_point now = clock::now());
+
+    void invalidate(const Uid& uid) { map_.erase(uid); }
+    void clear() { map_.clear(); }
+
+    size_t size() const       { return map_.size(); }
+    size_t block_size() const { return block_size_; }
+    const BlockCacheStats& stats() const { return stats_; }
+
+private:
+    struct Entry {
+        uint8_t              dsfid = 0;
+        time_point           stored{};        // 最初に記録した時刻（max_age の起点）
+        uint64_t             last_used = 0;   // 追い出し順
+        std::bitset<256>     valid;           // ブロック番号ごとの有無
+        std::vector<uint8_t> data;            // ブロック番号 × block_size の位置に置く
+    };
+
+    // 使える記録を返す（DSFID 違い・期限切れは捨てて nullptr）
+    Entry* lookup(const Uid& uid, uint8_t dsfid, time_point now);
+    void   evict_one();
+
+    size_t                         block_size_;
+    size_t                         capacity_;
+    std::chrono::milliseconds      max_age_;
+    std::unordered_map<Uid, Entry> map_;
+    uint64_t                       tick_ = 0;
+    BlockCacheStats                stats_;
+};
+
+// ───────────────────────────────────
+// 一括読み書き
+// ───────────────────────────────────
+struct TagMemoryOptions {
+    uint8_t  first_block      = 0;
+    uint16_t block_count      = 8;      // 読む範囲（first_block + block_count は 256 まで）
+    size_t   block_size       = 4;      // タグのブロック長（応答の長さの検査・分割に使う）
+    size_t   max_blocks       = 32;     // 1 コマンドで読むブロック数の上限（タグの制限。フレーム長でも制限される）
+    bool     multi_block_write = false; // 複数ブロック書き込み（未対応のタグが多いので既定は 1 ブロックずつ）
+    uint32_t timeout_ms       = 300;    // 1 要求の応答待ち
+    uint32_t retries          = 1;      // 失敗した要求（NACK_NO_TAG 以外）を送り直す回数
+    BatchPolicy batch{};
+};
+
+struct TagBlocks {
+    Uid      uid;
+    uint8_t  dsfid  = 0;
+    bool     ok     = false;
+    bool     cached = false;            // キャッシュから返した
+    std::vector<uint8_t> data;          // block_count × block_size バイト
+    std::string error;                  // 失敗時の理由
+};
+
+struct TagMemoryStats {
+    uint64_t tags     = 0;   // 対象の UID 数（重複は除く）
+    uint64_t cached   = 0;   // キャッシュから返した UID 数
+    uint64_t failed   = 0;
+    uint64_t commands = 0;   // 送った要求数（送り直しを含む）
+    uint64_t writes   = 0;   // write() の回数
+    uint64_t retried  = 0;   // 送り直した要求数
+};
+
+// inv の全 UID（重複は 1 つに）について opt の範囲を読む。結果は inv に現れた順
+std::vector<TagBlocks> read_tag_blocks(Transport& sp, const InventoryResult& inv, const TagMemoryOptions& opt,
+                                       BlockCache* cache = nullptr, TagMemoryStats* stats = nullptr);
+
+// first から n バイト（block_size の倍数）を書く。成功した分はキャッシュにも反映し、失敗したらその UID の記録を捨てる
+bool write_tag_blocks(Transport& sp, const Uid& uid, uint8_t dsfid, uint8_t first, const uint8_t* data, size_t n,
+                      const TagMemoryOptions& opt, BlockCache* cache = nullptr, std::string* error = nullptr,
+                      TagMemoryStats* stats = nullptr);
+
+} // namespace tr3
@@ -0,0 +1,121 @@
+#pragma once
+// タグの在席管理（UID の重複排除と 到着／離脱 イベント化）
+//   ・run_inventory2 やストリームで得た UID を observe() に与える
+//   ・同じ UID の繰り返し読み取りは集計だけ行い、イベントは 到着（Arrive）／離脱（Depart）のみ出す
+//     - 到着：読み取り回数が arrive_reads 以上、かつ最初の読み取りから arrive_dwell 経過
+//     - 離脱：在席中のタグが absence の間読めなかった（tick() で判定）
+//   ・UID → 記録 は線形探索のオープンアドレス表（8 バイト/スロット）。記録は固定長の配列に置く
+//   ・記録数は capacity で頭打ち。満杯時は離脱済みの古いものから、なければ最も長く読めていない
+//     タグから追い出す
+//
+// 時刻は単調増加で与えること（observe／tick の now が戻ると順序が崩れる）。スレッド安全ではない。
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "tr3_protocol.hpp"
+#include "uid.hpp"
+
+namespace tr3 {
+
+struct TagTrackerConfig {
+    size_t   capacity     = 65536;                         // 保持するタグ数の上限
+    uint32_t arrive_reads = 1;                             // 到着とみなす読み取り回数
+    std::chrono::milliseconds arrive_dwell{0};             // 到着とみなす連続在席時間
+    std::chrono::milliseconds absence{2000};               // この間読めなければ離脱
+    std::chrono::milliseconds retain{0};                   // 離脱後に記録を残す時間（0: 追い出されるまで）
+};
+
+struct TagInfo {
+    Uid      uid;
+    std::chrono::steady_clock::time_point first_seen;      // 記録を作った時刻
+    std::chrono::steady_clock::time_point session_start;   // 今回の在席の開始時刻
+    std::chrono::steady_clock::time_point last_seen;
+    uint32_t reads         = 0;                            // 通算の読み取り回数
+    uint32_t session_reads = 0;                            // 今回の在席中の読み取り回数
+    uint8_t  dsfid   = 0;
+    bool     present = false;                              // 到着済み（離脱前）
+};
+
+struct TagEvent {
+    enum class Kind : uint8_t { Arrive, Depart };
+    Kind    kind = Kind::Arrive;
+    bool    evicted = false;                               // 容量超過で追い出したための離脱
+    TagInfo tag;
+};
+
+struct TagTrackerStats {
+    uint64_t reads      = 0;   // observe した UID 数
+    uint64_t arrivals   = 0;
+    uint64_t departures = 0;
+    uint64_t evictions  = 0;   // 容量超過で追い出した記録数
+    uint64_t expired    = 0;   // retain 経過・未到着のまま途切れて消した記録数
+};
+
+class TagTracker {
+public:
+    using EventCallback = std::function<void(const TagEvent&)>;
+    using time_point    = std::chrono::steady_clock::time_point;
+
+    explicit TagTracker(TagTrackerConfig cfg = {}, EventCallback cb = {});
+
+    // UID を1件反映する
+    void observe(const Uid& uid, uint8_t dsfid, time_point now);
+    // 1サイクル分の結果をまとめて反映し、離脱判定も行う
+    void observe(const InventoryResult& r, time_point now);
+
+    // 離脱判定と古い記録の整理
+    void tick(time_point now);
+
+    const TagInfo* find(const Uid& uid) const;
+    size_t size() const     { return used_; }
+    size_t capacity() const { return entries_.size(); }
+    size_t present() const  { return present_; }
+    const TagTrackerStats& stats() const { return stats_; }
+
+    // 使用メモリ（表と記録配列、確保済みの分）
+    size_t memory_bytes() const;
+
+    void clear();
+
+private:
+    static constexpr uint32_t NIL  = 0xFFFFFFFFu;   // 記録の添字なし
+    static constexpr size_t   NPOS = size_t(-1);    // 表の位置なし
+
+    enum class State : uint8_t { Free, Pending, Present, Absent };
+
+    struct Entry {
+        TagInfo  info;
+        uint32_t prev = NIL, next = NIL;   // 所属リスト内の前後（Free は next のみ）
+        State    state = State::Free;
+    };
+    struct Slot {
+        uint32_t idx = NIL;   // entries_ の添字
+        uint32_t fp  = 0;     // ハッシュ下位 32 ビット（ホーム位置と比較の両方に使う）
+    };
+    struct List { uint32_t head = NIL, tail = NIL; };
+
+    size_t   lookup(const Uid& uid, uint32_t fp) const;   // 見つからなければ NPOS
+    uint32_t allocate();
+    void     release(uint32_t idx);
+    void     erase_slot(size_t pos);
+    void     link_tail(List& l, uint32_t idx);
+    void     unlink(List& l, uint32_t idx);
+    void     depart(uint32_t idx, bool evicted);
+    void     emit(TagEvent::Kind k, const Entry& e, bool evicted);
+
+    TagTrackerConfig   cfg_;
+    EventCallback      cb_;
+    std::vector<Slot>  table_;
+    size_t             mask_ = 0;
+    std::vector<Entry> entries_;
+    uint32_t           free_head_ = NIL;
+    List               active_;     // Pending／Present（最終読み取り時刻の古い順）
+    List               absent_;     // Absent（離脱した順）
+    size_t             used_    = 0;
+    size_t             present_ = 0;
+    TagTrackerStats    stats_;
+};
+
+} // namespace tr3
@@ -0,0 +1,120 @@
+#pragma once
+// TR3 フレーム共通定義
+//   STX | ADDR | CMD | LEN | DATA(LEN) | ETX | SUM | CR
+//   SUM = STX から ETX までの加算値（下位8ビット）
+#include <array>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace tr3 {
+
+inline constexpr uint8_t STX = 0x02;
+inline constexpr uint8_t ETX = 0x03;
+inline constexpr uint8_t CR  = 0x0D;
+
+inline constexpr uint8_t ADDR_DEFAULT = 0x00;
+
+inline constexpr uint8_t CMD_ACK  = 0x30;
+inline constexpr uint8_t CMD_NACK = 0x31;
+
+// HF: ROM / ReaderMode / Inventory2 / ブザー
+inline constexpr uint8_t CMD_ROM_REQ    = 0x4F; // len=1, data=0x90
+inline constexpr uint8_t DETAIL_ROM     = 0x90;
+inline constexpr uint8_t CMD_MODE_RD    = 0x4F; // len=1, data=0x00
+inline constexpr uint8_t DETAIL_MODE_R  = 0x00;
+inline constexpr uint8_t CMD_MODE_WR    = 0x4E; // len=7, data=[detail,mode,reserved,flags,speed,poll_hi,poll_lo]
+inline constexpr uint8_t CMD_INV2       = 0x78; // len=3, data=F0 40 01
+inline constexpr uint8_t DETAIL_INV2_F0 = 0xF0; // Inventory2
+inline constexpr uint8_t RSP_UID        = 0x49; // DSFID+UIDレスポンス
+inline constexpr uint8_t CMD_BUZZER     = 0x42; // ブザーの制御
+
+// ISO 15693 ブロック読み書き（CMD=0x78。詳細は ISO 15693 のコマンドコード）
+//   データ: [詳細, 要求フラグ, UID(LSB→MSB 8バイト), 先頭ブロック, (ブロック数-1), (書き込みデータ)]
+//           単一ブロックの読み書きは (ブロック数-1) を送らない
+//   ACK   : [詳細, (読み出したブロックデータ)]
+inline constexpr uint8_t CMD_ISO15693        = 0x78;
+inline constexpr uint8_t DETAIL_READ_SINGLE  = 0x20;
+inline constexpr uint8_t DETAIL_WRITE_SINGLE = 0x21;
+inline constexpr uint8_t DETAIL_READ_MULTI   = 0x23;
+inline constexpr uint8_t DETAIL_WRITE_MULTI  = 0x24;
+inline constexpr uint8_t ISO_FLAG_HIGH_RATE  = 0x02; // 高速データレート
+inline constexpr uint8_t ISO_FLAG_ADDRESSED  = 0x20; // アドレス指定（UID を送る）
+
+// NACK エラーコード（NACK データ部の2バイト目）
+inline constexpr uint8_t NACK_SUM_ERROR    = 0x42;
+inline constexpr uint8_t NACK_FORMAT_ERROR = 0x44;
+inline constexpr uint8_t NACK_NO_TAG       = 0x4A; // 指定のタグから応答なし
+
+inline constexpr size_t IDX_STX    = 0;
+inline constexpr size_t IDX_ADDR   = 1;
+inline constexpr size_t IDX_CMD    = 2;
+inline constexpr size_t IDX_LEN    = 3;
+inline constexpr size_t HEADER_LEN = 4;
+inline constexpr size_t FOOTER_LEN = 3;
+inline constexpr size_t MAX_FRAME  = HEADER_LEN + 255 + FOOTER_LEN;
+
+// 受信バッファ内の1フレームを指す参照（コピーしない）
+// 参照先バッファが書き換えられるまでの間だけ有効
+struct FrameView {
+    const uint8_t* data = nullptr;
+    size_t         size = 0;
+
+    uint8_t operator[](size_t i) const { return data[i]; }
+    const uint8_t* begin() const { return data; }
+    const uint8_t* end()   const { return data + size; }
+
+    uint8_t cmd() const { return data[IDX_CMD]; }
+    uint8_t len() const { return data[IDX_LEN]; }
+    const uint8_t* payload() const { return data + HEADER_LEN; }
+
+    std::vector<uint8_t> to_vector() const { return std::vector<uint8_t>(begin(), end()); }
+};
+
+uint8_t calc_sum(const uint8_t* bytes, size_t n);
+
+std::vector<uint8_t> make_frame(uint8_t addr, uint8_t cmd, const std::vector<uint8_t>& payload);
+
+// ───────────────────────────────────
+// 固定長フレーム（スタック上に確保。ヒープを使わない）
+//   constexpr auto f = make_frame_fixed(ADDR_DEFAULT, CMD_ROM_REQ, DETAIL_ROM);
+//   sp.write(f.data(), f.size());
+// ───────────────────────────────────
+template <size_t N>
+struct FixedFrame {
+    static_assert(N <= 255, "TR3 のデータ長は 1 バイト");
+    std::array<uint8_t, HEADER_LEN + N + FOOTER_LEN> bytes{};
+
+    constexpr const uint8_t* data() const { return bytes.data(); }
+    constexpr size_t         size() const { return bytes.size(); }
+    constexpr FrameView      view() const { return FrameView{bytes.data(), bytes.size()}; }
+};
+
+template <size_t N>
+constexpr FixedFrame<N> make_frame_fixed(uint8_t addr, uint8_t cmd, const std::array<uint8_t, N>& payload) {
+    FixedFrame<N> f{};
+    f.bytes[IDX_STX]  = STX;
+    f.bytes[IDX_ADDR] = addr;
+    f.bytes[IDX_CMD]  = cmd;
+    f.bytes[IDX_LEN]  = static_cast<uint8_t>(N);
+    for (size_t i = 0; i < N; ++i) f.bytes[HEADER_LEN + i] = payload[i];
+    f.bytes[HEADER_LEN + N] = ETX;
+    uint32_t sum = 0;
+    for (size_t i = 0; i <= HEADER_LEN + N; ++i) sum += f.bytes[i];
+    f.bytes[HEADER_LEN + N + 1] = static_cast<uint8_t>(sum & 0xFF);
+    f.bytes[HEADER_LEN + N + 2] = CR;
+    return f;
+}
+
+// データ部をバイトの並びで渡す版（長さはバイト数から決まる）
+template <class... B>
+constexpr FixedFrame<sizeof...(B)> make_frame_fixed(uint8_t addr, uint8_t cmd, B... payload) {
+    return make_frame_fixed<sizeof...(B)>(addr, cmd, std::array<uint8_t, sizeof...(B)>{static_cast<uint8_t>(payload)...});
+}
+
+bool verify_frame(const uint8_t* f, size_t n);
+bool verify_frame(const std::vector<uint8_t>& frame);
+inline bool verify_frame(const FrameView& v) { return verify_frame(v.data, v.size); }
+
+} // namespace tr3
@@ -3,7 +3,10 @@
 #include <string>
 #include <vector>
 #include <cstdint>
-#include "serial_port.hpp"
+#include "transport.hpp"
+#include "tr3_frame.hpp"
+#include "tr3_response.hpp"
+#include "uid.hpp"
 
 namespace tr3 {
 
@@ -27,7 +30,7 @@ struct ReaderModePretty {
 // インベントリ結果
 // ───────────────────────────────────
 struct InventoryItem {
-    std::vector<uint8_t> uid;  // MSB→LSB順へ並べ替え済み
+    Uid     uid;               // MSB→LSB順へ並べ替え済み
     uint8_t dsfid = 0x00;
 };
 struct InventoryResult {
@@ -41,45 +44,104 @@ struct InventoryResult {
 // stop_on_ack=true: ACK/NACK受信で戻る（従来動作）
 // stop_on_ack=false: タイムアウトまで全フレーム収集（Inventory2等）
 // ───────────────────────────────────
-std::vector<uint8_t> communicate(SerialPort& sp,
+std::vector<uint8_t> communicate(Transport& sp,
                                  const std::vector<uint8_t>& command,
                                  uint32_t timeout_ms,
                                  bool stop_on_ack = true);
+std::vector<uint8_t> communicate(Transport& sp,
+                                 const uint8_t* command, size_t command_len,
+                                 uint32_t timeout_ms,
+                                 bool stop_on_ack = true);
 
-bool verify_frame(const std::vector<uint8_t>& frame);
+// フレーム生成／検証（make_frame / verify_frame）は tr3_frame.hpp
 
 // ───────────────────────────────────
 // ROMバージョン
 // ───────────────────────────────────
-std::string read_rom_version(SerialPort& sp, uint32_t timeout_ms = 600);
+std::string read_rom_version(Transport& sp, uint32_t timeout_ms = 600);
+// ACK のデータ部（ASCII "100S"）→ 表示形式 "1.00 S"
+std::string format_rom_version(const RomVersionAck& ack);
 
 // ───────────────────────────────────
 // 動作モード 読み取り / 書き込み
 // ───────────────────────────────────
-bool read_reader_mode(SerialPort& sp, ReaderModeRaw& raw, ReaderModePretty& pretty, uint32_t timeout_ms = 600);
+bool read_reader_mode(Transport& sp, ReaderModeRaw& raw, ReaderModePretty& pretty, uint32_t timeout_ms = 600);
+
+// 通信速度ビット（bit6..7）→ bps（0b00=19200, 0b01=9600, 0b10=38400, 0b11=115200）
+uint32_t baud_from_speed_bits(uint8_t speed_byte);
+// 動作モード読み取り結果の通信速度（データ不足なら 0）
+uint32_t baud_from_mode(const ReaderModeRaw& raw);
+// bps → 通信速度ビット（bit6..7 の位置。リーダが対応しない速度は 0xFF）
+uint8_t speed_bits_from_baud(uint32_t baud);
+
+// 動作モード読み取り結果が既にコマンドモード(0x00)か（true なら書き込みは不要）
+inline bool is_command_mode(const ReaderModeRaw& raw) { return !raw.bytes.empty() && raw.bytes[0] == 0x00; }
 
 // ★要件対応：モードのみ「コマンドモード(0x00)」に変更し、他設定は維持して書き込む
-bool write_reader_mode_to_command(SerialPort& sp,
+bool write_reader_mode_to_command(Transport& sp,
                                   const ReaderModeRaw& current,
                                   uint32_t timeout_ms = 600);
 
+// モードのみ new_mode に変更し、他設定は維持して書き込む（RAM）
+bool write_reader_mode(Transport& sp,
+                       const ReaderModeRaw& current,
+                       uint8_t new_mode,
+                       uint32_t timeout_ms = 600);
+
+// 通信速度のみ baud に変更し、他設定は維持して書き込む（RAM）
+//   ACK は変更前の速度で返る。以降は新しい速度で開き直さないと通信できない
+bool write_reader_speed(Transport& sp,
+                        const ReaderModeRaw& current,
+                        uint32_t baud,
+                        uint32_t timeout_ms = 600);
+
+// 動作モード書き込み（RAM）のフレーム：モード・各種設定パラメータ・通信速度ビット以外は 0
+FixedFrame<7> make_mode_write_frame(uint8_t new_mode, uint8_t flags, uint8_t speed = 0x00);
+
 // ───────────────────────────────────
 // ブザー制御（BUZ: 0x57）
 // response_type: 0x00=応答なし, 0x01=応答あり（本プログラムでは 0x01 を使用）
 // sound_type   : 0x00=ピー, 0x01=ピッピッピ（他バリエーションは機種仕様に準拠）
-// 戻り値       : 送信・ACK受信に成功したら true
+// 戻り値       : 送信・ACK受信に成功したら true（応答なし指定時は送信できたら true。待たない）
 // ───────────────────────────────────
-bool buzzer(SerialPort& sp, uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms = 600);
+bool buzzer(Transport& sp, uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms = 600);
 
 // ───────────────────────────────────
 // Inventory2（アンチコリジョン設定により順序が変わってもOK）
 // ───────────────────────────────────
-InventoryResult run_inventory2(SerialPort& sp, uint32_t timeout_ms = 1500);
+InventoryResult run_inventory2(Transport& sp, uint32_t timeout_ms = 1500);
+// 結果を out に書き込む版（out.items の容量を再利用するため、繰り返し呼ぶ場合はこちら）
+void run_inventory2(Transport& sp, InventoryResult& out, uint32_t timeout_ms = 1500);
+
+// UID レスポンス（0x49）を InventoryItem へ変換（0x49 以外・長さ不足は false）
+bool decode_uid_frame(const FrameView& f, InventoryItem& out);
+
+// ───────────────────────────────────
+// ISO 15693 ブロック読み書き（アドレス指定。count=1 なら単一ブロックのコマンドを使う）
+//   読み出し：out にブロックデータを連結して返す（ブロック長は応答の長さ ÷ count）
+//   書き込み：data は count ブロック分（n が count の倍数でなければ送らずに false）
+//   1 フレームのデータ部は 255 バイトまでなので、1 回に扱えるのは max_blocks_per_* まで
+// ───────────────────────────────────
+bool read_blocks(Transport& sp, const Uid& uid, uint8_t first, uint8_t count,
+                 std::vector<uint8_t>& out, uint32_t timeout_ms = 600);
+bool write_blocks(Transport& sp, const Uid& uid, uint8_t first, uint8_t count,
+                  const uint8_t* data, size_t n, uint32_t timeout_ms = 600);
+
+// 要求フレーム（count が 0、データ長が合わない・長すぎるときは空）
+std::vector<uint8_t> make_block_read_frame(const Uid& uid, uint8_t first, uint8_t count);
+std::vector<uint8_t> make_block_write_frame(const Uid& uid, uint8_t first, uint8_t count,
+                                            const uint8_t* data, size_t n);
+
+inline constexpr size_t max_blocks_per_read(size_t block_size)  { return block_size ? 254 / block_size : 0; }  // ACK: 詳細 + データ
+inline constexpr size_t max_blocks_per_write(size_t block_size) { return block_size ? 243 / block_size : 0; }  // 詳細・フラグ・UID・先頭・数 + データ
 
 // ───────────────────────────────────
 // NACK
 // ───────────────────────────────────
 std::string parse_nack_message(const std::vector<uint8_t>& nack_frame);
+std::string parse_nack_message(const FrameView& nack_frame);
+// エラーコード → メッセージ（静的文字列。確保しない）
+const char* nack_message(uint8_t code);
 
 } // namespace tr3
 
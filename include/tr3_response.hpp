@@ -0,0 +1,88 @@
+#pragma once
+// 受信フレームの型付きデコード（FrameView から直接読み、コピーしない）
+// 各 decode_* はコマンド・長さが合わなければ false を返す。
+#include <cstddef>
+#include <cstdint>
+#include "tr3_frame.hpp"
+#include "uid.hpp"
+
+namespace tr3 {
+
+// ACK(0x30) [0xF0, UID数]
+struct Inventory2Ack { uint8_t count = 0; };
+
+// 0x49 [DSFID, UID(LSB→MSB 8バイト)]
+struct UidResponse {
+    uint8_t dsfid = 0;
+    Uid     uid;
+};
+
+// NACK(0x31) [?, エラーコード]
+struct NackResponse { uint8_t code = 0xFF; };
+
+// ACK(0x30) [0x90, ASCII...]。ascii はフレーム内を指す
+struct RomVersionAck {
+    const char* ascii = nullptr;
+    size_t      len   = 0;
+};
+
+// ACK(0x30) [0x00, モード, 予約, 各種設定, 速度ビット, ...]。bytes はフレーム内を指す
+struct ReaderModeAck {
+    const uint8_t* bytes = nullptr;
+    size_t         len   = 0;
+    uint8_t mode()       const { return len > 0 ? bytes[0] : 0; }
+    uint8_t flags()      const { return len > 2 ? bytes[2] : 0; }
+    uint8_t speed_bits() const { return len > 3 ? bytes[3] : 0; }
+};
+
+// ACK(0x30) [詳細(20h/23h), ブロックデータ...]。data はフレーム内を指す
+struct BlockReadAck {
+    uint8_t        detail = 0;
+    const uint8_t* data   = nullptr;
+    size_t         len    = 0;
+};
+
+inline bool decode_inventory2_ack(const FrameView& f, Inventory2Ack& out) {
+    if (f.cmd() != CMD_ACK || f.len() < 2 || f[HEADER_LEN] != DETAIL_INV2_F0) return false;
+    out.count = f[HEADER_LEN + 1];
+    return true;
+}
+
+inline bool decode_uid_response(const FrameView& f, UidResponse& out) {
+    if (f.cmd() != RSP_UID || f.len() < 1 + Uid::SIZE) return false;
+    out.dsfid = f[HEADER_LEN];
+    out.uid   = Uid::from_lsb_first(f.payload() + 1);
+    return true;
+}
+
+inline bool decode_nack(const FrameView& f, NackResponse& out) {
+    if (f.cmd() != CMD_NACK) return false;
+    out.code = (f.len() >= 2) ? f[HEADER_LEN + 1] : 0xFF;
+    return true;
+}
+
+inline bool decode_rom_version_ack(const FrameView& f, RomVersionAck& out) {
+    if (f.cmd() != CMD_ACK || f.len() < 1 || f[HEADER_LEN] != DETAIL_ROM) return false;
+    out.ascii = reinterpret_cast<const char*>(f.payload() + 1);
+    out.len   = size_t(f.len()) - 1;
+    return true;
+}
+
+inline bool decode_reader_mode_ack(const FrameView& f, ReaderModeAck& out) {
+    if (f.cmd() != CMD_ACK || f.len() < 1 || f[HEADER_LEN] != DETAIL_MODE_R) return false;
+    out.bytes = f.payload() + 1;
+    out.len   = size_t(f.len()) - 1;
+    return true;
+}
+
+inline bool decode_block_read_ack(const FrameView& f, BlockReadAck& out) {
+    if (f.cmd() != CMD_ACK || f.len() < 1) return false;
+    const uint8_t d = f[HEADER_LEN];
+    if (d != DETAIL_READ_SINGLE && d != DETAIL_READ_MULTI) return false;
+    out.detail = d;
+    out.data   = f.payload() + 1;
+    out.len    = size_t(f.len()) - 1;
+    return true;
+}
+
+} // namespace tr3
@@ -0,0 +1,79 @@
+#pragma once
+// バイト列トランスポートの抽象（シリアルポート等）
+// プロトコル層（tr3_protocol）はこのインターフェイスだけに依存する
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "wait_timings.hpp"
+#include "frame_parser.hpp"
+
+namespace tr3 {
+
+// I/O 統計（システムコール回数と転送量）
+struct IoStats {
+    uint64_t read_calls    = 0;  // 読み取りシステムコール回数（ReadFile / read）
+    uint64_t write_calls   = 0;  // 書き込みシステムコール回数（WriteFile / write）
+    uint64_t wait_calls    = 0;  // 待ち合わせ・設定系（SetCommTimeouts / poll）
+    uint64_t bytes_read    = 0;
+    uint64_t bytes_written = 0;
+};
+
+class Transport {
+public:
+    using clock = std::chrono::steady_clock;
+
+    virtual ~Transport() = default;
+
+    virtual bool write(const uint8_t* data, size_t n) = 0;
+    bool write(const std::vector<uint8_t>& data) { return write(data.data(), data.size()); }
+
+    // 一括読み取り：受信済みのバイトを最大 cap バイトまで取り出す。
+    // 何も無ければ最初の1バイトを deadline まで待つ。戻り値=読み取りバイト数（0=タイムアウト/エラー）
+    virtual size_t read_some(uint8_t* dst, size_t cap, clock::time_point deadline) = 0;
+
+    // 1バイト読み取り（互換用。read_some の薄いラッパ）
+    bool read_byte(uint8_t& out, std::chrono::milliseconds per_byte_timeout) {
+        return read_some(&out, 1, clock::now() + per_byte_timeout) == 1;
+    }
+
+    const IoStats& io_stats() const { return stats_; }
+    void reset_io_stats() { stats_ = IoStats{}; }
+
+    // 回線速度（bps）。不明なら 0
+    virtual uint32_t baud() const { return 0; }
+
+    // デバイスが外れた（以後の送受信は失敗し続ける）。受信待ちのループはこれで打ち切る
+    virtual bool disconnected() const { return false; }
+
+    // 他スレッドから read_some の待ちを打ち切る（0 で戻る）。wakeable() が false なら何もしない
+    virtual void wake() {}
+    virtual bool wakeable() const { return false; }
+
+    // 受信待ちの時間設定（ポート毎）
+    const WaitTimings& timings() const { return timings_; }
+    void set_timings(const WaitTimings& t) { timings_ = t; on_timings_changed(); }
+
+    // 応答終端の判定に使うフレーム間隔の学習モデル
+    GapEstimator&       gap_model()       { return gap_model_; }
+    const GapEstimator& gap_model() const { return gap_model_; }
+
+    // 現在の設定・学習状態での応答終端ギャップ
+    std::chrono::microseconds end_of_response_gap() const {
+        return tr3::end_of_response_gap(timings_, baud(), &gap_model_);
+    }
+
+    // 同期 API（communicate / run_inventory2）の受信パーサ。呼び出しごとに reset() して使い回す
+    // （バッファの確保はポートの構築時の 1 回だけ）
+    FrameParser& rx_parser() { return rx_parser_; }
+
+protected:
+    virtual void on_timings_changed() {}
+
+    IoStats      stats_;
+    WaitTimings  timings_;
+    GapEstimator gap_model_;
+    FrameParser  rx_parser_;
+};
+
+} // namespace tr3
@@ -0,0 +1,55 @@
+#pragma once
+// ISO 15693 UID（8 バイト固定）の値型
+//   ・MSB→LSB の順で保持（表示順）。フレーム上は LSB から送られてくる
+//   ・比較・ハッシュ可能。ヒープを使わない
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace tr3 {
+
+struct Uid {
+    static constexpr size_t SIZE = 8;
+    std::array<uint8_t, SIZE> bytes{};
+
+    // フレーム上の並び（LSB 先頭）から作る
+    static Uid from_lsb_first(const uint8_t* lsb) {
+        Uid u;
+        for (size_t i = 0; i < SIZE; ++i) u.bytes[i] = lsb[SIZE - 1 - i];
+        return u;
+    }
+    // 64 ビット整数として（MSB が上位）
+    uint64_t to_u64() const {
+        uint64_t v = 0;
+        for (uint8_t b : bytes) v = (v << 8) | b;
+        return v;
+    }
+
+    uint8_t        operator[](size_t i) const { return bytes[i]; }
+    const uint8_t* begin() const { return bytes.data(); }
+    const uint8_t* end()   const { return bytes.data() + SIZE; }
+    static constexpr size_t size() { return SIZE; }
+
+    friend bool operator==(const Uid& a, const Uid& b) { return a.bytes == b.bytes; }
+    friend bool operator!=(const Uid& a, const Uid& b) { return a.bytes != b.bytes; }
+    friend bool operator< (const Uid& a, const Uid& b) { return a.bytes <  b.bytes; }
+};
+
+// 64 ビットのミキサ（splitmix64 の最終段）。UID は上位がメーカコード等で偏るため混ぜる
+inline uint64_t uid_hash(const Uid& u) {
+    uint64_t x = u.to_u64();
+    x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27; x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace tr3
+
+namespace std {
+template <>
+struct hash<tr3::Uid> {
+    size_t operator()(const tr3::Uid& u) const noexcept { return size_t(tr3::uid_hash(u)); }
+};
+} // namespace std
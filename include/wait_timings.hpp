@@ -0,0 +1,73 @@
+#pragma once
+// 受信待ちの時間設定と、応答終端（無通信ギャップ）の判定
+//   ・ボーレートから 1 文字（8N1 = 10 ビット）の時間を求め、ギャップ閾値を決める
+//   ・実際に観測したフレーム間隔を学習し（EWMA 平均＋偏差）、閾値を詰める／広げる
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+namespace tr3 {
+
+struct WaitTimings {
+    // 読み取り1回あたりの待ち刻み（Win32 の ReadTotalTimeoutConstant 等）
+    std::chrono::microseconds poll_slice{10000};
+
+    // 応答終端の無通信ギャップ = 文字時間 × gap_chars + gap_margin（gap_min〜gap_max に制限）
+    uint32_t                  gap_chars  = 32;      // UID フレーム（16バイト）2 個分
+    std::chrono::microseconds gap_margin{2000};     // OS / USB シリアル変換の遅延ぶん
+    std::chrono::microseconds gap_min{2000};
+    std::chrono::microseconds gap_max{120000};      // 従来の固定値
+
+    // 観測したフレーム間隔から閾値を学習する
+    bool     learn_gap         = true;
+    uint32_t learn_min_samples = 8;                 // これ未満はボーレート由来の値を使う
+    double   learn_k           = 4.0;               // 閾値 = 平均 + k × 偏差
+};
+
+// 8N1 の 1 文字時間（マイクロ秒）。baud=0（不明）は 19200 とみなす
+inline double char_time_us(uint32_t baud) {
+    return 10.0 * 1e6 / double(baud ? baud : 19200);
+}
+
+// 受信フレーム間隔の学習モデル（EWMA）
+class GapEstimator {
+public:
+    void observe(std::chrono::microseconds gap) {
+        const double x = double(gap.count());
+        if (n_ == 0) { mean_ = x; dev_ = x / 2; }
+        else {
+            const double err = x - mean_;
+            mean_ += ALPHA * err;
+            dev_  += ALPHA * (std::fabs(err) - dev_);
+        }
+        ++n_;
+    }
+    uint64_t samples() const { return n_; }
+    double   mean_us() const { return mean_; }
+    double   dev_us()  const { return dev_; }
+    void     reset() { n_ = 0; mean_ = dev_ = 0; }
+
+private:
+    static constexpr double ALPHA = 0.125;  // TCP の RTT 推定と同じ重み
+    uint64_t n_ = 0;
+    double   mean_ = 0, dev_ = 0;
+};
+
+// 応答終端とみなす無通信ギャップ
+inline std::chrono::microseconds end_of_response_gap(const WaitTimings& t, uint32_t baud,
+                                                      const GapEstimator* learned = nullptr) {
+    using us = std::chrono::microseconds;
+    const double base = char_time_us(baud) * t.gap_chars + double(t.gap_margin.count());
+    double g = base;
+    if (t.learn_gap && learned && learned->samples() >= t.learn_min_samples) {
+        // 学習値を優先するが、gap_chars 文字ぶんの伝送時間は下回らない。
+        // 観測値は受信スレッド側の間隔なので、OS / USB シリアル変換の揺らぎぶん gap_margin を上乗せする
+        const double floor_us = char_time_us(baud) * t.gap_chars;
+        g = std::max(floor_us, learned->mean_us() + t.learn_k * learned->dev_us()) + double(t.gap_margin.count());
+    }
+    g = std::clamp(g, double(t.gap_min.count()), double(t.gap_max.count()));
+    return us(static_cast<int64_t>(g));
+}
+
+} // namespace tr3
@@ -0,0 +1,308 @@
+// コルーチンによるリーダ操作（C++20・Linux / epoll）
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+
+#include "../include/async_reader.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+static constexpr int MAX_EVENTS = 64;
+
+// ───────────────────────────────────
+// spawn したタスクの駆動（完了したら自身を live_ から外して破棄される）
+// ───────────────────────────────────
+struct EventLoop::Driver {
+    struct promise_type {
+        EventLoop* loop = nullptr;
+        Driver get_return_object() { return Driver{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept {
+            loop->live_.erase(std::coroutine_handle<promise_type>::from_promise(*this).address());
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> h;
+};
+
+EventLoop::Driver EventLoop::drive(Task<void> t) {
+    try {
+        co_await std::move(t);
+    } catch (const std::exception& e) {
+        log_text(LogLevel::Error, LogTag::Cmt, std::string("タスクが例外で終了: ") + e.what());
+    } catch (...) {
+        log_text(LogLevel::Error, LogTag::Cmt, std::string("タスクが例外で終了"));
+    }
+}
+
+// ───────────────────────────────────
+// イベントループ
+// ───────────────────────────────────
+EventLoop::EventLoop() {
+    epfd_   = ::epoll_create1(EPOLL_CLOEXEC);
+    wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd_ < 0 || wakefd_ < 0) {
+        last_error_ = std::string("epoll 初期化失敗: ") + std::strerror(errno);
+        if (epfd_ >= 0) { ::close(epfd_); epfd_ = -1; }
+        return;
+    }
+    epoll_event ev{}; ev.events = EPOLLIN; ev.data.ptr = nullptr;   // nullptr = 停止通知
+    ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+}
+
+EventLoop::~EventLoop() {
+    // 終わっていないタスクを破棄する（駆動コルーチンが子タスクのフレームを順に破棄する）
+    std::vector<void*> rest(live_.begin(), live_.end());
+    live_.clear();
+    for (void* p : rest) std::coroutine_handle<>::from_address(p).destroy();
+    if (epfd_ >= 0)   ::close(epfd_);
+    if (wakefd_ >= 0) ::close(wakefd_);
+}
+
+void EventLoop::spawn(Task<void> t) {
+    Driver d = drive(std::move(t));
+    d.h.promise().loop = this;
+    live_.insert(d.h.address());
+    post(d.h);
+}
+
+void EventLoop::stop() {
+    stop_.store(true, std::memory_order_release);
+    const uint64_t one = 1;
+    if (wakefd_ >= 0) (void)!::write(wakefd_, &one, sizeof(one));
+}
+
+void EventLoop::add_timer(time_point when, std::coroutine_handle<> h, AsyncReader* r, uint64_t op) {
+    timers_.push(Timer{when, ++seq_, h, r, op});
+}
+
+bool EventLoop::watch(AsyncReader* r, int fd) {
+    epoll_event ev{}; ev.events = EPOLLIN; ev.data.ptr = r;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0) return true;
+    last_error_ = std::string("epoll_ctl 失敗: ") + std::strerror(errno);
+    return false;
+}
+
+void EventLoop::unwatch(int fd) {
+    ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::run() {
+    if (!ok()) return;
+    stop_.store(false, std::memory_order_relaxed);
+    epoll_event evs[MAX_EVENTS];
+
+    while (!stop_.load(std::memory_order_acquire) && !live_.empty()) {
+        // 再開待ちのコルーチンを進める（再開中に積まれた分も同じ周回で）
+        for (size_t i = 0; i < ready_.size(); ++i) ready_[i].resume();
+        ready_.clear();
+        if (live_.empty() || stop_.load(std::memory_order_acquire)) break;
+
+        // 期限が来たタイマ
+        auto now = clock::now();
+        while (!timers_.empty() && timers_.top().when <= now) {
+            const Timer t = timers_.top();
+            timers_.pop();
+            if (t.h) post(t.h);
+            else if (readers_.count(t.reader)) t.reader->on_deadline(t.op, now);
+        }
+        if (!ready_.empty()) continue;
+
+        int wait_ms = -1;
+        if (!timers_.empty())
+            wait_ms = int(std::max<long long>(0, duration_cast<milliseconds>(timers_.top().when - now + microseconds(999)).count()));
+        const int n = ::epoll_wait(epfd_, evs, MAX_EVENTS, wait_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            last_error_ = std::string("epoll_wait 失敗: ") + std::strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            auto* r = static_cast<AsyncReader*>(evs[i].data.ptr);
+            if (!r) {
+                uint64_t v; (void)!::read(wakefd_, &v, sizeof(v));
+                continue;
+            }
+            if (!r->is_open()) continue;
+            if (evs[i].events & EPOLLIN) r->on_readable();
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) r->close();
+        }
+    }
+}
+
+// ───────────────────────────────────
+// リーダ
+// ───────────────────────────────────
+AsyncReader::AsyncReader(EventLoop& loop, std::string port, uint32_t baud, size_t rx_capacity)
+    : loop_(loop), sp_(std::move(port), baud), parser_(rx_capacity)
+{
+    loop_.readers_.insert(this);
+}
+
+AsyncReader::~AsyncReader() {
+    close();
+    loop_.readers_.erase(this);
+}
+
+bool AsyncReader::open() {
+    if (sp_.is_open()) return true;
+    if (!sp_.open()) return false;
+    if (!loop_.watch(this, sp_.native_handle())) { sp_.close(); return false; }
+    parser_.reset();
+    parser_last_ = FrameParserStats{};
+    return true;
+}
+
+void AsyncReader::close() {
+    if (sp_.is_open()) {
+        loop_.unwatch(sp_.native_handle());
+        sp_.close();
+    }
+    if (waiter_) finish(ReplyStatus::Cancelled);
+}
+
+bool AsyncReader::begin(Command c, std::coroutine_handle<> h, CommandReply* out) {
+    if (waiter_) {   // 1 台につき同時に待てる要求は 1 つ
+        out->status = ReplyStatus::Cancelled;
+        return false;
+    }
+    rq_ = RequestState(std::move(c));
+    ++stats_.requests;
+
+    const Command& cmd = rq_.cmd;
+    if (cmd.frame.empty() || !sp_.is_open()) {
+        rq_.finish(ReplyStatus::WriteError);
+        *out = std::move(rq_.reply);
+        return false;
+    }
+    log_frame(LogTag::Send, cmd.frame.data(), cmd.frame.size());
+    metrics().on_request(rq_.reply.cmd);
+    if (!sp_.write(cmd.frame.data(), cmd.frame.size())) {
+        metrics().add_write_error();
+        log_text(LogLevel::Error, LogTag::Cmt, std::string("送信エラー: ") + sp_.last_error());
+        rq_.finish(ReplyStatus::WriteError);
+        *out = std::move(rq_.reply);
+        return false;
+    }
+    if (cmd.expect == Expect::None) {
+        rq_.finish(ReplyStatus::Ok);
+        *out = std::move(rq_.reply);
+        return false;
+    }
+    rq_.on_sent(steady_clock::now());
+    waiter_ = h;
+    out_    = out;
+    op_     = loop_.next_op();
+    armed_  = {};
+    arm_timer();
+    return true;
+}
+
+void AsyncReader::finish(ReplyStatus st) {
+    rq_.finish(st);
+    if (st == ReplyStatus::Timeout) ++stats_.timeouts;
+    if (st == ReplyStatus::Nack)    ++stats_.nacks;
+    *out_ = std::move(rq_.reply);
+    // 再開は次の周回で（受信バッファに残っている後続フレームをこの要求の後の要求へ回さないため）
+    loop_.post(waiter_);
+    waiter_ = {};
+    out_    = nullptr;
+    op_     = 0;
+}
+
+void AsyncReader::arm_timer() {
+    const auto t = rq_.wake_at(sp_.end_of_response_gap());
+    if (armed_ == EventLoop::time_point{} || t < armed_) {
+        loop_.add_timer(t, {}, this, op_);
+        armed_ = t;
+    }
+}
+
+void AsyncReader::on_deadline(uint64_t op, EventLoop::time_point now) {
+    if (!waiter_ || op != op_) return;   // 完了済みの要求のタイマ
+    if (now < armed_) return;            // より早いタイマを登録し直した後の古い分
+    armed_ = {};
+    // epoll より先にタイマを見るので、届いている分を読んでから判定する
+    on_readable();
+    if (!waiter_ || op != op_) return;
+    ReplyStatus st;
+    if (rq_.expired(now, sp_.end_of_response_gap(), st)) finish(st);
+    else                                                 arm_timer();
+}
+
+void AsyncReader::on_readable() {
+    // 溜まっている分を読み切る（非ブロッキング。期限を過去にして poll させない）
+    while (sp_.is_open()) {
+        size_t room = 0;
+        uint8_t* dst = parser_.prepare(room);
+        const size_t n = sp_.read_some(dst, room, steady_clock::time_point{});
+        if (n == 0) break;
+        parser_.commit(n);
+        stats_.bytes_rx += n;
+
+        const auto now = steady_clock::now();
+        if (waiter_ && rq_.cmd.expect == Expect::Inventory2 && rq_.received > 0)
+            sp_.gap_model().observe(duration_cast<microseconds>(now - rq_.t_last));   // UID 間の間隔を学習
+        FrameView f;
+        while (parser_.next(f)) {
+            log_frame(LogTag::Recv, f.data, f.size);
+            if (!waiter_) { ++stats_.unsolicited; continue; }
+            NackResponse nack;
+            if (decode_nack(f, nack)) {
+                rq_.on_nack(nack.code, f, now);
+                finish(ReplyStatus::Nack);
+                continue;
+            }
+            const auto m = rq_.match(f);
+            if (m == RequestState::Match::No) { ++stats_.unsolicited; continue; }
+            rq_.on_frame(f, now);
+            if (m == RequestState::Match::Done) finish(ReplyStatus::Ok);
+        }
+    }
+    metrics().add_parser(parser_.stats(), parser_last_);
+    if (waiter_) arm_timer();   // Inventory2 の無通信ギャップは UID を受けるたびに延びる
+}
+
+// ───────────────────────────────────
+// 操作
+// ───────────────────────────────────
+Task<std::string> AsyncReader::rom_version(uint32_t timeout_ms) {
+    const CommandReply r = co_await request(cmd_rom_version(timeout_ms));
+    std::string v;
+    reply_rom_version(r, v);
+    co_return v;
+}
+
+Task<bool> AsyncReader::read_mode(ReaderModeRaw& out, uint32_t timeout_ms) {
+    const CommandReply r = co_await request(cmd_read_mode(timeout_ms));
+    co_return reply_reader_mode(r, out);
+}
+
+Task<bool> AsyncReader::write_mode(const ReaderModeRaw& current, uint8_t new_mode, uint32_t timeout_ms) {
+    const CommandReply r = co_await request(cmd_write_mode(current, new_mode, timeout_ms));
+    co_return r.ok();
+}
+
+Task<bool> AsyncReader::buzzer(uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms) {
+    const CommandReply r = co_await request(cmd_buzzer(response_type, sound_type, timeout_ms));
+    co_return r.ok();
+}
+
+Task<InventoryResult> AsyncReader::inventory2(uint32_t timeout_ms) {
+    const CommandReply r = co_await request(cmd_inventory2(timeout_ms));
+    InventoryResult out;
+    reply_inventory(r, out);
+    co_return out;
+}
+
+} // namespace tr3
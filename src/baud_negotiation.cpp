@@ -0,0 +1,181 @@
+// 通信速度の自動判定と切り替え
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "../include/baud_negotiation.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/log.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+static void log_cmt(const std::string& text, LogLevel lv = LogLevel::Info) {
+    log_text(lv, LogTag::Cmt, text);
+}
+
+static uint32_t elapsed_ms(steady_clock::time_point t0) {
+    return uint32_t(duration_cast<milliseconds>(steady_clock::now() - t0).count());
+}
+
+// 閉じて速度を変えて開き直す
+static bool reopen_at(SerialPort& sp, uint32_t baud) {
+    sp.close();
+    return sp.set_baud(baud) && sp.open();
+}
+
+// ───────────────────────────────────
+// 探索
+// ───────────────────────────────────
+std::vector<uint32_t> baud_probe_order(uint32_t hint) {
+    std::vector<uint32_t> order;
+    if (hint && speed_bits_from_baud(hint) != 0xFF) order.push_back(hint);
+    for (uint32_t b : {19200u, 115200u, 38400u, 9600u})
+        if (b != hint) order.push_back(b);
+    return order;
+}
+
+bool ping_rom(Transport& sp, uint32_t timeout_ms, std::string* version, size_t* stray) {
+    static constexpr auto tx = make_frame_fixed(ADDR_DEFAULT, CMD_ROM_REQ, DETAIL_ROM);
+    if (stray) *stray = 0;
+    if (!sp.write(tx.data(), tx.size())) return false;
+
+    FrameParser parser(256);
+    const auto deadline = steady_clock::now() + milliseconds(timeout_ms);
+    while (steady_clock::now() < deadline) {
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp.read_some(dst, room, deadline);
+        if (n == 0) {
+            if (sp.disconnected()) return false;
+            continue;
+        }
+        parser.commit(n);
+
+        // 速度が違えば化けたバイトになり、フレームとして取り出せない
+        FrameView f;
+        while (parser.next(f)) {
+            RomVersionAck ack;
+            if (!decode_rom_version_ack(f, ack)) { if (stray) ++*stray; continue; }
+            if (version) *version = format_rom_version(ack);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool probe_baud(SerialPort& sp, BaudProbeResult& out, uint32_t hint, uint32_t timeout_ms) {
+    out = BaudProbeResult{};
+    const uint32_t original = sp.baud();
+    const auto t0 = steady_clock::now();
+
+    for (uint32_t b : baud_probe_order(hint)) {
+        out.tried.push_back(b);
+        if (!reopen_at(sp, b)) { out.error = sp.last_error(); continue; }
+        if (ping_rom(sp, timeout_ms, &out.rom_version)) {
+            out.ok   = true;
+            out.baud = b;
+            out.elapsed_ms = elapsed_ms(t0);
+            log_cmt("通信速度の判定 : " + std::to_string(b) + "bps（" + std::to_string(out.tried.size()) +
+                    " 通り目・" + std::to_string(out.elapsed_ms) + "ms）");
+            return true;
+        }
+    }
+    sp.close();
+    sp.set_baud(original);
+    out.elapsed_ms = elapsed_ms(t0);
+    if (out.error.empty()) out.error = "どの通信速度でも ROM 応答がありません";
+    log_cmt("通信速度の判定に失敗: " + out.error, LogLevel::Error);
+    return false;
+}
+
+// ───────────────────────────────────
+// 切り替え
+// ───────────────────────────────────
+// Inventory2 を cycles 回実行した 1 回あたりの時間（ms）
+static double measure_cycle_ms(SerialPort& sp, uint32_t cycles, uint32_t timeout_ms, size_t* uids) {
+    if (cycles == 0) return 0;
+    InventoryResult r;
+    const auto t0 = steady_clock::now();
+    for (uint32_t i = 0; i < cycles; ++i) {
+        run_inventory2(sp, r, timeout_ms);
+        if (uids) *uids = std::max(*uids, r.items.size());
+    }
+    return duration<double, std::milli>(steady_clock::now() - t0).count() / cycles;
+}
+
+// 開き直した直後は設定が落ち着くまで待ってから ROM で確かめる
+static bool verify_at(SerialPort& sp, uint32_t baud, const BaudUpgradeOptions& opt) {
+    if (!reopen_at(sp, baud)) return false;
+    std::this_thread::sleep_for(milliseconds(opt.settle_ms));
+    for (uint32_t i = 0; i < std::max<uint32_t>(1, opt.verify_tries); ++i)
+        if (ping_rom(sp, opt.verify_timeout)) return true;
+    return false;
+}
+
+bool upgrade_baud(SerialPort& sp, const ReaderModeRaw& current, BaudUpgradeResult& out,
+                  const BaudUpgradeOptions& opt) {
+    out = BaudUpgradeResult{};
+    out.from = out.to = sp.baud();
+
+    if (!sp.is_open()) { out.error = "ポートが開いていません"; return false; }
+    if (speed_bits_from_baud(opt.target) == 0xFF) {
+        out.error = "リーダが対応しない通信速度: " + std::to_string(opt.target);
+        return false;
+    }
+    if (current.bytes.size() < 4) { out.error = "現行モード情報が不足しています"; return false; }
+    if (baud_from_mode(current) == opt.target && sp.baud() == opt.target) {
+        out.ok = true;
+        out.cycle_ms_before = out.cycle_ms_after =
+            measure_cycle_ms(sp, opt.measure_cycles, opt.inventory_timeout_ms, &out.uids);
+        log_cmt("通信速度は既に " + std::to_string(opt.target) + "bps です");
+        return true;
+    }
+
+    out.cycle_ms_before = measure_cycle_ms(sp, opt.measure_cycles, opt.inventory_timeout_ms, &out.uids);
+
+    // ACK は旧速度で返る。ACK を取りこぼしても切り替わっている可能性があるので、
+    // 旧速度でまだ応答する（NACK 等で切り替わっていない）ときだけ打ち切る
+    if (!write_reader_speed(sp, current, opt.target) && ping_rom(sp, opt.verify_timeout)) {
+        out.error = "通信速度の書き込みに失敗しました";
+        log_cmt(out.error + "（" + std::to_string(out.from) + "bps のまま）", LogLevel::Error);
+        return false;
+    }
+    if (verify_at(sp, opt.target, opt)) {
+        out.ok = true;
+        out.to = opt.target;
+        out.cycle_ms_after = measure_cycle_ms(sp, opt.measure_cycles, opt.inventory_timeout_ms, nullptr);
+        log_cmt("通信速度を切り替えました : " + std::to_string(out.from) + " → " + std::to_string(out.to) + "bps");
+        return true;
+    }
+
+    // 新しい速度で応答しない → 元の速度へ戻す → それも駄目なら全速度を探し直す
+    out.error = std::to_string(opt.target) + "bps で応答がありません";
+    log_cmt("通信速度の切り替えに失敗: " + out.error, LogLevel::Error);
+    out.fell_back = true;
+    if (verify_at(sp, out.from, opt)) {
+        log_cmt("元の通信速度 " + std::to_string(out.from) + "bps で通信を続けます");
+        return false;
+    }
+    BaudProbeResult pr;
+    if (probe_baud(sp, pr, out.from)) {
+        out.to = pr.baud;
+        log_cmt(std::to_string(out.to) + "bps で通信を続けます");
+        return false;
+    }
+    out.to = 0;
+    out.error += "（元の速度でも応答がありません）";
+    return false;
+}
+
+double inventory_wire_ms(uint32_t baud, size_t uids) {
+    if (baud == 0) return 0;
+    const size_t overhead = HEADER_LEN + FOOTER_LEN;
+    const size_t bytes = (overhead + 3)             // 要求（F0 40 01）
+                       + (overhead + 2)             // ACK（F0, UID 数）
+                       + uids * (overhead + 9);     // UID 応答（DSFID + UID 8 バイト）
+    return double(bytes) * 10.0 * 1000.0 / double(baud);
+}
+
+} // namespace tr3
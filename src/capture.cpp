@@ -0,0 +1,157 @@
+// シリアル通信のバイナリキャプチャ
+#include "../include/capture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+static const char CAPTURE_MAGIC[8] = {'T', 'R', '3', 'C', 'A', 'P', 0, 0};
+
+static int64_t mono_ns() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//===============================
+// 記録
+//===============================
+CaptureWriter::CaptureWriter(size_t chunk_bytes)
+    : chunk_(sizeof(CaptureChunkHeader) + std::max<size_t>(chunk_bytes, 4096)) {}
+
+bool CaptureWriter::open(const std::string& path, uint32_t baud) {
+    close();
+    std::lock_guard<std::mutex> lk(mu_);
+    fp_ = std::fopen(path.c_str(), "wb");
+    if (!fp_) { last_error_ = "キャプチャファイルを開けません: " + path; return false; }
+
+    CaptureFileHeader h{};
+    std::memcpy(h.magic, CAPTURE_MAGIC, sizeof(h.magic));
+    h.version    = CAPTURE_VERSION;
+    h.baud       = baud;
+    h.t0_wall_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    h.t0_mono_ns = mono_ns();
+    if (std::fwrite(&h, sizeof(h), 1, fp_) != 1) {
+        last_error_ = "キャプチャファイルへ書けません";
+        std::fclose(fp_); fp_ = nullptr;
+        return false;
+    }
+    t0_mono_       = h.t0_mono_ns;
+    last_flush_ns_ = h.t0_mono_ns;
+    used_ = 0; nrec_ = 0;
+    stats_ = CaptureStats{};
+    return true;
+}
+
+void CaptureWriter::close() {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!fp_) return;
+    flush_locked();
+    std::fclose(fp_);
+    fp_ = nullptr;
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (fp_) { flush_locked(); std::fflush(fp_); }
+}
+
+void CaptureWriter::flush_locked() {
+    if (nrec_ == 0) return;
+    CaptureChunkHeader ch{};
+    ch.magic   = CAPTURE_CHUNK_MAGIC;
+    ch.bytes   = uint32_t(used_);
+    ch.records = nrec_;
+    std::memcpy(chunk_.data(), &ch, sizeof(ch));
+    if (std::fwrite(chunk_.data(), 1, sizeof(ch) + used_, fp_) != sizeof(ch) + used_)
+        last_error_ = "キャプチャファイルへ書けません";
+    ++stats_.chunks;
+    used_ = 0; nrec_ = 0;
+    last_flush_ns_ = mono_ns();
+}
+
+void CaptureWriter::record(CaptureDir dir, const uint8_t* data, size_t n) {
+    if (n == 0) return;
+    const int64_t now = mono_ns();
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!fp_) return;
+
+    // 1 記録の長さは 16 ビット。それを超える読み取りは分けて記録する
+    while (n > 0) {
+        const size_t len  = std::min<size_t>(n, 0xFFFF);
+        const size_t need = capture_record_size(len);
+        const size_t room = chunk_.size() - sizeof(CaptureChunkHeader);
+        if (used_ + need > room) flush_locked();
+        if (need > room) chunk_.resize(sizeof(CaptureChunkHeader) + need);   // 大きな記録は 1 チャンクに 1 つ
+
+        uint8_t* w = chunk_.data() + sizeof(CaptureChunkHeader) + used_;
+        CaptureRecordHeader rh{};
+        rh.t_ns = now - t0_mono_;
+        rh.dir  = uint8_t(dir);
+        rh.len  = uint16_t(len);
+        std::memcpy(w, &rh, sizeof(rh));
+        std::memcpy(w + sizeof(rh), data, len);
+        std::memset(w + sizeof(rh) + len, 0, need - sizeof(rh) - len);
+        used_ += need;
+        ++nrec_;
+        ++stats_.records;
+        stats_.bytes += len;
+        data += len; n -= len;
+    }
+    if (flush_interval_ns_ > 0 && now - last_flush_ns_ >= flush_interval_ns_) flush_locked();
+}
+
+CaptureStats CaptureWriter::stats() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return stats_;
+}
+
+//===============================
+// 読み出し
+//===============================
+bool CaptureReader::open(const std::string& path) {
+    close();
+    truncated_ = false;
+    if (!map_.open(path)) { last_error_ = map_.last_error(); return false; }
+    if (map_.size() < sizeof(CaptureFileHeader)) { last_error_ = "キャプチャファイルが短すぎます"; close(); return false; }
+    std::memcpy(&hdr_, map_.data(), sizeof(hdr_));
+    if (std::memcmp(hdr_.magic, CAPTURE_MAGIC, sizeof(hdr_.magic)) != 0) {
+        last_error_ = "キャプチャファイルではありません"; close(); return false;
+    }
+    if (hdr_.version != CAPTURE_VERSION) { last_error_ = "未対応のキャプチャ形式です"; close(); return false; }
+    rewind();
+    return true;
+}
+
+bool CaptureReader::next(CaptureRecord& out) {
+    const uint8_t* base = map_.data();
+    const size_t   size = map_.size();
+
+    if (pos_ >= chunk_end_) {
+        // 次のチャンクへ
+        if (pos_ + sizeof(CaptureChunkHeader) > size) { truncated_ = pos_ != size; return false; }
+        CaptureChunkHeader ch;
+        std::memcpy(&ch, base + pos_, sizeof(ch));
+        if (ch.magic != CAPTURE_CHUNK_MAGIC || pos_ + sizeof(ch) + ch.bytes > size) { truncated_ = true; return false; }
+        pos_      += sizeof(ch);
+        chunk_end_ = pos_ + ch.bytes;
+        if (pos_ >= chunk_end_) return next(out);   // 空チャンク
+    }
+
+    CaptureRecordHeader rh;
+    if (pos_ + sizeof(rh) > chunk_end_) { truncated_ = true; return false; }
+    std::memcpy(&rh, base + pos_, sizeof(rh));
+    const size_t need = capture_record_size(rh.len);
+    if (pos_ + need > chunk_end_) { truncated_ = true; return false; }
+
+    out.t_ns = rh.t_ns;
+    out.dir  = CaptureDir(rh.dir);
+    out.data = base + pos_ + sizeof(rh);
+    out.len  = rh.len;
+    pos_ += need;
+    return true;
+}
+
+} // namespace tr3
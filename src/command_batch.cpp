@@ -0,0 +1,98 @@
+// コマンドの一括送信
+#include "../include/command_batch.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+#include <string>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+CommandBatcher::CommandBatcher(Transport& sp, BatchPolicy policy) : sp_(sp), policy_(policy) {
+    if (policy_.max_commands == 0) policy_.max_commands = 1;
+}
+
+// ───────────────────────────────────
+// 送信
+// ───────────────────────────────────
+size_t CommandBatcher::add(Command c) {
+    const size_t n = c.frame.size();
+    // 入りきらないなら先に積んだ分を送る（1 フレームで上限を超えるものは単独で送る）
+    if (!queue_.empty() && queued_bytes_ + n > policy_.max_bytes) { ++stats_.by_size; flush(); }
+
+    const size_t index = results_.size();
+    results_.emplace_back();
+    if (queue_.empty()) t_first_ = clock::now();
+    queue_.push_back(Slot{RequestState(std::move(c)), index});
+    queued_bytes_ += n;
+    ++stats_.commands;
+
+    if (queue_.size() >= policy_.max_commands || queued_bytes_ >= policy_.max_bytes) { ++stats_.by_size; flush(); }
+    else flush_if_due();
+    return index;
+}
+
+bool CommandBatcher::flush_if_due(time_point now) {
+    if (queue_.empty() || policy_.max_delay.count() <= 0 || now < t_first_ + policy_.max_delay) return true;
+    ++stats_.by_delay;
+    return flush();
+}
+
+bool CommandBatcher::flush() {
+    if (queue_.empty()) return true;
+    const bool ok = in_flight_.send(sp_, queue_, buf_, [this](Slot& s, ReplyStatus st) { complete(s, st); });
+    if (!buf_.empty()) {
+        ++stats_.writes;
+        if (ok) stats_.bytes += buf_.size();
+    }
+    queued_bytes_ = 0;
+    return ok;
+}
+
+// ───────────────────────────────────
+// 受信（応答は送信順に届く）
+// ───────────────────────────────────
+void CommandBatcher::complete(Slot& s, ReplyStatus st) {
+    s.rq.finish(st);
+    results_[s.index] = std::move(s.rq.reply);
+}
+
+std::vector<CommandReply> CommandBatcher::execute() {
+    flush();
+
+    FrameParser      parser;
+    FrameParserStats parser_last;
+    const auto gap = sp_.end_of_response_gap();
+    auto done = [this](Slot& s, ReplyStatus st) { complete(s, st); };
+    while (!in_flight_.empty()) {
+        const RequestState& head = in_flight_.front().rq;
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp_.read_some(dst, room, head.wake_at(gap));
+        const auto now = clock::now();
+        if (n) {
+            if (head.cmd.expect == Expect::Inventory2 && head.received > 0)
+                sp_.gap_model().observe(duration_cast<microseconds>(now - head.t_last));   // UID 間の間隔を学習
+            parser.commit(n);
+            FrameView f;
+            while (parser.next(f)) {
+                log_frame(LogTag::Recv, f.data, f.size);
+                if (!in_flight_.dispatch(f, now, stats_.lost, done)) ++stats_.unsolicited;
+            }
+            metrics().add_parser(parser.stats(), parser_last);
+        } else if (sp_.disconnected()) {
+            in_flight_.complete_all(ReplyStatus::Timeout, done);
+            break;
+        }
+        in_flight_.expire(now, gap, done);
+    }
+
+    std::vector<CommandReply> out;
+    out.swap(results_);
+    return out;
+}
+
+} // namespace tr3
@@ -0,0 +1,370 @@
+// 非同期コマンドエンジン
+#include "../include/command_engine.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/inventory_cycle.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// 要求の生成
+// ───────────────────────────────────
+template <size_t N>
+static std::vector<uint8_t> to_vec(const FixedFrame<N>& f) { return std::vector<uint8_t>(f.data(), f.data() + f.size()); }
+
+Command cmd_rom_version(uint32_t timeout_ms) {
+    return Command{to_vec(make_frame_fixed(ADDR_DEFAULT, CMD_ROM_REQ, DETAIL_ROM)), Expect::Ack, DETAIL_ROM, timeout_ms};
+}
+
+Command cmd_read_mode(uint32_t timeout_ms) {
+    return Command{to_vec(make_frame_fixed(ADDR_DEFAULT, CMD_MODE_RD, DETAIL_MODE_R)), Expect::Ack, DETAIL_MODE_R, timeout_ms};
+}
+
+Command cmd_write_mode(const ReaderModeRaw& current, uint8_t new_mode, uint32_t timeout_ms) {
+    Command c;
+    c.expect     = Expect::Ack;
+    c.ack_detail = 0x00;   // ACK は書き込みの詳細コード（RAM=00h）を返す
+    c.timeout_ms = timeout_ms;
+    if (current.bytes.size() >= 4) c.frame = to_vec(make_mode_write_frame(new_mode, current.bytes[2], current.bytes[3]));
+    return c;
+}
+
+Command cmd_buzzer(uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms) {
+    return Command{to_vec(make_frame_fixed(ADDR_DEFAULT, CMD_BUZZER, response_type, sound_type)),
+                   response_type == 0x00 ? Expect::None : Expect::Ack, ACK_EMPTY, timeout_ms};
+}
+
+Command cmd_inventory2(uint32_t timeout_ms) {
+    return Command{to_vec(INV2_REQUEST), Expect::Inventory2, DETAIL_INV2_F0, timeout_ms};
+}
+
+Command cmd_read_blocks(const Uid& uid, uint8_t first, uint8_t count, uint32_t timeout_ms) {
+    return Command{make_block_read_frame(uid, first, count), Expect::Ack,
+                   count == 1 ? DETAIL_READ_SINGLE : DETAIL_READ_MULTI, timeout_ms};
+}
+
+Command cmd_write_blocks(const Uid& uid, uint8_t first, uint8_t count, const uint8_t* data, size_t n,
+                         uint32_t timeout_ms) {
+    return Command{make_block_write_frame(uid, first, count, data, n), Expect::Ack,
+                   count == 1 ? DETAIL_WRITE_SINGLE : DETAIL_WRITE_MULTI, timeout_ms};
+}
+
+bool ack_matches(const Command& c, const FrameView& f) {
+    if (f.cmd() != CMD_ACK) return false;
+    if (c.ack_detail == ACK_ANY)   return true;
+    if (c.ack_detail == ACK_EMPTY) return f.len() == 0;
+    return f.len() >= 1 && f[HEADER_LEN] == uint8_t(c.ack_detail);
+}
+
+// ───────────────────────────────────
+// 応答の読み出し
+// ───────────────────────────────────
+const char* reply_status_name(ReplyStatus s) {
+    switch (s) {
+    case ReplyStatus::Ok:         return "ok";
+    case ReplyStatus::Nack:       return "nack";
+    case ReplyStatus::Timeout:    return "timeout";
+    case ReplyStatus::WriteError: return "write_error";
+    case ReplyStatus::Cancelled:  return "cancelled";
+    }
+    return "?";
+}
+
+bool reply_rom_version(const CommandReply& r, std::string& out) {
+    if (!r.ok()) return false;
+    bool found = false;
+    r.each_frame([&](const FrameView& f) {
+        RomVersionAck ack;
+        if (!found && decode_rom_version_ack(f, ack)) { out = format_rom_version(ack); found = true; }
+    });
+    return found;
+}
+
+bool reply_reader_mode(const CommandReply& r, ReaderModeRaw& out) {
+    if (!r.ok()) return false;
+    bool found = false;
+    r.each_frame([&](const FrameView& f) {
+        ReaderModeAck ack;
+        if (!found && decode_reader_mode_ack(f, ack)) { out.bytes.assign(ack.bytes, ack.bytes + ack.len); found = true; }
+    });
+    return found;
+}
+
+bool reply_inventory(const CommandReply& r, InventoryResult& out) {
+    Inventory2Cycle cycle;
+    cycle.result().items.swap(out.items);   // 容量を使い回す
+    cycle.reset();
+    r.each_frame([&](const FrameView& f) { cycle.on_frame(f); });
+    out.items          = std::move(cycle.result().items);
+    out.expected_count = cycle.result().expected_count;
+    out.error_message  = cycle.result().error_message;
+    if (out.error_message.empty()) {
+        if      (r.status == ReplyStatus::Nack)                           out.error_message = nack_message(r.nack_code);
+        else if (r.status == ReplyStatus::WriteError)                     out.error_message = "送信エラー";
+        else if (r.status == ReplyStatus::Cancelled)                      out.error_message = "中止";
+        else if (r.status == ReplyStatus::Timeout && out.items.empty())   out.error_message = "タイムアウト";
+    }
+    return r.ok();
+}
+
+bool reply_blocks(const CommandReply& r, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!r.ok()) return false;
+    bool found = false;
+    r.each_frame([&](const FrameView& f) {
+        BlockReadAck ack;
+        if (!found && decode_block_read_ack(f, ack)) { out.assign(ack.data, ack.data + ack.len); found = true; }
+    });
+    return found;
+}
+
+// ───────────────────────────────────
+// 1 要求分の応答
+// ───────────────────────────────────
+RequestState::RequestState(Command c) : cmd(std::move(c)) {
+    reply.cmd = cmd.frame.size() > IDX_CMD ? cmd.frame[IDX_CMD] : 0;
+}
+
+void RequestState::on_sent(time_point now) {
+    t_sent   = now;
+    deadline = now + milliseconds(cmd.timeout_ms);
+}
+
+RequestState::Match RequestState::match(const FrameView& f) const {
+    switch (cmd.expect) {
+    case Expect::Ack:
+        return ack_matches(cmd, f) ? Match::Done : Match::No;
+    case Expect::Inventory2:
+        if (expected < 0) {
+            Inventory2Ack ack;
+            if (!decode_inventory2_ack(f, ack)) return Match::No;
+            return ack.count == 0 ? Match::Done : Match::More;
+        }
+        if (f.cmd() != RSP_UID) return Match::No;
+        return (received + 1 >= expected) ? Match::Done : Match::More;
+    case Expect::None:
+        break;
+    }
+    return Match::No;
+}
+
+void RequestState::on_frame(const FrameView& f, time_point now) {
+    if (!responded) {
+        responded = true;
+        reply.rtt = duration_cast<microseconds>(now - t_sent);
+        metrics().on_ack(reply.cmd, uint64_t(reply.rtt.count()));
+    }
+    t_last = now;
+    reply.frames.insert(reply.frames.end(), f.begin(), f.end());
+    if (cmd.expect == Expect::Inventory2) {
+        Inventory2Ack ack;
+        if (expected < 0 && decode_inventory2_ack(f, ack)) expected = ack.count;
+        else ++received;
+    }
+}
+
+void RequestState::on_nack(uint8_t code, const FrameView& f, time_point now) {
+    const bool first = !responded;
+    responded = true;
+    if (first) reply.rtt = duration_cast<microseconds>(now - t_sent);
+    t_last = now;
+    reply.frames.insert(reply.frames.end(), f.begin(), f.end());
+    reply.nack_code = code;
+    metrics().on_nack(reply.cmd, code, uint64_t(reply.rtt.count()));
+}
+
+RequestState::time_point RequestState::wake_at(microseconds gap) const {
+    if (cmd.expect == Expect::Inventory2 && received > 0) return std::min(deadline, t_last + gap);
+    return deadline;
+}
+
+bool RequestState::expired(time_point now, microseconds gap, ReplyStatus& st) const {
+    // Inventory2：UID 受信後は無通信ギャップで打ち切る（SUM エラーで欠けた分は待たない）
+    const bool quiet = cmd.expect == Expect::Inventory2 && received > 0 && now >= t_last + gap;
+    if (!quiet && now < deadline) return false;
+    st = (quiet || (cmd.expect == Expect::Inventory2 && expected >= 0)) ? ReplyStatus::Ok : ReplyStatus::Timeout;
+    return true;
+}
+
+void RequestState::finish(ReplyStatus st) {
+    reply.status = st;
+    auto& m = metrics();
+    if (st == ReplyStatus::Timeout && !responded) m.on_timeout(reply.cmd);
+    if (cmd.expect == Expect::Inventory2 && responded) {
+        if (st == ReplyStatus::Ok) m.on_inventory_cycle(uint64_t(duration_cast<microseconds>(steady_clock::now() - t_sent).count()));
+        m.add_uids(size_t(received));
+    }
+}
+
+void note_request_sent(const RequestState& rq) {
+    log_frame(LogTag::Send, rq.cmd.frame.data(), rq.cmd.frame.size());
+    metrics().on_request(rq.reply.cmd);
+}
+
+void note_write_error() {
+    metrics().add_write_error();
+    log_text(LogLevel::Error, LogTag::Cmt, std::string("送信エラー"));
+}
+
+// ───────────────────────────────────
+// エンジン
+// ───────────────────────────────────
+CommandEngine::CommandEngine(Transport& sp, CommandEngineConfig cfg)
+    : sp_(sp), cfg_(cfg), unsolicited_(cfg.unsolicited_capacity)
+{
+    if (cfg_.max_in_flight == 0) cfg_.max_in_flight = 1;
+}
+
+bool CommandEngine::start(UnsolicitedCallback cb) {
+    if (running()) return false;
+    unsolicited_cb_ = std::move(cb);
+    stop_req_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    th_ = std::thread([this] { io_loop(); });
+    return true;
+}
+
+void CommandEngine::stop() {
+    if (th_.joinable()) {
+        stop_req_.store(true, std::memory_order_release);
+        sp_.wake();
+        th_.join();
+    }
+    running_.store(false, std::memory_order_release);
+
+    // 未完了の要求は中止として返す（I/O スレッドは止まっているのでここで触ってよい）
+    std::deque<Pending> rest;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        rest.swap(queue_);
+        queued_.store(0, std::memory_order_relaxed);
+    }
+    in_flight_.complete_all(ReplyStatus::Cancelled, [this](Pending& p, ReplyStatus st) { complete(p, st); });
+    for (auto& p : rest) complete(p, ReplyStatus::Cancelled);
+}
+
+std::future<CommandReply> CommandEngine::submit(Command c) {
+    auto pr = std::make_shared<std::promise<CommandReply>>();
+    auto fu = pr->get_future();
+    submit(std::move(c), [pr](const CommandReply& r) { pr->set_value(r); });
+    return fu;
+}
+
+void CommandEngine::submit(Command c, ReplyCallback cb) {
+    Pending p{RequestState(std::move(c)), std::move(cb)};
+    n_submitted_.fetch_add(1, std::memory_order_relaxed);
+    {
+        // stop() は running_ を下ろしてから queue_ を空けるので、ここで動作中と見えたものは必ず完了する
+        std::lock_guard<std::mutex> lk(mu_);
+        if (running()) {
+            queue_.push_back(std::move(p));
+            queued_.fetch_add(1);
+            // 待っている I/O スレッドだけ起こす（送信中・応答待ちで枠が一杯なら起こさない）
+            if (idle_wait_.load()) sp_.wake();
+            return;
+        }
+    }
+    complete(p, ReplyStatus::Cancelled);   // 開始前・停止後は送らない（呼び出したスレッドで完了する）
+}
+
+CommandEngineStats CommandEngine::stats() const {
+    CommandEngineStats s;
+    s.submitted   = n_submitted_.load(std::memory_order_relaxed);
+    s.completed   = n_completed_.load(std::memory_order_relaxed);
+    s.timeouts    = n_timeouts_.load(std::memory_order_relaxed);
+    s.nacks       = n_nacks_.load(std::memory_order_relaxed);
+    s.lost        = n_lost_.load(std::memory_order_relaxed);
+    s.unsolicited = n_unsolicited_.load(std::memory_order_relaxed);
+    s.dropped     = n_dropped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void CommandEngine::complete(Pending& p, ReplyStatus st) {
+    p.rq.finish(st);
+    if (st == ReplyStatus::Timeout) n_timeouts_.fetch_add(1, std::memory_order_relaxed);
+    if (st == ReplyStatus::Nack)    n_nacks_.fetch_add(1, std::memory_order_relaxed);
+    n_completed_.fetch_add(1, std::memory_order_relaxed);
+    if (p.cb) p.cb(p.rq.reply);
+}
+
+void CommandEngine::to_unsolicited(const FrameView& f, steady_clock::time_point now) {
+    n_unsolicited_.fetch_add(1, std::memory_order_relaxed);
+    if (unsolicited_cb_) { unsolicited_cb_(f); return; }
+    UnsolicitedFrame u;
+    std::memcpy(u.bytes.data(), f.data, f.size);
+    u.size   = uint16_t(f.size);
+    u.t_mono = now;
+    if (!unsolicited_.push(u)) n_dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CommandEngine::io_loop() {
+    FrameParser      parser;
+    FrameParserStats parser_last;
+    std::deque<Pending> batch;
+    auto done = [this](Pending& p, ReplyStatus st) { complete(p, st); };
+
+    while (!stop_req_.load(std::memory_order_acquire)) {
+        // 送信枠が空いていれば積まれた要求を送る
+        if (in_flight_.size() < cfg_.max_in_flight && queued_.load(std::memory_order_acquire) > 0) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                size_t room = cfg_.max_in_flight - in_flight_.size();
+                while (room > 0 && !queue_.empty()) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                    --room;
+                }
+                queued_.store(queue_.size(), std::memory_order_release);
+            }
+            in_flight_.send(sp_, batch, tx_, done);   // 応答なし・送信エラーはここで完了する
+            if (in_flight_.size() < cfg_.max_in_flight && queued_.load(std::memory_order_acquire) > 0) continue;
+        }
+
+        // 応答終端の無通信ギャップ（学習・速度変更に追従するよう毎回読み直す）
+        const auto gap = sp_.end_of_response_gap();
+
+        // 受信期限：先頭の要求の期限。送信枠が空いていれば新しい要求に気付けるようにする
+        // （wake() 対応なら submit() が待ちを打ち切る。非対応なら idle_poll_ms で区切る）
+        auto now = steady_clock::now();
+        const bool idle = in_flight_.size() < cfg_.max_in_flight;
+        auto wait_until = now + (sp_.wakeable() ? milliseconds(1000) : milliseconds(cfg_.idle_poll_ms));
+        if (!in_flight_.empty()) {
+            const auto t = in_flight_.front().rq.wake_at(gap);
+            wait_until = idle ? std::min(wait_until, t) : t;
+        }
+        if (idle) {
+            // 先に待つことを示してから積まれた要求を確かめる（submit との間で通知を取りこぼさない）
+            idle_wait_.store(true);
+            if (queued_.load() > 0 || stop_req_.load()) wait_until = now;
+        }
+
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp_.read_some(dst, room, wait_until);
+        if (idle) idle_wait_.store(false, std::memory_order_relaxed);
+        now = steady_clock::now();
+        if (n) {
+            if (!in_flight_.empty() && in_flight_.front().rq.cmd.expect == Expect::Inventory2 && in_flight_.front().rq.received > 0)
+                sp_.gap_model().observe(duration_cast<microseconds>(now - in_flight_.front().rq.t_last));   // UID 間の間隔を学習
+            parser.commit(n);
+            FrameView f;
+            uint64_t lost = 0;
+            while (parser.next(f)) {
+                log_frame(LogTag::Recv, f.data, f.size);
+                if (!in_flight_.dispatch(f, now, lost, done)) to_unsolicited(f, now);
+            }
+            if (lost) n_lost_.fetch_add(lost, std::memory_order_relaxed);
+            metrics().add_parser(parser.stats(), parser_last);
+        }
+        in_flight_.expire(now, gap, done);
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,227 @@
+// EventRingPublisher / EventRingSubscriber: POSIX 共有メモリ実装
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "../include/event_ring.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+static const char RING_MAGIC[8] = {'T', 'R', '3', 'R', 'I', 'N', 'G', 0};
+
+static int64_t wall_ns() {
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+const char* ring_event_kind_name(RingEventKind k) {
+    switch (k) {
+    case RingEventKind::Read:   return "read";
+    case RingEventKind::Arrive: return "arrive";
+    case RingEventKind::Depart: return "depart";
+    }
+    return "?";
+}
+
+//===============================
+// 発行側
+//===============================
+bool EventRingPublisher::open(const std::string& name, size_t capacity) {
+    close();
+    if (name.size() < 2 || name[0] != '/') { last_error_ = "共有メモリ名は / で始めてください: " + name; return false; }
+    size_t cap = 1;
+    while (cap < capacity && cap < (size_t(1) << 30)) cap <<= 1;
+
+    // 前回の残り（落ちた発行側など）は消して作り直す。開いたままの購読側は古い方を見続ける
+    ::shm_unlink(name.c_str());
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) { last_error_ = "shm_open 失敗: " + name + " (" + std::strerror(errno) + ")"; return false; }
+    const size_t bytes = sizeof(EventRingHeader) + cap * sizeof(EventRingSlot);
+    if (::ftruncate(fd, off_t(bytes)) != 0) {
+        last_error_ = std::string("ftruncate 失敗: ") + std::strerror(errno);
+        ::close(fd); ::shm_unlink(name.c_str());
+        return false;
+    }
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        last_error_ = std::string("mmap 失敗: ") + std::strerror(errno);
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate した領域は 0 埋め（スロットの seq = 0 は未使用）。最初の一周でページを割り当てずに済むよう、
+    // ここで全ページに触れておく。ヘッダを書いてから発行中にする
+    std::memset(p, 0, bytes);
+    auto* h = static_cast<EventRingHeader*>(p);
+    std::memcpy(h->magic, RING_MAGIC, sizeof(h->magic));
+    h->version         = EVENT_RING_VERSION;
+    h->slot_size       = uint16_t(sizeof(EventRingSlot));
+    h->capacity        = uint32_t(cap);
+    h->created_wall_ns = wall_ns();
+    h->publisher_pid   = int64_t(::getpid());
+    h->head.store(0, std::memory_order_relaxed);
+    h->state.store(EVENT_RING_LIVE, std::memory_order_release);
+
+    name_  = name;
+    base_  = p;
+    bytes_ = bytes;
+    hdr_   = h;
+    slots_ = reinterpret_cast<EventRingSlot*>(static_cast<uint8_t*>(p) + sizeof(EventRingHeader));
+    mask_  = cap - 1;
+    seq_   = 0;
+    return true;
+}
+
+void EventRingPublisher::close() {
+    if (!hdr_) return;
+    hdr_->state.store(EVENT_RING_CLOSED, std::memory_order_release);
+    ::munmap(base_, bytes_);
+    ::shm_unlink(name_.c_str());
+    base_ = nullptr; hdr_ = nullptr; slots_ = nullptr; bytes_ = 0;
+}
+
+void EventRingPublisher::write_slot(uint32_t reader_id, RingEventKind kind, const Uid& uid, uint8_t dsfid, int64_t t) {
+    const uint64_t seq = ++seq_;
+    EventRingSlot& s = slots_[(seq - 1) & mask_];
+    RingEvent ev{};
+    ev.seq       = seq;
+    ev.t_wall_ns = t;
+    ev.reader_id = reader_id;
+    ev.kind      = uint8_t(kind);
+    ev.dsfid     = dsfid;
+    std::memcpy(ev.uid, uid.bytes.data(), sizeof(ev.uid));
+
+    // 書き込み中（0）にしてから中身を書き、最後に seq を入れる
+    s.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&s.ev, &ev, sizeof(ev));
+    s.seq.store(seq, std::memory_order_release);
+}
+
+void EventRingPublisher::publish(uint32_t reader_id, RingEventKind kind, const Uid& uid, uint8_t dsfid, int64_t t_wall_ns) {
+    if (!hdr_) return;
+    write_slot(reader_id, kind, uid, dsfid, t_wall_ns ? t_wall_ns : wall_ns());
+    hdr_->head.store(seq_, std::memory_order_release);
+}
+
+void EventRingPublisher::publish(uint32_t reader_id, const InventoryResult& r, int64_t t_wall_ns) {
+    if (!hdr_ || r.items.empty()) return;
+    const int64_t t = t_wall_ns ? t_wall_ns : wall_ns();
+    for (const auto& it : r.items) write_slot(reader_id, RingEventKind::Read, it.uid, it.dsfid, t);
+    hdr_->head.store(seq_, std::memory_order_release);
+}
+
+void EventRingPublisher::publish(uint32_t reader_id, const TagEvent& e, int64_t t_wall_ns) {
+    publish(reader_id, e.kind == TagEvent::Kind::Arrive ? RingEventKind::Arrive : RingEventKind::Depart,
+            e.tag.uid, e.tag.dsfid, t_wall_ns);
+}
+
+//===============================
+// 購読側
+//===============================
+bool EventRingSubscriber::open(const std::string& name, bool from_oldest) {
+    close();
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) { last_error_ = "shm_open 失敗: " + name + " (" + std::strerror(errno) + ")"; return false; }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(EventRingHeader)) {
+        last_error_ = "共有メモリが小さすぎます: " + name;
+        ::close(fd);
+        return false;
+    }
+    const size_t bytes = size_t(st.st_size);
+    void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { last_error_ = std::string("mmap 失敗: ") + std::strerror(errno); return false; }
+
+    const auto* h = static_cast<const EventRingHeader*>(p);
+    const uint64_t cap = h->capacity;
+    std::string err;
+    if (h->state.load(std::memory_order_acquire) == 0)          err = "発行側が準備中です: ";
+    else if (std::memcmp(h->magic, RING_MAGIC, sizeof(h->magic)) != 0) err = "イベントリングではありません: ";
+    else if (h->version != EVENT_RING_VERSION || h->slot_size != sizeof(EventRingSlot)) err = "未対応の形式です: ";
+    else if (cap == 0 || (cap & (cap - 1)) != 0 || bytes < sizeof(EventRingHeader) + cap * sizeof(EventRingSlot))
+        err = "容量が不正です: ";
+    if (!err.empty()) { last_error_ = err + name; ::munmap(p, bytes); return false; }
+
+    base_  = p;
+    bytes_ = bytes;
+    hdr_   = h;
+    slots_ = reinterpret_cast<const EventRingSlot*>(static_cast<const uint8_t*>(p) + sizeof(EventRingHeader));
+    mask_  = cap - 1;
+    stats_ = EventRingStats{};
+
+    const uint64_t head = h->head.load(std::memory_order_acquire);
+    next_ = from_oldest && head > cap ? head - cap + 1 : (from_oldest ? 1 : head + 1);
+    return true;
+}
+
+void EventRingSubscriber::close() {
+    if (!hdr_) return;
+    ::munmap(base_, bytes_);
+    base_ = nullptr; hdr_ = nullptr; slots_ = nullptr; peeked_ = nullptr; bytes_ = 0;
+}
+
+void EventRingSubscriber::skip_to(uint64_t seq) {
+    if (seq <= next_) return;
+    stats_.lost += seq - next_;
+    ++stats_.overruns;
+    next_ = seq;
+}
+
+const RingEvent* EventRingSubscriber::peek() {
+    peeked_ = nullptr;
+    if (!hdr_) return nullptr;
+    while (true) {
+        const uint64_t head = hdr_->head.load(std::memory_order_acquire);
+        if (next_ > head) return nullptr;
+        // 一周以上遅れていれば残っている最古まで飛ばす
+        if (head - next_ > mask_) skip_to(head - mask_);
+
+        const EventRingSlot& s = slots_[(next_ - 1) & mask_];
+        if (s.seq.load(std::memory_order_acquire) == next_) { peeked_ = &s; return &s.ev; }
+        // 読む前に上書きされ始めた。head を読み直して飛ばす
+        skip_to(std::max(next_ + 1, hdr_->head.load(std::memory_order_acquire) - mask_));
+    }
+}
+
+bool EventRingSubscriber::advance() {
+    if (!peeked_) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool ok = peeked_->seq.load(std::memory_order_relaxed) == next_;
+    peeked_ = nullptr;
+    if (ok) { ++next_; ++stats_.received; }
+    else    skip_to(next_ + 1);
+    return ok;
+}
+
+bool EventRingSubscriber::next(RingEvent& out) {
+    while (const RingEvent* e = peek()) {
+        std::memcpy(&out, e, sizeof(out));
+        if (advance()) return true;
+    }
+    return false;
+}
+
+uint64_t EventRingSubscriber::lag() const {
+    if (!hdr_) return 0;
+    const uint64_t head = hdr_->head.load(std::memory_order_acquire);
+    return head >= next_ ? head - next_ + 1 : 0;
+}
+
+bool EventRingSubscriber::publisher_gone() const {
+    if (!hdr_) return true;
+    if (hdr_->state.load(std::memory_order_acquire) != EVENT_RING_LIVE) return true;
+    const pid_t pid = pid_t(hdr_->publisher_pid);
+    return ::kill(pid, 0) != 0 && errno == ESRCH;   // 閉じずに落ちた
+}
+
+} // namespace tr3
@@ -0,0 +1,103 @@
+// TR3 受信フレームの逐次パーサ
+#include <cstring>
+#include <algorithm>
+
+#include "../include/frame_parser.hpp"
+
+namespace tr3 {
+
+FrameParser::FrameParser(size_t capacity)
+    : buf_(std::max(capacity, 2 * MAX_FRAME)) {}
+
+void FrameParser::reset() {
+    head_ = tail_ = 0;
+    stats_ = FrameParserStats{};
+}
+
+uint8_t* FrameParser::prepare(size_t& room) {
+    if (tail_ == buf_.size()) {
+        if (head_ > 0) {
+            // 処理済み領域を捨てて未処理データを先頭へ詰める（償却 O(1)/byte）
+            std::memmove(buf_.data(), buf_.data() + head_, tail_ - head_);
+            tail_ -= head_;
+            head_ = 0;
+        } else {
+            // 容量いっぱいで1フレームも取り出せない＝壊れたデータ。全破棄して受け直す
+            stats_.bytes_discarded += tail_;
+            ++stats_.overflows;
+            head_ = tail_ = 0;
+        }
+    }
+    room = buf_.size() - tail_;
+    return buf_.data() + tail_;
+}
+
+void FrameParser::commit(size_t n) {
+    tail_ = std::min(tail_ + n, buf_.size());
+}
+
+size_t FrameParser::feed(const uint8_t* src, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        size_t room = 0;
+        uint8_t* dst = prepare(room);
+        const size_t k = std::min(room, n - done);
+        std::memcpy(dst, src + done, k);
+        commit(k);
+        done += k;
+    }
+    return done;
+}
+
+bool FrameParser::next(FrameView& out) {
+    while (head_ < tail_) {
+        const uint8_t* base = buf_.data();
+
+        // STX までまとめて読み飛ばす
+        if (base[head_] != STX) {
+            const uint8_t* p = find_byte(base + head_, tail_ - head_, STX);
+            const size_t stx = p ? size_t(p - base) : tail_;
+            ++stats_.resyncs;
+            stats_.bytes_discarded += stx - head_;
+            head_ = stx;
+            if (head_ == tail_) { head_ = tail_ = 0; return false; }
+        }
+
+        const size_t avail = tail_ - head_;
+        if (avail < HEADER_LEN) return false;
+        const size_t need = HEADER_LEN + base[head_ + IDX_LEN] + FOOTER_LEN;
+        if (avail < need) return false;
+
+        // バッファは確保済みなので末尾の先まで読んでよい（SUM を 1 回のロードで計算できる）
+        if (!check_frame_at(base + head_, need, buf_.size() - head_)) {
+            // 偽の STX だった：1バイト進めて再同期
+            ++stats_.checksum_failures;
+            ++head_;
+            continue;
+        }
+
+        out.data = base + head_;
+        out.size = need;
+        head_ += need;
+        ++stats_.frames;
+        return true;
+    }
+    // 全て消費したら先頭に戻す（詰め直しを減らす）
+    if (head_ == tail_) head_ = tail_ = 0;
+    return false;
+}
+
+const uint8_t* FrameParser::next_batch(FrameIndex& out) {
+    out.clear();
+    const uint8_t* base = buf_.data() + head_;
+    parse_frames(base, tail_ - head_, out);
+    head_ += out.consumed;
+    stats_.frames            += out.stats.frames;
+    stats_.resyncs           += out.stats.resyncs;
+    stats_.bytes_discarded   += out.stats.bytes_discarded;
+    stats_.checksum_failures += out.stats.checksum_failures;
+    // 詰め直しはしない（返した索引が指す領域を次の prepare()/feed() まで保つ）
+    return base;
+}
+
+} // namespace tr3
@@ -0,0 +1,255 @@
+// フレーム一括抽出とベクトル化カーネル（SSE2 / AVX2 / スカラ）
+#include "../include/frame_scan.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TR3_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TR3_TARGET_AVX2
+#else
+#define TR3_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace tr3 {
+
+namespace {
+
+// ───────────────────────────────────
+// スカラ
+// ───────────────────────────────────
+const uint8_t* find_scalar(const uint8_t* p, size_t n, uint8_t b) {
+    return static_cast<const uint8_t*>(std::memchr(p, b, n));
+}
+
+uint8_t sum_scalar(const uint8_t* p, size_t n) {
+    uint32_t s = 0;
+    for (size_t i = 0; i < n; ++i) s += p[i];
+    return uint8_t(s);
+}
+
+#ifdef TR3_SCAN_X86
+// 先頭 k バイトだけ 0xFF のマスクを MASK + 32 - k から読む
+alignas(64) const uint8_t MASK[64] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+inline unsigned ctz32(uint32_t m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return unsigned(i);
+#else
+    return unsigned(__builtin_ctz(m));
+#endif
+}
+
+inline uint64_t hsum_sad128(__m128i acc) {
+    alignas(16) uint64_t v[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(v), acc);
+    return v[0] + v[1];
+}
+
+// ───────────────────────────────────
+// SSE2（x86-64 では常に使える）
+// ───────────────────────────────────
+const uint8_t* find_sse2(const uint8_t* p, size_t n, uint8_t b) {
+    const __m128i t = _mm_set1_epi8(char(b));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), t));
+        if (m) return p + i + ctz32(uint32_t(m));
+    }
+    for (; i < n; ++i) if (p[i] == b) return p + i;
+    return nullptr;
+}
+
+// psadbw で 8 バイトずつの和を 64 ビットに積む（桁あふれなし）
+uint8_t sum_sse2(const uint8_t* p, size_t n) {
+    const __m128i z = _mm_setzero_si128();
+    __m128i acc = z;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), z));
+    return uint8_t(hsum_sad128(acc) + sum_scalar(p + i, n - i));
+}
+
+// n <= 16、p から 16 バイト読めること
+uint8_t sum_short_sse2(const uint8_t* p, size_t n) {
+    const __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(MASK + 32 - n)));
+    return uint8_t(hsum_sad128(_mm_sad_epu8(v, _mm_setzero_si128())));
+}
+
+// ───────────────────────────────────
+// AVX2
+// ───────────────────────────────────
+TR3_TARGET_AVX2 uint64_t hsum_sad256(__m256i acc) {
+    return hsum_sad128(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+}
+
+TR3_TARGET_AVX2 const uint8_t* find_avx2(const uint8_t* p, size_t n, uint8_t b) {
+    const __m256i t = _mm256_set1_epi8(char(b));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const uint32_t m = uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), t)));
+        if (m) return p + i + ctz32(m);
+    }
+    return find_sse2(p + i, n - i, b);
+}
+
+TR3_TARGET_AVX2 uint8_t sum_avx2(const uint8_t* p, size_t n) {
+    const __m256i z = _mm256_setzero_si256();
+    __m256i acc = z;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), z));
+    return uint8_t(hsum_sad256(acc) + sum_sse2(p + i, n - i));
+}
+
+// n <= 32、p から 32 バイト読めること
+TR3_TARGET_AVX2 uint8_t sum_short_avx2(const uint8_t* p, size_t n) {
+    const __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(MASK + 32 - n)));
+    return uint8_t(hsum_sad256(_mm256_sad_epu8(v, _mm256_setzero_si256())));
+}
+#endif // TR3_SCAN_X86
+
+// ───────────────────────────────────
+// 選択
+// ───────────────────────────────────
+struct Kernels {
+    SimdLevel level;
+    const uint8_t* (*find)(const uint8_t*, size_t, uint8_t);
+    uint8_t (*sum)(const uint8_t*, size_t);
+    uint8_t (*sum_short)(const uint8_t*, size_t);   // short_width バイト読めるとき、その長さまで
+    size_t short_width;
+};
+
+const Kernels K_SCALAR = {SimdLevel::Scalar, find_scalar, sum_scalar, nullptr, 0};
+#ifdef TR3_SCAN_X86
+const Kernels K_SSE2   = {SimdLevel::Sse2, find_sse2, sum_sse2, sum_short_sse2, 16};
+const Kernels K_AVX2   = {SimdLevel::Avx2, find_avx2, sum_avx2, sum_short_avx2, 32};
+#endif
+
+SimdLevel detect() {
+#ifdef TR3_SCAN_X86
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 1);
+    const bool sse2    = (r[3] & (1 << 26)) != 0;
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    __cpuidex(r, 7, 0);
+    const bool avx2 = osxsave && (r[1] & (1 << 5)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return SimdLevel::Avx2;
+    if (sse2) return SimdLevel::Sse2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const Kernels* kernels_for(SimdLevel lv) {
+#ifdef TR3_SCAN_X86
+    if (lv == SimdLevel::Avx2) return &K_AVX2;
+    if (lv == SimdLevel::Sse2) return &K_SSE2;
+#endif
+    (void)lv;
+    return &K_SCALAR;
+}
+
+std::atomic<const Kernels*> g_kernels{nullptr};
+
+const Kernels& kernels() {
+    const Kernels* k = g_kernels.load(std::memory_order_acquire);
+    if (!k) {
+        k = kernels_for(detect());
+        g_kernels.store(k, std::memory_order_release);   // 競合しても同じ値
+    }
+    return *k;
+}
+
+} // namespace
+
+SimdLevel simd_supported() {
+    static const SimdLevel lv = detect();
+    return lv;
+}
+
+SimdLevel simd_level() { return kernels().level; }
+
+SimdLevel set_simd_level(SimdLevel lv) {
+    if (uint8_t(lv) > uint8_t(simd_supported())) lv = simd_supported();
+    g_kernels.store(kernels_for(lv), std::memory_order_release);
+    return lv;
+}
+
+const char* simd_level_name(SimdLevel lv) {
+    switch (lv) {
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Sse2: return "sse2";
+    default:              return "scalar";
+    }
+}
+
+const uint8_t* find_byte(const uint8_t* p, size_t n, uint8_t b) { return kernels().find(p, n, b); }
+uint8_t        sum_bytes(const uint8_t* p, size_t n)            { return kernels().sum(p, n); }
+
+namespace {
+inline bool check_with(const Kernels& k, const uint8_t* p, size_t need, size_t readable) {
+    if (need < HEADER_LEN + FOOTER_LEN || readable < need) return false;
+    if (p[need - 1] != CR || p[need - 3] != ETX) return false;
+    const size_t m = need - 2;   // SUM の対象（STX〜ETX）
+    const uint8_t s = (m <= k.short_width && readable >= k.short_width) ? k.sum_short(p, m) : k.sum(p, m);
+    return s == p[need - 2];
+}
+} // namespace
+
+bool check_frame_at(const uint8_t* p, size_t need, size_t readable) {
+    return check_with(kernels(), p, need, readable);
+}
+
+size_t parse_frames(const uint8_t* data, size_t n, FrameIndex& out) {
+    const Kernels& k = kernels();
+    FrameScanStats& st = out.stats;
+    size_t pos = 0;
+    while (pos < n) {
+        // STX までまとめて読み飛ばす
+        if (data[pos] != STX) {
+            const uint8_t* q = k.find(data + pos, n - pos, STX);
+            const size_t stx = q ? size_t(q - data) : n;
+            ++st.resyncs;
+            st.bytes_discarded += stx - pos;
+            pos = stx;
+            if (pos == n) break;
+        }
+
+        const size_t avail = n - pos;
+        if (avail < HEADER_LEN) break;
+        const size_t need = HEADER_LEN + data[pos + IDX_LEN] + FOOTER_LEN;
+        if (avail < need) break;
+
+        if (!check_with(k, data + pos, need, avail)) {
+            // 偽の STX だった：1バイト進めて再同期
+            ++st.checksum_failures;
+            ++pos;
+            continue;
+        }
+        out.frames.push_back(FrameRef{uint32_t(pos), uint16_t(need)});
+        ++st.frames;
+        pos += need;
+    }
+    out.consumed = pos;
+    return pos;
+}
+
+} // namespace tr3
@@ -0,0 +1,138 @@
+// 読み取り結果の出力
+#include "../include/inventory_output.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace tr3 {
+
+static const struct { const char* name; OutputFormat f; } FORMATS[] = {
+    {"text", OutputFormat::Text}, {"csv", OutputFormat::Csv}, {"jsonl", OutputFormat::Jsonl}, {"binary", OutputFormat::Binary},
+};
+static const struct { const char* name; OutputEmit e; } EMITS[] = {
+    {"reads", OutputEmit::Reads}, {"presence", OutputEmit::Presence}, {"all", OutputEmit::All},
+};
+
+bool parse_output_format(const std::string& s, OutputFormat& out) {
+    for (const auto& f : FORMATS) if (s == f.name) { out = f.f; return true; }
+    return false;
+}
+const char* output_format_name(OutputFormat f) {
+    for (const auto& x : FORMATS) if (x.f == f) return x.name;
+    return "?";
+}
+bool parse_output_emit(const std::string& s, OutputEmit& out) {
+    for (const auto& e : EMITS) if (s == e.name) { out = e.e; return true; }
+    return false;
+}
+const char* output_emit_name(OutputEmit e) {
+    for (const auto& x : EMITS) if (x.e == e) return x.name;
+    return "?";
+}
+
+bool InventoryOutput::open(const std::string& path, OutputFormat fmt) {
+    close();
+    fmt_ = fmt;
+    if (path.empty() || path == "-") {
+        fp_ = stdout;
+        own_ = false;
+#ifdef _WIN32
+        // テキストモードのままだと 0x0A が CRLF に化ける
+        if (fmt == OutputFormat::Binary) ::_setmode(::_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        fp_ = std::fopen(path.c_str(), fmt == OutputFormat::Binary ? "wb" : "w");
+        if (!fp_) { last_error_ = "出力先を開けません: " + path + " (" + std::strerror(errno) + ")"; return false; }
+        own_ = true;
+    }
+    buf_.clear();
+    buf_.reserve(64 * 1024);
+    seq_ = 0;
+    if (fmt_ == OutputFormat::Csv) buf_ += "time,t_wall_ns,reader,cycle,kind,uid,dsfid\n";
+    return true;
+}
+
+void InventoryOutput::close() {
+    if (!fp_) return;
+    flush();
+    if (own_) std::fclose(fp_);
+    fp_ = nullptr;
+}
+
+void InventoryOutput::write(uint32_t reader_id, uint64_t cycle, JournalKind kind, const Uid& uid, uint8_t dsfid,
+                            int64_t t_wall_ns) {
+    if (!fp_) return;
+    ++seq_;
+    if (fmt_ == OutputFormat::Binary) {
+        JournalRecord r{};
+        r.seq       = seq_;
+        r.t_wall_ns = t_wall_ns;
+        r.reader_id = reader_id;
+        r.kind      = uint8_t(kind);
+        r.dsfid     = dsfid;
+        std::memcpy(r.uid, uid.bytes.data(), sizeof(r.uid));
+        buf_.append(reinterpret_cast<const char*>(&r), sizeof(r));
+        return;
+    }
+
+    static const char HEX[] = "0123456789ABCDEF";
+    char hex[17];
+    for (size_t i = 0; i < 8; ++i) { hex[i * 2] = HEX[uid[i] >> 4]; hex[i * 2 + 1] = HEX[uid[i] & 0x0F]; }
+    hex[16] = '\0';
+
+    const int64_t sec = t_wall_ns >= 0 ? t_wall_ns / 1000000000 : (t_wall_ns - 999999999) / 1000000000;
+    const int     ms  = int((t_wall_ns - sec * 1000000000) / 1000000);
+    if (fmt_ != OutputFormat::Jsonl && sec != cached_sec_) {
+        cached_sec_ = sec;
+        const std::time_t t = std::time_t(sec);
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        std::strftime(prefix_, sizeof(prefix_), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+
+    char line[192];
+    int n = 0;
+    const char* k = journal_kind_name(kind);
+    switch (fmt_) {
+    case OutputFormat::Text:
+        n = std::snprintf(line, sizeof(line), "%s.%03d  reader=%u  cycle=%llu  %-6s  %s  dsfid=%02X\n",
+                          prefix_, ms, unsigned(reader_id), (unsigned long long)cycle, k, hex, unsigned(dsfid));
+        break;
+    case OutputFormat::Csv:
+        n = std::snprintf(line, sizeof(line), "%s.%03d,%lld,%u,%llu,%s,%s,%02X\n",
+                          prefix_, ms, (long long)t_wall_ns, unsigned(reader_id), (unsigned long long)cycle, k, hex,
+                          unsigned(dsfid));
+        break;
+    default:
+        n = std::snprintf(line, sizeof(line),
+                          "{\"t_wall_ns\":%lld,\"reader\":%u,\"cycle\":%llu,\"kind\":\"%s\",\"uid\":\"%s\",\"dsfid\":\"%02X\"}\n",
+                          (long long)t_wall_ns, unsigned(reader_id), (unsigned long long)cycle, k, hex, unsigned(dsfid));
+        break;
+    }
+    if (n > 0) buf_.append(line, size_t(n));
+}
+
+void InventoryOutput::write(uint32_t reader_id, uint64_t cycle, const InventoryResult& r, int64_t t_wall_ns) {
+    for (const auto& it : r.items) write(reader_id, cycle, JournalKind::Read, it.uid, it.dsfid, t_wall_ns);
+}
+
+bool InventoryOutput::flush() {
+    if (!fp_) return false;
+    bool ok = true;
+    if (!buf_.empty()) ok = std::fwrite(buf_.data(), 1, buf_.size(), fp_) == buf_.size();
+    buf_.clear();
+    if (std::fflush(fp_) != 0) ok = false;
+    if (!ok) last_error_ = std::string("出力に書き込めません: ") + std::strerror(errno);
+    return ok;
+}
+
+} // namespace tr3
@@ -0,0 +1,157 @@
+// パイプライン化した Inventory2 ループ
+#include "../include/inventory_pipeline.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/inventory_cycle.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+InventoryPipeline::InventoryPipeline(Transport& sp, PipelineConfig cfg)
+    : sp_(sp), cfg_(cfg),
+      // 毎サイクル同じフレームなので最初に1回だけ作る（固定長・ヒープ確保なし）
+      buz_found_(make_frame_fixed(ADDR_DEFAULT, CMD_BUZZER, uint8_t(0x00), cfg.sound_found)),
+      buz_none_ (make_frame_fixed(ADDR_DEFAULT, CMD_BUZZER, uint8_t(0x00), cfg.sound_none))
+{
+}
+
+bool InventoryPipeline::send_inventory() {
+    metrics().on_request(CMD_INV2);
+    if (sp_.write(INV2_REQUEST.data(), INV2_REQUEST.size())) return true;
+    metrics().add_write_error();
+    return false;
+}
+
+void InventoryPipeline::drain_input() {
+    // 無通信が drain_ms 続くまで読み捨てる（流れ続けても cycle_timeout_ms で打ち切る）
+    uint8_t buf[256];
+    const auto limit = steady_clock::now() + milliseconds(cfg_.cycle_timeout_ms);
+    for (auto now = steady_clock::now(); now < limit; now = steady_clock::now())
+        if (sp_.read_some(buf, sizeof(buf), std::min(limit, now + milliseconds(cfg_.drain_ms))) == 0) break;
+}
+
+PipelineStats InventoryPipeline::run(uint64_t cycles, const CycleCallback& cb) {
+    PipelineStats st;
+    stop_req_.store(false, std::memory_order_relaxed);
+
+    auto&            m = metrics();
+    FrameParser      parser;
+    FrameParserStats parser_last;     // 計測へ加え済みのパーサ統計
+    bool             acked = false;   // 現サイクルの ACK/NACK を計測済みか
+    bool             await_ack = false;   // 打ち切りの後：ACK/NACK が届くまでのフレームは前のサイクルの残り
+    Inventory2Cycle  cur, done;        // 受信中のサイクル／コールバックへ渡す完了済みサイクル
+    cur.result().items.reserve(64);
+    done.result().items.reserve(64);
+
+    // 応答終端の無通信ギャップ（学習・速度変更に追従するようサイクルごとに読み直す）
+    auto gap = sp_.end_of_response_gap();
+    // 壊れたフレームを見た後は、ACK／UID の受信からギャップが空いた時点でサイクルを終える
+    // （見ていなければ予告数は必ず届くので、cycle_timeout_ms だけを上限にする）
+    const auto& ps = parser.stats();
+    auto lost = [&] { return ps.checksum_failures + ps.overflows; };
+    uint64_t lost0 = 0;
+
+    const auto t_start = steady_clock::now();
+    auto t_sent = t_start;
+    auto t_rx   = t_start;          // 現サイクルで最後に受信した時刻
+    if (!send_inventory()) return st;
+
+    while (!stop_req_.load(std::memory_order_acquire)) {
+        const auto t_limit = t_sent + milliseconds(cfg_.cycle_timeout_ms);
+        const bool started = cur.expected() >= 0 || !cur.result().items.empty();
+        const bool gap_end = started && lost() > lost0;
+        const auto t_wait  = gap_end ? std::min(t_limit, t_rx + gap) : t_limit;
+
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp_.read_some(dst, room, t_wait);
+        if (n) { parser.commit(n); t_rx = steady_clock::now(); }
+
+        bool complete = false;
+        FrameView f;
+        while (!complete && parser.next(f)) {
+            if (await_ack) {
+                Inventory2Ack ack;
+                NackResponse  nack;
+                if (!decode_inventory2_ack(f, ack) && !decode_nack(f, nack)) continue;
+                await_ack = false;
+            }
+            const auto state = cur.on_frame(f);
+            if (!acked && cur.expected() >= 0) {
+                acked = true;
+                m.on_ack(CMD_INV2, uint64_t(duration_cast<microseconds>(steady_clock::now() - t_sent).count()));
+            }
+            if (state == Inventory2Cycle::State::Nack) {
+                ++st.nacks;
+                NackResponse nack;
+                m.on_nack(CMD_INV2, decode_nack(f, nack) ? nack.code : 0xFF,
+                          uint64_t(duration_cast<microseconds>(steady_clock::now() - t_sent).count()));
+                acked = true;
+            }
+            complete = (state != Inventory2Cycle::State::Pending);
+        }
+
+        const auto now = steady_clock::now();
+        bool timed_out = false, gap_ended = false;
+        if (!complete && now >= t_limit) {
+            cur.result().error_message = "タイムアウト";
+            ++st.timeouts;
+            if (!acked) m.on_timeout(CMD_INV2);
+            complete = timed_out = true;
+        } else if (!complete && n == 0 && gap_end && now >= t_wait) {
+            // 欠けたフレームは再送されないので、届いた分でサイクルを終える
+            ++st.gap_ends;
+            if (!acked) m.on_timeout(CMD_INV2);
+            complete = gap_ended = true;
+        }
+        if (!complete) continue;
+
+        // ── サイクル完了 ──
+        const uint64_t cycle_us = uint64_t(duration_cast<microseconds>(now - t_sent).count());
+        st.latency_us.record(cycle_us);
+        ++st.cycles;
+        st.uids += cur.result().items.size();
+        if (cur.state() == Inventory2Cycle::State::Done || (gap_ended && acked)) m.on_inventory_cycle(cycle_us);
+        m.add_uids(cur.result().items.size());
+        m.add_parser(parser.stats(), parser_last);
+        acked = false;
+
+        // 次サイクルを先に送る（ブザーは応答なしなので ACK が混ざらない）
+        bool more = (cycles == 0 || st.cycles < cycles) && !stop_req_.load(std::memory_order_acquire);
+        const bool found = !cur.result().items.empty();
+        if (cfg_.buzzer == BuzzerPolicy::Always || (cfg_.buzzer == BuzzerPolicy::OnRead && found))
+        {
+            const auto& bz = found ? buz_found_ : buz_none_;
+            sp_.write(bz.data(), bz.size());
+        }
+        if (more && timed_out) {
+            // 遅れて届く ACK・UID を次のサイクルへ数えないよう、受信済みの分も含めて捨ててから送る
+            drain_input();
+            parser.reset();
+            parser_last = FrameParserStats{};
+        }
+        // 捨てきれなかった残り（上限で打ち切り）や、ギャップで終えたサイクルの遅れた UID も数えない
+        await_ack = timed_out || gap_ended;
+        lost0 = lost();
+        if (more) {
+            gap = sp_.end_of_response_gap();
+            t_sent = t_rx = steady_clock::now();
+            if (!send_inventory()) more = false;   // 送信エラー：このサイクルの結果を渡して終了
+        }
+
+        // 完了したサイクルの後処理は、リーダが次サイクルを処理している間に行う
+        std::swap(cur, done);
+        cur.reset();
+        if (cb) cb(st.cycles, done.result());
+
+        if (!more) break;
+    }
+
+    st.elapsed_s = duration<double>(steady_clock::now() - t_start).count();
+    return st;
+}
+
+} // namespace tr3
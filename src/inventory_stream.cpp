@@ -0,0 +1,81 @@
+// 連続インベントリ（ストリーミング）
+#include "../include/inventory_stream.hpp"
+#include "../include/frame_parser.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// 受信スレッドが停止要求を確認する間隔
+static constexpr milliseconds STREAM_POLL{50};
+
+InventoryStream::InventoryStream(Transport& sp, size_t queue_capacity)
+    : sp_(sp), queue_(queue_capacity) {}
+
+bool InventoryStream::start(StreamMode mode, Callback cb, uint32_t timeout_ms) {
+    if (running()) return false;
+
+    // 元のモードを保存してから切り替える
+    ReaderModePretty pretty;
+    if (!read_reader_mode(sp_, saved_, pretty, timeout_ms)) return false;
+    if (!write_reader_mode(sp_, saved_, static_cast<uint8_t>(mode), timeout_ms)) return false;
+
+    cb_ = std::move(cb);
+    stop_req_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    th_ = std::thread([this] { rx_loop(); });
+    return true;
+}
+
+bool InventoryStream::stop(uint32_t timeout_ms) {
+    if (!running()) return false;
+    stop_req_.store(true, std::memory_order_release);
+    if (th_.joinable()) th_.join();
+    running_.store(false, std::memory_order_release);
+
+    // 自律動作中も UID が届き続けるが、communicate() は ACK まで読み飛ばす
+    return write_reader_mode(sp_, saved_, saved_.bytes.empty() ? 0x00 : saved_.bytes[0], timeout_ms);
+}
+
+InventoryStreamStats InventoryStream::stats() const {
+    InventoryStreamStats s;
+    s.uids    = n_uids_.load(std::memory_order_relaxed);
+    s.other   = n_other_.load(std::memory_order_relaxed);
+    s.dropped = n_dropped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void InventoryStream::rx_loop() {
+    FrameParser parser;
+    uint64_t seq = 0;
+
+    while (!stop_req_.load(std::memory_order_acquire)) {
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp_.read_some(dst, room, steady_clock::now() + STREAM_POLL);
+        if (n == 0) continue;
+        parser.commit(n);
+
+        // 同じ read でまとめて届いたフレームには同じ受信時刻を付ける
+        const auto t_mono = steady_clock::now();
+        const auto t_wall = system_clock::now();
+
+        FrameView f;
+        while (parser.next(f)) {
+            InventoryEvent ev;
+            if (!decode_uid_frame(f, ev.item)) {
+                n_other_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            ev.t_mono = t_mono;
+            ev.t_wall = t_wall;
+            ev.seq    = seq++;
+            n_uids_.fetch_add(1, std::memory_order_relaxed);
+
+            if (cb_) cb_(ev);
+            else if (!queue_.push(std::move(ev))) n_dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace tr3
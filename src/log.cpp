@@ -0,0 +1,293 @@
+// 非同期ログ（リング → 整形スレッド → stdout）
+#include "../include/log.hpp"
+#include "../include/tr3_frame.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// レベル
+// ───────────────────────────────────
+bool parse_log_level(const char* s, LogLevel& out) {
+    if (!s) return false;
+    if      (std::strcmp(s, "off")   == 0) out = LogLevel::Off;
+    else if (std::strcmp(s, "error") == 0) out = LogLevel::Error;
+    else if (std::strcmp(s, "info")  == 0) out = LogLevel::Info;
+    else if (std::strcmp(s, "trace") == 0) out = LogLevel::Trace;
+    else return false;
+    return true;
+}
+
+static uint8_t level_from_env() {
+    LogLevel lv = LogLevel::Trace;
+    parse_log_level(std::getenv("TR3_LOG"), lv);   // 未指定・不明な値は trace
+    return uint8_t(lv);
+}
+
+namespace detail {
+std::atomic<uint8_t> g_log_level{level_from_env()};
+}
+
+void set_log_level(LogLevel lv) { detail::g_log_level.store(uint8_t(lv), std::memory_order_relaxed); }
+LogLevel log_level()            { return LogLevel(detail::g_log_level.load(std::memory_order_relaxed)); }
+
+// ───────────────────────────────────
+// 16進変換表（"00".."FF"）
+// ───────────────────────────────────
+struct HexTable {
+    std::array<char, 512> c{};
+    constexpr HexTable() {
+        constexpr char digits[] = "0123456789ABCDEF";
+        for (int i = 0; i < 256; ++i) {
+            c[size_t(i) * 2]     = digits[i >> 4];
+            c[size_t(i) * 2 + 1] = digits[i & 0x0F];
+        }
+    }
+};
+static constexpr HexTable HEX{};
+
+// ───────────────────────────────────
+// 記録リング（複数生産者・単一消費者、スロット毎の通番で同期）
+// ───────────────────────────────────
+namespace {
+
+constexpr size_t RING_SLOTS   = 1024;                 // 2 のべき乗
+constexpr size_t SLOT_PAYLOAD = 300;                  // フレーム最大長（MAX_FRAME）が入る大きさ
+static_assert(SLOT_PAYLOAD >= MAX_FRAME, "1 フレームが 1 スロットに収まること");
+
+enum : uint8_t { KIND_FRAME = 0, KIND_TEXT = 1 };
+
+struct Slot {
+    std::atomic<size_t> seq{0};
+    int64_t  t_ns  = 0;      // steady_clock
+    uint8_t  tag   = 0;
+    uint8_t  kind  = 0;
+    uint16_t len   = 0;
+    uint8_t  data[SLOT_PAYLOAD];
+};
+
+class Logger {
+public:
+    Logger()
+        : steady0_(steady_clock::now()), wall0_(system_clock::now())
+    {
+        for (size_t i = 0; i < RING_SLOTS; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        if (th_.joinable()) th_.join();
+    }
+
+    void push(LogTag tag, uint8_t kind, const void* p, size_t n) {
+        if (!started_.load(std::memory_order_acquire)) start();
+
+        size_t pos = enq_.load(std::memory_order_relaxed);
+        Slot* s;
+        for (;;) {
+            s = &slots_[pos & (RING_SLOTS - 1)];
+            const size_t seq = s->seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);   // 満杯：待たずに捨てる
+                return;
+            } else {
+                pos = enq_.load(std::memory_order_relaxed);
+            }
+        }
+        if (n > SLOT_PAYLOAD) n = SLOT_PAYLOAD;
+        s->t_ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        s->tag  = uint8_t(tag);
+        s->kind = kind;
+        s->len  = uint16_t(n);
+        std::memcpy(s->data, p, n);
+        s->seq.store(pos + 1, std::memory_order_release);
+
+        // 整形スレッドが空で眠っているときだけ起こす（空→非空の 1 回。流れている間はロックを取らない）
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lk(mu_);
+            wake_req_ = true;
+            cv_.notify_one();
+        }
+    }
+
+    void flush() {
+        const size_t target = enq_.load(std::memory_order_acquire);
+        if (!started_.load(std::memory_order_acquire)) return;
+        std::unique_lock<std::mutex> lk(mu_);
+        flush_req_ = true;
+        cv_.notify_all();
+        done_cv_.wait(lk, [&] { return deq_pub_.load(std::memory_order_acquire) >= target || quit_; });
+    }
+
+    void set_sink(std::FILE* fp) { sink_.store(fp, std::memory_order_release); }
+
+    LogStats stats() const {
+        LogStats st;
+        st.records = records_.load(std::memory_order_relaxed);
+        st.dropped = dropped_.load(std::memory_order_relaxed);
+        return st;
+    }
+
+private:
+    void start() {
+        std::call_once(start_once_, [this] {
+            th_ = std::thread([this] { run(); });
+            started_.store(true, std::memory_order_release);
+        });
+    }
+
+    // 整形スレッド：溜まった分をまとめて整形し、1 回の fwrite で出す
+    void run() {
+        std::string out;
+        out.reserve(64 * 1024);
+        for (;;) {
+            size_t n = 0;
+            for (;;) {
+                Slot& s = slots_[deq_ & (RING_SLOTS - 1)];
+                if (s.seq.load(std::memory_order_acquire) != deq_ + 1) break;
+                format(s, out);
+                s.seq.store(deq_ + RING_SLOTS, std::memory_order_release);
+                ++deq_; ++n;
+                if (out.size() >= 60 * 1024) break;
+            }
+            if (!out.empty()) {
+                std::FILE* fp = sink_.load(std::memory_order_acquire);
+                std::fwrite(out.data(), 1, out.size(), fp);
+                std::fflush(fp);
+                out.clear();
+            }
+            records_.fetch_add(n, std::memory_order_relaxed);
+            deq_pub_.store(deq_, std::memory_order_release);
+            if (n) {
+                // 待っている log_flush() を起こす（ロックを取ってから通知して取りこぼしを防ぐ）
+                std::lock_guard<std::mutex> lk(mu_);
+                done_cv_.notify_all();
+                continue;
+            }
+
+            // 空：眠ることを示してから見直し、書き込み側の通知（push）まで待つ
+            std::unique_lock<std::mutex> lk(mu_);
+            if (quit_ && !pending()) break;
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!pending()) cv_.wait(lk, [&] { return quit_ || flush_req_ || wake_req_; });
+            sleeping_.store(false, std::memory_order_relaxed);
+            flush_req_ = wake_req_ = false;
+        }
+        std::lock_guard<std::mutex> lk(mu_);
+        done_cv_.notify_all();
+    }
+
+    bool pending() const {
+        const Slot& s = slots_[deq_ & (RING_SLOTS - 1)];
+        return s.seq.load(std::memory_order_acquire) == deq_ + 1;
+    }
+
+    // "MM/DD hh:mm:ss.mmm  [tag]  本文\n"
+    void format(const Slot& s, std::string& out) {
+        const auto wall = wall0_ + duration_cast<system_clock::duration>(
+                              nanoseconds(s.t_ns) - steady0_.time_since_epoch());
+        const auto sec  = duration_cast<seconds>(wall.time_since_epoch());
+        const int  ms   = int(duration_cast<milliseconds>(wall.time_since_epoch() - sec).count());
+        if (sec.count() != cached_sec_) {
+            // localtime は秒が変わったときだけ呼ぶ
+            cached_sec_ = sec.count();
+            const std::time_t t = std::time_t(cached_sec_);
+            std::tm tm{};
+#ifdef _WIN32
+            localtime_s(&tm, &t);
+#else
+            localtime_r(&t, &tm);
+#endif
+            std::strftime(cached_prefix_, sizeof(cached_prefix_), "%m/%d %H:%M:%S", &tm);
+        }
+        char head[48];
+        const int hn = std::snprintf(head, sizeof(head), "%s.%03d  [%s]  ", cached_prefix_, ms,
+                                     s.tag == uint8_t(LogTag::Send) ? "send" :
+                                     s.tag == uint8_t(LogTag::Recv) ? "recv" : "cmt");
+        out.append(head, size_t(hn));
+
+        if (s.kind == KIND_TEXT) {
+            out.append(reinterpret_cast<const char*>(s.data), s.len);
+        } else {
+            const size_t base = out.size();
+            out.resize(base + (s.len ? s.len * 3 - 1 : 0));
+            char* w = &out[base];
+            for (size_t i = 0; i < s.len; ++i) {
+                if (i) *w++ = ' ';
+                const char* h = &HEX.c[size_t(s.data[i]) * 2];
+                *w++ = h[0]; *w++ = h[1];
+            }
+        }
+        out.push_back('\n');
+    }
+
+    std::array<Slot, RING_SLOTS> slots_;
+    alignas(64) std::atomic<size_t> enq_{0};
+    alignas(64) size_t              deq_ = 0;          // 整形スレッド専用
+    std::atomic<size_t>             deq_pub_{0};       // log_flush() 向けに公開する消費位置
+    alignas(64) std::atomic<bool>   sleeping_{false};  // 整形スレッドが空で待っている
+
+    std::atomic<uint64_t>    records_{0};
+    std::atomic<uint64_t>    dropped_{0};
+    std::atomic<std::FILE*>  sink_{stdout};
+
+    const steady_clock::time_point steady0_;
+    const system_clock::time_point wall0_;
+    int64_t cached_sec_ = -1;
+    char    cached_prefix_[32] = {};
+
+    std::once_flag          start_once_;
+    std::atomic<bool>       started_{false};
+    std::thread             th_;
+    std::mutex              mu_;
+    std::condition_variable cv_, done_cv_;
+    bool quit_      = false;
+    bool flush_req_ = false;
+    bool wake_req_  = false;
+};
+
+Logger& logger() {
+    static Logger lg;
+    return lg;
+}
+
+} // namespace
+
+// ───────────────────────────────────
+// 公開関数
+// ───────────────────────────────────
+void set_log_sink(std::FILE* fp) { logger().set_sink(fp ? fp : stdout); }
+
+void log_frame(LogTag tag, const uint8_t* data, size_t n) {
+    if (!log_enabled(LogLevel::Trace)) return;
+    logger().push(tag, KIND_FRAME, data, n);
+}
+
+void log_text(LogLevel lv, LogTag tag, const char* text, size_t n) {
+    if (!log_enabled(lv)) return;
+    logger().push(tag, KIND_TEXT, text, n);
+}
+
+void log_flush() { logger().flush(); }
+
+LogStats log_stats() { return logger().stats(); }
+
+} // namespace tr3
@@ -0,0 +1,35 @@
+// SimReader を同一プロセス内で直接つなぐトランスポート
+#include "../include/loopback_transport.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace tr3 {
+
+bool LoopbackTransport::write(const uint8_t* data, size_t n) {
+    ++stats_.write_calls;
+    stats_.bytes_written += n;
+    if (rx_pos_ == rx_.size()) { rx_.clear(); rx_pos_ = 0; }   // 読み切っていれば先頭から使い直す
+    sim_.on_rx(data, n, rx_);
+    return true;
+}
+
+size_t LoopbackTransport::read_some(uint8_t* dst, size_t cap, clock::time_point deadline) {
+    if (cap == 0) return 0;
+    ++stats_.read_calls;
+    if (rx_pos_ == rx_.size()) {
+        // 応答は write() の時点で揃っているので、この後に届くものはない：実機と同じく期限まで待つ
+        ++stats_.wait_calls;
+        std::this_thread::sleep_until(deadline);
+        return 0;
+    }
+    size_t k = std::min(cap, rx_.size() - rx_pos_);
+    if (max_chunk_) k = std::min(k, size_t(std::uniform_int_distribution<size_t>(1, max_chunk_)(rng_)));
+    std::memcpy(dst, rx_.data() + rx_pos_, k);
+    rx_pos_ += k;
+    stats_.bytes_read += k;
+    return k;
+}
+
+} // namespace tr3
@@ -1,30 +1,44 @@
-// 1) COM/ボーレート選択（日本語UI）
+// 1) COM/ボーレート選択（日本語UI。既定は自動：応答する速度を探す）
 // 2) ROMバージョン表示
 // 3) 動作モードの読み取り → 「モードのみコマンドモードへ」書き込み → 再読取り
+//    自動のときは通信速度を 115200 bps へ切り替える（失敗したら元の速度で続ける）
+//    前回のプロファイルと同じリーダなら ROM 応答 1 回で済ませ、抜き差しされたら自動で繋ぎ直す
 // 4) Inventory2 実行（★試行回数を入力して繰り返し実行）
+//
+// 引数を付けると対話なしで動く（tr3_usb --help。ポート・速度・周期・出力形式・ブザーを
+// オプションか設定ファイルで指定し、SIGINT / SIGTERM で止まる。結果は標準出力、状態は標準エラーへ）
 
-#define NOMINMAX
-#include <windows.h>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 #include "../include/serial_port.hpp"
+#include "../include/baud_negotiation.hpp"
+#include "../include/reader_profile.hpp"
+#include "../include/reader_discovery.hpp"
+#include "../include/port_watch.hpp"
 #include "../include/tr3_protocol.hpp"
+#include "../include/log.hpp"
+#include "../include/tag_tracker.hpp"
+#include "../include/capture.hpp"
+#include "../include/tag_journal.hpp"
+#include "../include/metrics.hpp"
+#include "../include/run_options.hpp"
+#include "../include/inventory_output.hpp"
+#ifndef _WIN32
+#include "../include/metrics_socket.hpp"
+#include "../include/event_ring.hpp"
+#endif
 
 //----------------------------------------------
-static std::vector<std::string> enum_com_ports() {
-    std::vector<std::string> ports;
-    char deviceName[16], target[512];
-    for (int i = 1; i <= 256; ++i) {
-        std::snprintf(deviceName, sizeof(deviceName), "COM%d", i);
-        if (::QueryDosDeviceA(deviceName, target, sizeof(target))) ports.emplace_back(deviceName);
-    }
-    return ports;
-}
 static int ask_number(const std::string& prompt, int minVal, int maxVal, int defVal) {
+    tr3::log_flush();   // ログを出し切ってからプロンプトを出す
     while (true) {
         std::cout << prompt;
         std::string s; std::getline(std::cin, s);
@@ -36,48 +50,399 @@ static int ask_number(const std::string& prompt, int minVal, int maxVal, int def
         } catch (...) { std::cout<<"数字で入力してください。\n"; }
     }
 }
+
+// SIGINT / SIGTERM（対話なしのとき）。実行中のサイクルを終えてから止まる
+static volatile std::sig_atomic_t g_stop = 0;
+static void on_stop_signal(int) { g_stop = 1; }
+
+// 指定があればそれを、無ければ環境変数を使う（対話モードでは常に環境変数）
+static const char* setting(const std::string& v, const char* env) {
+    return v.empty() ? std::getenv(env) : v.c_str();
+}
+// 全ポートを同時に探し、見つかったリーダを表示する（前回のポートがあれば先頭に並べる）
+static std::vector<tr3::DiscoveredReader> discover(const tr3::ProfileStore& profiles, std::ostream& msg) {
+    tr3::DiscoveryOptions dopt;
+    dopt.profiles = &profiles;
+    auto found = tr3::discover_readers(dopt);
+    tr3::log_flush();
+    if (const tr3::ReaderProfile* last = profiles.latest())
+        std::stable_partition(found.readers.begin(), found.readers.end(),
+                              [&](const tr3::DiscoveredReader& r) { return r.port == last->port; });
+    msg << "=== 検出したリーダ（" << found.probed << " ポート・" << found.elapsed_ms << " ms）===\n";
+    for (size_t i=0;i<found.readers.size();++i) {
+        const auto& r = found.readers[i];
+        msg << "  ["<<i<<"] "<<r.port<<"  "<<r.baud<<" bps  ROM "<<r.rom_version
+            << (r.mode_ok && tr3::is_command_mode(r.mode) ? "  コマンドモード" : "") << "\n";
+    }
+    return std::move(found.readers);
+}
 //----------------------------------------------
-int main(int, char**) {
-    // === COM選択 ===
-    auto coms = enum_com_ports();
-    if (coms.empty()) { std::cerr << "COMポートが見つかりません。\n"; return 1; }
-    std::cout << "=== 利用可能なCOMポート ===\n";
-    for (size_t i=0;i<coms.size();++i) std::cout<<"  ["<<i<<"] "<<coms[i]<<"\n";
-    int idx = ask_number("使用する番号（Enterで0）: ", 0, int(coms.size()-1), 0);
-    std::string com = coms[size_t(idx)];
-
-    // === ボーレート選択（既定19200） ===
-    const std::vector<uint32_t> baudList = {19200,38400,57600,115200,9600};
-    std::cout << "=== ボーレート（Enterで19200） ===\n";
-    for (size_t i=0;i<baudList.size();++i) std::cout<<"  ["<<i<<"] "<<baudList[i]<<" bps\n";
-    int bidx = ask_number("番号を入力: ",0,int(baudList.size()-1),0);
-    uint32_t baud = baudList[size_t(bidx)];
+int main(int argc, char** argv) {
+    // === 引数があれば対話なしで動かす（結果は標準出力、ログと状態表示は標準エラー）===
+    const bool headless = argc > 1;
+    tr3::RunOptions opt;
+    if (headless) {
+        bool help = false;
+        std::string err;
+        if (!tr3::parse_run_args(argc, argv, opt, help, err)) { std::cerr<<err<<"\n\n"<<tr3::run_usage(); return 1; }
+        if (help) { std::cout<<tr3::run_usage(); return 0; }
+        tr3::set_log_sink(stderr);
+        tr3::LogLevel lv = tr3::LogLevel::Error;
+        if (!tr3::parse_log_level(opt.log.c_str(), lv)) tr3::parse_log_level(std::getenv("TR3_LOG"), lv);
+        tr3::set_log_level(lv);
+        // 探索・接続の途中で止められても、後始末（ジャーナル・共有メモリ）を済ませてから終わる
+        std::signal(SIGINT,  on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+#ifndef _WIN32
+        std::signal(SIGPIPE, SIG_IGN);   // 読み手が閉じたら書き込みエラーとして止める
+#endif
+    }
+    std::ostream& msg = headless ? std::cerr : std::cout;
+
+    // === 前回の接続プロファイル（環境変数 TR3_PROFILE。空文字で無効）===
+    tr3::ProfileStore profiles(tr3::default_profile_path());
+    profiles.load();
+
+    std::string com;
+    bool auto_baud = true;
+    uint32_t baud = 19200;
+    uint32_t hint_baud = 0;   // 自動検出で応答した速度（速度探索で最初に試す）
+    if (headless) {
+        // === 対話なし：指定のポート。省略時は前回のポートだけを確かめ、駄目なら（auto なら最初から）
+        //     全ポートを同時に探して最初のリーダ。関係のない機器へはなるべく要求を送らない ===
+        com = opt.port;
+        if (com.empty() || com == "auto") {
+            std::vector<tr3::DiscoveredReader> found;
+            const tr3::ReaderProfile* last = profiles.latest();
+            if (com.empty() && last) {
+                tr3::DiscoveryOptions dopt;
+                dopt.ports    = {last->port};
+                dopt.profiles = &profiles;
+                found = tr3::discover_readers(dopt).readers;
+                tr3::log_flush();
+            }
+            if (found.empty()) found = discover(profiles, std::cerr);
+            if (found.empty()) { std::cerr << "リーダが見つかりません。\n"; return 1; }
+            com = found[0].port;
+            hint_baud = found[0].baud;
+        }
+        auto_baud = opt.baud == 0;
+        if (!auto_baud) baud = opt.baud;
+    } else {
+        // === COM選択（前回のポートがあればそれを既定にする。末尾の番号で全ポートを自動検出） ===
+        auto coms = tr3::enum_serial_ports();
+        if (coms.empty()) { std::cerr << "COMポートが見つかりません。\n"; return 1; }
+        int defIdx = 0;
+        if (const tr3::ReaderProfile* last = profiles.latest())
+            for (size_t i=0;i<coms.size();++i) if (coms[i] == last->port) defIdx = int(i);
+        std::cout << "=== 利用可能なCOMポート ===\n";
+        for (size_t i=0;i<coms.size();++i) std::cout<<"  ["<<i<<"] "<<coms[i]<<"\n";
+        std::cout<<"  ["<<coms.size()<<"] 自動検出（全ポートを同時に探す）\n";
+        int idx = ask_number("使用する番号（Enterで"+std::to_string(defIdx)+"）: ", 0, int(coms.size()), defIdx);
+        if (size_t(idx) == coms.size()) {
+            const auto found = discover(profiles, std::cout);
+            if (found.empty()) { std::cerr << "リーダが見つかりません。\n"; return 1; }
+            const int fidx = found.size() == 1 ? 0
+                : ask_number("使用する番号（Enterで0）: ", 0, int(found.size()-1), 0);
+            com = found[size_t(fidx)].port;
+            hint_baud = found[size_t(fidx)].baud;
+        } else {
+            com = coms[size_t(idx)];
+        }
+
+        // === ボーレート選択（既定は自動） ===
+        const std::vector<uint32_t> baudList = {19200,38400,57600,115200,9600};
+        std::cout << "=== ボーレート（Enterで自動） ===\n";
+        std::cout << "  [0] 自動（応答する速度を探し、115200 bps へ切り替え）\n";
+        for (size_t i=0;i<baudList.size();++i) std::cout<<"  ["<<i+1<<"] "<<baudList[i]<<" bps\n";
+        int bidx = ask_number("番号を入力: ",0,int(baudList.size()),0);
+        auto_baud = (bidx == 0);
+        if (!auto_baud) baud = baudList[size_t(bidx-1)];
+    }
 
+    // === 環境変数 TR3_CAPTURE が指定されていれば、送受信をバイナリで記録 ===
+    //   自動のときは速度の切り替えが済んでから開く（キャプチャには最終的な速度を記録する）
+    //   キャプチャはポートより長く生存させるため、ポートより先に宣言する
+    tr3::CaptureWriter capture;
     tr3::SerialPort sp(com, baud);
-    if (!sp.open()) { std::cerr<<"オープン失敗: "<<sp.last_error()<<"\n"; return 2; }
+    auto start_capture = [&] {
+        if (const char* cap_path = setting(opt.capture, "TR3_CAPTURE")) {
+            if (capture.open(cap_path, sp.baud())) sp.set_capture(&capture);
+            else std::cerr<<capture.last_error()<<"\n";
+        }
+    };
+    if (!auto_baud) start_capture();
 
-    // === ROM（疎通） ===
-    if (tr3::read_rom_version(sp, 600).empty()) { std::cerr<<"ROM取得失敗\n"; return 3; }
+    // === 環境変数 TR3_JOURNAL が指定されていれば、そのディレクトリへ読み取り結果を記録 ===
+    //   読み取った UID と在席の開始・終了をジャーナルへ追記する（ディスクへはまとめて書き出す）
+    tr3::JournalWriter journal;
+    if (const char* j_dir = setting(opt.journal, "TR3_JOURNAL")) {
+        tr3::JournalOptions jo; jo.dir = j_dir;
+        if (!journal.open(jo)) std::cerr<<journal.last_error()<<"\n";
+    }
+#ifndef _WIN32
+    // === 環境変数 TR3_EVENTS が指定されていれば、その名前の共有メモリへ読み取り結果を配信（POSIX のみ）===
+    //   例: TR3_EVENTS=/tr3_events。購読側は tr3_subscribe か EventRingSubscriber で読む
+    tr3::EventRingPublisher events;
+    if (const char* e_name = setting(opt.events, "TR3_EVENTS")) {
+        if (!events.open(e_name)) std::cerr<<events.last_error()<<"\n";
+    }
+#endif
 
-    // === 動作モード 読み取り → 「モードのみコマンドモードへ」設定 → 再読取り ===
+    // === 環境変数 TR3_METRICS / TR3_METRICS_SOCK が指定されていれば、計測値を公開 ===
+    //   TR3_METRICS      : 1秒ごとにファイルへ書き出す（.json なら JSON、それ以外は Prometheus テキスト）
+    //   TR3_METRICS_SOCK : UNIX ドメインソケットで接続ごとに Prometheus テキストを返す（POSIX のみ）
+    tr3::MetricsExporter metrics_out;
+    if (const char* m_path = setting(opt.metrics, "TR3_METRICS")) {
+        const std::string p = m_path;
+        const bool json = p.size() >= 5 && p.compare(p.size() - 5, 5, ".json") == 0;
+        if (!metrics_out.start(p, json ? tr3::MetricsFormat::Json : tr3::MetricsFormat::Prometheus))
+            std::cerr<<metrics_out.last_error()<<"\n";
+    }
+#ifndef _WIN32
+    tr3::MetricsSocketServer metrics_sock;
+    if (const char* m_sock = setting(opt.metrics_sock, "TR3_METRICS_SOCK")) {
+        if (!metrics_sock.start(m_sock)) std::cerr<<metrics_sock.last_error()<<"\n";
+    }
+#endif
+
+    // === 接続：ROM（疎通） → 動作モード 読み取り → 「モードのみコマンドモードへ」設定 → 再読取り ===
+    //   前回のプロファイルと ROM 応答 1 回で同じと確かめられれば、動作モードのやり取りを省く。
+    //   既にコマンドモードなら書き込みと再読取りを省く。
+    //   戻り値 0=成功、それ以外は終了コード。reconnect=true（抜き差し後）は計測を省き、エラー表示を控える
     tr3::ReaderModeRaw raw{}; tr3::ReaderModePretty pretty{};
-    if (!tr3::read_reader_mode(sp, raw, pretty, 600))
-        std::cerr<<"動作モードの取得に失敗しました。\n";
+    auto attach = [&](bool reconnect) -> int {
+        const tr3::ReaderProfile* cached = profiles.find(com);
+        if (cached && (auto_baud || cached->baud == baud) && tr3::attach_cached(sp, *cached)) {
+            raw = cached->mode;
+            return 0;
+        }
 
-    if (!tr3::write_reader_mode_to_command(sp, raw, 600))
-        std::cerr<<"動作モードの設定に失敗しました。\n";
+        if (auto_baud) {
+            tr3::BaudProbeResult probe;
+            if (!tr3::probe_baud(sp, probe, cached ? cached->baud : hint_baud)) {
+                tr3::log_flush();
+                if (!reconnect) std::cerr<<"通信速度の判定に失敗: "<<probe.error<<"\n";
+                return 2;
+            }
+        } else if (!sp.open()) {
+            if (!reconnect) std::cerr<<"オープン失敗: "<<sp.last_error()<<"\n";
+            return 2;
+        }
 
-    tr3::read_reader_mode(sp, raw, pretty, 600);
+        const std::string rom = tr3::read_rom_version(sp, 600);
+        if (rom.empty()) { tr3::log_flush(); if (!reconnect) std::cerr<<"ROM取得失敗\n"; return 3; }
+
+        if (!tr3::read_reader_mode(sp, raw, pretty, 600)) {
+            tr3::log_flush(); std::cerr<<"動作モードの取得に失敗しました。\n";
+        } else if (tr3::is_command_mode(raw)) {
+            tr3::log_text(tr3::LogLevel::Info, tr3::LogTag::Cmt, std::string("既にコマンドモードのため書き込みを省略します"));
+        } else {
+            if (!tr3::write_reader_mode_to_command(sp, raw, 600))
+                { tr3::log_flush(); std::cerr<<"動作モードの設定に失敗しました。\n"; }
+            tr3::read_reader_mode(sp, raw, pretty, 600);
+        }
+
+        // === 自動：通信速度を最速へ切り替え、1 サイクルあたりの短縮を表示 ===
+        if (auto_baud && raw.bytes.size() >= 4) {
+            tr3::BaudUpgradeOptions uo;
+            if (reconnect) uo.measure_cycles = 0;
+            tr3::BaudUpgradeResult up;
+            tr3::upgrade_baud(sp, raw, up, uo);
+            tr3::log_flush();
+            if (up.to == 0) { std::cerr<<"通信速度の切り替え後に応答がありません: "<<up.error<<"\n"; return 3; }
+            if (up.ok && up.from != up.to && !reconnect) {
+                msg << std::fixed << std::setprecision(1)
+                          << "通信速度: " << up.from << " → " << up.to << " bps\n"
+                          << "Inventory2 1回（実測）: " << up.cycle_ms_before << " ms → " << up.cycle_ms_after
+                          << " ms（短縮 " << (up.cycle_ms_before - up.cycle_ms_after) << " ms）\n"
+                          << "Inventory2 1回（伝送の理論値・" << up.uids << "件）: "
+                          << tr3::inventory_wire_ms(up.from, up.uids) << " ms → " << tr3::inventory_wire_ms(up.to, up.uids)
+                          << " ms\n" << std::defaultfloat;
+            } else if (!up.ok) {
+                msg << "通信速度の切り替えに失敗しました（" << up.error << "）。" << up.to << " bps で続けます。\n";
+            }
+            if (up.to != up.from) tr3::read_reader_mode(sp, raw, pretty, 600);
+        }
+
+        // 次回・再接続時に ROM 応答 1 回で済ませるため、確かめた設定を保存する
+        if (profiles.enabled() && tr3::is_command_mode(raw) && raw.bytes.size() >= 4) {
+            tr3::ReaderProfile p;
+            p.port = com; p.baud = sp.baud(); p.rom_version = rom; p.mode = raw;
+            profiles.put(std::move(p));
+            if (!profiles.save()) std::cerr<<profiles.last_error()<<"\n";
+        }
+        return 0;
+    };
+
+    if (g_stop) return 0;   // 探索の途中で止められた（対話なしのみ）
+    const auto t_attach = std::chrono::steady_clock::now();
+    if (const int rc = attach(false)) return rc;
+    tr3::log_flush();
+    msg << "接続: " << com << " " << sp.baud() << " bps（"
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_attach).count()
+              << " ms）\n";
+    if (auto_baud) start_capture();
+
+    // === 抜き差し：ポートが現れたら開き直し、プロファイルで確かめて続ける（最大 60 秒待つ） ===
+    //   待っている間も止める指示（SIGINT / SIGTERM）を 200 ms ごとに見る
+    tr3::PortWatcher watcher(com);
+    auto reattach = [&]() -> bool {
+        sp.close();
+        const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (!g_stop) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= give_up) return false;
+            const auto slice = std::min(std::chrono::milliseconds(200),
+                                        std::chrono::duration_cast<std::chrono::milliseconds>(give_up - now));
+            if (!watcher.wait_present(slice)) continue;
+            if (attach(true) == 0) return true;
+            sp.close();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));   // ノードはあるがまだ開けない・応答しない
+        }
+        return false;
+    };
+
+    // === 対話なし：止められるまで（または --cycles 回）周期的に実行し、結果を出力する ===
+    if (headless) {
+        tr3::InventoryOutput out;
+        if (!out.open(opt.output, opt.format)) { std::cerr<<out.last_error()<<"\n"; return 1; }
+        const bool emit_reads    = opt.emit != tr3::OutputEmit::Presence;
+        const bool emit_presence = opt.emit != tr3::OutputEmit::Reads;
+
+        uint64_t cycle = 0;
+        int64_t  t_wall = 0;
+        tr3::TagTracker tracker({}, [&](const tr3::TagEvent& e) {
+            const bool arrive = e.kind == tr3::TagEvent::Kind::Arrive;
+            if (journal.is_open()) journal.append(opt.reader_id, e, t_wall);
+#ifndef _WIN32
+            events.publish(opt.reader_id, e, t_wall);
+#endif
+            if (emit_presence)
+                out.write(opt.reader_id, cycle, arrive ? tr3::JournalKind::Arrive : tr3::JournalKind::Depart,
+                          e.tag.uid, e.tag.dsfid, t_wall);
+        });
+
+        // 集計：サイクル数・UID 数は手元で、タイムアウト・NACK は計測（全コマンド）の差分で数える
+        struct Totals { uint64_t cycles = 0, uids = 0, timeouts = 0, nacks = 0; };
+        auto failures = [] {
+            Totals t;
+            for (const auto& c : tr3::metrics().snapshot().commands) { t.timeouts += c.timeouts; t.nacks += c.nacks; }
+            return t;
+        };
+        const Totals base = failures();
+        Totals total, last;
+        const auto t_start = std::chrono::steady_clock::now();
+        auto t_last = t_start;
+        auto report = [&](const char* label, const Totals& from, std::chrono::steady_clock::time_point since) {
+            const Totals f = failures();
+            Totals now = total;
+            now.timeouts = f.timeouts - base.timeouts;
+            now.nacks    = f.nacks - base.nacks;
+            const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+            const double div = sec > 0 ? sec : 1;
+            tr3::log_flush();
+            std::cerr << std::fixed << std::setprecision(1)
+                      << "[" << label << "] " << sec << " 秒  サイクル " << (now.cycles - from.cycles)
+                      << " (" << double(now.cycles - from.cycles) / div << "/s)  UID " << (now.uids - from.uids)
+                      << " (" << double(now.uids - from.uids) / div << "/s)  タイムアウト " << (now.timeouts - from.timeouts)
+                      << "  NACK " << (now.nacks - from.nacks) << "  在席 " << tracker.present()
+                      << std::defaultfloat << "\n";
+            return now;
+        };
+
+        // 周期：--rate の間隔で始める（遅れた分は詰めずに次から数え直す）。0 なら休まない
+        const auto period = opt.rate_hz > 0
+            ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / opt.rate_hz))
+            : std::chrono::steady_clock::duration::zero();
+        auto next_at = std::chrono::steady_clock::now();
+        int rc = 0;
+        tr3::InventoryResult r;
+        while (!g_stop && (opt.cycles == 0 || cycle < opt.cycles)) {
+            if (period.count() > 0) {
+                // シグナルで止められるよう、待ちは細かく区切る
+                while (!g_stop && std::chrono::steady_clock::now() < next_at)
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                        next_at - std::chrono::steady_clock::now(), std::chrono::milliseconds(50)));
+                if (g_stop) break;
+                next_at = std::max(next_at + period, std::chrono::steady_clock::now());
+            }
+
+            tr3::run_inventory2(sp, r, opt.timeout_ms);
+            if (sp.disconnected()) {
+                tr3::log_flush();
+                std::cerr << "リーダが切断されました。再接続を待っています...\n";
+                if (!reattach()) {
+                    if (g_stop) break;   // 待っている間に止められた
+                    tr3::log_flush(); std::cerr<<"再接続できませんでした。\n"; rc = 4; break;
+                }
+                std::cerr << "再接続しました\n";
+                continue;
+            }
+            ++cycle;
+            ++total.cycles;
+            total.uids += r.items.size();
+            t_wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (journal.is_open()) journal.append(opt.reader_id, r, t_wall);
+#ifndef _WIN32
+            events.publish(opt.reader_id, r, t_wall);
+#endif
+            if (emit_reads) out.write(opt.reader_id, cycle, r, t_wall);
+            tracker.observe(r, std::chrono::steady_clock::now());
+
+            if (opt.buzzer == tr3::BuzzerPolicy::Always || (opt.buzzer == tr3::BuzzerPolicy::Found && !r.items.empty()))
+                tr3::buzzer(sp, /*response_type=*/0x01, /*sound_type=*/r.items.empty() ? 0x01 : 0x00, 600);
+
+            if (!out.flush()) { std::cerr<<out.last_error()<<"\n"; rc = 5; break; }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (opt.summary_sec > 0 && now - t_last >= std::chrono::seconds(opt.summary_sec)) {
+                last = report("集計", last, t_last);
+                t_last = now;
+            }
+        }
+        report("合計", Totals{}, t_start);
+        return rc;
+    }
 
     // === ★インベントリの試行回数を入力 ===
     int tries = ask_number("インベントリの試行回数（Enterで1）: ", 1, 1000000, 1);
 
+    // === 試行をまたいだ在席管理（新たに現れた／離れた UID を数える）===
+    size_t arrived = 0, departed = 0;
+    tr3::TagTracker tracker({}, [&](const tr3::TagEvent& e) {
+        if (e.kind == tr3::TagEvent::Kind::Arrive) ++arrived; else ++departed;
+        if (journal.is_open()) journal.append(0, e);
+#ifndef _WIN32
+        events.publish(0, e);
+#endif
+    });
+
     // === インベントリを指定回数繰り返し実行 ===
     for (int t = 1; t <= tries; ++t) {
         if (tries > 1) {
             std::cout << "\n--- インベントリ試行 " << t << " / " << tries << " ---\n";
         }
         auto r = tr3::run_inventory2(sp, 2000);
+        tr3::log_flush();   // 通信ログと結果表示の順序を揃える
+        if (sp.disconnected()) {
+            std::cout << "リーダが切断されました。再接続を待っています...\n";
+            const auto t_lost = std::chrono::steady_clock::now();
+            if (!reattach()) { tr3::log_flush(); std::cerr<<"再接続できませんでした。\n"; return 4; }
+            tr3::log_flush();
+            std::cout << "再接続しました（"
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_lost).count()
+                      << " ms）\n";
+            --t;   // 同じ試行をやり直す
+            continue;
+        }
+        arrived = departed = 0;
+        if (journal.is_open()) journal.append(0, r);
+#ifndef _WIN32
+        events.publish(0, r);
+#endif
+        tracker.observe(r, std::chrono::steady_clock::now());
         if (!r.error_message.empty()) {
             std::cout << "NACK/エラー: " << r.error_message << "\n";
             // 見つからなかった扱いにして「ピッピッピ」を鳴らす（応答あり）
@@ -90,6 +455,8 @@ int main(int, char**) {
                     std::cout<<std::uppercase<<std::hex<<std::setw(2)<<std::setfill('0')<<int(b)<<" ";
                 std::cout<<std::dec<<"\n";
             }
+            if (tries > 1) std::cout << "新規: " << arrived << "  離脱: " << departed
+                                     << "  在席: " << tracker.present() << "\n";
             // 取得件数に応じてブザー
             if (!r.items.empty()) {
                 // タグが1件以上 → ピー
@@ -99,7 +466,7 @@ int main(int, char**) {
                 tr3::buzzer(sp, /*response_type=*/0x01, /*sound_type=*/0x01, 600);
             }
         }
-        if (t < tries) ::Sleep(100);
+        if (t < tries) std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     return 0;
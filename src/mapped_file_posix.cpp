@@ -0,0 +1,96 @@
+// MappedFile / MappedWriteFile: POSIX mmap 実装
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "../include/mapped_file.hpp"
+
+namespace tr3 {
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { last_error_ = std::string("open 失敗: ") + std::strerror(errno); return false; }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        last_error_ = std::string("fstat 失敗: ") + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_ = size_t(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            last_error_ = std::string("mmap 失敗: ") + std::strerror(errno);
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        ::madvise(p, size_, MADV_SEQUENTIAL);   // 先頭から順に読む
+        data_ = static_cast<const uint8_t*>(p);
+    }
+    ::close(fd);   // マップはファイルを閉じても残る
+    opened_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+    data_   = nullptr;
+    size_   = 0;
+    opened_ = false;
+}
+
+// ───────────────────────────────────
+// 読み書き
+// ───────────────────────────────────
+bool MappedWriteFile::create(const std::string& path, size_t size) {
+    close();
+    if (size == 0) { last_error_ = "大きさ 0 のマップは作れません"; return false; }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) { last_error_ = std::string("open 失敗: ") + std::strerror(errno); return false; }
+
+    // 先に領域を確保しておく（書き込み中に空き不足で SIGBUS にならないように）
+#ifdef __linux__
+    const int rc = ::posix_fallocate(fd, 0, off_t(size));
+    if (rc != 0) { last_error_ = std::string("posix_fallocate 失敗: ") + std::strerror(rc); ::close(fd); return false; }
+#else
+    if (::ftruncate(fd, off_t(size)) != 0) {
+        last_error_ = std::string("ftruncate 失敗: ") + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+#endif
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { last_error_ = std::string("mmap 失敗: ") + std::strerror(errno); return false; }
+    data_ = static_cast<uint8_t*>(p);
+    size_ = size;
+    return true;
+}
+
+void MappedWriteFile::close() {
+    if (data_) ::munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedWriteFile::sync(size_t offset, size_t n) {
+    if (!data_ || n == 0 || offset >= size_) return true;
+    n = std::min(n, size_ - offset);
+    // msync の先頭はページ境界でなければならない
+    static const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / page * page;
+    if (::msync(data_ + begin, offset + n - begin, MS_SYNC) != 0) {
+        last_error_ = std::string("msync 失敗: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+} // namespace tr3
@@ -0,0 +1,92 @@
+// MappedFile / MappedWriteFile: Win32 実装
+#include <windows.h>
+#include <string>
+
+#include "../include/mapped_file.hpp"
+
+namespace tr3 {
+
+static std::string last_error_text(const char* what) {
+    return std::string(what) + " 失敗: " + std::to_string(static_cast<unsigned long>(::GetLastError()));
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE f = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) { last_error_ = last_error_text("CreateFile"); return false; }
+
+    LARGE_INTEGER sz{};
+    if (!::GetFileSizeEx(f, &sz)) { last_error_ = last_error_text("GetFileSizeEx"); ::CloseHandle(f); return false; }
+    size_ = static_cast<size_t>(sz.QuadPart);
+    if (size_ > 0) {
+        HANDLE m = ::CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m) { last_error_ = last_error_text("CreateFileMapping"); ::CloseHandle(f); size_ = 0; return false; }
+        const void* p = ::MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+        if (!p) {
+            last_error_ = last_error_text("MapViewOfFile");
+            ::CloseHandle(m); ::CloseHandle(f); size_ = 0;
+            return false;
+        }
+        mapping_ = m;
+        data_    = static_cast<const uint8_t*>(p);
+    }
+    file_   = f;
+    opened_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_)    ::UnmapViewOfFile(data_);
+    if (mapping_) ::CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_)    ::CloseHandle(static_cast<HANDLE>(file_));
+    data_ = nullptr; mapping_ = nullptr; file_ = nullptr;
+    size_   = 0;
+    opened_ = false;
+}
+
+// ───────────────────────────────────
+// 読み書き
+// ───────────────────────────────────
+bool MappedWriteFile::create(const std::string& path, size_t size) {
+    close();
+    if (size == 0) { last_error_ = "大きさ 0 のマップは作れません"; return false; }
+    // FILE_SHARE_DELETE：開いたまま名前を変えられるように（ジャーナルの予備セグメント）
+    HANDLE f = ::CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) { last_error_ = last_error_text("CreateFile"); return false; }
+
+    // マップの大きさを指定すると、ファイルもその大きさまで（0 埋めで）伸びる
+    HANDLE m = ::CreateFileMappingA(f, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size & 0xFFFFFFFFu), nullptr);
+    if (!m) { last_error_ = last_error_text("CreateFileMapping"); ::CloseHandle(f); return false; }
+    void* p = ::MapViewOfFile(m, FILE_MAP_WRITE, 0, 0, size);
+    if (!p) {
+        last_error_ = last_error_text("MapViewOfFile");
+        ::CloseHandle(m); ::CloseHandle(f);
+        return false;
+    }
+    file_    = f;
+    mapping_ = m;
+    data_    = static_cast<uint8_t*>(p);
+    size_    = size;
+    return true;
+}
+
+void MappedWriteFile::close() {
+    if (data_)    ::UnmapViewOfFile(data_);
+    if (mapping_) ::CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_)    ::CloseHandle(static_cast<HANDLE>(file_));
+    data_ = nullptr; mapping_ = nullptr; file_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedWriteFile::sync(size_t offset, size_t n) {
+    if (!data_ || n == 0 || offset >= size_) return true;
+    if (n > size_ - offset) n = size_ - offset;
+    // FlushViewOfFile はダーティページを書き出すだけなので、FlushFileBuffers で完了まで待つ
+    if (!::FlushViewOfFile(data_ + offset, n))                 { last_error_ = last_error_text("FlushViewOfFile");  return false; }
+    if (!::FlushFileBuffers(static_cast<HANDLE>(file_)))       { last_error_ = last_error_text("FlushFileBuffers"); return false; }
+    return true;
+}
+
+} // namespace tr3
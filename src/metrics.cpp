@@ -0,0 +1,295 @@
+// 計測値の集計と出力
+#include "../include/metrics.hpp"
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+Metrics& metrics() {
+    static Metrics m;
+    return m;
+}
+
+// ───────────────────────────────────
+// AtomicHistogram
+// ───────────────────────────────────
+LatencyHistogram AtomicHistogram::snapshot() const {
+    LatencyHistogram h;
+    for (size_t i = 0; i < counts_.size(); ++i) h.add_bucket(i, counts_[i].load(std::memory_order_relaxed));
+    h.add_totals(sum_.load(std::memory_order_relaxed), max_.load(std::memory_order_relaxed));
+    return h;
+}
+
+void AtomicHistogram::reset() {
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+// ───────────────────────────────────
+// Metrics
+// ───────────────────────────────────
+void Metrics::add_parser(const FrameParserStats& now, FrameParserStats& last) {
+    auto add = [](std::atomic<uint64_t>& a, uint64_t cur, uint64_t& prev) {
+        if (cur > prev) a.fetch_add(cur - prev, std::memory_order_relaxed);
+        prev = cur;
+    };
+    add(frames_,            now.frames,            last.frames);
+    add(resyncs_,           now.resyncs,           last.resyncs);
+    add(bytes_discarded_,   now.bytes_discarded,   last.bytes_discarded);
+    add(checksum_failures_, now.checksum_failures, last.checksum_failures);
+    add(overflows_,         now.overflows,         last.overflows);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot s;
+    s.wall_ms           = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    s.bytes_sent        = bytes_sent_.load(std::memory_order_relaxed);
+    s.bytes_received    = bytes_received_.load(std::memory_order_relaxed);
+    s.write_errors      = write_errors_.load(std::memory_order_relaxed);
+    s.frames            = frames_.load(std::memory_order_relaxed);
+    s.resyncs           = resyncs_.load(std::memory_order_relaxed);
+    s.bytes_discarded   = bytes_discarded_.load(std::memory_order_relaxed);
+    s.checksum_failures = checksum_failures_.load(std::memory_order_relaxed);
+    s.overflows         = overflows_.load(std::memory_order_relaxed);
+    s.uids              = uids_.load(std::memory_order_relaxed);
+    s.inventory_cycle_us = inventory_cycle_.snapshot();
+    for (size_t i = 0; i < 256; ++i) s.nack_codes[i] = nack_codes_[i].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < METRIC_SLOTS; ++i) {
+        auto& d = s.commands[i];
+        const auto& src = slots_[i];
+        d.cmd      = i < METRIC_COMMANDS.size() ? METRIC_COMMANDS[i] : 0;
+        d.requests = src.requests.load(std::memory_order_relaxed);
+        d.acks     = src.acks.load(std::memory_order_relaxed);
+        d.nacks    = src.nacks.load(std::memory_order_relaxed);
+        d.timeouts = src.timeouts.load(std::memory_order_relaxed);
+        d.rtt_us   = src.rtt.snapshot();
+    }
+    return s;
+}
+
+void Metrics::reset() {
+    for (auto* a : {&bytes_sent_, &bytes_received_, &write_errors_, &frames_, &resyncs_,
+                    &bytes_discarded_, &checksum_failures_, &overflows_, &uids_})
+        a->store(0, std::memory_order_relaxed);
+    inventory_cycle_.reset();
+    for (auto& c : nack_codes_) c.store(0, std::memory_order_relaxed);
+    for (auto& sl : slots_) {
+        sl.requests.store(0, std::memory_order_relaxed);
+        sl.acks.store(0, std::memory_order_relaxed);
+        sl.nacks.store(0, std::memory_order_relaxed);
+        sl.timeouts.store(0, std::memory_order_relaxed);
+        sl.rtt.reset();
+    }
+}
+
+// ───────────────────────────────────
+// Prometheus テキスト形式
+// ───────────────────────────────────
+namespace {
+
+// Prometheus のバケット境界（us）。スクレイプ間で固定にするため HDR のバケットから集約する
+constexpr uint64_t PROM_BOUNDS_US[] = {
+    500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000, 5000000};
+
+// 書式付きで末尾に追加する（1 回の出力は 512 バイトまで）
+void append(std::string& s, const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = std::vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) s.append(buf, size_t(n) < sizeof(buf) ? size_t(n) : sizeof(buf) - 1);
+}
+
+const char* cmd_label(const CommandMetricsSnapshot& c, char (&buf)[8]) {
+    if (c.cmd == 0) return "other";
+    std::snprintf(buf, sizeof(buf), "0x%02X", c.cmd);
+    return buf;
+}
+
+void prom_counter(std::string& o, const char* name, const char* help, uint64_t v) {
+    append(o, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n", name, help, name, name, v);
+}
+
+void prom_histogram(std::string& o, const char* name, const char* labels, const LatencyHistogram& h) {
+    // labels は "cmd=\"0x78\"" のような形式（空なら付けない）
+    const char* sep = labels[0] ? "," : "";
+    uint64_t cum = 0;
+    size_t   b   = 0;
+    for (uint64_t le : PROM_BOUNDS_US) {
+        for (; b < LatencyHistogram::BUCKETS && LatencyHistogram::upper_of(b) <= le; ++b) cum += h.bucket(b);
+        append(o, "%s_bucket{%s%sle=\"%" PRIu64 "\"} %" PRIu64 "\n", name, labels, sep, le, cum);
+    }
+    append(o, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", name, labels, sep, h.count());
+    if (labels[0]) {
+        append(o, "%s_sum{%s} %" PRIu64 "\n", name, labels, h.sum());
+        append(o, "%s_count{%s} %" PRIu64 "\n", name, labels, h.count());
+    } else {
+        append(o, "%s_sum %" PRIu64 "\n", name, h.sum());
+        append(o, "%s_count %" PRIu64 "\n", name, h.count());
+    }
+}
+
+} // namespace
+
+std::string to_prometheus(const MetricsSnapshot& s) {
+    std::string o;
+    o.reserve(8192);
+    prom_counter(o, "tr3_bytes_sent_total",         "ホストから送信したバイト数", s.bytes_sent);
+    prom_counter(o, "tr3_bytes_received_total",     "リーダから受信したバイト数", s.bytes_received);
+    prom_counter(o, "tr3_write_errors_total",       "送信エラー", s.write_errors);
+    prom_counter(o, "tr3_frames_total",             "受信したフレーム数", s.frames);
+    prom_counter(o, "tr3_resyncs_total",            "STX 探索で読み飛ばした回数", s.resyncs);
+    prom_counter(o, "tr3_bytes_discarded_total",    "再同期で捨てたバイト数", s.bytes_discarded);
+    prom_counter(o, "tr3_checksum_failures_total",  "SUM 不一致のフレーム数", s.checksum_failures);
+    prom_counter(o, "tr3_parser_overflows_total",   "受信バッファあふれ", s.overflows);
+    prom_counter(o, "tr3_uids_total",               "Inventory2 で受信した UID 数", s.uids);
+
+    o += "# HELP tr3_nack_total NACK のエラーコード別件数\n# TYPE tr3_nack_total counter\n";
+    for (size_t i = 0; i < s.nack_codes.size(); ++i)
+        if (s.nack_codes[i]) append(o, "tr3_nack_total{code=\"0x%02zX\"} %" PRIu64 "\n", i, s.nack_codes[i]);
+
+    struct Field { const char* name; const char* help; uint64_t CommandMetricsSnapshot::*m; };
+    const Field fields[] = {
+        {"tr3_command_requests_total", "送信したコマンド数",            &CommandMetricsSnapshot::requests},
+        {"tr3_command_acks_total",     "ACK を受信したコマンド数",      &CommandMetricsSnapshot::acks},
+        {"tr3_command_nacks_total",    "NACK を受信したコマンド数",     &CommandMetricsSnapshot::nacks},
+        {"tr3_command_timeouts_total", "応答なしで打ち切ったコマンド数", &CommandMetricsSnapshot::timeouts},
+    };
+    char lb[8];
+    for (const auto& f : fields) {
+        append(o, "# HELP %s %s\n# TYPE %s counter\n", f.name, f.help, f.name);
+        for (const auto& c : s.commands) append(o, "%s{cmd=\"%s\"} %" PRIu64 "\n", f.name, cmd_label(c, lb), c.*f.m);
+    }
+
+    o += "# HELP tr3_command_rtt_us コマンド送信から応答受信まで（us）\n# TYPE tr3_command_rtt_us histogram\n";
+    for (const auto& c : s.commands) {
+        char labels[32];
+        std::snprintf(labels, sizeof(labels), "cmd=\"%s\"", cmd_label(c, lb));
+        prom_histogram(o, "tr3_command_rtt_us", labels, c.rtt_us);
+    }
+    o += "# HELP tr3_command_rtt_quantile_us コマンド応答時間の分位点（us）\n# TYPE tr3_command_rtt_quantile_us gauge\n";
+    for (const auto& c : s.commands) {
+        for (double q : {50.0, 90.0, 99.0})
+            append(o, "tr3_command_rtt_quantile_us{cmd=\"%s\",quantile=\"%.2f\"} %" PRIu64 "\n",
+                   cmd_label(c, lb), q / 100.0, c.rtt_us.percentile(q));
+    }
+    o += "# HELP tr3_inventory_cycle_us Inventory2 の送信から完了まで（us）\n# TYPE tr3_inventory_cycle_us histogram\n";
+    prom_histogram(o, "tr3_inventory_cycle_us", "", s.inventory_cycle_us);
+    return o;
+}
+
+// ───────────────────────────────────
+// JSON
+// ───────────────────────────────────
+static void json_hist(std::string& o, const LatencyHistogram& h) {
+    append(o, "{\"count\":%" PRIu64 ",\"mean\":%.1f,\"min\":%" PRIu64 ",\"p50\":%" PRIu64 ",\"p90\":%" PRIu64
+              ",\"p99\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+           h.count(), h.mean(), h.min(), h.percentile(50), h.percentile(90), h.percentile(99), h.max());
+}
+
+std::string to_json(const MetricsSnapshot& s) {
+    std::string o;
+    o.reserve(4096);
+    append(o, "{\"time_ms\":%lld,\"counters\":{", (long long)s.wall_ms);
+    append(o, "\"bytes_sent\":%" PRIu64 ",\"bytes_received\":%" PRIu64 ",\"write_errors\":%" PRIu64
+              ",\"frames\":%" PRIu64 ",\"resyncs\":%" PRIu64 ",\"bytes_discarded\":%" PRIu64
+              ",\"checksum_failures\":%" PRIu64 ",\"overflows\":%" PRIu64 ",\"uids\":%" PRIu64 "},",
+           s.bytes_sent, s.bytes_received, s.write_errors, s.frames, s.resyncs, s.bytes_discarded,
+           s.checksum_failures, s.overflows, s.uids);
+    o += "\"nack\":{";
+    bool first = true;
+    for (size_t i = 0; i < s.nack_codes.size(); ++i) {
+        if (!s.nack_codes[i]) continue;
+        append(o, "%s\"0x%02zX\":%" PRIu64, first ? "" : ",", i, s.nack_codes[i]);
+        first = false;
+    }
+    o += "},\"commands\":{";
+    char lb[8];
+    for (size_t i = 0; i < s.commands.size(); ++i) {
+        const auto& c = s.commands[i];
+        append(o, "%s\"%s\":{\"requests\":%" PRIu64 ",\"acks\":%" PRIu64 ",\"nacks\":%" PRIu64
+                  ",\"timeouts\":%" PRIu64 ",\"rtt_us\":",
+               i ? "," : "", cmd_label(c, lb), c.requests, c.acks, c.nacks, c.timeouts);
+        json_hist(o, c.rtt_us);
+        o += "}";
+    }
+    o += "},\"inventory_cycle_us\":";
+    json_hist(o, s.inventory_cycle_us);
+    o += "}\n";
+    return o;
+}
+
+// ───────────────────────────────────
+// ファイル出力
+// ───────────────────────────────────
+std::string metrics_text(MetricsFormat fmt) {
+    const auto snap = metrics().snapshot();
+    return fmt == MetricsFormat::Json ? to_json(snap) : to_prometheus(snap);
+}
+
+bool write_metrics_file(const std::string& path, MetricsFormat fmt, std::string* err) {
+    const std::string text = metrics_text(fmt);
+    const std::string tmp  = path + ".tmp";
+
+    std::FILE* fp = std::fopen(tmp.c_str(), "wb");
+    if (!fp) { if (err) *err = "計測ファイルを開けません: " + tmp; return false; }
+    const bool ok = std::fwrite(text.data(), 1, text.size(), fp) == text.size();
+    std::fclose(fp);
+    if (!ok) { if (err) *err = "計測ファイルへ書けません: " + tmp; return false; }
+#ifdef _WIN32
+    std::remove(path.c_str());   // Windows の rename は置き換えない
+#endif
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) { if (err) *err = "計測ファイルを置き換えられません: " + path; return false; }
+    return true;
+}
+
+bool MetricsExporter::start(std::string path, MetricsFormat fmt, milliseconds interval) {
+    stop();
+    path_     = std::move(path);
+    fmt_      = fmt;
+    interval_ = interval.count() > 0 ? interval : milliseconds(1000);
+    quit_     = false;
+    std::string err;
+    if (!write_metrics_file(path_, fmt_, &err)) {
+        std::lock_guard<std::mutex> lk(mu_);
+        last_error_ = err;
+        return false;
+    }
+    th_ = std::thread([this] { run(); });
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (!th_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    th_.join();
+    write_metrics_file(path_, fmt_);
+}
+
+std::string MetricsExporter::last_error() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return last_error_;
+}
+
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!cv_.wait_for(lk, interval_, [&] { return quit_; })) {
+        lk.unlock();
+        std::string err;
+        const bool ok = write_metrics_file(path_, fmt_, &err);
+        lk.lock();
+        if (!ok) last_error_ = err;
+    }
+}
+
+} // namespace tr3
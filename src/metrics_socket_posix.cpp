@@ -0,0 +1,76 @@
+// MetricsSocketServer: UNIX ドメインソケット実装
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "../include/metrics_socket.hpp"
+
+namespace tr3 {
+
+bool MetricsSocketServer::start(const std::string& path, MetricsFormat fmt) {
+    stop();
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) { last_error_ = "ソケットのパスが長すぎます: " + path; return false; }
+    path_ = path;
+    fmt_  = fmt;
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) { last_error_ = std::string("socket 失敗: ") + std::strerror(errno); return false; }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    ::unlink(path.c_str());   // 前回の残り
+    if (::bind(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 8) != 0) {
+        last_error_ = std::string("bind/listen 失敗: ") + std::strerror(errno);
+        ::close(fd_); fd_ = -1;
+        return false;
+    }
+    if (::pipe2(wake_, O_CLOEXEC) != 0) {
+        last_error_ = std::string("pipe 失敗: ") + std::strerror(errno);
+        ::close(fd_); fd_ = -1;
+        ::unlink(path.c_str());
+        return false;
+    }
+    th_ = std::thread([this] { run(); });
+    return true;
+}
+
+void MetricsSocketServer::stop() {
+    if (th_.joinable()) {
+        const char c = 0;
+        (void)!::write(wake_[1], &c, 1);
+        th_.join();
+    }
+    for (int& fd : wake_) if (fd >= 0) { ::close(fd); fd = -1; }
+    if (fd_ >= 0) { ::close(fd_); fd_ = -1; ::unlink(path_.c_str()); }
+}
+
+void MetricsSocketServer::run() {
+    pollfd p[2] = {{fd_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+    while (true) {
+        if (::poll(p, 2, -1) < 0) { if (errno == EINTR) continue; break; }
+        if (p[1].revents) break;
+        if (!(p[0].revents & POLLIN)) continue;
+
+        const int c = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (c < 0) continue;
+        // 受け手が読まなくても止まらないよう、送信は 1 秒で打ち切る
+        timeval tv{1, 0};
+        ::setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        const std::string text = metrics_text(fmt_);
+        size_t done = 0;
+        while (done < text.size()) {
+            const ssize_t w = ::send(c, text.data() + done, text.size() - done, MSG_NOSIGNAL);
+            if (w > 0) { done += size_t(w); continue; }
+            if (w < 0 && errno == EINTR) continue;
+            break;
+        }
+        ::close(c);
+        served_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,60 @@
+// PortWatcher: POSIX 実装（Linux は inotify、それ以外は一定間隔で確かめる）
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <algorithm>
+#include <thread>
+
+#include "../include/port_watch.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// inotify の取りこぼし・非対応のファイルシステム（devpts 等）に備えて、この間隔でも確かめる
+static constexpr milliseconds RECHECK{100};
+
+PortWatcher::PortWatcher(std::string port) : port_(std::move(port)) {
+#ifdef __linux__
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ >= 0) {
+        const size_t slash = port_.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : port_.substr(0, slash));
+        // udev はノードを作った後で権限を付けるので、作成と属性変更の両方を見る
+        if (::inotify_add_watch(fd_, dir.c_str(), IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+#endif
+}
+
+PortWatcher::~PortWatcher() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool PortWatcher::present() const {
+    return ::access(port_.c_str(), R_OK | W_OK) == 0;
+}
+
+bool PortWatcher::wait_present(milliseconds timeout) {
+    const auto deadline = steady_clock::now() + timeout;
+    while (true) {
+        // 監視を始めてから確かめるので、確認と待ちの間に現れても取りこぼさない
+        if (present()) return true;
+        const auto now = steady_clock::now();
+        if (now >= deadline) return false;
+        const auto slice = std::min(RECHECK, duration_cast<milliseconds>(deadline - now) + milliseconds(1));
+        if (fd_ < 0) { std::this_thread::sleep_for(slice); continue; }
+
+        pollfd p{fd_, POLLIN, 0};
+        if (::poll(&p, 1, int(slice.count())) > 0) {
+            char buf[4096];
+            while (::read(fd_, buf, sizeof(buf)) > 0) {}   // 中身は見ずに present() で確かめる
+        }
+    }
+}
+
+} // namespace tr3
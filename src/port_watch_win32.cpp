@@ -0,0 +1,38 @@
+// PortWatcher: Win32 API 実装（QueryDosDevice でポート名の有無を確かめる）
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <algorithm>
+#include <thread>
+
+#include "../include/port_watch.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// デバイス通知（WM_DEVICECHANGE）はウィンドウが要るので、コンソールでは短い間隔で確かめる。
+// QueryDosDevice 1 回はカーネルの名前表を引くだけで軽い
+static constexpr milliseconds RECHECK{20};
+
+PortWatcher::PortWatcher(std::string port) : port_(std::move(port)) {}
+
+PortWatcher::~PortWatcher() {}
+
+bool PortWatcher::present() const {
+    char target[512];
+    return ::QueryDosDeviceA(port_.c_str(), target, sizeof(target)) != 0;
+}
+
+bool PortWatcher::wait_present(milliseconds timeout) {
+    const auto deadline = steady_clock::now() + timeout;
+    while (true) {
+        if (present()) return true;
+        const auto now = steady_clock::now();
+        if (now >= deadline) return false;
+        std::this_thread::sleep_for(std::min(RECHECK, duration_cast<milliseconds>(deadline - now) + milliseconds(1)));
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,79 @@
+// リーダの自動検出
+#include "../include/reader_discovery.hpp"
+#include "../include/baud_negotiation.hpp"
+#include "../include/log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+namespace {
+
+struct Slot {
+    bool             ok = false;
+    DiscoveredReader reader;
+    std::string      error;
+};
+
+// 1 ポート分：速度を探し、応答したら動作モードを読んで閉じる
+void probe_port(const std::string& port, const DiscoveryOptions& opt, Slot& out) {
+    const auto t0 = steady_clock::now();
+    uint32_t hint = 0;
+    if (opt.profiles)
+        if (const ReaderProfile* p = opt.profiles->find(port)) hint = p->baud;
+
+    SerialPort sp(port, hint ? hint : 19200);
+    BaudProbeResult pr;
+    if (probe_baud(sp, pr, hint, opt.probe_timeout_ms)) {
+        out.ok                 = true;
+        out.reader.port        = port;
+        out.reader.baud        = pr.baud;
+        out.reader.rom_version = pr.rom_version;
+        ReaderModePretty pretty;
+        out.reader.mode_ok = read_reader_mode(sp, out.reader.mode, pretty, opt.mode_timeout_ms);
+        if (!out.reader.mode_ok) out.reader.mode = ReaderModeRaw{};
+    } else {
+        out.error = pr.error;
+    }
+    sp.close();
+    out.reader.elapsed_ms = uint32_t(duration_cast<milliseconds>(steady_clock::now() - t0).count());
+}
+
+} // namespace
+
+DiscoveryResult discover_readers(const DiscoveryOptions& opt) {
+    const auto t0 = steady_clock::now();
+    const std::vector<std::string> ports = opt.ports.empty() ? enum_serial_ports() : opt.ports;
+
+    // ポートごとに結果の置き場を分けておき、スレッドは次のポートを取っては探す
+    std::vector<Slot> slots(ports.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < ports.size();)
+            probe_port(ports[i], opt, slots[i]);
+    };
+    const size_t n = std::min(ports.size(), std::max<size_t>(1, opt.max_parallel));
+    std::vector<std::thread> th;
+    th.reserve(n);
+    for (size_t i = 0; i < n; ++i) th.emplace_back(worker);
+    for (auto& t : th) t.join();
+
+    DiscoveryResult out;
+    out.probed = ports.size();
+    for (size_t i = 0; i < ports.size(); ++i) {
+        if (slots[i].ok) out.readers.push_back(std::move(slots[i].reader));
+        else             out.failed.push_back(DiscoveryFailure{ports[i], std::move(slots[i].error)});
+    }
+    out.elapsed_ms = uint32_t(duration_cast<milliseconds>(steady_clock::now() - t0).count());
+    log_text(LogLevel::Info, LogTag::Cmt,
+             "リーダの検出: " + std::to_string(out.readers.size()) + " 台 / " + std::to_string(out.probed) +
+             " ポート（" + std::to_string(out.elapsed_ms) + " ms）");
+    return out;
+}
+
+} // namespace tr3
@@ -0,0 +1,322 @@
+// 複数リーダの同時駆動（Linux / epoll）
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "../include/reader_pool.hpp"
+#include "../include/serial_port.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/inventory_cycle.hpp"
+#include "../include/metrics.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+static constexpr uint32_t WAKE_TAG = 0xFFFFFFFFu;   // epoll_event.data.u32 の停止通知用
+static constexpr int      MAX_EVENTS = 64;
+
+// 壊れたフレーム（SUMエラー・あふれ）の累計。増えていなければ予告数の UID は必ず届く
+static uint64_t frames_lost(const FrameParserStats& st) { return st.checksum_failures + st.overflows; }
+
+struct ReaderPool::Reader {
+    enum class Phase { Closed, Idle, Waiting, Draining };   // Draining：打ち切ったサイクルの残りを捨てている
+
+    uint32_t                    id = 0;
+    ReaderConfig                cfg;
+    std::unique_ptr<SerialPort> sp;
+    FrameParser                 parser;
+    FrameParserStats            parser_last;    // 計測へ加え済みのパーサ統計
+    Inventory2Cycle             cycle;
+    Phase                       phase = Phase::Closed;
+    steady_clock::time_point    due{};          // 次の処理（再接続・次サイクル・タイムアウト）
+    steady_clock::time_point    t_sent{};       // Inventory2 の送信時刻
+    steady_clock::time_point    t_rx{};         // 現サイクルで最後に受信した時刻
+    microseconds                gap{};          // 応答終端の無通信ギャップ（サイクル開始時に読む）
+    uint64_t                    lost0 = 0;      // サイクル開始時のパーサの破損フレーム数
+    steady_clock::time_point    resume_at{};    // Draining の後に次サイクルを送る時刻
+    steady_clock::time_point    drain_end{};    // Draining の上限（自律動作で流れ続けても次へ進む）
+    uint64_t                    cycle_no = 0;
+    bool                        acked = false;  // 現サイクルの ACK/NACK を計測済みか
+    bool                        await_ack = false;   // 打ち切りの後：ACK/NACK までのフレームは前のサイクルの残り
+    bool                        ever_opened = false;
+
+    // health() 用（I/O スレッドが書き、他スレッドが読む）
+    std::atomic<bool>     connected{false};
+    std::atomic<uint64_t> cycles{0}, uids{0}, timeouts{0}, gap_ends{0}, nacks{0}, reconnects{0};
+    std::atomic<uint64_t> bytes_rx{0}, checksum_failures{0};
+    std::atomic<int64_t>  last_cycle_ns{-1};   // steady_clock の time_since_epoch
+};
+
+ReaderPool::ReaderPool(EventCallback cb) : cb_(std::move(cb)) {}
+
+ReaderPool::~ReaderPool() {
+    stop();
+    if (epfd_ >= 0)   ::close(epfd_);
+    if (wakefd_ >= 0) ::close(wakefd_);
+}
+
+uint32_t ReaderPool::add_reader(const ReaderConfig& cfg) {
+    auto r = std::make_unique<Reader>();
+    r->id  = uint32_t(readers_.size());
+    r->cfg = cfg;
+    r->sp  = std::make_unique<SerialPort>(cfg.port, cfg.baud);
+    readers_.push_back(std::move(r));
+    return readers_.back()->id;
+}
+
+bool ReaderPool::start() {
+    if (running()) return false;
+    if (epfd_ < 0) {
+        epfd_   = ::epoll_create1(EPOLL_CLOEXEC);
+        wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd_ < 0 || wakefd_ < 0) { last_error_ = std::string("epoll 初期化失敗: ") + std::strerror(errno); return false; }
+        epoll_event ev{}; ev.events = EPOLLIN; ev.data.u32 = WAKE_TAG;
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+    }
+    t_start_ = steady_clock::now();
+    for (auto& r : readers_) { r->phase = Reader::Phase::Closed; r->due = t_start_; }
+
+    stop_req_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    th_ = std::thread([this] { io_loop(); });
+    return true;
+}
+
+void ReaderPool::stop() {
+    if (!running()) return;
+    stop_req_.store(true, std::memory_order_release);
+    const uint64_t one = 1;
+    (void)!::write(wakefd_, &one, sizeof(one));
+    if (th_.joinable()) th_.join();
+    for (auto& r : readers_) disconnect(*r, steady_clock::now());
+    running_.store(false, std::memory_order_release);
+}
+
+std::vector<ReaderHealth> ReaderPool::health() const {
+    std::vector<ReaderHealth> out;
+    out.reserve(readers_.size());
+    const auto   now = steady_clock::now();
+    const double up  = running() ? duration<double>(now - t_start_).count() : 0.0;
+    for (const auto& r : readers_) {
+        ReaderHealth h;
+        h.reader_id = r->id;
+        h.port      = r->cfg.port;
+        h.connected = r->connected.load(std::memory_order_relaxed);
+        h.cycles    = r->cycles.load(std::memory_order_relaxed);
+        h.uids      = r->uids.load(std::memory_order_relaxed);
+        h.timeouts  = r->timeouts.load(std::memory_order_relaxed);
+        h.gap_ends  = r->gap_ends.load(std::memory_order_relaxed);
+        h.nacks     = r->nacks.load(std::memory_order_relaxed);
+        h.reconnects = r->reconnects.load(std::memory_order_relaxed);
+        h.bytes_rx  = r->bytes_rx.load(std::memory_order_relaxed);
+        h.checksum_failures = r->checksum_failures.load(std::memory_order_relaxed);
+        if (up > 0) { h.cycles_per_sec = double(h.cycles) / up; h.uids_per_sec = double(h.uids) / up; }
+        const int64_t last = r->last_cycle_ns.load(std::memory_order_relaxed);
+        if (last >= 0)
+            h.ms_since_last_cycle = duration<double, std::milli>(now.time_since_epoch() - nanoseconds(last)).count();
+        out.push_back(std::move(h));
+    }
+    return out;
+}
+
+void ReaderPool::try_open(Reader& r, steady_clock::time_point now) {
+    if (!r.sp->open()) {
+        r.due = now + milliseconds(r.cfg.reconnect_ms);
+        return;
+    }
+    epoll_event ev{}; ev.events = EPOLLIN; ev.data.u32 = r.id;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, r.sp->native_handle(), &ev) != 0) {
+        r.sp->close();
+        r.due = now + milliseconds(r.cfg.reconnect_ms);
+        return;
+    }
+    if (r.ever_opened) r.reconnects.fetch_add(1, std::memory_order_relaxed);
+    r.ever_opened = true;
+    r.parser.reset();
+    r.parser_last = FrameParserStats{};
+    r.connected.store(true, std::memory_order_relaxed);
+    r.phase = Reader::Phase::Idle;
+    r.due   = now;
+}
+
+void ReaderPool::disconnect(Reader& r, steady_clock::time_point now) {
+    if (r.sp->is_open()) {
+        ::epoll_ctl(epfd_, EPOLL_CTL_DEL, r.sp->native_handle(), nullptr);
+        r.sp->close();
+    }
+    r.connected.store(false, std::memory_order_relaxed);
+    r.phase = Reader::Phase::Closed;
+    r.due   = now + milliseconds(r.cfg.reconnect_ms);
+}
+
+void ReaderPool::begin_cycle(Reader& r, steady_clock::time_point now) {
+    r.cycle.reset();
+    metrics().on_request(CMD_INV2);
+    if (!r.sp->write(INV2_REQUEST.data(), INV2_REQUEST.size())) {
+        metrics().add_write_error();
+        disconnect(r, now);
+        return;
+    }
+    r.t_sent = r.t_rx = now;
+    r.gap    = r.sp->end_of_response_gap();
+    r.lost0  = frames_lost(r.parser.stats());
+    r.acked  = false;
+    ++r.cycle_no;
+    r.phase = Reader::Phase::Waiting;
+    r.due   = now + milliseconds(r.cfg.cycle_timeout_ms);
+}
+
+void ReaderPool::update_due(Reader& r) {
+    // 壊れたフレームを見た後は、最後の受信から無通信ギャップが空いた時点でサイクルを終える
+    // （cycle_timeout_ms は上限としてだけ使う）
+    r.due = r.t_sent + milliseconds(r.cfg.cycle_timeout_ms);
+    const bool started = r.cycle.expected() >= 0 || !r.cycle.result().items.empty();
+    if (started && frames_lost(r.parser.stats()) > r.lost0) r.due = std::min(r.due, r.t_rx + r.gap);
+}
+
+void ReaderPool::finish_cycle(Reader& r, steady_clock::time_point now, CycleEnd end) {
+    auto& m = metrics();
+    if (r.cycle.state() == Inventory2Cycle::State::Done || (end == CycleEnd::Gap && r.acked))
+        m.on_inventory_cycle(uint64_t(duration_cast<microseconds>(now - r.t_sent).count()));
+    else if (!r.acked)
+        m.on_timeout(CMD_INV2);
+    m.add_uids(r.cycle.result().items.size());
+    m.add_parser(r.parser.stats(), r.parser_last);
+
+    r.cycles.fetch_add(1, std::memory_order_relaxed);
+    r.last_cycle_ns.store(int64_t(duration_cast<nanoseconds>(now.time_since_epoch()).count()),
+                          std::memory_order_relaxed);
+    // 捨てきれなかった残り（上限で打ち切り）や、ギャップで終えたサイクルの遅れた UID も次のサイクルへ数えない
+    r.await_ack = (end != CycleEnd::Complete);
+    if (end == CycleEnd::Timeout) {
+        // 遅れて届く ACK・UID を次のサイクルへ数えないよう、無通信になるまで捨ててから送る
+        r.phase     = Reader::Phase::Draining;
+        r.resume_at = now + milliseconds(r.cfg.interval_ms);
+        r.drain_end = now + milliseconds(r.cfg.cycle_timeout_ms);
+        r.due       = std::min(now + milliseconds(r.cfg.drain_ms), r.drain_end);
+        return;
+    }
+    r.phase = Reader::Phase::Idle;
+    r.due   = now + milliseconds(r.cfg.interval_ms);
+    if (r.cfg.interval_ms == 0) begin_cycle(r, now);
+}
+
+void ReaderPool::end_drain(Reader& r, steady_clock::time_point now) {
+    metrics().add_parser(r.parser.stats(), r.parser_last);
+    r.parser.reset();   // 途中まで受けたフレームも捨てる
+    r.parser_last = FrameParserStats{};
+    r.phase = Reader::Phase::Idle;
+    r.due   = std::max(now, r.resume_at);
+    if (r.due == now) begin_cycle(r, now);
+}
+
+void ReaderPool::on_readable(Reader& r) {
+    // 溜まっている分を読み切る（非ブロッキング。期限を過去にして poll させない）
+    while (true) {
+        size_t room = 0;
+        uint8_t* dst = r.parser.prepare(room);
+        const size_t n = r.sp->read_some(dst, room, steady_clock::time_point{});
+        if (n == 0) break;
+        r.parser.commit(n);
+        r.bytes_rx.fetch_add(n, std::memory_order_relaxed);
+
+        const auto t_mono = steady_clock::now();
+        const auto t_wall = system_clock::now();
+        r.t_rx = t_mono;
+        if (r.phase == Reader::Phase::Draining)
+            r.due = std::min(t_mono + milliseconds(r.cfg.drain_ms), r.drain_end);   // 届いている間は捨て続ける
+        FrameView f;
+        while (r.parser.next(f)) {
+            if (r.phase != Reader::Phase::Waiting) continue;   // 打ち切り後に届いた残りは捨てる
+            if (r.await_ack) {
+                Inventory2Ack ack;
+                NackResponse  nack;
+                if (!decode_inventory2_ack(f, ack) && !decode_nack(f, nack)) continue;
+                r.await_ack = false;
+            }
+            const size_t before = r.cycle.result().items.size();
+            const auto   state  = r.cycle.on_frame(f);
+
+            const auto& items = r.cycle.result().items;
+            if (items.size() > before) {
+                r.uids.fetch_add(1, std::memory_order_relaxed);
+                if (cb_) {
+                    PoolEvent ev;
+                    ev.reader_id = r.id;
+                    ev.cycle     = r.cycle_no;
+                    ev.item      = items.back();
+                    ev.t_mono    = t_mono;
+                    ev.t_wall    = t_wall;
+                    cb_(ev);
+                }
+            }
+            if (!r.acked && (r.cycle.expected() >= 0 || state == Inventory2Cycle::State::Nack)) {
+                r.acked = true;
+                const uint64_t rtt = uint64_t(duration_cast<microseconds>(t_mono - r.t_sent).count());
+                NackResponse nack;
+                if (state == Inventory2Cycle::State::Nack && decode_nack(f, nack)) metrics().on_nack(CMD_INV2, nack.code, rtt);
+                else                                                               metrics().on_ack(CMD_INV2, rtt);
+            }
+            if (state == Inventory2Cycle::State::Nack) r.nacks.fetch_add(1, std::memory_order_relaxed);
+            if (state != Inventory2Cycle::State::Pending) finish_cycle(r, t_mono);
+        }
+        if (r.phase == Reader::Phase::Waiting) update_due(r);
+    }
+    r.checksum_failures.store(r.parser.stats().checksum_failures, std::memory_order_relaxed);
+}
+
+void ReaderPool::io_loop() {
+    epoll_event evs[MAX_EVENTS];
+
+    while (!stop_req_.load(std::memory_order_acquire)) {
+        // 期限が来た処理を進め、次に起きる時刻を求める
+        auto now  = steady_clock::now();
+        auto wake = now + seconds(1);
+        for (auto& rp : readers_) {
+            Reader& r = *rp;
+            if (now >= r.due) {
+                switch (r.phase) {
+                case Reader::Phase::Closed:  try_open(r, now); break;
+                case Reader::Phase::Idle:    begin_cycle(r, now); break;
+                case Reader::Phase::Waiting:
+                    if (now < r.t_sent + milliseconds(r.cfg.cycle_timeout_ms)) {
+                        // フレームが欠けたまま無通信ギャップが空いた：届いた分でサイクルを終える
+                        r.gap_ends.fetch_add(1, std::memory_order_relaxed);
+                        finish_cycle(r, now, CycleEnd::Gap);
+                        break;
+                    }
+                    r.timeouts.fetch_add(1, std::memory_order_relaxed);
+                    finish_cycle(r, now, CycleEnd::Timeout);
+                    break;
+                case Reader::Phase::Draining: end_drain(r, now); break;
+                }
+            }
+            wake = std::min(wake, r.due);
+        }
+
+        const auto wait = duration_cast<milliseconds>(wake - now + microseconds(999)).count();
+        const int n = ::epoll_wait(epfd_, evs, MAX_EVENTS, int(std::max<long long>(0, wait)));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            last_error_ = std::string("epoll_wait 失敗: ") + std::strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            const uint32_t tag = evs[i].data.u32;
+            if (tag == WAKE_TAG) {
+                uint64_t v; (void)!::read(wakefd_, &v, sizeof(v));
+                continue;
+            }
+            Reader& r = *readers_[tag];
+            if (!r.sp->is_open()) continue;
+            if (evs[i].events & EPOLLIN) on_readable(r);
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) disconnect(r, steady_clock::now());
+        }
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,134 @@
+// リーダ接続プロファイルの保存と高速再接続
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "../include/reader_profile.hpp"
+#include "../include/baud_negotiation.hpp"
+#include "../include/log.hpp"
+
+namespace tr3 {
+
+static constexpr const char* HEADER = "# tr3 reader profile v1";
+
+static std::string to_hex(const std::vector<uint8_t>& v) {
+    static const char* digits = "0123456789ABCDEF";
+    std::string s;
+    for (uint8_t b : v) { s.push_back(digits[b >> 4]); s.push_back(digits[b & 0x0F]); }
+    return s;
+}
+
+static bool from_hex(const std::string& s, std::vector<uint8_t>& out) {
+    auto nib = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    if (s.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < s.size(); i += 2) {
+        const int hi = nib(s[i]), lo = nib(s[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out.push_back(uint8_t(hi << 4 | lo));
+    }
+    return true;
+}
+
+// ───────────────────────────────────
+// 保存・読み込み
+// ───────────────────────────────────
+bool ProfileStore::load() {
+    items_.clear();
+    if (path_.empty()) return true;
+    std::ifstream in(path_);
+    if (!in) return true;   // まだ無い
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> col;
+        std::istringstream ss(line);
+        for (std::string c; std::getline(ss, c, '\t');) col.push_back(c);
+        if (col.size() < 5) continue;
+
+        ReaderProfile p;
+        p.port        = col[0];
+        p.baud        = uint32_t(std::strtoul(col[1].c_str(), nullptr, 10));
+        p.rom_version = col[2];
+        p.saved_at    = std::strtoll(col[4].c_str(), nullptr, 10);
+        if (p.port.empty() || p.baud == 0 || !from_hex(col[3], p.mode.bytes) || p.mode.bytes.size() < 4) continue;
+        items_.push_back(std::move(p));
+    }
+    return true;
+}
+
+bool ProfileStore::save() {
+    if (path_.empty()) return true;
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) { last_error_ = "プロファイルを書き込めません: " + tmp; return false; }
+        out << HEADER << "\n";
+        for (const auto& p : items_)
+            out << p.port << '\t' << p.baud << '\t' << p.rom_version << '\t'
+                << to_hex(p.mode.bytes) << '\t' << p.saved_at << '\n';
+        if (!out.flush()) { last_error_ = "プロファイルを書き込めません: " + tmp; return false; }
+    }
+#ifdef _WIN32
+    std::remove(path_.c_str());   // Windows の rename は既存のファイルを置き換えない
+#endif
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        last_error_ = "プロファイルを置き換えられません: " + path_;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+const ReaderProfile* ProfileStore::find(const std::string& port) const {
+    for (const auto& p : items_) if (p.port == port) return &p;
+    return nullptr;
+}
+
+const ReaderProfile* ProfileStore::latest() const {
+    const ReaderProfile* best = nullptr;
+    for (const auto& p : items_) if (!best || p.saved_at >= best->saved_at) best = &p;
+    return best;
+}
+
+void ProfileStore::put(ReaderProfile p) {
+    using namespace std::chrono;
+    p.saved_at = duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+    for (auto& q : items_) if (q.port == p.port) { q = std::move(p); return; }
+    items_.push_back(std::move(p));
+}
+
+std::string default_profile_path() {
+    const char* v = std::getenv("TR3_PROFILE");
+    return v ? std::string(v) : std::string("tr3_reader.profile");
+}
+
+// ───────────────────────────────────
+// 高速再接続
+// ───────────────────────────────────
+bool attach_cached(SerialPort& sp, const ReaderProfile& p, uint32_t timeout_ms) {
+    sp.close();
+    if (!sp.set_baud(p.baud) || !sp.open()) return false;
+
+    std::string version;
+    size_t stray = 0;
+    if (!ping_rom(sp, timeout_ms, &version, &stray)) return false;
+    if (version != p.rom_version) {
+        log_text(LogLevel::Info, LogTag::Cmt, "ROMバージョンが前回と違います（" + version + "）。設定を確認し直します");
+        return false;
+    }
+    if (stray > 0 || !is_command_mode(p.mode)) return false;
+
+    log_text(LogLevel::Info, LogTag::Cmt, "前回のプロファイルで接続 : " + std::to_string(p.baud) + "bps / ROM " + version);
+    return true;
+}
+
+} // namespace tr3
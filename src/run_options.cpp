@@ -0,0 +1,146 @@
+// 対話なしで動かすときの設定（コマンドライン・設定ファイル）
+#include "../include/run_options.hpp"
+#include "../include/log.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace tr3 {
+
+const char* buzzer_policy_name(BuzzerPolicy p) {
+    switch (p) {
+    case BuzzerPolicy::Never:  return "never";
+    case BuzzerPolicy::Found:  return "found";
+    case BuzzerPolicy::Always: return "always";
+    }
+    return "?";
+}
+
+const char* run_usage() {
+    return
+        "使い方: tr3_usb                      … 対話モード（ポート・速度・回数を尋ねる）\n"
+        "        tr3_usb [オプション]          … 対話なし（止めるまで、または --cycles 回）\n"
+        "  --config FILE        設定ファイル（キー = 値）。後に書いたオプションで上書き\n"
+        "  --port NAME|auto     COM3 / /dev/ttyUSB0。auto は全ポートを同時に探し、最初に見つかったリーダ（前回のポートを優先）\n"
+        "                       省略時は前回のポートだけを確かめ、応答が無ければ auto と同じ\n"
+        "  --baud auto|BPS      既定 auto（応答する速度を探し、最速へ切り替え）\n"
+        "  --cycles N           Inventory2 の回数（0 = 止めるまで。既定 0）\n"
+        "  --rate HZ            1 秒あたりのサイクル数（0 = 休まず連続。既定 0）\n"
+        "  --timeout MS         Inventory2 1 回の待ち（既定 2000）\n"
+        "  --reader-id N        出力に付けるリーダ番号（既定 0）\n"
+        "  --format F           text / csv / jsonl / binary（既定 text）\n"
+        "  --emit E             reads / presence / all（読み取り／到着・離脱／両方。既定 reads）\n"
+        "  --output FILE        出力先（既定 - = 標準出力）\n"
+        "  --buzzer P           never / found / always（既定 never）\n"
+        "  --summary SEC        集計を標準エラーへ出す間隔（0 = 終了時だけ。既定 10）\n"
+        "  --log L              off / error / info / trace（既定 TR3_LOG、未指定なら error。出力先は標準エラー）\n"
+        "  --journal DIR  --events NAME  --capture FILE  --metrics FILE  --metrics-sock PATH\n"
+        "                       TR3_JOURNAL などの環境変数と同じ（指定した方を優先）\n"
+        "SIGINT / SIGTERM で実行中のサイクルを終えてから止まる。\n";
+}
+
+static bool parse_u64(const std::string& s, uint64_t& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long v = std::strtoull(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || s[0] == '-') return false;
+    out = v;
+    return true;
+}
+
+static bool parse_u32(const std::string& s, uint32_t& out) {
+    uint64_t v = 0;
+    if (!parse_u64(s, v) || v > UINT32_MAX) return false;
+    out = uint32_t(v);
+    return true;
+}
+
+bool apply_run_option(const std::string& key, const std::string& v, RunOptions& o, std::string& error) {
+    bool ok = true;
+    if      (key == "port")         { o.port = v; ok = !v.empty(); }
+    else if (key == "baud")         { if (v == "auto") o.baud = 0; else ok = parse_u32(v, o.baud) && o.baud > 0; }
+    else if (key == "cycles")       ok = parse_u64(v, o.cycles);
+    else if (key == "rate") {
+        char* end = nullptr;
+        o.rate_hz = std::strtod(v.c_str(), &end);
+        ok = !v.empty() && *end == '\0' && o.rate_hz >= 0 && o.rate_hz <= 1000;
+    }
+    else if (key == "timeout")      ok = parse_u32(v, o.timeout_ms) && o.timeout_ms > 0;
+    else if (key == "reader-id")    ok = parse_u32(v, o.reader_id);
+    else if (key == "format")       ok = parse_output_format(v, o.format);
+    else if (key == "emit")         ok = parse_output_emit(v, o.emit);
+    else if (key == "output")       o.output = v;
+    else if (key == "buzzer") {
+        if      (v == "never")  o.buzzer = BuzzerPolicy::Never;
+        else if (v == "found")  o.buzzer = BuzzerPolicy::Found;
+        else if (v == "always") o.buzzer = BuzzerPolicy::Always;
+        else ok = false;
+    }
+    else if (key == "summary")      ok = parse_u32(v, o.summary_sec);
+    else if (key == "log")          { LogLevel lv; o.log = v; ok = parse_log_level(v.c_str(), lv); }
+    else if (key == "journal")      o.journal = v;
+    else if (key == "events")       o.events = v;
+    else if (key == "capture")      o.capture = v;
+    else if (key == "metrics")      o.metrics = v;
+    else if (key == "metrics-sock") o.metrics_sock = v;
+    else { error = "不明な項目: " + key; return false; }
+
+    if (!ok) error = "値が不正です: " + key + " = " + v;
+    return ok;
+}
+
+static std::string trim(const std::string& s) {
+    const size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return {};
+    const size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+bool load_run_config(const std::string& path, RunOptions& out, std::string& error) {
+    std::ifstream in(path);
+    if (!in) { error = "設定ファイルを開けません: " + path; return false; }
+    std::string line;
+    for (int no = 1; std::getline(in, line); ++no) {
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        line = trim(line);
+        if (line.empty()) continue;
+        const size_t eq = line.find('=');
+        std::string err;
+        if (eq == std::string::npos) err = "キー = 値 の形ではありません";
+        else apply_run_option(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), out, err);
+        if (!err.empty()) { error = path + ":" + std::to_string(no) + ": " + err; return false; }
+    }
+    return true;
+}
+
+bool parse_run_args(int argc, char** argv, RunOptions& out, bool& help, std::string& error) {
+    help = false;
+    // 設定ファイルを先に読み、コマンドラインで上書きする
+    for (int i = 1; i < argc; ++i) {
+        std::string path;
+        if (std::strncmp(argv[i], "--config=", 9) == 0) path = argv[i] + 9;
+        else if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) path = argv[i + 1];
+        else continue;
+        if (!load_run_config(path, out, error)) return false;
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--help" || a == "-h") { help = true; return true; }
+        if (a.compare(0, 2, "--") != 0) { error = "不明な引数: " + a; return false; }
+        // --key=value と --key value のどちらでもよい
+        std::string key = a.substr(2), value;
+        const size_t eq = key.find('=');
+        if (eq != std::string::npos) { value = key.substr(eq + 1); key.resize(eq); }
+        else if (i + 1 < argc) value = argv[++i];
+        else { error = a + " に値がありません"; return false; }
+        if (key == "config") continue;
+        if (!apply_run_option(key, value, out, error)) return false;
+    }
+    return true;
+}
+
+} // namespace tr3
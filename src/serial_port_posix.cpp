@@ -0,0 +1,187 @@
+// SerialPort: POSIX termios 実装（Linux の /dev/ttyUSB* /dev/ttyACM* 等）
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+#include "../include/serial_port.hpp"
+#include "../include/capture.hpp"
+#include "../include/metrics.hpp"
+
+namespace tr3 {
+
+static bool to_speed(uint32_t baud, speed_t& out) {
+    switch (baud) {
+        case 9600:   out = B9600;   return true;
+        case 19200:  out = B19200;  return true;
+        case 38400:  out = B38400;  return true;
+        case 57600:  out = B57600;  return true;
+        case 115200: out = B115200; return true;
+        case 230400: out = B230400; return true;
+        default:     return false;
+    }
+}
+
+// デバイスが外れたときの errno（USB シリアルの抜去で EIO / ENXIO / ENODEV になる）
+static bool is_gone(int e) { return e == EIO || e == ENXIO || e == ENODEV; }
+
+bool SerialPort::is_open() const { return h_ >= 0; }
+
+bool SerialPort::open() {
+    close();
+    speed_t spd{};
+    if (!to_speed(baud_, spd)) { last_error_ = "未対応のボーレート"; return false; }
+
+    // 読み取りは poll で待つので O_NONBLOCK のまま使う
+    h_ = ::open(port_name_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (h_ < 0) { last_error_ = std::string("open 失敗: ") + std::strerror(errno); return false; }
+
+    termios tio{};
+    if (::tcgetattr(h_, &tio) != 0) {
+        last_error_ = std::string("tcgetattr 失敗: ") + std::strerror(errno); close(); return false;
+    }
+    // raw モード 8N1、フロー制御なし
+    ::cfmakeraw(&tio);
+    tio.c_cflag |= (CLOCAL | CREAD);
+    tio.c_cflag &= ~(PARENB | CSTOPB | CSIZE);
+    tio.c_cflag |= CS8;
+#ifdef CRTSCTS
+    tio.c_cflag &= ~CRTSCTS;
+#endif
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    ::cfsetispeed(&tio, spd);
+    ::cfsetospeed(&tio, spd);
+    if (::tcsetattr(h_, TCSANOW, &tio) != 0) {
+        last_error_ = std::string("tcsetattr 失敗: ") + std::strerror(errno); close(); return false;
+    }
+    ++stats_.wait_calls;
+
+    ::tcflush(h_, TCIOFLUSH);
+    lost_ = false;
+    return true;
+}
+
+// poll() は期限まで直接待つので待ち刻みの設定は不要
+void SerialPort::on_timings_changed() {}
+
+void SerialPort::close() {
+    if (h_ >= 0) { ::close(h_); h_ = -1; }
+}
+
+void SerialPort::open_wake() {
+    int fd[2];
+    if (::pipe(fd) != 0) return;   // 作れなければ wakeable() = false（呼び出し側は区切って待つ）
+    for (int f : fd) {
+        ::fcntl(f, F_SETFL, ::fcntl(f, F_GETFL) | O_NONBLOCK);
+        ::fcntl(f, F_SETFD, FD_CLOEXEC);
+    }
+    wake_rd_ = fd[0];
+    wake_wr_ = fd[1];
+}
+
+void SerialPort::close_wake() {
+    if (wake_rd_ >= 0) { ::close(wake_rd_); wake_rd_ = -1; }
+    if (wake_wr_ >= 0) { ::close(wake_wr_); wake_wr_ = -1; }
+}
+
+void SerialPort::wake() {
+    // パイプが一杯でも未読の通知が残っているので、書けなくてよい
+    const uint8_t b = 1;
+    if (wake_wr_ >= 0) (void)!::write(wake_wr_, &b, 1);
+}
+
+bool SerialPort::write(const uint8_t* data, size_t n) {
+    if (h_ < 0) return false;
+    size_t done = 0;
+    while (done < n) {
+        ++stats_.write_calls;
+        const ssize_t w = ::write(h_, data + done, n - done);
+        if (w > 0) { done += size_t(w); stats_.bytes_written += uint64_t(w); continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && errno == EAGAIN) {
+            // 送信バッファが一杯：書き込み可能になるまで待つ
+            pollfd p{h_, POLLOUT, 0};
+            ++stats_.wait_calls;
+            if (::poll(&p, 1, 200) <= 0) { last_error_ = "write タイムアウト"; return false; }
+            continue;
+        }
+        if (is_gone(errno)) lost_ = true;
+        last_error_ = std::string("write 失敗: ") + std::strerror(errno);
+        return false;
+    }
+    metrics().add_sent(n);
+    if (capture_) capture_->record(CaptureDir::Tx, data, n);
+    return true;
+}
+
+size_t SerialPort::read_some(uint8_t* dst, size_t cap, clock::time_point deadline) {
+    if (h_ < 0 || cap == 0) return 0;
+    while (true) {
+        // まず読んでみる（受信済みなら1回のシステムコールで済む）
+        ++stats_.read_calls;
+        const ssize_t r = ::read(h_, dst, cap);
+        if (r > 0) {
+            stats_.bytes_read += uint64_t(r);
+            metrics().add_received(size_t(r));
+            if (capture_) capture_->record(CaptureDir::Rx, dst, size_t(r));
+            return size_t(r);
+        }
+        if (r < 0 && errno != EAGAIN && errno != EINTR) {
+            if (is_gone(errno)) lost_ = true;
+            last_error_ = std::string("read 失敗: ") + std::strerror(errno);
+            return 0;
+        }
+
+        const auto now = clock::now();
+        if (now >= deadline) return 0;
+        const auto rest = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        pollfd ps[2] = {{h_, POLLIN, 0}, {wake_rd_, POLLIN, 0}};
+        const pollfd& p = ps[0];
+        ++stats_.wait_calls;
+        const int pr = ::poll(ps, wake_rd_ >= 0 ? 2 : 1, int(std::max<long long>(1, rest)));
+        if (pr == 0) return 0;
+        if (pr < 0 && errno != EINTR) { last_error_ = std::string("poll 失敗: ") + std::strerror(errno); return 0; }
+        if (pr > 0 && (p.revents & (POLLERR | POLLHUP | POLLNVAL)) && !(p.revents & POLLIN)) {
+            lost_ = true;
+            last_error_ = "ポートが切断されました";
+            return 0;
+        }
+        if (pr > 0 && (ps[1].revents & POLLIN)) {
+            // wake()：通知を読み捨てて戻る（受信済みのデータがあれば先にそれを返す）
+            uint8_t b[64];
+            while (::read(wake_rd_, b, sizeof(b)) > 0) {}
+            if (!(p.revents & POLLIN)) return 0;
+        }
+    }
+}
+
+std::vector<std::string> enum_serial_ports() {
+    std::vector<std::string> ports;
+    DIR* d = ::opendir("/dev");
+    if (!d) return ports;
+    while (dirent* e = ::readdir(d)) {
+        const std::string name = e->d_name;
+        if (name.rfind("ttyUSB", 0) == 0 || name.rfind("ttyACM", 0) == 0)
+            ports.push_back("/dev/" + name);
+    }
+    ::closedir(d);
+    // "ttyUSB2" < "ttyUSB10" となるよう、接頭辞→番号の順で並べる
+    auto split = [](const std::string& s) {
+        size_t i = s.size();
+        while (i > 0 && std::isdigit(static_cast<unsigned char>(s[i - 1]))) --i;
+        return std::make_pair(s.substr(0, i), i < s.size() ? std::stoul(s.substr(i)) : 0ul);
+    };
+    std::sort(ports.begin(), ports.end(),
+              [&](const std::string& a, const std::string& b) { return split(a) < split(b); });
+    return ports;
+}
+
+} // namespace tr3
@@ -0,0 +1,137 @@
+// SerialPort: Win32 API 実装
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "../include/serial_port.hpp"
+#include "../include/capture.hpp"
+#include "../include/metrics.hpp"
+
+namespace tr3 {
+
+// read_some の待ち刻み。ReadFile はこの時間だけ最初の1バイトを待って戻る
+static DWORD read_slice_ms(const WaitTimings& t) {
+    return static_cast<DWORD>(std::max<long long>(1, t.poll_slice.count() / 1000));
+}
+
+static DCB make_dcb(uint32_t baud) {
+    DCB dcb{}; dcb.DCBlength = sizeof(DCB);
+    dcb.BaudRate = baud;
+    dcb.fBinary  = TRUE;
+    dcb.fParity  = FALSE;
+    dcb.Parity   = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.ByteSize = 8;
+    return dcb;
+}
+
+// ReadFile / WriteFile の失敗がデバイスの抜去によるものか（ハンドルが無効になると ClearCommError も失敗する）
+static bool device_gone(HANDLE h) {
+    DWORD errs = 0;
+    return !ClearCommError(h, &errs, nullptr);
+}
+
+bool SerialPort::is_open() const { return h_ != INVALID_HANDLE_VALUE; }
+
+bool SerialPort::open() {
+    close();
+    std::string path = "\\\\.\\" + port_name_;
+    h_ = CreateFileA(path.c_str(), GENERIC_READ|GENERIC_WRITE, 0, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h_ == INVALID_HANDLE_VALUE) { last_error_ = "CreateFile 失敗"; return false; }
+
+    DCB dcb = make_dcb(baud_);
+    if (!SetCommState(h_, &dcb)) { last_error_ = "SetCommState 失敗"; close(); return false; }
+
+    // タイムアウトはオープン時（と set_timings 時）に1回だけ設定する。
+    // Interval=MAXDWORD かつ Multiplier=MAXDWORD の組み合わせでは、
+    //   ・受信済みバイトがあれば即座にそれを全部返す
+    //   ・無ければ最初の1バイトを Constant ミリ秒まで待つ
+    // という動作になり、バイト毎の SetCommTimeouts が不要になる。
+    on_timings_changed();
+
+    SetupComm(h_, 4096, 4096);
+    PurgeComm(h_, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    lost_ = false;
+    return true;
+}
+
+void SerialPort::on_timings_changed() {
+    if (h_ == INVALID_HANDLE_VALUE) return;
+    COMMTIMEOUTS to{};
+    to.ReadIntervalTimeout         = MAXDWORD;
+    to.ReadTotalTimeoutMultiplier  = MAXDWORD;
+    to.ReadTotalTimeoutConstant    = read_slice_ms(timings_);
+    to.WriteTotalTimeoutConstant   = 200;
+    to.WriteTotalTimeoutMultiplier = 0;
+    SetCommTimeouts(h_, &to);
+    ++stats_.wait_calls;
+}
+
+void SerialPort::close() {
+    if (h_ != INVALID_HANDLE_VALUE) { CloseHandle(h_); h_ = INVALID_HANDLE_VALUE; }
+}
+
+bool SerialPort::write(const uint8_t* data, size_t n) {
+    if (h_ == INVALID_HANDLE_VALUE) return false;
+    DWORD w = 0;
+    ++stats_.write_calls;
+    if (!WriteFile(h_, data, static_cast<DWORD>(n), &w, nullptr)) { lost_ = device_gone(h_); return false; }
+    stats_.bytes_written += w;
+    metrics().add_sent(w);
+    if (capture_ && w > 0) capture_->record(CaptureDir::Tx, data, w);
+    return w == n;
+}
+
+// Win32 は wake() 非対応（同期 ReadFile は poll_slice で戻るまで打ち切れない）
+void SerialPort::open_wake() {}
+void SerialPort::close_wake() {}
+
+size_t SerialPort::read_some(uint8_t* dst, size_t cap, clock::time_point deadline) {
+    if (h_ == INVALID_HANDLE_VALUE || cap == 0) return 0;
+    const DWORD want = static_cast<DWORD>(std::min<size_t>(cap, MAXDWORD));
+
+    // 1回の ReadFile は最大 poll_slice で戻るので、期限まで繰り返す
+    do {
+        DWORD r = 0;
+        ++stats_.read_calls;
+        if (!ReadFile(h_, dst, want, &r, nullptr)) { lost_ = device_gone(h_); last_error_ = "ReadFile 失敗"; return 0; }
+        if (r > 0) {
+            stats_.bytes_read += r;
+            metrics().add_received(r);
+            if (capture_) capture_->record(CaptureDir::Rx, dst, r);
+            return r;
+        }
+    } while (clock::now() < deadline);
+    return 0;
+}
+
+// QueryDosDevice(NULL) で全 DOS デバイス名を 1 回で取り出し、"COM<番号>" だけを拾う
+// （COM1〜COM256 を 1 つずつ問い合わせると 256 回のシステムコールになる）
+std::vector<std::string> enum_serial_ports() {
+    std::vector<char> names(64 * 1024);
+    DWORD len = 0;
+    while ((len = ::QueryDosDeviceA(nullptr, names.data(), DWORD(names.size()))) == 0) {
+        if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER || names.size() >= 16 * 1024 * 1024) return {};
+        names.resize(names.size() * 2);
+    }
+
+    std::vector<std::pair<unsigned long, std::string>> found;
+    for (const char* p = names.data(); p < names.data() + len && *p; p += std::strlen(p) + 1) {
+        if (std::strncmp(p, "COM", 3) != 0 || !p[3]) continue;
+        char* end = nullptr;
+        const unsigned long n = std::strtoul(p + 3, &end, 10);
+        if (*end == '\0' && n > 0) found.emplace_back(n, p);
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> ports;
+    for (auto& f : found) ports.push_back(std::move(f.second));
+    return ports;
+}
+
+} // namespace tr3
@@ -0,0 +1,154 @@
+// SimReader を擬似端末（pty）上で動かす
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/sim_pty.hpp"
+#include "../include/tr3_protocol.hpp"
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// 速度ビットの初期値を回線速度に合わせる（照合しないときは cfg のまま）
+static SimConfig with_speed(SimConfig cfg, const PtySimOptions& opt) {
+    if (opt.check_baud) {
+        const uint8_t bits = speed_bits_from_baud(opt.baud);
+        if (bits != 0xFF) cfg.speed_bits = bits;
+    }
+    return cfg;
+}
+
+static uint32_t bps_from_speed(speed_t s) {
+    switch (s) {
+        case B9600:   return 9600;
+        case B19200:  return 19200;
+        case B38400:  return 38400;
+        case B57600:  return 57600;
+        case B115200: return 115200;
+        case B230400: return 230400;
+        default:      return 0;
+    }
+}
+
+PtySimulator::PtySimulator(const SimConfig& cfg, const PtySimOptions& opt)
+    : sim_(with_speed(cfg, opt)), opt_(opt), line_baud_(opt.baud) {}
+
+PtySimulator::~PtySimulator() {
+    stop();
+    if (keep_ >= 0)   ::close(keep_);
+    if (master_ >= 0) ::close(master_);
+}
+
+bool PtySimulator::start() {
+    if (opt_.baud == 0) { last_error_ = "baud=0"; return false; }
+    if (opt_.check_baud && speed_bits_from_baud(opt_.baud) == 0xFF) {
+        last_error_ = "リーダが対応しない速度: " + std::to_string(opt_.baud); return false;
+    }
+    master_ = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_ < 0 || ::grantpt(master_) != 0 || ::unlockpt(master_) != 0) {
+        last_error_ = std::string("posix_openpt 失敗: ") + std::strerror(errno);
+        return false;
+    }
+    const char* name = ::ptsname(master_);
+    if (!name) { last_error_ = "ptsname 失敗"; return false; }
+    slave_path_ = name;
+
+    keep_ = ::open(slave_path_.c_str(), O_RDWR | O_NOCTTY);
+    if (keep_ >= 0) {
+        termios tio{};
+        if (::tcgetattr(keep_, &tio) == 0) {
+            ::cfmakeraw(&tio);
+            ::cfsetspeed(&tio, B0);   // クライアントが開いて速度を設定するまでは一致しない
+            ::tcsetattr(keep_, TCSANOW, &tio);
+        }
+    }
+
+    stop_req_.store(false);
+    th_ = std::thread([this] { loop(); });
+    return true;
+}
+
+void PtySimulator::stop() {
+    stop_req_.store(true);
+    if (th_.joinable()) th_.join();
+}
+
+// ボーレートに従って約 1ms 分ずつ書き出す
+bool PtySimulator::paced_write(const std::vector<uint8_t>& bytes) {
+    const size_t slice = opt_.pace ? std::max<size_t>(1, line_baud_ / 10 / 1000) : bytes.size();
+    const auto   t0    = steady_clock::now();
+    size_t done = 0;
+    while (done < bytes.size()) {
+        const size_t k = std::min(slice, bytes.size() - done);
+        size_t off = 0;
+        while (off < k) {
+            const ssize_t w = ::write(master_, bytes.data() + done + off, k - off);
+            if (w > 0) { off += size_t(w); continue; }
+            if (w < 0 && (errno == EINTR || errno == EAGAIN)) {
+                if (stop_req_.load()) return false;
+                pollfd p{master_, POLLOUT, 0}; ::poll(&p, 1, 10); continue;
+            }
+            return false;
+        }
+        done += k;
+        if (opt_.pace) {
+            const auto due = t0 + microseconds(uint64_t(done) * 10'000'000ull / line_baud_);
+            std::this_thread::sleep_until(due);
+        }
+    }
+    return true;
+}
+
+// 擬似端末は速度を伝送に反映しないので、termios の設定値どうしで照合する
+bool PtySimulator::line_matches() const {
+    termios tio{};
+    if (keep_ < 0 || ::tcgetattr(keep_, &tio) != 0) return true;
+    return bps_from_speed(::cfgetispeed(&tio)) == line_baud_;
+}
+
+void PtySimulator::loop() {
+    std::vector<uint8_t> rx(4096), tx;
+    tx.reserve(64 * 1024);
+
+    while (!stop_req_.load()) {
+        // 自律動作モード中は送出周期で起きる
+        const int wait_ms = sim_.autonomous() ? int(std::max<long long>(1, sim_.scan_interval().count())) : 50;
+        pollfd p{master_, POLLIN, 0};
+        const int pr = ::poll(&p, 1, wait_ms);
+        if (pr < 0 && errno != EINTR) { last_error_ = std::string("poll 失敗: ") + std::strerror(errno); break; }
+
+        tx.clear();
+        sim_.on_tick(steady_clock::now(), tx);
+        if (!tx.empty() && !paced_write(tx)) break;
+        if (pr <= 0) continue;
+
+        const ssize_t n = ::read(master_, rx.data(), rx.size());
+        if (n <= 0) {
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+            std::this_thread::sleep_for(milliseconds(10));   // クライアントが切断中
+            continue;
+        }
+        if (opt_.check_baud && !line_matches()) {
+            // 速度が違えば実機では化けたバイトになる。フレームとして届かないので捨てる
+            mismatch_.fetch_add(uint64_t(n), std::memory_order_relaxed);
+            continue;
+        }
+        tx.clear();
+        sim_.on_rx(rx.data(), size_t(n), tx);
+        if (tx.empty()) continue;
+
+        if (opt_.latency_us) std::this_thread::sleep_for(microseconds(opt_.latency_us));
+        if (!paced_write(tx)) break;
+        // 通信速度の書き込みは ACK を旧速度で返した後に切り替わる
+        if (opt_.check_baud) line_baud_ = baud_from_speed_bits(sim_.speed_bits());
+    }
+}
+
+} // namespace tr3
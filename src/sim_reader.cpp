@@ -0,0 +1,195 @@
+// TR3 リーダライタの模擬（シミュレータ）応答ロジック
+#include <algorithm>
+
+#include "../include/sim_reader.hpp"
+
+namespace tr3 {
+
+SimReader::SimReader(const SimConfig& cfg)
+    : cfg_(cfg), parser_(4096), rng_(cfg.seed),
+      mode_(cfg.mode), flags_(cfg.flags), speed_bits_(cfg.speed_bits)
+{
+    set_tag_count(cfg.tag_count);
+}
+
+void SimReader::set_tag_count(size_t n) {
+    n = std::min(n, MAX_TAGS);
+    // 同じ seed なら常に同じ UID 集合になるよう、専用の乱数で生成する
+    std::mt19937 gen(cfg_.seed ^ 0x5A5A5A5Au);
+    tags_.resize(n);
+    index_.clear();
+    for (size_t k = 0; k < n; ++k) {
+        auto& uid = tags_[k];
+        uid[0] = 0xE0;   // ISO 15693
+        uid[1] = 0x04;   // IC メーカコード
+        for (size_t i = 2; i < uid.size(); ++i) uid[i] = static_cast<uint8_t>(gen());
+        uint64_t key = 0;
+        for (uint8_t b : uid) key = (key << 8) | b;
+        index_[key] = k;
+    }
+    next_tag_ = 0;
+
+    // ユーザブロックの初期値も seed から決める
+    mem_.resize(n * cfg_.tag_blocks * cfg_.block_size);
+    for (auto& b : mem_) b = static_cast<uint8_t>(gen());
+}
+
+void SimReader::on_rx(const uint8_t* data, size_t n, std::vector<uint8_t>& out) {
+    const uint64_t sum_err_before = parser_.stats().checksum_failures;
+    parser_.feed(data, n);
+    FrameView f;
+    while (parser_.next(f)) handle(f, out);
+
+    // SUM 不一致のフレームを受けたら NACK(SUM_ERROR) を返す
+    const uint64_t sum_errs = parser_.stats().checksum_failures - sum_err_before;
+    for (uint64_t i = 0; i < sum_errs; ++i) {
+        ++stats_.rx_sum_errors;
+        emit_nack(NACK_SUM_ERROR, out);
+    }
+}
+
+void SimReader::emit(uint8_t cmd, const std::vector<uint8_t>& payload, std::vector<uint8_t>& out) {
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    if (cfg_.noise_rate > 0.0 && coin(rng_) < cfg_.noise_rate) {
+        const int junk = 1 + int(rng_() % 4);
+        for (int i = 0; i < junk; ++i) out.push_back(static_cast<uint8_t>(rng_()));
+    }
+    auto f = make_frame(ADDR_DEFAULT, cmd, payload);
+    if (cfg_.sum_error_rate > 0.0 && coin(rng_) < cfg_.sum_error_rate) f[f.size() - 2] ^= 0x5A;
+    out.insert(out.end(), f.begin(), f.end());
+}
+
+void SimReader::emit_nack(uint8_t code, std::vector<uint8_t>& out) {
+    ++stats_.nacks;
+    emit(CMD_NACK, {0x00, code}, out);
+}
+
+void SimReader::emit_uids(size_t n, std::vector<uint8_t>& out) {
+    for (size_t k = 0; k < n; ++k) {
+        const auto& uid = tags_[(next_tag_ + k) % tags_.size()];
+        std::vector<uint8_t> p;
+        p.reserve(9);
+        p.push_back(0x00);                                   // DSFID
+        p.insert(p.end(), uid.rbegin(), uid.rend());         // UID は LSB から送る
+        emit(RSP_UID, p, out);
+    }
+    // 一度に返し切れない場合は次回に続きから返す
+    if (!tags_.empty()) next_tag_ = (next_tag_ + n) % tags_.size();
+    stats_.uids_sent += n;
+}
+
+const uint8_t* SimReader::block(size_t i, size_t b) const {
+    if (i >= tags_.size() || b >= cfg_.tag_blocks) return nullptr;
+    return mem_.data() + (i * cfg_.tag_blocks + b) * cfg_.block_size;
+}
+
+bool SimReader::autonomous() const {
+    return mode_ == 0x01 || mode_ == 0x50 || mode_ == 0x58 || mode_ == 0x59;
+}
+
+void SimReader::on_tick(std::chrono::steady_clock::time_point now, std::vector<uint8_t>& out) {
+    if (!autonomous() || now < next_scan_) return;
+    next_scan_ = now + scan_interval();
+    emit_uids(std::min(tags_.size(), MAX_UIDS_PER_CYCLE), out);
+}
+
+void SimReader::handle(const FrameView& f, std::vector<uint8_t>& out) {
+    ++stats_.commands;
+    const uint8_t  cmd = f.cmd();
+    const uint8_t  len = f.len();
+    const uint8_t* d   = f.payload();
+
+    // ROM バージョン / 動作モード読み取り（どちらも 0x4F、詳細で区別）
+    if (cmd == CMD_ROM_REQ && len == 1 && d[0] == DETAIL_ROM) {
+        // [detail][ASCII...]：長さを先に決めてから詰める
+        const std::string& rom = cfg_.rom_ascii;
+        std::vector<uint8_t> p(1 + rom.size());
+        p[0] = DETAIL_ROM;
+        std::copy(rom.begin(), rom.end(), p.begin() + 1);
+        emit(CMD_ACK, p, out);
+        return;
+    }
+    if (cmd == CMD_MODE_RD && len == 1 && d[0] == DETAIL_MODE_R) {
+        // [detail][0]=モード,[1]=予約,[2]=各種設定,[3]=速度ビット,[4..8]=予約
+        emit(CMD_ACK, {DETAIL_MODE_R, mode_, 0x00, flags_, speed_bits_, 0, 0, 0, 0, 0}, out);
+        return;
+    }
+    // 動作モード書き込み：[detail, mode, reserved, flags, speed, poll_hi, poll_lo]
+    // 通信速度の変更は ACK を旧速度で返した後に効く（PtySimulator が speed_bits() を見て切り替える）
+    if (cmd == CMD_MODE_WR && len == 7) {
+        mode_       = d[1];
+        flags_      = d[3];
+        speed_bits_ = d[4] & 0xC0;
+        emit(CMD_ACK, {d[0]}, out);
+        return;
+    }
+    // ブザー：[response_type, sound_type]。応答なし指定なら何も返さない
+    if (cmd == CMD_BUZZER && len == 2) {
+        if (d[0] != 0x00) emit(CMD_ACK, {}, out);
+        return;
+    }
+    // Inventory2：ACK(UID数) → UID数分の 0x49 フレーム
+    if (cmd == CMD_INV2 && len == 3 && d[0] == DETAIL_INV2_F0) {
+        ++stats_.inventories;
+        const size_t n = std::min(tags_.size(), MAX_UIDS_PER_CYCLE);
+        emit(CMD_ACK, {DETAIL_INV2_F0, static_cast<uint8_t>(n)}, out);
+        emit_uids(n, out);
+        return;
+    }
+
+    if (cmd == CMD_ISO15693 && len >= 2 &&
+        (d[0] == DETAIL_READ_SINGLE || d[0] == DETAIL_READ_MULTI ||
+         d[0] == DETAIL_WRITE_SINGLE || d[0] == DETAIL_WRITE_MULTI)) {
+        handle_blocks(f, out);
+        return;
+    }
+
+    emit_nack(NACK_FORMAT_ERROR, out);
+}
+
+// ISO 15693 ブロック読み書き：[詳細, 要求フラグ, (UID LSB→MSB), 先頭, (数-1), (データ)]
+void SimReader::handle_blocks(const FrameView& f, std::vector<uint8_t>& out) {
+    const uint8_t  len    = f.len();
+    const uint8_t* d      = f.payload();
+    const uint8_t  detail = d[0];
+    const bool     multi  = detail == DETAIL_READ_MULTI || detail == DETAIL_WRITE_MULTI;
+    const bool     write  = detail == DETAIL_WRITE_SINGLE || detail == DETAIL_WRITE_MULTI;
+    const size_t   bs     = cfg_.block_size;
+    if (write) ++stats_.block_writes; else ++stats_.block_reads;
+
+    size_t pos = 2;
+    size_t tag = 0;
+    if (d[1] & ISO_FLAG_ADDRESSED) {
+        if (len < pos + 8) { emit_nack(NACK_FORMAT_ERROR, out); return; }
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; ++i) key = (key << 8) | d[pos + 7 - i];
+        pos += 8;
+        const auto it = index_.find(key);
+        if (it == index_.end()) { emit_nack(NACK_NO_TAG, out); return; }
+        tag = it->second;
+    } else if (tags_.empty()) {
+        emit_nack(NACK_NO_TAG, out);
+        return;
+    }
+
+    if (len < pos + (multi ? 2 : 1)) { emit_nack(NACK_FORMAT_ERROR, out); return; }
+    const size_t first = d[pos++];
+    const size_t count = multi ? size_t(d[pos++]) + 1 : 1;
+    if (first + count > cfg_.tag_blocks) { emit_nack(NACK_FORMAT_ERROR, out); return; }
+    uint8_t* mem = mem_.data() + (tag * cfg_.tag_blocks + first) * bs;
+
+    if (write) {
+        if (len - pos != count * bs) { emit_nack(NACK_FORMAT_ERROR, out); return; }
+        std::copy(d + pos, d + len, mem);
+        emit(CMD_ACK, {detail}, out);
+        return;
+    }
+    if (len != pos || 1 + count * bs > 255) { emit_nack(NACK_FORMAT_ERROR, out); return; }
+    std::vector<uint8_t> p;
+    p.reserve(1 + count * bs);
+    p.push_back(detail);
+    p.insert(p.end(), mem, mem + count * bs);
+    emit(CMD_ACK, p, out);
+}
+
+} // namespace tr3
@@ -0,0 +1,423 @@
+// タグイベントのジャーナル
+#include "../include/tag_journal.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+using namespace std::chrono;
+namespace fs = std::filesystem;
+
+namespace tr3 {
+
+static const char JOURNAL_MAGIC[8] = {'T', 'R', '3', 'J', 'R', 'N', 'L', 0};
+
+static int64_t wall_ns() {
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+const char* journal_kind_name(JournalKind k) {
+    switch (k) {
+    case JournalKind::Read:   return "read";
+    case JournalKind::Arrive: return "arrive";
+    case JournalKind::Depart: return "depart";
+    }
+    return "?";
+}
+
+static JournalRecord make_record(uint32_t reader_id, JournalKind kind, const Uid& uid, uint8_t dsfid, int64_t t) {
+    JournalRecord r{};
+    r.t_wall_ns = t;
+    r.reader_id = reader_id;
+    r.kind      = uint8_t(kind);
+    r.dsfid     = dsfid;
+    std::memcpy(r.uid, uid.bytes.data(), sizeof(r.uid));
+    return r;
+}
+
+//===============================
+// 書き込み
+//===============================
+bool JournalWriter::open(const JournalOptions& opt) {
+    close();
+    opt_ = opt;
+    if (opt_.segment_records == 0) opt_.segment_records = 1;
+    if (opt_.commit_records == 0)  opt_.commit_records = 1;
+    stats_ = JournalStats{};
+    last_error_.clear();
+    files_.clear();
+    next_seq_ = 1;
+    next_number_ = 0;
+    pending_ = 0;
+
+    std::error_code ec;
+    fs::create_directories(opt_.dir, ec);
+    if (ec) { last_error_ = "ジャーナルのディレクトリを作れません: " + opt_.dir; return false; }
+
+    // 既存のセグメントの続きから（番号・seq を引き継ぐ）。使い始める前に落ちたセグメントと予備は消す
+    std::remove(spare_path().c_str());
+    for (auto& path : journal_segments(opt_.dir, opt_.prefix)) files_.push_back(std::move(path));
+    while (!files_.empty()) {
+        const std::string name = fs::path(files_.back()).stem().string();
+        next_number_ = std::max<uint64_t>(next_number_, std::strtoull(name.c_str() + opt_.prefix.size(), nullptr, 10) + 1);
+        JournalReader r;
+        if (!r.open(files_.back())) break;
+        if (r.unused()) {
+            r.close();
+            std::remove(files_.back().c_str());
+            files_.pop_back();
+            continue;
+        }
+        JournalRecord rec{};
+        while (r.next(rec)) {}
+        next_seq_ = r.header().first_seq + r.read_count();
+        break;
+    }
+
+    SegmentPtr seg = create_segment(segment_path(next_number_));
+    if (!seg) return false;
+    ++stats_.segments;
+    if (!activate_locked(std::move(seg))) return false;
+    remove_old();
+
+    stop_req_ = false;
+    running_  = true;
+    th_ = std::thread([this] { commit_loop(); });
+    return true;
+}
+
+void JournalWriter::close() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!running_) return;
+        stop_req_ = true;
+    }
+    cv_.notify_all();
+    th_.join();   // 最後のコミットはスレッドが終わる前に行う
+
+    std::lock_guard<std::mutex> lk(mu_);
+    // 使わなかった予備と、1 件も書かなかった現在のセグメントは残さない
+    if (next_) { next_->map.close(); std::remove(next_->path.c_str()); next_.reset(); }
+    if (cur_) {
+        cur_->map.close();
+        if (cur_->count == 0) { std::remove(cur_->path.c_str()); files_.pop_back(); }
+        cur_.reset();
+    }
+    running_ = false;
+}
+
+std::string JournalWriter::segment_path(uint64_t number) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%08llu.seg", static_cast<unsigned long long>(number));
+    return (fs::path(opt_.dir) / (opt_.prefix + name)).string();
+}
+
+std::string JournalWriter::spare_path() const {
+    return (fs::path(opt_.dir) / (opt_.prefix + "next.tmp")).string();
+}
+
+// first_seq = 0（未使用）のヘッダを書いて返す。番号と seq の起点は activate_locked で付ける
+JournalWriter::SegmentPtr JournalWriter::create_segment(const std::string& path) {
+    auto s = std::make_shared<Segment>();
+    s->path     = path;
+    s->capacity = opt_.segment_records;
+    if (!s->map.create(s->path, sizeof(JournalSegmentHeader) + s->capacity * sizeof(JournalRecord))) {
+        set_error("セグメントを作れません: " + s->path + " (" + s->map.last_error() + ")");
+        return nullptr;
+    }
+    JournalSegmentHeader h{};
+    std::memcpy(h.magic, JOURNAL_MAGIC, sizeof(h.magic));
+    h.version         = JOURNAL_VERSION;
+    h.record_size     = uint16_t(sizeof(JournalRecord));
+    h.capacity        = s->capacity;
+    h.created_wall_ns = wall_ns();
+    std::memcpy(s->map.data(), &h, sizeof(h));
+    return s;
+}
+
+bool JournalWriter::activate_locked(SegmentPtr seg) {
+    // 予備は使い始めるときに番号を付ける（作った順ではなく書いた順の番号になる）
+    const std::string path = segment_path(next_number_);
+    if (seg->path != path) {
+        std::error_code ec;
+        fs::rename(seg->path, path, ec);
+        if (ec) {
+            set_error("セグメントの名前を変えられません: " + seg->path + " (" + ec.message() + ")");
+            seg->map.close();
+            std::remove(seg->path.c_str());
+            return false;
+        }
+        seg->path = path;
+    }
+    seg->number = next_number_++;
+    seg->header()->segment   = seg->number;
+    seg->header()->first_seq = next_seq_;
+    files_.push_back(seg->path);
+    cur_ = std::move(seg);
+    return true;
+}
+
+bool JournalWriter::rotate_locked() {
+    if (cur_) retired_.push_back(std::move(cur_));
+    SegmentPtr s = std::move(next_);
+    if (!s || !activate_locked(std::move(s))) {
+        // コミットスレッドが間に合わなかった（ここでファイルを作るので受信経路が少し止まる）
+        s = create_segment(segment_path(next_number_));
+        if (!s) return false;
+        ++stats_.segments;
+        ++stats_.inline_rotations;
+        if (!activate_locked(std::move(s))) return false;
+    }
+    cv_.notify_one();   // 一杯になった分のコミットと次のセグメントの用意
+    return true;
+}
+
+void JournalWriter::append(uint32_t reader_id, JournalKind kind, const Uid& uid, uint8_t dsfid, int64_t t_wall_ns) {
+    const JournalRecord rec = make_record(reader_id, kind, uid, dsfid, t_wall_ns ? t_wall_ns : wall_ns());
+    std::lock_guard<std::mutex> lk(mu_);
+    append_locked(rec);
+}
+
+void JournalWriter::append(uint32_t reader_id, const InventoryResult& r, int64_t t_wall_ns) {
+    if (r.items.empty()) return;
+    const int64_t t = t_wall_ns ? t_wall_ns : wall_ns();
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const auto& it : r.items) append_locked(make_record(reader_id, JournalKind::Read, it.uid, it.dsfid, t));
+}
+
+void JournalWriter::append(uint32_t reader_id, const TagEvent& e, int64_t t_wall_ns) {
+    append(reader_id, e.kind == TagEvent::Kind::Arrive ? JournalKind::Arrive : JournalKind::Depart,
+           e.tag.uid, e.tag.dsfid, t_wall_ns);
+}
+
+void JournalWriter::append_locked(JournalRecord rec) {
+    // 前の切り替えに失敗して cur_ が無ければ、ここでもう一度切り替えを試す
+    if (!running_ || ((!cur_ || cur_->count == cur_->capacity) && !rotate_locked())) { ++stats_.dropped; return; }
+
+    rec.seq = next_seq_++;
+    uint8_t* w = cur_->records() + cur_->count * sizeof(JournalRecord);
+    // seq を最後に書く（書いている途中の記録を、動作中に読む側が有効とみなさないように）
+    std::memcpy(w + sizeof(rec.seq), reinterpret_cast<const uint8_t*>(&rec) + sizeof(rec.seq), sizeof(rec) - sizeof(rec.seq));
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(w, &rec.seq, sizeof(rec.seq));
+    ++cur_->count;
+    ++stats_.appended;
+
+    if (cur_->count == cur_->capacity) rotate_locked();
+    if (++pending_ >= opt_.commit_records) cv_.notify_one();
+}
+
+// ───────────────────────────────────
+// コミット
+// ───────────────────────────────────
+void JournalWriter::commit_loop() {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_req_) {
+        cv_.wait_for(lk, opt_.commit_interval,
+                     [&] { return stop_req_ || pending_ >= opt_.commit_records || !retired_.empty(); });
+        lk.unlock();
+        commit_once();
+        remove_old();
+
+        // 次のセグメントを先に作っておく（append() の中でファイルを作らずに済むように）
+        lk.lock();
+        if (!next_ && !stop_req_) {
+            lk.unlock();
+            SegmentPtr s = create_segment(spare_path());
+            lk.lock();
+            if (s) { next_ = std::move(s); ++stats_.segments; }
+        }
+    }
+    lk.unlock();
+    commit_once();
+}
+
+bool JournalWriter::commit() {
+    return commit_once();
+}
+
+bool JournalWriter::commit_once() {
+    std::lock_guard<std::mutex> cl(commit_mu_);
+    SegmentPtr cur;
+    size_t upto = 0;
+    std::vector<SegmentPtr> retired;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        cur  = cur_;
+        upto = cur ? cur->count : 0;
+        retired.swap(retired_);
+        pending_ = 0;
+    }
+
+    const auto t0 = steady_clock::now();
+    uint64_t n = 0;
+    bool ok = true;
+    // 一杯になったセグメントは以後書かれないので、残りを書き出して閉じる
+    for (auto& s : retired) {
+        n += s->count - s->synced;
+        ok &= sync_segment(*s, s->count);
+        s->map.close();
+    }
+    if (cur) {
+        n += upto - std::min(upto, cur->synced);
+        ok &= sync_segment(*cur, upto);
+    }
+    if (n == 0) return ok;
+
+    const uint64_t us = uint64_t(duration_cast<microseconds>(steady_clock::now() - t0).count());
+    std::lock_guard<std::mutex> lk(mu_);
+    ++stats_.commits;
+    stats_.committed += n;
+    stats_.max_commit_us = std::max(stats_.max_commit_us, us);
+    return ok;
+}
+
+bool JournalWriter::sync_segment(Segment& s, size_t upto) {
+    if (upto <= s.synced) return true;
+    bool ok = true;
+    if (opt_.sync) {
+        const size_t off = sizeof(JournalSegmentHeader) + s.synced * sizeof(JournalRecord);
+        ok = s.map.sync(off, (upto - s.synced) * sizeof(JournalRecord));
+    }
+    // 記録を書き出してからヘッダのコミット済み件数を進める
+    s.header()->committed = upto;
+    if (ok && opt_.sync) ok = s.map.sync(0, sizeof(JournalSegmentHeader));
+    if (!ok) set_error("ジャーナルを書き出せません: " + s.map.last_error());
+    s.synced = upto;
+    return ok;
+}
+
+void JournalWriter::remove_old() {
+    if (opt_.max_segments == 0) return;
+    std::vector<std::string> victims;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        // 末尾は現在のセグメント。一杯になったものはコミット（close）済みになってから消す
+        while (files_.size() > std::max<size_t>(opt_.max_segments, retired_.size() + 1)) {
+            victims.push_back(std::move(files_.front()));
+            files_.pop_front();
+        }
+    }
+    for (const auto& v : victims) {
+        if (std::remove(v.c_str()) != 0) continue;
+        std::lock_guard<std::mutex> lk(mu_);
+        ++stats_.removed;
+    }
+}
+
+void JournalWriter::set_error(const std::string& e) {
+    std::lock_guard<std::mutex> lk(err_mu_);
+    last_error_ = e;
+}
+
+std::string JournalWriter::last_error() const {
+    std::lock_guard<std::mutex> lk(err_mu_);
+    return last_error_;
+}
+
+JournalStats JournalWriter::stats() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return stats_;
+}
+
+//===============================
+// 読み出し
+//===============================
+bool JournalReader::open(const std::string& path) {
+    close();
+    if (!map_.open(path)) { last_error_ = map_.last_error(); return false; }
+    if (map_.size() < sizeof(JournalSegmentHeader)) { last_error_ = "セグメントが短すぎます: " + path; close(); return false; }
+    std::memcpy(&hdr_, map_.data(), sizeof(hdr_));
+    if (std::memcmp(hdr_.magic, JOURNAL_MAGIC, sizeof(hdr_.magic)) != 0) {
+        last_error_ = "ジャーナルのセグメントではありません: " + path; close(); return false;
+    }
+    if (hdr_.version != JOURNAL_VERSION || hdr_.record_size != sizeof(JournalRecord)) {
+        last_error_ = "未対応のジャーナル形式です: " + path; close(); return false;
+    }
+    // 確保した大きさより短いファイル（コピー途中など）は、あるところまで読む
+    hdr_.capacity = std::min<uint64_t>(hdr_.capacity, (map_.size() - sizeof(hdr_)) / sizeof(JournalRecord));
+    return true;
+}
+
+bool JournalReader::next(JournalRecord& out) {
+    if (pos_ >= hdr_.capacity) return false;
+    const uint8_t* p = map_.data() + sizeof(JournalSegmentHeader) + pos_ * sizeof(JournalRecord);
+    std::memcpy(&out, p, sizeof(out));
+    if (unused() || out.seq != hdr_.first_seq + pos_) return false;
+    ++pos_;
+    return true;
+}
+
+std::vector<std::string> journal_segments(const std::string& dir, const std::string& prefix) {
+    std::vector<std::pair<uint64_t, std::string>> found;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path& p = it->path();
+        if (p.extension() != ".seg") continue;
+        const std::string stem = p.stem().string();
+        if (stem.size() <= prefix.size() || stem.compare(0, prefix.size(), prefix) != 0) continue;
+        const char* num = stem.c_str() + prefix.size();
+        char* end_num = nullptr;
+        const uint64_t n = std::strtoull(num, &end_num, 10);
+        if (end_num == num || *end_num != '\0') continue;
+        found.emplace_back(n, p.string());
+    }
+    std::sort(found.begin(), found.end());
+    std::vector<std::string> out;
+    out.reserve(found.size());
+    for (auto& f : found) out.push_back(std::move(f.second));
+    return out;
+}
+
+// ───────────────────────────────────
+// CSV 出力（整形は 1 行ずつスタック上で行い、まとめて fwrite）
+// ───────────────────────────────────
+uint64_t export_journal_csv(const std::vector<std::string>& segments, std::FILE* out, std::string* error) {
+    static const char HEX[] = "0123456789ABCDEF";
+    std::string buf;
+    buf.reserve(1 << 20);
+    buf += "time,t_wall_ns,reader,kind,uid,dsfid,seq\n";
+
+    int64_t cached_sec = INT64_MIN;
+    char    prefix[32] = {};
+    uint64_t n = 0;
+    for (const auto& path : segments) {
+        JournalReader r;
+        if (!r.open(path)) { if (error) *error = r.last_error(); continue; }
+        JournalRecord rec;
+        while (r.next(rec)) {
+            const int64_t sec = rec.t_wall_ns >= 0 ? rec.t_wall_ns / 1000000000 : (rec.t_wall_ns - 999999999) / 1000000000;
+            const int     ms  = int((rec.t_wall_ns - sec * 1000000000) / 1000000);
+            if (sec != cached_sec) {
+                // localtime は秒が変わったときだけ呼ぶ
+                cached_sec = sec;
+                const std::time_t t = std::time_t(sec);
+                std::tm tm{};
+#ifdef _WIN32
+                localtime_s(&tm, &t);
+#else
+                localtime_r(&t, &tm);
+#endif
+                std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm);
+            }
+            char uid[17];
+            for (size_t i = 0; i < 8; ++i) { uid[i * 2] = HEX[rec.uid[i] >> 4]; uid[i * 2 + 1] = HEX[rec.uid[i] & 0x0F]; }
+            uid[16] = '\0';
+            char line[160];
+            const int k = std::snprintf(line, sizeof(line), "%s.%03d,%lld,%u,%s,%s,%02X,%llu\n",
+                                        prefix, ms, static_cast<long long>(rec.t_wall_ns), unsigned(rec.reader_id),
+                                        journal_kind_name(JournalKind(rec.kind)), uid, unsigned(rec.dsfid),
+                                        static_cast<unsigned long long>(rec.seq));
+            buf.append(line, size_t(k));
+            ++n;
+            if (buf.size() >= (1 << 20) - sizeof(line)) { std::fwrite(buf.data(), 1, buf.size(), out); buf.clear(); }
+        }
+    }
+    std::fwrite(buf.data(), 1, buf.size(), out);
+    return n;
+}
+
+} // namespace tr3
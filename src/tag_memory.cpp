@@ -0,0 +1,245 @@
+// タグメモリの一括読み書きとブロックキャッシュ
+#include "../include/tag_memory.hpp"
+#include "../include/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace tr3 {
+
+// ───────────────────────────────────
+// ブロックキャッシュ
+// ───────────────────────────────────
+BlockCache::BlockCache(size_t block_size, size_t capacity, milliseconds max_age)
+    : block_size_(block_size ? block_size : 4), capacity_(capacity ? capacity : 1), max_age_(max_age) {}
+
+BlockCache::Entry* BlockCache::lookup(const Uid& uid, uint8_t dsfid, time_point now) {
+    auto it = map_.find(uid);
+    if (it == map_.end()) return nullptr;
+    Entry& e = it->second;
+    if (e.dsfid != dsfid || (max_age_.count() > 0 && now - e.stored > max_age_)) {
+        map_.erase(it);
+        ++stats_.stale;
+        return nullptr;
+    }
+    e.last_used = ++tick_;
+    return &e;
+}
+
+void BlockCache::evict_one() {
+    // 容量に達したときだけなので線形に探す
+    auto victim = map_.begin();
+    for (auto it = map_.begin(); it != map_.end(); ++it)
+        if (it->second.last_used < victim->second.last_used) victim = it;
+    if (victim != map_.end()) { map_.erase(victim); ++stats_.evictions; }
+}
+
+bool BlockCache::get(const Uid& uid, uint8_t dsfid, uint8_t first, size_t count, std::vector<uint8_t>& out,
+                     time_point now) {
+    const Entry* e = lookup(uid, dsfid, now);
+    bool all = e && count > 0 && size_t(first) + count <= 256;
+    for (size_t b = first; all && b < size_t(first) + count; ++b) all = e->valid.test(b);
+    if (!all) { ++stats_.misses; return false; }
+
+    const auto* p = e->data.data() + size_t(first) * block_size_;
+    out.assign(p, p + count * block_size_);
+    ++stats_.hits;
+    return true;
+}
+
+void BlockCache::put(const Uid& uid, uint8_t dsfid, uint8_t first, const uint8_t* data, size_t count,
+                     time_point now) {
+    if (count == 0 || size_t(first) + count > 256) return;
+    Entry* e = lookup(uid, dsfid, now);
+    if (!e) {
+        if (map_.size() >= capacity_) evict_one();
+        e = &map_[uid];
+        e->dsfid     = dsfid;
+        e->stored    = now;
+        e->last_used = ++tick_;
+    }
+    const size_t end = (size_t(first) + count) * block_size_;
+    if (e->data.size() < end) e->data.resize(end);
+    std::memcpy(e->data.data() + size_t(first) * block_size_, data, count * block_size_);
+    for (size_t b = first; b < size_t(first) + count; ++b) e->valid.set(b);
+}
+
+// ───────────────────────────────────
+// 要求の組を送って受ける（送り直しを含む）
+// ───────────────────────────────────
+namespace {
+
+struct Job {
+    size_t  owner = 0;   // 呼び出し側の番号（タグ・書き込み範囲）
+    uint8_t first = 0;
+    uint8_t count = 0;
+};
+
+// make(job) で要求を作り、応答を accept(job, reply, err) に渡す（false なら err を理由に失敗）。
+// 送り直しても失敗した要求は fail(job, err) へ
+template <class Make, class Accept, class Fail>
+void run_jobs(Transport& sp, std::vector<Job> pending, const TagMemoryOptions& opt, TagMemoryStats& st,
+              Make&& make, Accept&& accept, Fail&& fail) {
+    const size_t group = std::max<size_t>(1, opt.batch.max_commands);
+    std::vector<Job> again;
+    for (uint32_t round = 0; round <= opt.retries && !pending.empty(); ++round) {
+        if (round > 0) st.retried += pending.size();
+        again.clear();
+        CommandBatcher b(sp, opt.batch);
+        for (size_t i = 0; i < pending.size(); i += group) {
+            const size_t end = std::min(pending.size(), i + group);
+            for (size_t k = i; k < end; ++k) b.add(make(pending[k]));
+            const auto replies = b.execute();
+
+            // 応答が 1 つ欠けると後続が前の要求に合ってしまう（詳細コードが同じ）ので、組ごと信用しない
+            const bool shifted = std::any_of(replies.begin(), replies.end(),
+                                             [](const CommandReply& r) { return r.status == ReplyStatus::Timeout; });
+            for (size_t k = i; k < end; ++k) {
+                const CommandReply& r = replies[k - i];
+                std::string err;
+                bool retry = true;
+                if (shifted) {
+                    err = r.status == ReplyStatus::Timeout ? "タイムアウト" : "応答の取りこぼし";
+                } else if (r.ok()) {
+                    if (accept(pending[k], r, err)) continue;
+                } else if (r.status == ReplyStatus::Nack) {
+                    err   = nack_message(r.nack_code);
+                    retry = r.nack_code != NACK_NO_TAG;   // タグが視野にない
+                } else {
+                    err = reply_status_name(r.status);
+                }
+                if (retry && round < opt.retries && !sp.disconnected()) again.push_back(pending[k]);
+                else                                                   fail(pending[k], err);
+            }
+        }
+        st.commands += pending.size();
+        st.writes   += b.stats().writes;
+        pending.swap(again);
+    }
+}
+
+} // namespace
+
+// ───────────────────────────────────
+// 一括読み出し
+// ───────────────────────────────────
+std::vector<TagBlocks> read_tag_blocks(Transport& sp, const InventoryResult& inv, const TagMemoryOptions& opt,
+                                       BlockCache* cache, TagMemoryStats* stats) {
+    TagMemoryStats st;
+    std::vector<TagBlocks> tags;
+    tags.reserve(inv.items.size());
+    std::unordered_map<Uid, size_t> seen;
+    seen.reserve(inv.items.size());
+    for (const auto& it : inv.items) {
+        if (!seen.emplace(it.uid, tags.size()).second) continue;
+        TagBlocks t;
+        t.uid   = it.uid;
+        t.dsfid = it.dsfid;
+        tags.push_back(std::move(t));
+    }
+    st.tags = tags.size();
+
+    const size_t bs = opt.block_size;
+    if (bs == 0 || opt.block_count == 0 || size_t(opt.first_block) + opt.block_count > 256) {
+        for (auto& t : tags) t.error = "ブロック指定が不正";
+        st.failed = tags.size();
+        if (stats) *stats = st;
+        return tags;
+    }
+    // キャッシュのブロック長が違えば使えない
+    if (cache && cache->block_size() != bs) cache = nullptr;
+
+    // キャッシュで揃わないタグだけ、範囲を 1 コマンドで読める大きさに分けて読む
+    const size_t per = std::max<size_t>(1, std::min({opt.max_blocks, max_blocks_per_read(bs), size_t(256)}));
+    std::vector<Job> jobs;
+    for (size_t i = 0; i < tags.size(); ++i) {
+        auto& t = tags[i];
+        if (cache && cache->get(t.uid, t.dsfid, opt.first_block, opt.block_count, t.data)) {
+            t.ok = t.cached = true;
+            ++st.cached;
+            continue;
+        }
+        t.data.assign(size_t(opt.block_count) * bs, 0);
+        t.ok = true;   // 失敗した要求があれば fail で落とす
+        for (size_t b = 0; b < opt.block_count; b += per)
+            jobs.push_back(Job{i, uint8_t(opt.first_block + b), uint8_t(std::min(per, opt.block_count - b))});
+    }
+
+    std::vector<uint8_t> buf;
+    run_jobs(sp, std::move(jobs), opt, st,
+        [&](const Job& j) { return cmd_read_blocks(tags[j.owner].uid, j.first, j.count, opt.timeout_ms); },
+        [&](const Job& j, const CommandReply& r, std::string& err) {
+            if (!reply_blocks(r, buf))         { err = "応答フレーム不正"; return false; }
+            if (buf.size() != j.count * bs)    { err = "ブロック長が合わない"; return false; }
+            std::memcpy(tags[j.owner].data.data() + size_t(j.first - opt.first_block) * bs, buf.data(), buf.size());
+            return true;
+        },
+        [&](const Job& j, const std::string& err) {
+            auto& t = tags[j.owner];
+            if (t.ok) { t.ok = false; t.error = err; }
+        });
+
+    for (auto& t : tags) {
+        if (t.cached) continue;
+        if (!t.ok) { ++st.failed; t.data.clear(); continue; }
+        if (cache) cache->put(t.uid, t.dsfid, opt.first_block, t.data.data(), opt.block_count);
+    }
+    if (log_enabled(LogLevel::Info)) {
+        log_text(LogLevel::Info, LogTag::Cmt,
+                 "ブロック読み出し: タグ " + std::to_string(st.tags) + " (キャッシュ " + std::to_string(st.cached) +
+                 ", 失敗 " + std::to_string(st.failed) + ") 要求 " + std::to_string(st.commands) +
+                 " 送信 " + std::to_string(st.writes));
+    }
+    if (stats) *stats = st;
+    return tags;
+}
+
+// ───────────────────────────────────
+// 書き込み
+// ───────────────────────────────────
+bool write_tag_blocks(Transport& sp, const Uid& uid, uint8_t dsfid, uint8_t first, const uint8_t* data, size_t n,
+                      const TagMemoryOptions& opt, BlockCache* cache, std::string* error, TagMemoryStats* stats) {
+    TagMemoryStats st;
+    st.tags = 1;
+    const size_t bs = opt.block_size;
+    const size_t blocks = bs ? n / bs : 0;
+    if (blocks == 0 || n % bs != 0 || size_t(first) + blocks > 256) {
+        if (error) *error = "ブロック指定・データ長が不正";
+        st.failed = 1;
+        if (stats) *stats = st;
+        return false;
+    }
+    if (cache && cache->block_size() != bs) { cache->invalidate(uid); cache = nullptr; }
+
+    const size_t per = opt.multi_block_write
+        ? std::max<size_t>(1, std::min(opt.max_blocks, max_blocks_per_write(bs))) : 1;
+    std::vector<Job> jobs;
+    for (size_t b = 0; b < blocks; b += per)
+        jobs.push_back(Job{0, uint8_t(first + b), uint8_t(std::min(per, blocks - b))});
+
+    bool ok = true;
+    run_jobs(sp, std::move(jobs), opt, st,
+        [&](const Job& j) {
+            return cmd_write_blocks(uid, j.first, j.count, data + size_t(j.first - first) * bs, j.count * bs, opt.timeout_ms);
+        },
+        [&](const Job& j, const CommandReply&, std::string&) {
+            if (cache) cache->put(uid, dsfid, j.first, data + size_t(j.first - first) * bs, j.count);
+            return true;
+        },
+        [&](const Job&, const std::string& err) {
+            if (ok && error) *error = err;
+            ok = false;
+        });
+
+    // 書けたかどうか分からないブロックが残るので、記録ごと捨てて次は読み直させる
+    if (!ok) {
+        ++st.failed;
+        if (cache) cache->invalidate(uid);
+    }
+    if (stats) *stats = st;
+    return ok;
+}
+
+} // namespace tr3
@@ -0,0 +1,221 @@
+// タグの在席管理（オープンアドレス表＋固定長の記録配列）
+#include "../include/tag_tracker.hpp"
+
+namespace tr3 {
+
+TagTracker::TagTracker(TagTrackerConfig cfg, EventCallback cb)
+    : cfg_(cfg), cb_(std::move(cb))
+{
+    if (cfg_.capacity == 0) cfg_.capacity = 1;
+    if (cfg_.capacity >= NIL) cfg_.capacity = NIL - 1;
+    if (cfg_.arrive_reads == 0) cfg_.arrive_reads = 1;
+
+    // 負荷率 0.5 以下（線形探索の探索長を短く保つ）
+    size_t n = 16;
+    while (n < cfg_.capacity * 2) n <<= 1;
+    table_.resize(n);
+    mask_ = n - 1;
+
+    entries_.resize(cfg_.capacity);
+    clear();
+}
+
+void TagTracker::clear() {
+    for (auto& s : table_) s = Slot{};
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        entries_[i].state = State::Free;
+        entries_[i].prev  = NIL;
+        entries_[i].next  = (i + 1 < entries_.size()) ? uint32_t(i + 1) : NIL;
+    }
+    free_head_ = 0;
+    active_ = List{};
+    absent_ = List{};
+    used_ = present_ = 0;
+    stats_ = TagTrackerStats{};
+}
+
+size_t TagTracker::memory_bytes() const {
+    return table_.capacity() * sizeof(Slot) + entries_.capacity() * sizeof(Entry);
+}
+
+// ───────────────────────────────────
+// 表（線形探索、削除は後方シフト）
+// ───────────────────────────────────
+size_t TagTracker::lookup(const Uid& uid, uint32_t fp) const {
+    for (size_t i = fp & mask_;; i = (i + 1) & mask_) {
+        const Slot& s = table_[i];
+        if (s.idx == NIL) return NPOS;
+        if (s.fp == fp && entries_[s.idx].info.uid == uid) return i;
+    }
+}
+
+void TagTracker::erase_slot(size_t pos) {
+    // 後続のスロットを、ホーム位置を越えない範囲で詰める（墓標を残さない）
+    size_t i = pos;
+    for (size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+        if (table_[j].idx == NIL) break;
+        const size_t home = table_[j].fp & mask_;
+        const bool movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable) { table_[i] = table_[j]; i = j; }
+    }
+    table_[i] = Slot{};
+}
+
+const TagInfo* TagTracker::find(const Uid& uid) const {
+    const size_t pos = lookup(uid, uint32_t(uid_hash(uid)));
+    if (pos == NPOS) return nullptr;
+    return &entries_[table_[pos].idx].info;
+}
+
+// ───────────────────────────────────
+// リスト（添字による双方向リスト）
+// ───────────────────────────────────
+void TagTracker::link_tail(List& l, uint32_t idx) {
+    Entry& e = entries_[idx];
+    e.prev = l.tail; e.next = NIL;
+    if (l.tail != NIL) entries_[l.tail].next = idx; else l.head = idx;
+    l.tail = idx;
+}
+
+void TagTracker::unlink(List& l, uint32_t idx) {
+    Entry& e = entries_[idx];
+    if (e.prev != NIL) entries_[e.prev].next = e.next; else l.head = e.next;
+    if (e.next != NIL) entries_[e.next].prev = e.prev; else l.tail = e.prev;
+    e.prev = e.next = NIL;
+}
+
+// ───────────────────────────────────
+// 記録の確保・解放
+// ───────────────────────────────────
+void TagTracker::release(uint32_t idx) {
+    Entry& e = entries_[idx];
+    if (e.state == State::Absent) unlink(absent_, idx);
+    else                          unlink(active_, idx);
+    if (e.state == State::Present) --present_;
+
+    erase_slot(lookup(e.info.uid, uint32_t(uid_hash(e.info.uid))));
+    e.state = State::Free;
+    e.next  = free_head_;
+    free_head_ = idx;
+    --used_;
+}
+
+uint32_t TagTracker::allocate() {
+    if (free_head_ == NIL) {
+        // 満杯：離脱済みの古いものから、なければ最も長く読めていないタグを追い出す
+        const uint32_t victim = (absent_.head != NIL) ? absent_.head : active_.head;
+        if (entries_[victim].state == State::Present) depart(victim, /*evicted=*/true);
+        release(victim);
+        ++stats_.evictions;
+    }
+    const uint32_t idx = free_head_;
+    free_head_ = entries_[idx].next;
+    ++used_;
+    return idx;
+}
+
+// ───────────────────────────────────
+// イベント
+// ───────────────────────────────────
+void TagTracker::emit(TagEvent::Kind k, const Entry& e, bool evicted) {
+    if (!cb_) return;
+    TagEvent ev;
+    ev.kind    = k;
+    ev.evicted = evicted;
+    ev.tag     = e.info;
+    cb_(ev);
+}
+
+void TagTracker::depart(uint32_t idx, bool evicted) {
+    Entry& e = entries_[idx];
+    unlink(active_, idx);
+    e.state = State::Absent;
+    e.info.present = false;
+    --present_;
+    ++stats_.departures;
+    emit(TagEvent::Kind::Depart, e, evicted);
+    link_tail(absent_, idx);
+}
+
+// ───────────────────────────────────
+// 反映
+// ───────────────────────────────────
+void TagTracker::observe(const Uid& uid, uint8_t dsfid, time_point now) {
+    ++stats_.reads;
+    const uint32_t fp  = uint32_t(uid_hash(uid));
+    const size_t   pos = lookup(uid, fp);
+
+    uint32_t idx;
+    if (pos != NPOS) {
+        idx = table_[pos].idx;
+        Entry& e = entries_[idx];
+        if (e.state == State::Absent) {
+            // 再来：新しい在席として数え直す
+            unlink(absent_, idx);
+            e.state = State::Pending;
+            e.info.session_start = now;
+            e.info.session_reads = 0;
+        } else {
+            unlink(active_, idx);
+        }
+        link_tail(active_, idx);
+    } else {
+        idx = allocate();   // 追い出しで表が動くので、空きスロットはこの後に探す
+        size_t i = fp & mask_;
+        while (table_[i].idx != NIL) i = (i + 1) & mask_;
+        table_[i] = Slot{idx, fp};
+
+        Entry& e = entries_[idx];
+        e.info = TagInfo{};
+        e.info.uid = uid;
+        e.info.first_seen = e.info.session_start = now;
+        e.state = State::Pending;
+        link_tail(active_, idx);
+    }
+
+    Entry& e = entries_[idx];
+    e.info.dsfid     = dsfid;
+    e.info.last_seen = now;
+    ++e.info.reads;
+    ++e.info.session_reads;
+
+    if (e.state == State::Pending &&
+        e.info.session_reads >= cfg_.arrive_reads &&
+        now - e.info.session_start >= cfg_.arrive_dwell) {
+        e.state = State::Present;
+        e.info.present = true;
+        ++present_;
+        ++stats_.arrivals;
+        emit(TagEvent::Kind::Arrive, e, false);
+    }
+}
+
+void TagTracker::observe(const InventoryResult& r, time_point now) {
+    for (const auto& it : r.items) observe(it.uid, it.dsfid, now);
+    tick(now);
+}
+
+void TagTracker::tick(time_point now) {
+    // active_ は最終読み取りの古い順なので、先頭から期限切れの分だけ見ればよい
+    while (active_.head != NIL) {
+        const uint32_t idx = active_.head;
+        Entry& e = entries_[idx];
+        if (now - e.info.last_seen < cfg_.absence) break;
+        if (e.state == State::Present) {
+            depart(idx, /*evicted=*/false);
+        } else {
+            release(idx);   // 到着条件を満たす前に途切れた
+            ++stats_.expired;
+        }
+    }
+    if (cfg_.retain.count() > 0) {
+        while (absent_.head != NIL) {
+            const uint32_t idx = absent_.head;
+            if (now - entries_[idx].info.last_seen < cfg_.absence + cfg_.retain) break;
+            release(idx);
+            ++stats_.expired;
+        }
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,36 @@
+// TR3 フレーム生成／検証
+#include "../include/tr3_frame.hpp"
+#include "../include/frame_scan.hpp"
+
+namespace tr3 {
+
+uint8_t calc_sum(const uint8_t* bytes, size_t n) {
+    return sum_bytes(bytes, n);   // SSE2 / AVX2（frame_scan.cpp）
+}
+
+std::vector<uint8_t> make_frame(uint8_t addr, uint8_t cmd, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> f;
+    f.reserve(HEADER_LEN + payload.size() + FOOTER_LEN);
+    f.push_back(STX);
+    f.push_back(addr);
+    f.push_back(cmd);
+    f.push_back(static_cast<uint8_t>(payload.size()));
+    f.insert(f.end(), payload.begin(), payload.end());
+    f.push_back(ETX);
+    f.push_back(calc_sum(f.data(), f.size()));
+    f.push_back(CR);
+    return f;
+}
+
+bool verify_frame(const uint8_t* f, size_t n) {
+    if (n < HEADER_LEN + FOOTER_LEN) return false;
+    const size_t need = HEADER_LEN + f[IDX_LEN] + FOOTER_LEN;
+    if (n != need) return false;
+    return check_frame_at(f, need, n);   // ETX・CR・SUM
+}
+
+bool verify_frame(const std::vector<uint8_t>& f) {
+    return verify_frame(f.data(), f.size());
+}
+
+} // namespace tr3
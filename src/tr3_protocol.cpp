@@ -8,196 +8,217 @@
 #include <chrono>
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <ctime>
 
 #include "../include/tr3_protocol.hpp"
-#include "../include/serial_port.hpp"
+#include "../include/transport.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/inventory_cycle.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
 
 using namespace std::chrono;
 
 //===============================
-// 定数
+// 定数（フレーム・コマンドの定数は tr3_frame.hpp）
 //===============================
-static constexpr uint8_t STX = 0x02;
-static constexpr uint8_t ETX = 0x03;
-static constexpr uint8_t CR  = 0x0D;
-
-static constexpr uint8_t ADDR_DEFAULT = 0x00;
-
-static constexpr uint8_t CMD_ACK      = 0x30;
-static constexpr uint8_t CMD_NACK     = 0x31;
-
-// HF: ROM / ReaderMode / Inventory2
-static constexpr uint8_t CMD_ROM_REQ  = 0x4F; // len=1, data=0x90
-static constexpr uint8_t DETAIL_ROM   = 0x90;
-
-static constexpr uint8_t CMD_MODE_RD  = 0x4F; // len=1, data=0x00
-static constexpr uint8_t DETAIL_MODE_R= 0x00;
-
-static constexpr uint8_t CMD_MODE_WR  = 0x4E; // len=4, data=[mode,reserved,flags,speedbits]
-
-static constexpr uint8_t CMD_INV2     = 0x78; // len=3, data=F0 40 01
-static constexpr uint8_t DETAIL_INV2_F0=0xF0; // Inventory2
-static constexpr uint8_t RSP_UID      = 0x49; // DSFID+UIDレスポンス
-
-static constexpr size_t  IDX_STX    = 0;
-static constexpr size_t  IDX_ADDR   = 1;
-static constexpr size_t  IDX_CMD    = 2;
-static constexpr size_t  IDX_LEN    = 3;
-static constexpr size_t  HEADER_LEN = 4;
-static constexpr size_t  FOOTER_LEN = 3;
-
-// ブザー制御は「書き込み(0x4E)」の「詳細コマンド(0x42)」
-static constexpr uint8_t CMD_BUZZER = 0x42;  // ブザーの制御
-
+using tr3::ADDR_DEFAULT; using tr3::CMD_ACK; using tr3::CMD_NACK;
+using tr3::IDX_CMD; using tr3::IDX_LEN; using tr3::HEADER_LEN; using tr3::FOOTER_LEN;
+using tr3::CMD_ROM_REQ; using tr3::DETAIL_ROM; using tr3::CMD_MODE_RD; using tr3::DETAIL_MODE_R;
+using tr3::CMD_MODE_WR; using tr3::CMD_INV2; using tr3::DETAIL_INV2_F0; using tr3::RSP_UID;
+using tr3::CMD_BUZZER; using tr3::NACK_SUM_ERROR; using tr3::NACK_FORMAT_ERROR; using tr3::NACK_NO_TAG;
+using tr3::CMD_ISO15693; using tr3::DETAIL_READ_SINGLE; using tr3::DETAIL_READ_MULTI;
+using tr3::DETAIL_WRITE_SINGLE; using tr3::DETAIL_WRITE_MULTI; using tr3::ISO_FLAG_HIGH_RATE; using tr3::ISO_FLAG_ADDRESSED;
+using tr3::make_frame;
 
 //===============================
-// ログユーティリティ
+// ログユーティリティ（整形・出力は log.cpp の整形スレッドで行う）
 //===============================
-static std::string now_timestamp() {
-    const auto tp = system_clock::now();
-    const auto ms = duration_cast<milliseconds>(tp.time_since_epoch()) % 1000;
-    const std::time_t t = system_clock::to_time_t(tp);
-    std::tm tm{}; localtime_s(&tm, &t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%m/%d %H:%M:%S") << "." << std::setw(3) << std::setfill('0') << ms.count();
-    return oss.str();
+using tr3::LogLevel; using tr3::LogTag; using tr3::log_enabled;
+
+static void log_cmt(const char* text, LogLevel lv = LogLevel::Info) {
+    tr3::log_text(lv, LogTag::Cmt, text, std::strlen(text));
 }
-static void log_line(const char* tag, const std::string& payload) {
-    std::printf("%s  [%s]  %s\n", now_timestamp().c_str(), tag, payload.c_str());
-    std::fflush(stdout);
+static void log_cmt(const std::string& text, LogLevel lv = LogLevel::Info) {
+    tr3::log_text(lv, LogTag::Cmt, text);
 }
-static std::string to_hex_string(const std::vector<uint8_t>& buf) {
+static void log_send(const uint8_t* p, size_t n)  { tr3::log_frame(LogTag::Send, p, n); }
+static void log_recv(const tr3::FrameView& f)     { tr3::log_frame(LogTag::Recv, f.data, f.size); }
+
+// 受信を終えたパーサの統計を計測値へ加え、再同期・SUMエラーがあればログにも残す
+static void finish_parser(const tr3::FrameParser& parser) {
+    tr3::FrameParserStats zero;
+    tr3::metrics().add_parser(parser.stats(), zero);
+
+    if (!log_enabled(LogLevel::Error)) return;
+    const auto& st = parser.stats();
+    if (st.resyncs == 0 && st.checksum_failures == 0 && st.overflows == 0) return;
     std::ostringstream oss;
-    for (size_t i = 0; i < buf.size(); ++i) {
-        if (i) oss << ' ';
-        oss << std::uppercase << std::hex
-            << std::setw(2) << std::setfill('0') << static_cast<int>(buf[i]);
-    }
-    return oss.str();
+    oss << "受信異常: 再同期=" << st.resyncs << " 破棄=" << st.bytes_discarded
+        << "B SUMエラー=" << st.checksum_failures << " あふれ=" << st.overflows;
+    log_cmt(oss.str(), LogLevel::Error);
 }
 
-//===============================
-// フレーム生成/検証
-//===============================
-static uint8_t calc_sum_until(const std::vector<uint8_t>& bytes, size_t until) {
-    uint32_t s = 0; for (size_t i = 0; i < until; ++i) s += bytes[i];
-    return static_cast<uint8_t>(s & 0xFF);
-}
-static std::vector<uint8_t> make_frame(uint8_t addr, uint8_t cmd, const std::vector<uint8_t>& payload) {
-    std::vector<uint8_t> f;
-    f.reserve(HEADER_LEN + payload.size() + FOOTER_LEN);
-    f.push_back(STX);
-    f.push_back(addr);
-    f.push_back(cmd);
-    f.push_back(static_cast<uint8_t>(payload.size()));
-    f.insert(f.end(), payload.begin(), payload.end());
-    f.push_back(ETX);
-    f.push_back(calc_sum_until(f, f.size()));
-    f.push_back(CR);
-    return f;
-}
-bool tr3::verify_frame(const std::vector<uint8_t>& f) {
-    if (f.size() < HEADER_LEN + FOOTER_LEN) return false;
-    const uint8_t len  = f[IDX_LEN];
-    const size_t  need = HEADER_LEN + len + FOOTER_LEN;
-    if (f.size() != need) return false;
-    if (f[need - 1] != CR)  return false;
-    if (f[need - 3] != ETX) return false;
-    const uint8_t sum_expect = f[need - 2];
-    const uint8_t sum_calc   = calc_sum_until(f, need - 2);
-    return sum_expect == sum_calc;
+static uint64_t elapsed_us(steady_clock::time_point t0) {
+    return uint64_t(duration_cast<microseconds>(steady_clock::now() - t0).count());
+}
+
+// communicate() の戻り値（フレームの連結）から末尾フレームを指す（コピーしない）
+static tr3::FrameView last_frame(const std::vector<uint8_t>& rx) {
+    size_t i = 0, last = 0;
+    while (i + HEADER_LEN + FOOTER_LEN <= rx.size()) {
+        const uint8_t len  = rx[i + IDX_LEN];
+        const size_t  need = HEADER_LEN + len + FOOTER_LEN;
+        if (i + need > rx.size()) break;
+        last = i; i += need;
+    }
+    return tr3::FrameView{rx.data() + last, i - last};
 }
 
 //===============================
 // 送受信（ACKで止める/止めない選択）
 //===============================
-std::vector<uint8_t> tr3::communicate(SerialPort& sp,
+std::vector<uint8_t> tr3::communicate(Transport& sp,
                                       const std::vector<uint8_t>& command,
                                       uint32_t timeout_ms,
                                       bool stop_on_ack)
 {
-    log_line("send", to_hex_string(command));
-    if (!sp.write(command)) { log_line("cmt", "送信エラー"); return {}; }
+    return communicate(sp, command.data(), command.size(), timeout_ms, stop_on_ack);
+}
 
-    std::vector<uint8_t> rxbuf;  rxbuf.reserve(256);
+std::vector<uint8_t> tr3::communicate(Transport& sp,
+                                      const uint8_t* command, size_t command_len,
+                                      uint32_t timeout_ms,
+                                      bool stop_on_ack)
+{
+    auto& m = metrics();
+    const uint8_t req = command_len > IDX_CMD ? command[IDX_CMD] : 0;
+    log_send(command, command_len);
+    m.on_request(req);
+    if (!sp.write(command, command_len)) { m.add_write_error(); log_cmt("送信エラー", LogLevel::Error); return {}; }
+
+    FrameParser& parser = sp.rx_parser();   // ポートの受信パーサを使い回す（呼び出し毎に確保しない）
+    parser.reset();
     std::vector<uint8_t> out;
-    const auto deadline = steady_clock::now() + milliseconds(timeout_ms);
+    const auto t_sent   = steady_clock::now();
+    const auto deadline = t_sent + milliseconds(timeout_ms);
+    bool responded = false;   // 最初の ACK/NACK で応答時間を記録する
 
     while (steady_clock::now() < deadline) {
-        uint8_t b = 0;
-        if (sp.read_byte(b, std::chrono::milliseconds(10))) rxbuf.push_back(b);
-
-        // STXまで捨てる
-        while (!rxbuf.empty() && rxbuf[0] != STX) rxbuf.erase(rxbuf.begin());
-        if (rxbuf.size() < HEADER_LEN) continue;
-
-        const uint8_t dlen = rxbuf[IDX_LEN];
-        const size_t  need = HEADER_LEN + dlen + FOOTER_LEN;
-        if (rxbuf.size() < need) continue;
-
-        std::vector<uint8_t> f(rxbuf.begin(), rxbuf.begin() + need);
-        if (!verify_frame(f)) { rxbuf.erase(rxbuf.begin()); continue; }
-
-        log_line("recv", to_hex_string(f));
-        out.insert(out.end(), f.begin(), f.end());
-
-        const uint8_t cmd = f[IDX_CMD];
-        if (stop_on_ack && (cmd == CMD_ACK || cmd == CMD_NACK)) return out;
-
-        rxbuf.erase(rxbuf.begin(), rxbuf.begin() + need);
+        // ドライバに溜まっている分をパーサのバッファへ直接取り込む
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp.read_some(dst, room, deadline);
+        if (n == 0) {
+            if (sp.disconnected()) break;
+            continue;
+        }
+        parser.commit(n);
+
+        // 取り込んだ分から取り出せるフレームを全て処理する
+        FrameView f;
+        while (parser.next(f)) {
+            log_recv(f);
+            out.insert(out.end(), f.begin(), f.end());
+
+            const uint8_t cmd = f.cmd();
+            if (!responded && (cmd == CMD_ACK || cmd == CMD_NACK)) {
+                responded = true;
+                NackResponse nack;
+                if (decode_nack(f, nack)) m.on_nack(req, nack.code, elapsed_us(t_sent));
+                else                      m.on_ack(req, elapsed_us(t_sent));
+            }
+            if (stop_on_ack && (cmd == CMD_ACK || cmd == CMD_NACK)) { finish_parser(parser); return out; }
+        }
     }
-    log_line("cmt", "タイムアウト: レスポンスが一定時間内に受信されませんでした。");
+    finish_parser(parser);
+    if (responded) return out;   // 応答を全て待つ指定（stop_on_ack=false）で期限まで受けた
+    m.on_timeout(req);
+    log_cmt("タイムアウト: レスポンスが一定時間内に受信されませんでした。", LogLevel::Error);
     return out;
 }
 
 //===============================
 // ROM
 //===============================
-std::string tr3::read_rom_version(SerialPort& sp, uint32_t timeout_ms) {
-    log_line("cmt", "/* ROMバージョンの読み取り */");
-    auto tx = make_frame(ADDR_DEFAULT, CMD_ROM_REQ, {DETAIL_ROM});
-    auto rx = communicate(sp, tx, timeout_ms);
+std::string tr3::read_rom_version(Transport& sp, uint32_t timeout_ms) {
+    log_cmt("/* ROMバージョンの読み取り */");
+    static constexpr auto tx = make_frame_fixed(ADDR_DEFAULT, CMD_ROM_REQ, DETAIL_ROM);
+    auto rx = communicate(sp, tx.data(), tx.size(), timeout_ms);
     if (rx.empty()) return {};
 
-    size_t i = 0, last = 0;
-    while (i + HEADER_LEN + FOOTER_LEN <= rx.size()) {
-        const uint8_t len  = rx[i + IDX_LEN];
-        const size_t  need = HEADER_LEN + len + FOOTER_LEN;
-        if (i + need > rx.size()) break;
-        last = i; i += need;
-    }
-    std::vector<uint8_t> f(rx.begin() + last, rx.begin() + i);
-    if (!verify_frame(f) || f[IDX_CMD] != CMD_ACK || f[HEADER_LEN] != DETAIL_ROM) return {};
+    const FrameView f = last_frame(rx);
+    RomVersionAck ack;
+    if (!verify_frame(f) || !decode_rom_version_ack(f, ack)) return {};
+
+    const std::string pretty = format_rom_version(ack);
+    log_cmt(std::string("ROMバージョン : ") + pretty);
+    return pretty;
+}
 
+// ASCII "100S" → "1.00 S"
+std::string tr3::format_rom_version(const RomVersionAck& ack) {
     std::string ascii;
-    for (size_t k = HEADER_LEN + 1; k < f.size() - FOOTER_LEN; ++k)
-        if (std::isprint(f[k])) ascii.push_back(static_cast<char>(f[k]));
+    for (size_t k = 0; k < ack.len; ++k)
+        if (std::isprint(static_cast<unsigned char>(ack.ascii[k]))) ascii.push_back(ack.ascii[k]);
 
     std::string pretty = ascii;
     if (ascii.size() >= 4) {
         pretty = ascii.substr(0,1) + "." + ascii.substr(1,2) + " " + ascii.substr(3,1);
         if (ascii.size() > 4) pretty += ascii.substr(4);
     }
-    log_line("cmt", std::string("ROMバージョン : ") + pretty);
     return pretty;
 }
 
 //===============================
 // NACK（簡易）
 //===============================
-std::string tr3::parse_nack_message(const std::vector<uint8_t>& f) {
-    if (!verify_frame(f) || f[IDX_CMD] != CMD_NACK) return "Invalid NACK";
-    uint8_t code = (f.size() > HEADER_LEN + 1) ? f[HEADER_LEN + 1] : 0xFF;
+const char* tr3::nack_message(uint8_t code) {
     switch (code) {
-        case 0x42: return "SUM_ERROR: SUM不一致";
-        case 0x44: return "FORMAT_ERROR: フォーマット/パラメータ不正";
+        case NACK_SUM_ERROR:    return "SUM_ERROR: SUM不一致";
+        case NACK_FORMAT_ERROR: return "FORMAT_ERROR: フォーマット/パラメータ不正";
+        case NACK_NO_TAG:       return "NO_TAG: タグから応答なし";
         default:   return "Unknown NACK error";
     }
 }
 
+std::string tr3::parse_nack_message(const FrameView& f) {
+    NackResponse nack;
+    if (!verify_frame(f) || !decode_nack(f, nack)) return "Invalid NACK";
+    return nack_message(nack.code);
+}
+
+std::string tr3::parse_nack_message(const std::vector<uint8_t>& f) {
+    return parse_nack_message(FrameView{f.data(), f.size()});
+}
+
 //===============================
 // 動作モード 読み取り/表示
 //===============================
+uint32_t tr3::baud_from_speed_bits(uint8_t speed_byte) {
+    switch ((speed_byte >> 6) & 0x03) {
+        case 0b00: return 19200;
+        case 0b01: return 9600;
+        case 0b10: return 38400;
+        default:   return 115200;
+    }
+}
+
+uint32_t tr3::baud_from_mode(const ReaderModeRaw& raw) {
+    return raw.bytes.size() >= 4 ? baud_from_speed_bits(raw.bytes[3]) : 0;
+}
+
+uint8_t tr3::speed_bits_from_baud(uint32_t baud) {
+    switch (baud) {
+        case 19200:  return 0x00;
+        case 9600:   return 0x40;
+        case 38400:  return 0x80;
+        case 115200: return 0xC0;
+        default:     return 0xFF;   // リーダが対応しない速度
+    }
+}
+
 static tr3::ReaderModePretty pretty_from_raw(const tr3::ReaderModeRaw& raw) {
     tr3::ReaderModePretty p;
     if (raw.bytes.size() >= 4) {
@@ -226,173 +247,248 @@ static tr3::ReaderModePretty pretty_from_raw(const tr3::ReaderModeRaw& raw) {
         p.tx_data       = (flags & (1<<5)) ? "ユーザデータ + UID" : "ユーザデータのみ";
 
         // 通信速度: bit6/bit7
-        switch ((spdb >> 6) & 0x03) {
-            case 0b00: p.baud = "19200bps";   break;
-            case 0b01: p.baud = "9600bps";    break;
-            case 0b10: p.baud = "38400bps";   break;
-            case 0b11: p.baud = "115200bps";  break;
-        }
+        p.baud = std::to_string(tr3::baud_from_speed_bits(spdb)) + "bps";
     }
     return p;
 }
 
-bool tr3::read_reader_mode(SerialPort& sp, ReaderModeRaw& raw, ReaderModePretty& pretty, uint32_t timeout_ms) {
-    log_line("cmt", "/* リーダライタ動作モードの読み取り */");
-    auto tx = make_frame(ADDR_DEFAULT, CMD_MODE_RD, {DETAIL_MODE_R});
-    auto rx = communicate(sp, tx, timeout_ms);
+bool tr3::read_reader_mode(Transport& sp, ReaderModeRaw& raw, ReaderModePretty& pretty, uint32_t timeout_ms) {
+    log_cmt("/* リーダライタ動作モードの読み取り */");
+    static constexpr auto tx = make_frame_fixed(ADDR_DEFAULT, CMD_MODE_RD, DETAIL_MODE_R);
+    auto rx = communicate(sp, tx.data(), tx.size(), timeout_ms);
     if (rx.empty()) return false;
 
     // 末尾（ACK）を抽出
-    size_t i = 0, last = 0;
-    while (i + HEADER_LEN + FOOTER_LEN <= rx.size()) {
-        const uint8_t len  = rx[i + IDX_LEN];
-        const size_t  need = HEADER_LEN + len + FOOTER_LEN;
-        if (i + need > rx.size()) break;
-        last = i; i += need;
-    }
-    std::vector<uint8_t> f(rx.begin() + last, rx.begin() + i);
-    if (!verify_frame(f) || f[IDX_CMD] != CMD_ACK || f[HEADER_LEN] != DETAIL_MODE_R) return false;
+    const FrameView f = last_frame(rx);
+    ReaderModeAck ack;
+    if (!verify_frame(f) || !decode_reader_mode_ack(f, ack)) return false;
 
     // detail(0x00) の直後から9Bを保持
-    raw.bytes.assign(f.begin() + HEADER_LEN + 1, f.end() - FOOTER_LEN);
+    raw.bytes.assign(ack.bytes, ack.bytes + ack.len);
     pretty = pretty_from_raw(raw);
 
-    log_line("cmt", std::string("リーダライタ動作モード : ") + pretty.mode);
-    log_line("cmt", std::string("アンチコリジョン       : ") + pretty.anticollision);
-    log_line("cmt", std::string("読み取り動作           : ") + pretty.read_behavior);
-    log_line("cmt", std::string("ブザー                 : ") + pretty.buzzer);
-    log_line("cmt", std::string("送信データ             : ") + pretty.tx_data);
-    log_line("cmt", std::string("通信速度               : ") + pretty.baud);
+    log_cmt(std::string("リーダライタ動作モード : ") + pretty.mode);
+    log_cmt(std::string("アンチコリジョン       : ") + pretty.anticollision);
+    log_cmt(std::string("読み取り動作           : ") + pretty.read_behavior);
+    log_cmt(std::string("ブザー                 : ") + pretty.buzzer);
+    log_cmt(std::string("送信データ             : ") + pretty.tx_data);
+    log_cmt(std::string("通信速度               : ") + pretty.baud);
     return true;
 }
 
-// ★モードのみコマンドモードへ変更（他設定は維持）
+// ★モードのみ変更（他設定は維持）
 //   書き込み(4Eh)データ部は 7 バイト：
-//   [0]=詳細(00h=RAM/10h=EEPROM), [1]=モード, [2]=予約, [3]=各種設定パラメータ, [4]=予約, [5]=ポーリング上位, [6]=ポーリング下位
-bool tr3::write_reader_mode_to_command(SerialPort& sp, const ReaderModeRaw& current, uint32_t timeout_ms) {
-    if (current.bytes.size() < 4) { // [0]=モード, [2]=各種設定パラメータ(=flags相当) を使うので最低4バイト必要
-        log_line("cmt", "現行モード情報が不足しています（読み取りレスポンスのデータ部が短い）");
-        return false;
-    }
-
-    // 読み取り結果から「各種設定パラメータ」を抽出
-    // 読み取りACKのデータ部は [0]=モード, [1]=予約, [2]=各種設定パラメータ, [3]=速度ビット… の並びでした
-    const uint8_t flags = current.bytes[2];
-
-    // ★ログ：何をするか明記
-    log_line("cmt", "/* コマンドモードへ設定します （他の設定は現状維持）*/");
+//   [0]=詳細(00h=RAM/10h=EEPROM), [1]=モード, [2]=予約, [3]=各種設定パラメータ, [4]=通信速度(bit6..7), [5]=ポーリング上位, [6]=ポーリング下位
+bool tr3::write_reader_mode_to_command(Transport& sp, const ReaderModeRaw& current, uint32_t timeout_ms) {
+    return write_reader_mode(sp, current, /*new_mode=*/0x00, timeout_ms);
+}
 
+tr3::FixedFrame<7> tr3::make_mode_write_frame(uint8_t new_mode, uint8_t flags, uint8_t speed) {
     // 書き込み先は RAM（00h）。EEPROMに永続化したい場合は detail を 0x10 にしてください。
     const uint8_t detail   = 0x00; // RAM
-    const uint8_t new_mode = 0x00; // コマンドモード
     const uint8_t reserved = 0x00;
     const uint8_t poll_hi  = 0x00;
     const uint8_t poll_lo  = 0x00;
 
-    // 正しい 7 バイトの並びでペイロードを作る
-    std::vector<uint8_t> payload = {
+    // 正しい 7 バイトの並びでフレームを作る
+    return make_frame_fixed(ADDR_DEFAULT, CMD_MODE_WR,
         detail,        // 1: 詳細コマンド
         new_mode,      // 2: リーダライタ動作モード（ここだけ上書き）
         reserved,      // 3: 予約
         flags,         // 4: 各種設定パラメータ（読み取り値を維持）
-        reserved,      // 5: 予約
+        uint8_t(speed & 0xC0), // 5: 通信速度（bit6..7。読み取り値を維持）
         poll_hi,       // 6: ポーリング時間（上位）
         poll_lo        // 7: ポーリング時間（下位）
-    };
+    );
+}
 
-    // 送信
-    auto tx = make_frame(ADDR_DEFAULT, CMD_MODE_WR, payload);
-    auto rx = communicate(sp, tx, timeout_ms);
+// 書き込みフレームを送り ACK/NACK を判定
+static bool send_mode_write(tr3::Transport& sp, const tr3::FixedFrame<7>& tx, uint32_t timeout_ms) {
+    auto rx = tr3::communicate(sp, tx.data(), tx.size(), timeout_ms);
     if (rx.empty()) return false;
 
     // 末尾（ACK/NACK）判定
-    size_t i = 0, last = 0;
-    while (i + HEADER_LEN + FOOTER_LEN <= rx.size()) {
-        const uint8_t len  = rx[i + IDX_LEN];
-        const size_t  need = HEADER_LEN + len + FOOTER_LEN;
-        if (i + need > rx.size()) break;
-        last = i; i += need;
+    const tr3::FrameView f = last_frame(rx);
+    if (!tr3::verify_frame(f)) return false;
+    if (f.cmd() == CMD_NACK) {
+        log_cmt(std::string("NACK: ") + tr3::parse_nack_message(f), LogLevel::Error);
+        return false;
     }
-    std::vector<uint8_t> f(rx.begin() + last, rx.begin() + i);
-    if (!verify_frame(f)) return false;
-    if (f[IDX_CMD] == CMD_NACK) {
-        log_line("cmt", std::string("NACK: ") + parse_nack_message(f));
+    return (f.cmd() == CMD_ACK);
+}
+
+bool tr3::write_reader_mode(Transport& sp, const ReaderModeRaw& current, uint8_t new_mode, uint32_t timeout_ms) {
+    if (current.bytes.size() < 4) { // [0]=モード, [2]=各種設定パラメータ(=flags相当) を使うので最低4バイト必要
+        log_cmt("現行モード情報が不足しています（読み取りレスポンスのデータ部が短い）");
         return false;
     }
-    return (f[IDX_CMD] == CMD_ACK);
+
+    // 読み取り結果から「各種設定パラメータ」を抽出
+    // 読み取りACKのデータ部は [0]=モード, [1]=予約, [2]=各種設定パラメータ, [3]=速度ビット… の並びでした
+    const uint8_t flags = current.bytes[2];
+    const uint8_t speed = current.bytes[3];
+
+    // ★ログ：何をするか明記
+    if (new_mode == 0x00) {
+        log_cmt("/* コマンドモードへ設定します （他の設定は現状維持）*/");
+    } else {
+        ReaderModeRaw next = current; next.bytes[0] = new_mode;
+        log_cmt("/* " + pretty_from_raw(next).mode + "へ設定します （他の設定は現状維持）*/");
+    }
+
+    const auto tx = make_mode_write_frame(new_mode, flags, speed);
+    return send_mode_write(sp, tx, timeout_ms);
+}
+
+// 通信速度のみ変更（モード・他設定は維持）。ACK は変更前の速度で返り、以降は新しい速度になる
+bool tr3::write_reader_speed(Transport& sp, const ReaderModeRaw& current, uint32_t baud, uint32_t timeout_ms) {
+    if (current.bytes.size() < 4) {
+        log_cmt("現行モード情報が不足しています（読み取りレスポンスのデータ部が短い）");
+        return false;
+    }
+    const uint8_t speed = speed_bits_from_baud(baud);
+    if (speed == 0xFF) {
+        log_cmt("リーダライタが対応しない通信速度です: " + std::to_string(baud) + "bps", LogLevel::Error);
+        return false;
+    }
+    log_cmt("/* 通信速度を " + std::to_string(baud) + "bps へ設定します （他の設定は現状維持）*/");
+    const auto tx = make_mode_write_frame(current.bytes[0], current.bytes[2], speed);
+    return send_mode_write(sp, tx, timeout_ms);
 }
 
 
+//===============================
+// UID レスポンス（0x49）: [DSFID, UID(LSB→MSB 8バイト)]
+//===============================
+bool tr3::decode_uid_frame(const FrameView& f, InventoryItem& it) {
+    UidResponse r;
+    if (!decode_uid_response(f, r)) return false;
+    it.dsfid = r.dsfid;
+    it.uid   = r.uid;   // MSB→LSB
+    return true;
+}
+
 //===============================
 // Inventory2（順序非依存）
 //===============================
-tr3::InventoryResult tr3::run_inventory2(SerialPort& sp, uint32_t timeout_ms) {
+tr3::InventoryResult tr3::run_inventory2(Transport& sp, uint32_t timeout_ms) {
     InventoryResult out;
-    log_line("cmt", "/* Inventory2 */");
-    auto tx = make_frame(ADDR_DEFAULT, CMD_INV2, {0xF0, 0x40, 0x01});
+    run_inventory2(sp, out, timeout_ms);
+    return out;
+}
 
-    // 手動送信 → 逐次フレーム化
-    log_line("send", to_hex_string(tx));
-    if (!sp.write(tx)) { out.error_message = "送信エラー"; return out; }
+void tr3::run_inventory2(Transport& sp, InventoryResult& out, uint32_t timeout_ms) {
+    // out.items の容量は保持したまま再利用する（周回ごとの再確保を避ける）
+    out.items.clear();
+    out.expected_count = 0;
+    out.error_message.clear();
+
+    log_cmt("/* Inventory2 */");
+    const auto& tx = INV2_REQUEST;
 
-    std::vector<uint8_t> buf; buf.reserve(256);
-    const auto t_end   = steady_clock::now() + milliseconds(timeout_ms);
-    auto       t_quiet = steady_clock::now();
+    // 手動送信 → 逐次フレーム化
+    auto& m = metrics();
+    log_send(tx.data(), tx.size());
+    m.on_request(CMD_INV2);
+    if (!sp.write(tx.data(), tx.size())) { m.add_write_error(); out.error_message = "送信エラー"; return; }
+
+    FrameParser& parser = sp.rx_parser();   // ポートの受信パーサを使い回す（周回ごとの確保を避ける）
+    parser.reset();
+    const auto t_sent  = steady_clock::now();
+    const auto t_end   = t_sent + milliseconds(timeout_ms);
+    auto       t_quiet = t_sent;
     bool       got_any_uid = false;
     int        expected = -1;
 
-    while (steady_clock::now() < t_end) {
-        uint8_t b = 0;
-        if (sp.read_byte(b, std::chrono::milliseconds(10))) { t_quiet = steady_clock::now(); buf.push_back(b); }
-        while (!buf.empty() && buf[0] != STX) buf.erase(buf.begin());
-        if (buf.size() < HEADER_LEN) continue;
-
-        const uint8_t dlen = buf[IDX_LEN];
-        const size_t need  = HEADER_LEN + dlen + FOOTER_LEN;
-        if (buf.size() < need) continue;
+    // 応答終端の無通信ギャップ（ボーレートと学習済みのフレーム間隔から決まる）
+    const auto gap = sp.end_of_response_gap();
 
-        std::vector<uint8_t> f(buf.begin(), buf.begin()+need);
-        if (!verify_frame(f)) { buf.erase(buf.begin()); continue; }
+    // 壊れたフレーム（SUMエラー・あふれ）を見たか。見ていなければ予告数の UID は必ず届くので、
+    // ギャップでは打ち切らない（OS の一時的な遅れで残りを取りこぼさないため）
+    const auto& ps = parser.stats();
+    const uint64_t lost0 = ps.checksum_failures + ps.overflows;
+    auto frame_lost = [&] { return ps.checksum_failures + ps.overflows > lost0; };
 
-        log_line("recv", to_hex_string(f));
-        const uint8_t cmd = f[IDX_CMD];
-
-        if (cmd == CMD_ACK && f[HEADER_LEN] == DETAIL_INV2_F0) {
-            if (f.size() >= HEADER_LEN + FOOTER_LEN + 2) {
-                expected = f[HEADER_LEN + 1];
-                out.expected_count = expected;
-                std::ostringstream oss; oss << "UID数 : " << expected; log_line("cmt", oss.str());
+    while (steady_clock::now() < t_end) {
+        // フレームが欠けた後は無通信ギャップで打ち切るため、待ち期限をそこまでに縮める
+        const bool gap_end = got_any_uid && frame_lost();
+        auto wait_until = t_end;
+        if (gap_end) wait_until = std::min(t_end, t_quiet + gap);
+
+        size_t room = 0;
+        uint8_t* dst = parser.prepare(room);
+        const size_t n = sp.read_some(dst, room, wait_until);
+        if (n == 0) {
+            if (gap_end && steady_clock::now() >= wait_until) {
+                // 打ち切った間隔も（gap_max で頭打ちにして）学習に入れる。
+                // 途中の間隔だけでは閾値は縮む一方で、広がる方向に学習できないため
+                const auto quiet = duration_cast<microseconds>(steady_clock::now() - t_quiet);
+                sp.gap_model().observe(std::min(quiet, sp.timings().gap_max));
+                break;
             }
-        } else if (cmd == RSP_UID && f.size() >= HEADER_LEN + FOOTER_LEN + 9) {
-            InventoryItem it;
-            it.dsfid = f[HEADER_LEN + 0];
-            std::vector<uint8_t> uid_lsb(f.begin()+HEADER_LEN+1, f.begin()+HEADER_LEN+9);
-            it.uid.assign(uid_lsb.rbegin(), uid_lsb.rend()); // MSB→LSB
-            out.items.push_back(std::move(it));
-            got_any_uid = true;
-
-            std::ostringstream d; d<<std::uppercase<<std::hex<<std::setw(2)<<std::setfill('0')<<int(out.items.back().dsfid);
-            log_line("cmt", std::string("DSFID : ") + d.str());
-            std::ostringstream u; for (auto x: out.items.back().uid) u<<std::uppercase<<std::hex<<std::setw(2)<<std::setfill('0')<<int(x)<<" ";
-            log_line("cmt", std::string("UID   : ") + u.str());
-        } else if (cmd == CMD_NACK) {
-            out.error_message = parse_nack_message(f);
-            return out;
+            if (sp.disconnected()) { out.error_message = "ポートが切断されました"; break; }
+            continue;
         }
+        const auto now = steady_clock::now();
+        // バースト途中の受信間隔を学習
+        if (got_any_uid) sp.gap_model().observe(duration_cast<microseconds>(now - t_quiet));
+        t_quiet = now;
+        parser.commit(n);
+
+        bool done = false;
+        FrameView f;
+        while (!done && parser.next(f)) {
+            log_recv(f);
+            const uint8_t cmd = f.cmd();
+
+            Inventory2Ack ack;
+            InventoryItem it;
+            if (decode_inventory2_ack(f, ack)) {
+                m.on_ack(CMD_INV2, elapsed_us(t_sent));
+                expected = ack.count;
+                out.expected_count = expected;
+                if (log_enabled(LogLevel::Info)) {
+                    char line[32]; const int n = std::snprintf(line, sizeof(line), "UID数 : %d", expected);
+                    tr3::log_text(LogLevel::Info, LogTag::Cmt, line, size_t(n));
+                }
+            } else if (decode_uid_frame(f, it)) {
+                // ACK より前の UID は、前のサイクルをギャップで打ち切った後に届いた残りなので数えない
+                if (expected < 0) continue;
+                out.items.push_back(it);
+                got_any_uid = true;
+
+                if (log_enabled(LogLevel::Info)) {
+                    // 整形はスタック上で行う（ログ無効時は何もしない）
+                    const auto& u = it.uid;
+                    char line[64];
+                    int n = std::snprintf(line, sizeof(line), "DSFID : %02X", it.dsfid);
+                    tr3::log_text(LogLevel::Info, LogTag::Cmt, line, size_t(n));
+                    n = std::snprintf(line, sizeof(line), "UID   : %02X %02X %02X %02X %02X %02X %02X %02X ",
+                                      u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7]);
+                    tr3::log_text(LogLevel::Info, LogTag::Cmt, line, size_t(n));
+                }
+            } else if (cmd == CMD_NACK) {
+                NackResponse nack;
+                m.on_nack(CMD_INV2, decode_nack(f, nack) ? nack.code : 0xFF, elapsed_us(t_sent));
+                out.error_message = parse_nack_message(f);
+                finish_parser(parser);
+                return;
+            }
 
-        buf.erase(buf.begin(), buf.begin()+need);
-
-        // 終了条件
-        if (expected >= 0 && int(out.items.size()) >= expected) break;
-        if (got_any_uid) {
-            if (duration_cast<milliseconds>(steady_clock::now() - t_quiet).count() > 120) break;
+            // 終了条件
+            if (expected >= 0 && int(out.items.size()) >= expected) done = true;
         }
+        if (done) break;
     }
+    finish_parser(parser);
+
+    if (expected < 0) m.on_timeout(CMD_INV2);
+    else              m.on_inventory_cycle(elapsed_us(t_sent));
+    m.add_uids(out.items.size());
 
     if (out.items.empty() && out.error_message.empty()) {
         out.error_message = "UIDを取得できませんでした（タイムアウト/対象なし）";
     }
-    return out;
 }
 
 // ───────────────────────────────────
@@ -401,35 +497,120 @@ tr3::InventoryResult tr3::run_inventory2(SerialPort& sp, uint32_t timeout_ms) {
 //   response_type: 0x00=応答不要, 0x01=応答あり（本プログラムは 0x01 推奨）
 //   sound_type   : 0x00=ピー, 0x01=ピッピッピ, 0x02=ピッピッ, ... 0x08 まで
 // ───────────────────────────────────
-bool tr3::buzzer(SerialPort& sp, uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms) {
+bool tr3::buzzer(Transport& sp, uint8_t response_type, uint8_t sound_type, uint32_t timeout_ms) {
     // 表示用ラベル
     std::string tone = (sound_type == 0x00) ? "ピー" :
                        (sound_type == 0x01) ? "ピッピッピ" : ("type=0x" + [] (uint8_t v){
                            std::ostringstream o; o<<std::uppercase<<std::hex<<std::setw(2)<<std::setfill('0')<<int(v); return o.str();
                        }(sound_type));
-    log_line("cmt", std::string("/* ブザー制御: ") + tone + " */");
+    log_cmt(std::string("/* ブザー制御: ") + tone + " */");
 
-    // データ部（2バイト）
-    std::vector<uint8_t> payload{ response_type, sound_type };
+    // フレーム生成（CMD=0x42, データ部2バイト）
+    const auto tx = make_frame_fixed(ADDR_DEFAULT, CMD_BUZZER, response_type, sound_type);
+
+    // 応答なし指定：送信だけで戻る（ACK は返ってこないので待たない）
+    if (response_type == 0x00) {
+        log_send(tx.data(), tx.size());
+        metrics().on_request(CMD_BUZZER);
+        if (sp.write(tx.data(), tx.size())) return true;
+        metrics().add_write_error();
+        return false;
+    }
 
-    // フレーム生成（CMD=0x42）→ 送信（ACKで戻る）
-    auto tx = make_frame(ADDR_DEFAULT, CMD_BUZZER, payload);
-    auto rx = communicate(sp, tx, timeout_ms, /*stop_on_ack=*/true);
+    // 送信（ACKで戻る）
+    auto rx = communicate(sp, tx.data(), tx.size(), timeout_ms, /*stop_on_ack=*/true);
     if (rx.empty()) return false;
 
     // 末尾フレームの検査（ACK/NACK）
-    size_t i = 0, last = 0;
-    while (i + HEADER_LEN + FOOTER_LEN <= rx.size()) {
-        const uint8_t len  = rx[i + IDX_LEN];
-        const size_t  need = HEADER_LEN + len + FOOTER_LEN;
-        if (i + need > rx.size()) break;
-        last = i; i += need;
-    }
-    std::vector<uint8_t> f(rx.begin() + last, rx.begin() + i);
+    const FrameView f = last_frame(rx);
     if (!verify_frame(f)) return false;
-    if (f[IDX_CMD] == CMD_NACK) {
-        log_line("cmt", std::string("NACK: ") + parse_nack_message(f));
+    if (f.cmd() == CMD_NACK) {
+        log_cmt(std::string("NACK: ") + parse_nack_message(f), LogLevel::Error);
+        return false;
+    }
+    return (f.cmd() == CMD_ACK);  // ACK(0x30) データ長 0 の想定
+}
+
+//===============================
+// ISO 15693 ブロック読み書き（CMD=0x78）
+//   [詳細, 要求フラグ, UID(LSB→MSB), 先頭ブロック, (ブロック数-1), (書き込みデータ)]
+//===============================
+// 詳細・フラグ・UID・先頭ブロック（・ブロック数）までのデータ部
+static void block_header(std::vector<uint8_t>& p, uint8_t detail, const tr3::Uid& uid, uint8_t first, uint8_t count) {
+    p.push_back(detail);
+    p.push_back(ISO_FLAG_HIGH_RATE | ISO_FLAG_ADDRESSED);
+    p.insert(p.end(), uid.bytes.rbegin(), uid.bytes.rend());   // UID は LSB から送る
+    p.push_back(first);
+    if (count > 1) p.push_back(uint8_t(count - 1));
+}
+
+std::vector<uint8_t> tr3::make_block_read_frame(const Uid& uid, uint8_t first, uint8_t count) {
+    if (count == 0 || size_t(first) + count > 256) return {};
+    std::vector<uint8_t> p;
+    p.reserve(12);
+    block_header(p, count == 1 ? DETAIL_READ_SINGLE : DETAIL_READ_MULTI, uid, first, count);
+    return make_frame(ADDR_DEFAULT, CMD_ISO15693, p);
+}
+
+std::vector<uint8_t> tr3::make_block_write_frame(const Uid& uid, uint8_t first, uint8_t count,
+                                                 const uint8_t* data, size_t n) {
+    if (count == 0 || size_t(first) + count > 256 || n == 0 || n % count != 0) return {};
+    if (count > max_blocks_per_write(n / count)) return {};
+    std::vector<uint8_t> p;
+    p.reserve(12 + n);
+    block_header(p, count == 1 ? DETAIL_WRITE_SINGLE : DETAIL_WRITE_MULTI, uid, first, count);
+    p.insert(p.end(), data, data + n);
+    return make_frame(ADDR_DEFAULT, CMD_ISO15693, p);
+}
+
+// 末尾フレームが期待の詳細の ACK でなければ理由を返す（正常なら nullptr）
+static const char* block_reply_error(const tr3::FrameView& f, uint8_t detail) {
+    if (!tr3::verify_frame(f)) return "応答フレーム不正";
+    if (f.cmd() == CMD_NACK) return tr3::nack_message(f.len() >= 2 ? f[HEADER_LEN + 1] : 0xFF);
+    if (f.cmd() != CMD_ACK || f.len() < 1 || f[HEADER_LEN] != detail) return "応答フレーム不正";
+    return nullptr;
+}
+
+bool tr3::read_blocks(Transport& sp, const Uid& uid, uint8_t first, uint8_t count,
+                      std::vector<uint8_t>& out, uint32_t timeout_ms) {
+    out.clear();
+    const auto tx = make_block_read_frame(uid, first, count);
+    if (tx.empty()) { log_cmt("ブロック指定が不正です", LogLevel::Error); return false; }
+    if (log_enabled(LogLevel::Info)) {
+        char line[64];
+        const int n = std::snprintf(line, sizeof(line), "/* ブロック読み出し: %u から %u ブロック */", unsigned(first), unsigned(count));
+        tr3::log_text(LogLevel::Info, LogTag::Cmt, line, size_t(n));
+    }
+
+    auto rx = communicate(sp, tx, timeout_ms);
+    if (rx.empty()) return false;
+    const FrameView f = last_frame(rx);
+    if (const char* err = block_reply_error(f, tx[HEADER_LEN])) { log_cmt(std::string("ブロック読み出し失敗: ") + err, LogLevel::Error); return false; }
+
+    BlockReadAck ack;
+    if (!decode_block_read_ack(f, ack) || ack.len == 0 || ack.len % count != 0) {
+        log_cmt("ブロック読み出し失敗: データ長不正", LogLevel::Error);
         return false;
     }
-    return (f[IDX_CMD] == CMD_ACK);  // ACK(0x30) データ長 0 の想定
+    out.assign(ack.data, ack.data + ack.len);
+    return true;
+}
+
+bool tr3::write_blocks(Transport& sp, const Uid& uid, uint8_t first, uint8_t count,
+                       const uint8_t* data, size_t n, uint32_t timeout_ms) {
+    const auto tx = make_block_write_frame(uid, first, count, data, n);
+    if (tx.empty()) { log_cmt("ブロック指定・データ長が不正です", LogLevel::Error); return false; }
+    if (log_enabled(LogLevel::Info)) {
+        char line[64];
+        const int k = std::snprintf(line, sizeof(line), "/* ブロック書き込み: %u から %u ブロック */", unsigned(first), unsigned(count));
+        tr3::log_text(LogLevel::Info, LogTag::Cmt, line, size_t(k));
+    }
+
+    auto rx = communicate(sp, tx, timeout_ms);
+    if (rx.empty()) return false;
+    if (const char* err = block_reply_error(last_frame(rx), tx[HEADER_LEN])) {
+        log_cmt(std::string("ブロック書き込み失敗: ") + err, LogLevel::Error);
+        return false;
+    }
+    return true;
 }
@@ -0,0 +1,1210 @@
+// TR3 プロトコル層のベンチマーク（POSIX）
+//   tr3_bench [--cycles N] [--tags N] [--baud B] [--sum-error P] [--readers N] [--track N]
+//             [--only NAME[,NAME...]] [--json] [--log]
+//
+// フレーム生成・検証・受信パーサ・UID 処理は同一プロセス内で、通信を伴うものは
+// LoopbackTransport（プロセス内）または擬似端末上のシミュレータを相手に計測する。
+// --only は計測名の前方一致で絞り込む（例: --only frame,parse）。
+// --json では 1 結果 1 行の JSON を出す（コミットごとの記録・比較用）。
+// プロトコル層のログは既定で無効にする（--log で trace。ログは /dev/null へ捨てる）。
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <new>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/serial_port.hpp"
+#include "../include/sim_pty.hpp"
+#include "../include/tr3_protocol.hpp"
+#include "../include/inventory_cycle.hpp"
+#include "../include/inventory_pipeline.hpp"
+#include "../include/log.hpp"
+#include "../include/tag_tracker.hpp"
+#include "../include/capture.hpp"
+#include "../include/replay_transport.hpp"
+#include "../include/frame_parser.hpp"
+#include "../include/frame_scan.hpp"
+#include "../include/metrics.hpp"
+#include "../include/reader_discovery.hpp"
+#include "../include/baud_negotiation.hpp"
+#include "../include/loopback_transport.hpp"
+#include "../include/command_engine.hpp"
+#include "../include/command_batch.hpp"
+#include "../include/tag_memory.hpp"
+#include "../include/tag_journal.hpp"
+#include "../include/event_ring.hpp"
+#ifdef __linux__
+#include "../include/reader_pool.hpp"
+#endif
+
+using namespace std::chrono;
+
+// ───────────────────────────────────
+// ヒープ確保の計数（呼び出したスレッドの分だけ数える。シミュレータのスレッドは含まない）
+// ───────────────────────────────────
+// 置き換えるのは全ての形（配列・サイズ付き・アライン指定・nothrow）。一部だけだと確保と解放の組が食い違う
+static thread_local uint64_t t_allocs = 0;
+
+static void* counted_alloc(std::size_t n, std::size_t align) {
+    ++t_allocs;
+    if (n == 0) n = 1;
+    if (align <= alignof(std::max_align_t)) return std::malloc(n);
+    void* p = nullptr;
+    return ::posix_memalign(&p, align, n) == 0 ? p : nullptr;
+}
+static void* counted_alloc_or_throw(std::size_t n, std::size_t align) {
+    if (void* p = counted_alloc(n, align)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new  (std::size_t n)                                          { return counted_alloc_or_throw(n, 0); }
+void* operator new[](std::size_t n)                                          { return counted_alloc_or_throw(n, 0); }
+void* operator new  (std::size_t n, std::align_val_t a)                      { return counted_alloc_or_throw(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a)                      { return counted_alloc_or_throw(n, std::size_t(a)); }
+void* operator new  (std::size_t n, const std::nothrow_t&) noexcept          { return counted_alloc(n, 0); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept          { return counted_alloc(n, 0); }
+void* operator new  (std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return counted_alloc(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return counted_alloc(n, std::size_t(a)); }
+
+void operator delete  (void* p) noexcept                                     { std::free(p); }
+void operator delete[](void* p) noexcept                                     { std::free(p); }
+void operator delete  (void* p, std::size_t) noexcept                        { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept                        { std::free(p); }
+void operator delete  (void* p, std::align_val_t) noexcept                   { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                   { std::free(p); }
+void operator delete  (void* p, std::size_t, std::align_val_t) noexcept      { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept      { std::free(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept              { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept              { std::free(p); }
+void operator delete  (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+// ───────────────────────────────────
+// 結果の出力（既定は "名前  区分  key=value ..." の 1 行、--json では同じ内容を JSON 1 行で）
+// ───────────────────────────────────
+static bool g_json = false;
+
+// 計測中の検査（失敗があれば終了コード 1）
+static int g_failures = 0;
+static void check(bool ok, const char* bench, const std::string& what) {
+    if (ok) return;
+    std::fprintf(stderr, "%s: 失敗: %s\n", bench, what.c_str());
+    ++g_failures;
+}
+
+class Report {
+public:
+    explicit Report(const char* bench, const std::string& variant = {}) {
+        text_ = bench;
+        json_ = std::string("{\"bench\":\"") + bench + "\"";
+        if (!variant.empty()) {
+            text_ += "  " + variant;
+            json_ += ",\"case\":\"" + variant + "\"";
+        }
+    }
+    ~Report() {
+        if (g_json) std::printf("%s}\n", json_.c_str());
+        else        std::printf("%s%s\n", text_.c_str(), note_.c_str());
+        std::fflush(stdout);
+    }
+    Report(const Report&) = delete;
+    Report& operator=(const Report&) = delete;
+
+    Report& num(const char* key, double v, int prec = 2) {
+        char b[64];
+        std::snprintf(b, sizeof(b), "%.*f", prec, v);
+        return field(key, b);
+    }
+    Report& cnt(const char* key, uint64_t v) {
+        char b[32];
+        std::snprintf(b, sizeof(b), "%llu", (unsigned long long)v);
+        return field(key, b);
+    }
+    Report& str(const char* key, const std::string& v) {
+        text_ += std::string("  ") + key + "=" + v;
+        json_ += std::string(",\"") + key + "\":\"" + v + "\"";
+        return *this;
+    }
+    Report& note(const std::string& s) { note_ += "  " + s; return *this; }   // 表示のみ（JSON には出さない）
+
+private:
+    Report& field(const char* key, const char* v) {
+        text_ += std::string("  ") + key + "=" + v;
+        json_ += std::string(",\"") + key + "\":" + v;
+        return *this;
+    }
+    std::string text_, json_, note_;
+};
+
+// ───────────────────────────────────
+// 計測の補助
+// ───────────────────────────────────
+// 最低 min_time かかるまで body(回数) を倍々で繰り返し、1 回あたりの秒数を返す
+template <class F>
+static double time_per_op(F&& body, duration<double> min_time = milliseconds(300)) {
+    uint64_t n = 1;
+    while (true) {
+        const auto t0 = steady_clock::now();
+        body(n);
+        const duration<double> dt = steady_clock::now() - t0;
+        if (dt >= min_time || n >= (uint64_t(1) << 40)) return dt.count() / double(n);
+        n = dt.count() > 0 ? std::max<uint64_t>(n * 2, uint64_t(double(n) * min_time.count() / dt.count() * 1.1)) : n * 16;
+    }
+}
+
+// 最適化で計算が消えないように値を参照する
+static volatile uint64_t g_sink = 0;
+
+// この CPU で使える命令セット（スカラから順に）
+static std::vector<tr3::SimdLevel> simd_levels() {
+    std::vector<tr3::SimdLevel> v;
+    for (auto lv : {tr3::SimdLevel::Scalar, tr3::SimdLevel::Sse2, tr3::SimdLevel::Avx2})
+        if (uint8_t(lv) <= uint8_t(tr3::simd_supported())) v.push_back(lv);
+    return v;
+}
+
+// SimReader に Inventory2 を繰り返し与え、min_bytes 以上の受信バイト列を作る
+static std::vector<uint8_t> make_inventory_stream(const tr3::SimConfig& cfg, size_t min_bytes) {
+    tr3::SimReader sim(cfg);
+    std::vector<uint8_t> out;
+    out.reserve(min_bytes + 8192);
+    while (out.size() < min_bytes) sim.on_rx(tr3::INV2_REQUEST.data(), tr3::INV2_REQUEST.size(), out);
+    return out;
+}
+
+struct BenchArgs {
+    uint32_t cycles    = 50;
+    size_t   tags      = 50;
+    uint32_t baud      = 115200;
+    double   sum_error = 0.02;
+    uint32_t readers   = 8;
+    bool     log       = false;   // プロトコル層のログを有効にして計測する
+    size_t   track     = 1000000; // TagTracker の計測に使う UID 数
+    std::vector<std::string> only; // 空なら全て
+};
+
+static double cpu_seconds() {
+    rusage ru{};
+    ::getrusage(RUSAGE_SELF, &ru);
+    return double(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) + double(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// フレーム生成・検証・SUM 計算
+static void bench_frame(const BenchArgs&) {
+    volatile uint8_t v = 0x01;   // 定数畳み込みさせない
+    {
+        const std::vector<uint8_t> payload = {tr3::DETAIL_INV2_F0, 0x40, 0x01};
+        const uint64_t a0 = t_allocs;
+        uint64_t total = 0;
+        const double s = time_per_op([&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) g_sink = g_sink + tr3::make_frame(tr3::ADDR_DEFAULT, tr3::CMD_INV2, payload).back();
+            total += n;
+        });
+        Report("frame", "make_frame").num("ns_per_frame", s * 1e9, 1).num("mframes_per_s", 1e-6 / s)
+            .num("allocs_per_frame", double(t_allocs - a0) / double(total));
+    }
+    {
+        const double s = time_per_op([&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i)
+                g_sink = g_sink + tr3::make_frame_fixed(tr3::ADDR_DEFAULT, tr3::CMD_INV2, tr3::DETAIL_INV2_F0, uint8_t(0x40), uint8_t(v)).data()[tr3::HEADER_LEN + 3];
+        });
+        Report("frame", "make_frame_fixed").num("ns_per_frame", s * 1e9, 1).num("mframes_per_s", 1e-6 / s);
+    }
+
+    // 検証：UID 応答フレーム（16 バイト）を並べたもの
+    tr3::SimConfig cfg; cfg.tag_count = 255;
+    const auto stream = make_inventory_stream(cfg, 1 << 20);
+    std::vector<tr3::FrameView> views;
+    for (size_t off = 0; off + tr3::HEADER_LEN <= stream.size();) {
+        const size_t len = tr3::HEADER_LEN + stream[off + tr3::IDX_LEN] + tr3::FOOTER_LEN;
+        views.push_back(tr3::FrameView{stream.data() + off, len});
+        off += len;
+    }
+    {
+        uint64_t bytes = 0;
+        for (const auto& f : views) bytes += f.size;
+        const double s = time_per_op([&](uint64_t n) {
+            uint64_t ok = 0;
+            for (uint64_t i = 0; i < n; ++i) for (const auto& f : views) ok += tr3::verify_frame(f);
+            g_sink = g_sink + ok;
+        });
+        Report("frame", "verify_frame").num("ns_per_frame", s * 1e9 / double(views.size()), 1)
+            .num("mib_per_s", double(bytes) / s / 1048576.0, 1);
+    }
+    for (auto lv : simd_levels()) {
+        tr3::set_simd_level(lv);
+        const double s = time_per_op([&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) g_sink = g_sink + tr3::calc_sum(stream.data(), stream.size());
+        });
+        Report("frame", std::string("calc_sum/") + tr3::simd_level_name(lv)).num("mib_per_s", double(stream.size()) / s / 1048576.0, 1);
+    }
+    tr3::set_simd_level(tr3::simd_supported());
+}
+
+// 受信パーサ：きれいな列／ゴミ・SUM 破損を含む列／細切れに届く列からのフレーム取り出し
+static void bench_parse(const BenchArgs&) {
+    tr3::SimConfig clean; clean.tag_count = 255;
+    tr3::SimConfig noisy = clean; noisy.noise_rate = 0.05; noisy.sum_error_rate = 0.02;
+    const auto s_clean = make_inventory_stream(clean, 4 << 20);
+    const auto s_noisy = make_inventory_stream(noisy, 4 << 20);
+
+    // 細切れ：1〜16 バイトずつ（USB シリアルが少量ずつ返す状況）
+    std::vector<uint32_t> frag;
+    {
+        std::mt19937 rng(7);
+        for (size_t n = 0; n < s_clean.size();) { frag.push_back(1 + rng() % 16); n += frag.back(); }
+    }
+
+    struct Case { const char* name; const std::vector<uint8_t>* s; bool fragmented; };
+    for (auto lv : simd_levels()) {
+        tr3::set_simd_level(lv);
+        const std::string isa = tr3::simd_level_name(lv);
+        for (const Case& c : {Case{"clean", &s_clean, false}, Case{"noisy", &s_noisy, false}, Case{"fragmented", &s_clean, true}}) {
+            const auto& st = *c.s;
+            tr3::FrameParserStats ps;
+            uint64_t frames = 0;
+            const double s = time_per_op([&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    tr3::FrameParser parser;
+                    size_t off = 0, k = 0;
+                    while (off < st.size()) {
+                        // 受信ループと同じく prepare → 読み込み（ここでは memcpy）→ commit → next
+                        size_t room = 0;
+                        uint8_t* dst = parser.prepare(room);
+                        size_t want = std::min(room, st.size() - off);
+                        if (c.fragmented) want = std::min<size_t>(want, frag[k++ % frag.size()]);
+                        std::memcpy(dst, st.data() + off, want);
+                        parser.commit(want);
+                        off += want;
+                        tr3::FrameView f;
+                        while (parser.next(f)) ++frames;
+                    }
+                    ps = parser.stats();
+                }
+            }, milliseconds(500));
+            Report("parse", std::string(c.name) + "/" + isa).num("mib_per_s", double(st.size()) / s / 1048576.0, 1)
+                .num("mframes_per_s", double(ps.frames) / s / 1e6)
+                .cnt("frames", ps.frames).cnt("resyncs", ps.resyncs).cnt("sum_errors", ps.checksum_failures);
+            g_sink = g_sink + frames;
+        }
+        // 一括抽出：メモリ上の大きなバッファ（キャプチャの後処理）をそのまま索引化する
+        for (const Case& c : {Case{"batch_clean", &s_clean, false}, Case{"batch_noisy", &s_noisy, false}}) {
+            const auto& st = *c.s;
+            tr3::FrameIndex idx;
+            idx.frames.reserve(st.size() / 16 + 1);
+            const double s = time_per_op([&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) { idx.clear(); tr3::parse_frames(st.data(), st.size(), idx); }
+            }, milliseconds(500));
+            Report("parse", std::string(c.name) + "/" + isa).num("mib_per_s", double(st.size()) / s / 1048576.0, 1)
+                .num("mframes_per_s", double(idx.stats.frames) / s / 1e6)
+                .cnt("frames", idx.stats.frames).cnt("resyncs", idx.stats.resyncs).cnt("sum_errors", idx.stats.checksum_failures);
+        }
+    }
+    tr3::set_simd_level(tr3::simd_supported());
+}
+
+// UID 応答フレームのデコードと重複排除（同じタグ群を繰り返し読む状況）
+static void bench_uid(const BenchArgs& a) {
+    const size_t uniq = a.tags ? a.tags : 1;
+    tr3::SimConfig cfg; cfg.tag_count = std::min(uniq, tr3::SimReader::MAX_TAGS);
+    tr3::SimReader sim(cfg);
+    std::vector<uint8_t> buf;
+    for (const auto& t : sim.tags()) {
+        // UID 応答はデータ部が DSFID + UID（LSB→MSB）
+        const auto f = tr3::make_frame_fixed(tr3::ADDR_DEFAULT, tr3::RSP_UID, uint8_t(0x00),
+                                             t[7], t[6], t[5], t[4], t[3], t[2], t[1], t[0]);
+        buf.insert(buf.end(), f.data(), f.data() + f.size());
+    }
+    const size_t fsz = tr3::HEADER_LEN + 9 + tr3::FOOTER_LEN;
+    const size_t nf  = buf.size() / fsz;
+
+    {
+        const double s = time_per_op([&](uint64_t n) {
+            tr3::InventoryItem it;
+            uint64_t ok = 0;
+            for (uint64_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < nf; ++j) ok += tr3::decode_uid_frame(tr3::FrameView{buf.data() + j * fsz, fsz}, it);
+            g_sink = g_sink + ok;
+        });
+        Report("uid", "decode").num("ns_per_uid", s * 1e9 / double(nf), 1).num("muids_per_s", double(nf) / s / 1e6);
+    }
+    {
+        tr3::TagTracker tr(tr3::TagTrackerConfig{});
+        const auto now = steady_clock::now();
+        const double s = time_per_op([&](uint64_t n) {
+            tr3::InventoryItem it;
+            for (uint64_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < nf; ++j)
+                    if (tr3::decode_uid_frame(tr3::FrameView{buf.data() + j * fsz, fsz}, it)) tr.observe(it.uid, it.dsfid, now);
+        });
+        Report("uid", "decode+tag_tracker").num("ns_per_uid", s * 1e9 / double(nf), 1)
+            .num("muids_per_s", double(nf) / s / 1e6).cnt("unique", tr.size());
+    }
+    {
+        std::unordered_set<tr3::Uid> seen;
+        const double s = time_per_op([&](uint64_t n) {
+            tr3::InventoryItem it;
+            for (uint64_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < nf; ++j)
+                    if (tr3::decode_uid_frame(tr3::FrameView{buf.data() + j * fsz, fsz}, it)) seen.insert(it.uid);
+        });
+        Report("uid", "decode+unordered_set").num("ns_per_uid", s * 1e9 / double(nf), 1)
+            .num("muids_per_s", double(nf) / s / 1e6).cnt("unique", seen.size()).note("(比較用)");
+    }
+}
+
+// 通信を含む 1 サイクル：LoopbackTransport（回線待ちなし）での Inventory2 の回転数
+static void bench_loopback(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = std::min(a.tags, tr3::SimReader::MAX_UIDS_PER_CYCLE);
+    for (size_t chunk : {size_t(0), size_t(16)}) {
+        const std::string tag = chunk ? "fragmented" : "whole";
+        {
+            tr3::LoopbackTransport lb(cfg, chunk);
+            tr3::InventoryResult r;
+            uint64_t uids = 0, cycles = 0;
+            const double s = time_per_op([&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) { tr3::run_inventory2(lb, r, 2000); uids += r.items.size(); }
+                cycles += n;
+            });
+            Report("loopback", "run_inventory2/" + tag).num("cycles_per_s", 1.0 / s, 0)
+                .num("us_per_cycle", s * 1e6, 1).num("uids_per_cycle", double(uids) / double(cycles), 1);
+        }
+        {
+            tr3::LoopbackTransport lb(cfg, chunk);
+            tr3::InventoryPipeline pipe(lb);
+            uint64_t uids = 0, cycles = 0;
+            const double s = time_per_op([&](uint64_t n) {
+                const auto st = pipe.run(n, nullptr);
+                uids += st.uids; cycles += st.cycles;
+            });
+            Report("loopback", "pipeline/" + tag).num("cycles_per_s", 1.0 / s, 0)
+                .num("us_per_cycle", s * 1e6, 1).num("uids_per_cycle", cycles ? double(uids) / double(cycles) : 0.0, 1);
+        }
+    }
+}
+
+// シリアル受信：1バイト毎の read_byte と一括 read_some の比較
+static void bench_serial_io(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = 255;
+    tr3::PtySimOptions opt; opt.baud = a.baud; opt.pace = false; opt.latency_us = 0;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "serial_io: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "serial_io: %s\n", sp.last_error().c_str()); return; }
+
+    const auto& cmd = tr3::INV2_REQUEST;
+    const size_t reply = (tr3::HEADER_LEN + 2 + tr3::FOOTER_LEN) + 255 * (tr3::HEADER_LEN + 9 + tr3::FOOTER_LEN);
+
+    for (int bulk = 0; bulk < 2; ++bulk) {
+        sp.reset_io_stats();
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            sp.write(cmd.data(), cmd.size());
+            size_t got = 0;
+            const auto deadline = steady_clock::now() + seconds(2);
+            uint8_t buf[4096];
+            while (got < reply && steady_clock::now() < deadline) {
+                if (bulk) got += sp.read_some(buf, sizeof(buf), deadline);
+                else      got += sp.read_byte(buf[0], milliseconds(100)) ? 1 : 0;
+            }
+        }
+        const double dt = duration<double>(steady_clock::now() - t0).count();
+        const auto& st = sp.io_stats();
+        Report("serial_io", bulk ? "read_some" : "read_byte")
+            .cnt("bytes", st.bytes_read).cnt("read_calls", st.read_calls).cnt("wait_calls", st.wait_calls)
+            .num("syscalls_per_byte", double(st.read_calls + st.wait_calls) / double(st.bytes_read ? st.bytes_read : 1), 3)
+            .num("kib_per_s", double(st.bytes_read) / 1024.0 / dt, 1);
+    }
+    sim.stop();
+}
+
+// Inventory2 の応答終端判定：固定 120ms と ボーレート由来＋学習 の比較
+static void bench_inventory_gap(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = a.tags; cfg.sum_error_rate = a.sum_error;
+    tr3::PtySimOptions opt; opt.baud = a.baud;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "inventory_gap: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "inventory_gap: %s\n", sp.last_error().c_str()); return; }
+
+    double base_ms = 0;
+    for (int adaptive = 0; adaptive < 2; ++adaptive) {
+        tr3::WaitTimings t;
+        if (!adaptive) { t.gap_min = t.gap_max = milliseconds(120); t.learn_gap = false; }
+        sp.set_timings(t);
+        sp.gap_model().reset();
+
+        size_t uids = 0, short_cycles = 0;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            auto r = tr3::run_inventory2(sp, 2000);
+            uids += r.items.size();
+            if (int(r.items.size()) < r.expected_count) ++short_cycles;   // 終端をギャップで判定したサイクル
+        }
+        const double ms = duration<double, std::milli>(steady_clock::now() - t0).count() / a.cycles;
+        if (!adaptive) base_ms = ms;
+        Report r("inventory_gap", adaptive ? "adaptive" : "fixed");
+        r.num("gap_ms", sp.end_of_response_gap().count() / 1000.0).num("cycle_ms", ms)
+         .cnt("uids", uids).cnt("gap_terminated", short_cycles);
+        if (adaptive && base_ms > 0) r.note("(" + std::to_string(int(100.0 * (base_ms - ms) / base_ms)) + "% 短縮)");
+        // 誤りのない回線では、終端判定を詰めても UID を取りこぼしてはいけない
+        if (a.sum_error == 0)
+            check(uids == size_t(a.cycles) * a.tags, "inventory_gap",
+                  std::string(adaptive ? "adaptive" : "fixed") + " で UID を取りこぼした (" + std::to_string(uids) + "/" +
+                  std::to_string(size_t(a.cycles) * a.tags) + ")");
+    }
+
+    // パイプライン：フレームが欠けたサイクルも cycle_timeout_ms を待たずに終わること
+    {
+        sp.set_timings(tr3::WaitTimings{});
+        tr3::InventoryPipeline pipe(sp);
+        const auto st = pipe.run(a.cycles);
+        Report("inventory_gap", "pipeline").num("gap_ms", sp.end_of_response_gap().count() / 1000.0)
+            .num("cycle_ms", 1000.0 / (st.cycles_per_sec() > 0 ? st.cycles_per_sec() : 1.0))
+            .cnt("uids", st.uids).cnt("gap_terminated", st.gap_ends).cnt("timeouts", st.timeouts)
+            .cnt("p50_ms", st.latency_us.percentile(50) / 1000);
+        if (a.sum_error == 0)
+            check(st.uids == uint64_t(a.cycles) * a.tags && st.gap_ends == 0 && st.timeouts == 0, "inventory_gap",
+                  "pipeline で UID を取りこぼした (" + std::to_string(st.uids) + "/" +
+                  std::to_string(uint64_t(a.cycles) * a.tags) + ")");
+    }
+    sim.stop();
+}
+
+// 定常状態の 1 サイクルあたりのヒープ確保回数（最初の数サイクルはバッファ確保のため除く）
+static void bench_alloc(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = a.tags;
+    tr3::PtySimOptions opt; opt.baud = a.baud; opt.pace = false; opt.latency_us = 0;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "alloc: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "alloc: %s\n", sp.last_error().c_str()); return; }
+
+    const uint32_t warmup = 5;
+
+    // パイプライン：コールバック間（= 1 サイクル）の確保回数を数える
+    {
+        tr3::InventoryPipeline pipe(sp);
+        uint64_t n = 0, base = 0, counted = 0;
+        pipe.run(warmup + a.cycles, [&](uint64_t, const tr3::InventoryResult&) {
+            if (++n == warmup) base = t_allocs;
+            else if (n > warmup) counted = n - warmup;
+        });
+        const uint64_t allocs = t_allocs - base;
+        Report("alloc", "pipeline").cnt("cycles", counted)
+            .num("allocs_per_cycle", counted ? double(allocs) / double(counted) : 0.0);
+        check(allocs == 0, "alloc", "pipeline の定常状態で確保あり (" + std::to_string(allocs) + " 回)");
+    }
+    // 同期 API（結果を使い回す版）：受信パーサもポートのものを使い回す
+    {
+        tr3::InventoryResult r;
+        for (uint32_t c = 0; c < warmup; ++c) tr3::run_inventory2(sp, r, 2000);
+        const uint64_t base = t_allocs;
+        for (uint32_t c = 0; c < a.cycles; ++c) tr3::run_inventory2(sp, r, 2000);
+        const uint64_t allocs = t_allocs - base;   // Report の文字列の確保を含めないよう先に数える
+        Report("alloc", "run_inventory2").cnt("cycles", a.cycles)
+            .num("allocs_per_cycle", double(allocs) / double(a.cycles));
+        check(allocs == 0, "alloc", "run_inventory2 の定常状態で確保あり (" + std::to_string(allocs) + " 回)");
+    }
+    sim.stop();
+}
+
+// ログ 1 記録あたりの呼び出し側コスト（無効時／有効時）
+static void bench_log(const BenchArgs& a) {
+    const auto f = tr3::make_frame_fixed(tr3::ADDR_DEFAULT, tr3::RSP_UID,
+                                         0x00, 0xE0, 0x04, 0x01, 0x00, 0x12, 0x34, 0x56, 0x78);
+    const tr3::LogLevel saved = tr3::log_level();
+    const uint32_t n = a.cycles * 2000;
+    for (int on = 0; on < 2; ++on) {
+        tr3::set_log_level(on ? tr3::LogLevel::Trace : tr3::LogLevel::Off);
+        tr3::log_flush();
+        const auto st0 = tr3::log_stats();
+        const auto t0  = steady_clock::now();
+        for (uint32_t i = 0; i < n; ++i) tr3::log_frame(tr3::LogTag::Recv, f.data(), f.size());
+        const double ns = duration<double, std::nano>(steady_clock::now() - t0).count() / n;
+        tr3::log_flush();
+        const auto st1 = tr3::log_stats();
+        Report("log", on ? "trace" : "off").num("ns_per_record", ns, 1)
+            .cnt("written", st1.records - st0.records).cnt("dropped", st1.dropped - st0.dropped);
+    }
+    tr3::set_log_level(saved);
+}
+
+// 計測：1 記録あたりの費用（単独・4 スレッド同時）と、取得・変換の費用
+static void bench_metrics(const BenchArgs& a) {
+    const uint32_t n = a.cycles * 20000;
+    for (unsigned threads : {1u, 4u}) {
+        tr3::Metrics m;   // プロセス共有の計測値を汚さないよう別に作る
+        std::vector<std::thread> th;
+        const auto t0 = steady_clock::now();
+        for (unsigned k = 0; k < threads; ++k)
+            th.emplace_back([&m, n, k] {
+                for (uint32_t i = 0; i < n; ++i) {
+                    m.on_request(0x78);
+                    m.on_ack(0x78, 1000 + ((i * 7919u + k) & 0xFFFu));
+                }
+            });
+        for (auto& t : th) t.join();
+        const double ns = duration<double, std::nano>(steady_clock::now() - t0).count() / n;
+        Report("metrics", "record/threads=" + std::to_string(threads)).num("ns_per_command", ns, 1);
+    }
+
+    const uint32_t k = 1000;
+    size_t bytes = 0;
+    const auto t0 = steady_clock::now();
+    for (uint32_t i = 0; i < k; ++i) bytes += tr3::to_prometheus(tr3::metrics().snapshot()).size();
+    Report("metrics", "snapshot+prometheus").num("us", duration<double, std::micro>(steady_clock::now() - t0).count() / k, 1)
+        .cnt("bytes", bytes / k);
+}
+
+// 実行したベンチマーク全体の計測値（Inventory2 の応答時間など）
+static void print_metrics_summary() {
+    const auto s = tr3::metrics().snapshot();
+    for (const auto& c : s.commands) {
+        if (c.requests == 0) continue;
+        char cmd[16];
+        if (c.cmd) std::snprintf(cmd, sizeof(cmd), "cmd=%02X", c.cmd); else std::snprintf(cmd, sizeof(cmd), "cmd=other");
+        Report("metrics", cmd).cnt("requests", c.requests).cnt("acks", c.acks).cnt("nacks", c.nacks)
+            .cnt("timeouts", c.timeouts).cnt("rtt_p50_us", c.rtt_us.percentile(50))
+            .cnt("rtt_p99_us", c.rtt_us.percentile(99)).cnt("rtt_max_us", c.rtt_us.max());
+    }
+    Report("metrics", "totals").cnt("tx_bytes", s.bytes_sent).cnt("rx_bytes", s.bytes_received)
+        .cnt("frames", s.frames).cnt("resyncs", s.resyncs).cnt("sum_errors", s.checksum_failures).cnt("uids", s.uids);
+}
+
+// TagTracker：挿入・再読み取り・検索の速度（比較として std::unordered_map）
+static void bench_tag_tracker(const BenchArgs& a) {
+    const size_t n = a.track ? a.track : 1;
+    std::vector<tr3::Uid> uids(n);
+    uint64_t x = 0x243F6A8885A308D3ull;
+    for (auto& u : uids) {
+        x += 0x9E3779B97F4A7C15ull;   // splitmix64 で UID を作る（上位は E0 04 固定）
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        u.bytes[0] = 0xE0; u.bytes[1] = 0x04;
+        for (int i = 2; i < 8; ++i) u.bytes[size_t(i)] = uint8_t(z >> (8 * i));
+    }
+    auto rate = [&](steady_clock::time_point t0, size_t ops) {
+        return double(ops) / duration<double>(steady_clock::now() - t0).count() / 1e6;
+    };
+
+    tr3::TagTrackerConfig cfg; cfg.capacity = n;
+    uint64_t arrivals = 0;
+    tr3::TagTracker tr(cfg, [&](const tr3::TagEvent& e) { if (e.kind == tr3::TagEvent::Kind::Arrive) ++arrivals; });
+    const auto now = steady_clock::now();
+
+    auto t0 = steady_clock::now();
+    for (const auto& u : uids) tr.observe(u, 0, now);
+    const double ins = rate(t0, n);
+    t0 = steady_clock::now();
+    for (const auto& u : uids) tr.observe(u, 0, now);
+    const double upd = rate(t0, n);
+    size_t hit = 0;
+    t0 = steady_clock::now();
+    for (const auto& u : uids) hit += tr.find(u) != nullptr;
+    const double fnd = rate(t0, n);
+    Report("tag_tracker", "tags=" + std::to_string(n)).num("insert_m_per_s", ins).num("reread_m_per_s", upd)
+        .num("find_m_per_s", fnd).cnt("arrivals", arrivals).cnt("hits", hit)
+        .num("bytes_per_tag", double(tr.memory_bytes()) / double(n), 1);
+
+    // 容量の半分で回し、追い出しを発生させる
+    tr3::TagTrackerConfig small = cfg; small.capacity = n / 2 ? n / 2 : 1;
+    tr3::TagTracker ev(small);
+    t0 = steady_clock::now();
+    for (const auto& u : uids) ev.observe(u, 0, now);
+    Report("tag_tracker", "capacity=" + std::to_string(small.capacity))
+        .num("insert_evict_m_per_s", rate(t0, n)).cnt("evictions", ev.stats().evictions);
+
+    struct Rec { steady_clock::time_point first, last; uint32_t reads; };
+    std::unordered_map<tr3::Uid, Rec> m;
+    m.reserve(n);
+    t0 = steady_clock::now();
+    for (const auto& u : uids) { auto& r = m[u]; r.first = r.last = now; ++r.reads; }
+    const double mins = rate(t0, n);
+    hit = 0;
+    t0 = steady_clock::now();
+    for (const auto& u : uids) hit += m.find(u) != m.end();
+    const double mfnd = rate(t0, n);
+    Report("tag_tracker", "unordered_map").num("insert_m_per_s", mins).num("find_m_per_s", mfnd).cnt("hits", hit).note("(比較用)");
+}
+
+// キャプチャ：シミュレータとの通信を記録し、オフラインで再生・解析する
+static void bench_capture_replay(const BenchArgs& a) {
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string path = std::string(tmp ? tmp : "/tmp") + "/tr3_bench_" + std::to_string(::getpid()) + ".cap";
+
+    size_t live_uids = 0;
+    {
+        tr3::SimConfig cfg; cfg.tag_count = a.tags; cfg.sum_error_rate = a.sum_error;
+        tr3::PtySimOptions opt; opt.baud = a.baud;
+        tr3::PtySimulator sim(cfg, opt);
+        if (!sim.start()) { std::fprintf(stderr, "capture: %s\n", sim.last_error().c_str()); return; }
+        tr3::SerialPort sp(sim.slave_path(), a.baud);
+        if (!sp.open()) { std::fprintf(stderr, "capture: %s\n", sp.last_error().c_str()); return; }
+        tr3::CaptureWriter cw;
+        if (!cw.open(path, a.baud)) { std::fprintf(stderr, "capture: %s\n", cw.last_error().c_str()); return; }
+        sp.set_capture(&cw);
+        tr3::InventoryResult r;
+        for (uint32_t c = 0; c < a.cycles; ++c) { tr3::run_inventory2(sp, r, 2000); live_uids += r.items.size(); }
+        sp.set_capture(nullptr);
+        cw.close();
+        const auto st = cw.stats();
+        Report("capture", "record").cnt("cycles", a.cycles).cnt("records", st.records)
+            .cnt("bytes", st.bytes).cnt("chunks", st.chunks);
+        sim.stop();
+    }
+
+    // オフライン解析：マップした記録の受信分を FrameParser へ流す（0.5 秒以上回す）
+    {
+        tr3::CaptureReader cap;
+        if (!cap.open(path)) { std::fprintf(stderr, "capture: %s\n", cap.last_error().c_str()); return; }
+        tr3::FrameParser parser;
+        uint64_t frames = 0, bytes = 0;
+        const auto t0 = steady_clock::now();
+        do {
+            cap.rewind();
+            tr3::CaptureRecord rec;
+            while (cap.next(rec)) {
+                if (rec.dir != tr3::CaptureDir::Rx) continue;
+                for (size_t off = 0; off < rec.len;) {
+                    off += parser.feed(rec.data + off, rec.len - off);
+                    tr3::FrameView f;
+                    while (parser.next(f)) ++frames;
+                }
+                bytes += rec.len;
+            }
+        } while (steady_clock::now() - t0 < milliseconds(500));
+        const double dt = duration<double>(steady_clock::now() - t0).count();
+        Report("capture", "offline_parse").num("mframes_per_s", double(frames) / dt / 1e6)
+            .num("mib_per_s", double(bytes) / dt / 1048576.0, 1);
+    }
+
+    // 再生：同じ Inventory2 を ReplayTransport に対して実行する
+    for (int max = 1; max >= 0; --max) {
+        tr3::ReplayTransport rp(path, max ? tr3::ReplaySpeed::Max : tr3::ReplaySpeed::Original);
+        if (!rp.open()) { std::fprintf(stderr, "replay: %s\n", rp.last_error().c_str()); return; }
+        size_t uids = 0;
+        tr3::InventoryResult r;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) { tr3::run_inventory2(rp, r, 2000); uids += r.items.size(); }
+        const double dt = duration<double>(steady_clock::now() - t0).count();
+        const auto& rs = rp.replay_stats();
+        Report("replay", max ? "max" : "original").num("cycles_per_s", a.cycles / dt, 1)
+            .cnt("uids", uids).cnt("live_uids", live_uids).cnt("tx_mismatch", rs.tx_mismatched + rs.tx_unexpected);
+    }
+    std::remove(path.c_str());
+}
+
+// コマンドエンジン：ROM・モード読み取り・ブザー・Inventory2 の 1 組を
+// 同期 API で順に実行した場合と、エンジンへ積んで応答待ちを重ねた場合の比較
+static void bench_engine(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = std::min<size_t>(a.tags, 20);
+    tr3::PtySimOptions opt; opt.baud = a.baud;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "engine: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "engine: %s\n", sp.last_error().c_str()); return; }
+
+    double base_ms = 0;
+    {
+        tr3::ReaderModeRaw raw; tr3::ReaderModePretty pretty;
+        uint64_t ok = 0, uids = 0;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            ok += !tr3::read_rom_version(sp).empty();
+            ok += tr3::read_reader_mode(sp, raw, pretty);
+            ok += tr3::buzzer(sp, 0x01, 0x00);
+            const auto r = tr3::run_inventory2(sp, 2000);
+            ok += r.error_message.empty();
+            uids += r.items.size();
+        }
+        base_ms = duration<double, std::milli>(steady_clock::now() - t0).count() / a.cycles;
+        Report("engine", "blocking").num("set_ms", base_ms).cnt("ok", ok).cnt("uids", uids);
+    }
+    for (size_t depth : {size_t(1), size_t(4)}) {
+        tr3::CommandEngineConfig ec; ec.max_in_flight = depth;
+        tr3::CommandEngine eng(sp, ec);
+        eng.start();
+        uint64_t ok = 0, uids = 0;
+        std::vector<std::future<tr3::CommandReply>> replies;
+        tr3::InventoryResult inv;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            replies.push_back(eng.submit(tr3::cmd_rom_version()));
+            replies.push_back(eng.submit(tr3::cmd_read_mode()));
+            replies.push_back(eng.submit(tr3::cmd_buzzer(0x01, 0x00)));
+            replies.push_back(eng.submit(tr3::cmd_inventory2(2000)));
+        }
+        for (auto& f : replies) {
+            const auto r = f.get();
+            ok += r.ok();
+            if (r.cmd == tr3::CMD_INV2 && tr3::reply_inventory(r, inv)) uids += inv.items.size();
+        }
+        const double ms = duration<double, std::milli>(steady_clock::now() - t0).count() / a.cycles;
+        eng.stop();
+        const auto st = eng.stats();
+        Report r("engine", "in_flight=" + std::to_string(depth));
+        r.num("set_ms", ms).cnt("ok", ok).cnt("uids", uids).cnt("timeouts", st.timeouts).cnt("unsolicited", st.unsolicited);
+        if (base_ms > 0) r.note("(" + std::to_string(int(100.0 * (base_ms - ms) / base_ms)) + "% 短縮)");
+    }
+    // 待機中：要求が無い間の受信待ちの回数と、単発の要求の往復時間
+    {
+        tr3::CommandEngine eng(sp);
+        eng.start();
+        std::this_thread::sleep_for(milliseconds(100));
+        const uint64_t w0 = sp.io_stats().wait_calls;
+        const double cpu0 = cpu_seconds();
+        std::this_thread::sleep_for(seconds(1));
+        const uint64_t waits = sp.io_stats().wait_calls - w0;
+        const double cpu = cpu_seconds() - cpu0;
+        uint64_t ok = 0;
+        double ms = 0;
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            std::this_thread::sleep_for(milliseconds(2));   // 要求の合間は待機に戻る
+            const auto t0 = steady_clock::now();
+            ok += eng.submit(tr3::cmd_rom_version()).get().ok();
+            ms += duration<double, std::milli>(steady_clock::now() - t0).count();
+        }
+        ms /= a.cycles;
+        eng.stop();
+        Report("engine", "idle").cnt("waits_per_s", waits).num("cpu_percent", 100.0 * cpu, 1)
+            .num("rom_ms", ms).cnt("ok", ok).note("(CPU はシミュレータ込み)");
+    }
+    sim.stop();
+}
+
+// 一括送信：動作モード読み取り・ブザー・Inventory2 の 1 組を、同期 API で 1 コマンドずつ送った場合と
+// CommandBatcher で 1 回の write にまとめた場合の比較（write 回数 = USB の送信トランザクション数）
+static void bench_batch(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = std::min<size_t>(a.tags, 20);
+    tr3::PtySimOptions opt; opt.baud = a.baud;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "batch: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "batch: %s\n", sp.last_error().c_str()); return; }
+
+    double base_ms = 0, base_writes = 0;
+    {
+        tr3::ReaderModeRaw raw; tr3::ReaderModePretty pretty;
+        uint64_t ok = 0, uids = 0;
+        const uint64_t w0 = sp.io_stats().write_calls;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            ok += tr3::read_reader_mode(sp, raw, pretty);
+            ok += tr3::buzzer(sp, 0x01, 0x00);
+            const auto r = tr3::run_inventory2(sp, 2000);
+            ok += r.error_message.empty();
+            uids += r.items.size();
+        }
+        base_ms     = duration<double, std::milli>(steady_clock::now() - t0).count() / a.cycles;
+        base_writes = double(sp.io_stats().write_calls - w0) / a.cycles;
+        Report("batch", "sequential").num("cycle_ms", base_ms).num("writes_per_cycle", base_writes)
+            .cnt("ok", ok).cnt("uids", uids);
+    }
+    {
+        tr3::CommandBatcher b(sp);
+        tr3::InventoryResult inv;
+        uint64_t ok = 0, uids = 0;
+        const uint64_t w0 = sp.io_stats().write_calls;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < a.cycles; ++c) {
+            b.add(tr3::cmd_read_mode());
+            b.add(tr3::cmd_buzzer(0x01, 0x00));
+            b.add(tr3::cmd_inventory2(2000));
+            for (const auto& r : b.execute()) {
+                ok += r.ok();
+                if (r.cmd == tr3::CMD_INV2 && tr3::reply_inventory(r, inv)) uids += inv.items.size();
+            }
+        }
+        const double ms     = duration<double, std::milli>(steady_clock::now() - t0).count() / a.cycles;
+        const double writes = double(sp.io_stats().write_calls - w0) / a.cycles;
+        Report r("batch", "batched");
+        r.num("cycle_ms", ms).num("writes_per_cycle", writes).cnt("ok", ok).cnt("uids", uids)
+         .cnt("lost", b.stats().lost).cnt("unsolicited", b.stats().unsolicited);
+        if (base_ms > 0)
+            r.note("(送信 " + std::to_string(int(base_writes - writes + 0.5)) + " 回/サイクル減・" +
+                   std::to_string(int(100.0 * (base_ms - ms) / base_ms)) + "% 短縮)");
+    }
+    sim.stop();
+}
+
+// タグメモリ：インベントリで得た全タグのユーザブロックを、1 ブロックずつ同期 API で読む場合と
+// read_tag_blocks（複数ブロック読み出し・一括送信）で読む場合、キャッシュが効く 2 回目の比較。
+// 読んだ内容はシミュレータのメモリと突き合わせる（bad）
+static void bench_blocks(const BenchArgs& a) {
+    tr3::SimConfig cfg; cfg.tag_count = std::min<size_t>(a.tags, 20);
+    cfg.sum_error_rate = a.sum_error;   // 応答の欠けで後続がずれても取り違えないことを bad で確かめる
+    tr3::PtySimOptions opt; opt.baud = a.baud;
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "blocks: %s\n", sim.last_error().c_str()); return; }
+
+    tr3::SerialPort sp(sim.slave_path(), a.baud);
+    if (!sp.open()) { std::fprintf(stderr, "blocks: %s\n", sp.last_error().c_str()); return; }
+
+    const auto inv = tr3::run_inventory2(sp, 2000);
+    if (inv.items.empty()) { std::fprintf(stderr, "blocks: %s\n", inv.error_message.c_str()); return; }
+
+    tr3::TagMemoryOptions mo; mo.block_count = 8; mo.block_size = cfg.block_size;
+    const size_t bytes = size_t(mo.block_count) * mo.block_size;
+    auto expected = [&](const tr3::Uid& uid, const uint8_t* data) {
+        const auto& tags = sim.reader().tags();
+        for (size_t i = 0; i < tags.size(); ++i)
+            if (std::equal(tags[i].begin(), tags[i].end(), uid.begin()))
+                return std::memcmp(sim.reader().block(i, mo.first_block), data, bytes) == 0;
+        return false;
+    };
+    const uint32_t cycles = std::max<uint32_t>(1, std::min<uint32_t>(a.cycles, 3));   // 1 ブロックずつは遅いので回数を絞る
+
+    double base_ms = 0;
+    {
+        uint64_t ok = 0, bad = 0;
+        std::vector<uint8_t> blk, all;
+        const uint64_t w0 = sp.io_stats().write_calls;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < cycles; ++c) {
+            for (const auto& it : inv.items) {
+                all.clear();
+                bool good = true;
+                for (uint16_t b = 0; b < mo.block_count && good; ++b) {
+                    good = tr3::read_blocks(sp, it.uid, uint8_t(mo.first_block + b), 1, blk, mo.timeout_ms);
+                    all.insert(all.end(), blk.begin(), blk.end());
+                }
+                if (!good) continue;
+                ++ok;
+                bad += !expected(it.uid, all.data());
+            }
+        }
+        base_ms = duration<double, std::milli>(steady_clock::now() - t0).count() / cycles;
+        Report("blocks", "per_block").num("cycle_ms", base_ms)
+            .num("writes_per_cycle", double(sp.io_stats().write_calls - w0) / cycles)
+            .cnt("tags", inv.items.size()).cnt("ok", ok).cnt("bad", bad);
+    }
+    tr3::BlockCache cache(mo.block_size);
+    for (const bool cached : {false, true}) {
+        uint64_t ok = 0, bad = 0, hits = 0, retried = 0;
+        const uint64_t w0 = sp.io_stats().write_calls;
+        const auto t0 = steady_clock::now();
+        for (uint32_t c = 0; c < cycles; ++c) {
+            tr3::TagMemoryStats st;
+            for (const auto& t : tr3::read_tag_blocks(sp, inv, mo, cached ? &cache : nullptr, &st)) {
+                if (!t.ok) continue;
+                ++ok;
+                bad += !expected(t.uid, t.data.data());
+            }
+            hits += st.cached;
+            retried += st.retried;
+        }
+        const double ms = duration<double, std::milli>(steady_clock::now() - t0).count() / cycles;
+        Report r("blocks", cached ? "batched+cache" : "batched");
+        r.num("cycle_ms", ms).num("writes_per_cycle", double(sp.io_stats().write_calls - w0) / cycles)
+         .cnt("ok", ok).cnt("bad", bad).cnt("cache_hits", hits).cnt("retried", retried);
+        if (base_ms > 0) r.note("(" + std::to_string(int(100.0 * (base_ms - ms) / base_ms)) + "% 短縮)");
+    }
+    sim.stop();
+}
+
+// ジャーナル：1 件ごとに write + fsync する素朴な書き方と、マップしたセグメントへ書いて
+// コミットスレッドがまとめて msync する書き方の比較（append() 側の待ちも測る）
+static void bench_journal(const BenchArgs& a) {
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string dir = std::string(tmp ? tmp : "/tmp") + "/tr3_bench_journal_" + std::to_string(::getpid());
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    tr3::Uid uid{};
+    double base_rate = 0;
+    {
+        const std::string path = dir + "/naive.log";
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { std::fprintf(stderr, "journal: %s を作れません\n", path.c_str()); return; }
+        const uint32_t n = 2000;
+        tr3::JournalRecord rec{};
+        const auto t0 = steady_clock::now();
+        for (uint32_t i = 0; i < n; ++i) {
+            rec.seq = i + 1;
+            if (::write(fd, &rec, sizeof(rec)) != ssize_t(sizeof(rec)) || ::fsync(fd) != 0) break;
+        }
+        const double dt = duration<double>(steady_clock::now() - t0).count();
+        ::close(fd);
+        std::remove(path.c_str());
+        base_rate = n / dt;
+        Report("journal", "fsync_per_event").cnt("events", n).num("events_per_s", base_rate, 0);
+    }
+    {
+        tr3::JournalOptions jo;
+        jo.dir = dir; jo.segment_records = size_t(1) << 18; jo.max_segments = 4;
+        tr3::JournalWriter j;
+        if (!j.open(jo)) { std::fprintf(stderr, "journal: %s\n", j.last_error().c_str()); return; }
+        const uint64_t n = uint64_t(std::max<uint32_t>(a.cycles, 1)) * 20000;
+        int64_t max_ns = 0;
+        const auto t0 = steady_clock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            uid.bytes[7] = uint8_t(i);
+            const auto s = steady_clock::now();
+            j.append(0, tr3::JournalKind::Read, uid, 0);
+            max_ns = std::max<int64_t>(max_ns, duration_cast<nanoseconds>(steady_clock::now() - s).count());
+        }
+        j.close();
+        const double dt = duration<double>(steady_clock::now() - t0).count();
+        const auto st = j.stats();
+        Report r("journal", "group_commit");
+        r.cnt("events", n).num("events_per_s", n / dt, 0).num("max_append_us", max_ns / 1e3, 1)
+         .cnt("committed", st.committed).cnt("commits", st.commits).cnt("max_commit_us", st.max_commit_us)
+         .cnt("segments", st.segments).cnt("inline_rotations", st.inline_rotations).cnt("dropped", st.dropped);
+        if (base_rate > 0) r.note("(" + std::to_string(int(n / dt / base_rate)) + " 倍)");
+    }
+    std::filesystem::remove_all(dir, ec);
+}
+
+// 共有メモリ配信：発行側が 50 件ずつ出し続ける間に、追いつける購読側 2 つと遅い購読側 1 つが読む。
+// 遅い購読側がいても発行側の速さ・待ちが変わらないこと、読めた分の中身が壊れていないこと（bad）を確かめる
+static void bench_event_ring(const BenchArgs& a) {
+    const std::string name = "/tr3_bench_ring_" + std::to_string(::getpid());
+    tr3::EventRingPublisher pub;
+    if (!pub.open(name, 65536)) { std::fprintf(stderr, "ring: %s\n", pub.last_error().c_str()); return; }
+
+    struct Sub { bool slow; uint64_t received = 0, lost = 0, bad = 0; };
+    Sub subs[3] = {{false}, {false}, {true}};
+    std::atomic<bool> done{false};
+    std::atomic<int>  ready{0};
+    std::vector<std::thread> th;
+    for (auto& s : subs) {
+        th.emplace_back([&, sp = &s] {
+            tr3::EventRingSubscriber sub;
+            if (!sub.open(name)) { ready.fetch_add(1); return; }
+            ready.fetch_add(1);
+            tr3::RingEvent e;
+            uint64_t prev = 0;
+            while (true) {
+                const bool fin = done.load(std::memory_order_acquire);
+                bool got = false;
+                while (sub.next(e)) {
+                    got = true;
+                    // UID の下位 8 バイトに seq を入れてあるので、中身と seq が合っているかで破損を見る
+                    uint64_t v = 0;
+                    for (int i = 0; i < 8; ++i) v = (v << 8) | e.uid[i];
+                    sp->bad += (v != e.seq) || (e.seq <= prev);
+                    prev = e.seq;
+                    if (sp->slow && sub.stats().received % 256 == 0) std::this_thread::sleep_for(milliseconds(1));
+                }
+                if (fin && !got) break;
+                if (!got) std::this_thread::yield();
+            }
+            sp->received = sub.stats().received;
+            sp->lost     = sub.stats().lost;
+        });
+    }
+    while (ready.load() < 3) std::this_thread::yield();
+
+    const uint64_t batches = uint64_t(std::max<uint32_t>(a.cycles, 1)) * 800;
+    tr3::InventoryResult r;
+    r.items.resize(50);
+    uint64_t seq = 0;
+    std::vector<int64_t> ns;
+    ns.reserve(batches);
+    const auto t0 = steady_clock::now();
+    for (uint64_t b = 0; b < batches; ++b) {
+        for (auto& it : r.items) {
+            uint64_t v = ++seq;
+            for (int i = 7; i >= 0; --i) { it.uid.bytes[size_t(i)] = uint8_t(v); v >>= 8; }
+        }
+        const auto s = steady_clock::now();
+        pub.publish(0, r);
+        ns.push_back(duration_cast<nanoseconds>(steady_clock::now() - s).count());
+    }
+    const double dt = duration<double>(steady_clock::now() - t0).count();
+    done.store(true, std::memory_order_release);
+    for (auto& t : th) t.join();
+    pub.close();
+
+    // 最大値は CPU が少ないと購読側への切り替えで決まるので、p99 も出す
+    std::sort(ns.begin(), ns.end());
+    Report("ring", "publish").cnt("events", seq).num("mevents_per_s", seq / dt / 1e6)
+        .num("p99_publish_us", ns[ns.size() * 99 / 100] / 1e3).num("max_publish_us", ns.back() / 1e3, 1)
+        .cnt("capacity", pub.capacity());
+    for (size_t i = 0; i < 3; ++i)
+        Report("ring", subs[i].slow ? "slow_subscriber" : "subscriber" + std::to_string(i))
+            .cnt("received", subs[i].received).cnt("lost", subs[i].lost).cnt("bad", subs[i].bad)
+            .cnt("accounted", subs[i].received + subs[i].lost == seq);
+}
+
+// リーダの自動検出：速度の違うシミュレータ 4 台と、何も応答しない端末 4 本を探す。
+// 1 ポートずつ probe_baud する場合と、discover_readers（ポートごとのスレッド）で同時に探す場合の時間を比べる
+static void bench_discovery(const BenchArgs&) {
+    static const uint32_t BAUDS[] = {9600, 19200, 38400, 115200};
+    std::vector<std::unique_ptr<tr3::PtySimulator>> sims;
+    std::vector<std::string> ports;
+    for (size_t i = 0; i < 4; ++i) {
+        tr3::SimConfig cfg; cfg.tag_count = 1; cfg.seed = uint32_t(i + 1);
+        tr3::PtySimOptions opt; opt.baud = BAUDS[i]; opt.check_baud = true;
+        sims.push_back(std::make_unique<tr3::PtySimulator>(cfg, opt));
+        if (!sims.back()->start()) { std::fprintf(stderr, "discovery: %s\n", sims.back()->last_error().c_str()); return; }
+        ports.push_back(sims.back()->slave_path());
+    }
+    // 応答しない端末（マスタ側を開いたまま何もしない）
+    std::vector<int> dead;
+    for (int i = 0; i < 4; ++i) {
+        const int m = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if (m < 0 || ::grantpt(m) != 0 || ::unlockpt(m) != 0) { if (m >= 0) ::close(m); continue; }
+        dead.push_back(m);
+        ports.push_back(::ptsname(m));
+    }
+
+    tr3::DiscoveryOptions opt;
+    opt.ports = ports;
+
+    size_t seq_found = 0;
+    auto t0 = steady_clock::now();
+    for (const auto& port : ports) {
+        tr3::SerialPort sp(port, 19200);
+        tr3::BaudProbeResult pr;
+        seq_found += tr3::probe_baud(sp, pr, 0, opt.probe_timeout_ms);
+        sp.close();
+    }
+    const double seq_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+
+    t0 = steady_clock::now();
+    const auto res = tr3::discover_readers(opt);
+    const double par_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+    size_t baud_ok = 0;
+    for (const auto& r : res.readers)
+        for (size_t i = 0; i < sims.size(); ++i) baud_ok += r.port == ports[i] && r.baud == BAUDS[i];
+
+    Report("discovery", "sequential").cnt("ports", ports.size()).cnt("found", seq_found).num("ms", seq_ms, 1);
+    Report("discovery", "concurrent").cnt("ports", ports.size()).cnt("found", res.readers.size())
+        .cnt("baud_ok", baud_ok).num("ms", par_ms, 1).note("(" + std::to_string(int(seq_ms / std::max(par_ms, 1.0))) + " 倍)");
+    for (int m : dead) ::close(m);
+    for (auto& s : sims) s->stop();
+}
+
+#ifdef __linux__
+// 複数リーダ：1 本の I/O スレッドで N 台を駆動したときのスループットと CPU 使用量
+static void bench_reader_pool(const BenchArgs& a) {
+    std::vector<std::unique_ptr<tr3::PtySimulator>> sims;
+    std::atomic<uint64_t> events{0};
+    tr3::ReaderPool pool([&](const tr3::PoolEvent&) { events.fetch_add(1, std::memory_order_relaxed); });
+
+    for (uint32_t i = 0; i < a.readers; ++i) {
+        tr3::SimConfig cfg; cfg.tag_count = 10; cfg.seed = i + 1; cfg.sum_error_rate = a.sum_error;
+        tr3::PtySimOptions opt; opt.baud = a.baud;
+        sims.push_back(std::make_unique<tr3::PtySimulator>(cfg, opt));
+        if (!sims.back()->start()) { std::fprintf(stderr, "reader_pool: %s\n", sims.back()->last_error().c_str()); return; }
+        tr3::ReaderConfig rc; rc.port = sims.back()->slave_path(); rc.baud = a.baud;
+        pool.add_reader(rc);
+    }
+    // CPU 使用量はプロセス全体（シミュレータのスレッドを含む）
+    const double cpu0 = cpu_seconds();
+    const auto   t0   = steady_clock::now();
+    pool.start();
+    std::this_thread::sleep_for(seconds(2));
+    const auto h = pool.health();
+    pool.stop();
+    const double dt  = duration<double>(steady_clock::now() - t0).count();
+    const double cpu = cpu_seconds() - cpu0;
+
+    uint64_t cycles = 0, timeouts = 0, gap_ends = 0;
+    for (const auto& r : h) { cycles += r.cycles; timeouts += r.timeouts; gap_ends += r.gap_ends; }
+    Report("reader_pool", "readers=" + std::to_string(a.readers)).num("cycles_per_s", double(cycles) / dt, 1)
+        .num("uids_per_s", double(events.load()) / dt, 1).cnt("timeouts", timeouts).cnt("gap_terminated", gap_ends)
+        .num("cpu_percent", 100.0 * cpu / dt, 1).note("(CPU はシミュレータ込み)");
+    for (auto& s : sims) s->stop();
+}
+#endif
+
+// 計測の一覧（--only で名前の前方一致により選ぶ）
+struct BenchCase {
+    const char* name;
+    void (*fn)(const BenchArgs&);
+};
+static const BenchCase CASES[] = {
+    {"frame",           bench_frame},
+    {"parse",           bench_parse},
+    {"uid",             bench_uid},
+    {"loopback",        bench_loopback},
+    {"serial_io",       bench_serial_io},
+    {"inventory_gap",   bench_inventory_gap},
+    {"alloc",           bench_alloc},
+    {"log",             bench_log},
+    {"tag_tracker",     bench_tag_tracker},
+    {"capture",         bench_capture_replay},
+    {"engine",          bench_engine},
+    {"batch",           bench_batch},
+    {"blocks",          bench_blocks},
+    {"journal",         bench_journal},
+    {"ring",            bench_event_ring},
+    {"discovery",       bench_discovery},
+#ifdef __linux__
+    {"reader_pool",     bench_reader_pool},
+#endif
+    {"metrics",         bench_metrics},
+};
+
+static bool selected(const BenchArgs& a, const char* name) {
+    if (a.only.empty()) return true;
+    for (const auto& o : a.only) if (std::string(name).compare(0, o.size(), o) == 0) return true;
+    return false;
+}
+
+int main(int argc, char** argv) {
+    BenchArgs a;
+    for (int i = 1; i < argc; i += 2) {
+        const std::string k = argv[i];
+        if (k == "--log")  { a.log = true; --i; continue; }
+        if (k == "--json") { g_json = true; --i; continue; }
+        if (i + 1 >= argc) { std::fprintf(stderr, "値がありません: %s\n", k.c_str()); return 2; }
+        if      (k == "--cycles")    a.cycles    = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (k == "--tags")      a.tags      = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (k == "--baud")      a.baud      = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (k == "--sum-error") a.sum_error = std::strtod(argv[i + 1], nullptr);
+        else if (k == "--track")     a.track     = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (k == "--readers")   a.readers   = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (k == "--only") {
+            const std::string v = argv[i + 1];
+            for (size_t p = 0; p <= v.size();) {
+                const size_t q = std::min(v.find(',', p), v.size());
+                if (q > p) a.only.push_back(v.substr(p, q - p));
+                p = q + 1;
+            }
+        }
+        else { std::fprintf(stderr, "不明なオプション: %s\n", k.c_str()); return 2; }
+    }
+    if (a.cycles == 0) a.cycles = 1;
+
+    // ログの整形・出力が計測に混ざらないよう、出力先は捨てる
+    std::FILE* devnull = std::fopen("/dev/null", "w");
+    if (devnull) tr3::set_log_sink(devnull);
+    tr3::set_log_level(a.log ? tr3::LogLevel::Trace : tr3::LogLevel::Off);
+
+    // 実行条件（比較時に条件の違いを見分けるため）
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    Report("config", build).str("simd", tr3::simd_level_name(tr3::simd_supported())).cnt("cycles", a.cycles).cnt("tags", a.tags).cnt("baud", a.baud)
+        .num("sum_error", a.sum_error, 3).cnt("readers", a.readers).cnt("log", a.log);
+
+    for (const auto& c : CASES) if (selected(a, c.name)) c.fn(a);
+    if (selected(a, "metrics")) print_metrics_summary();
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+// リーダの自動検出（全シリアルポートを同時に探して一覧表示）
+//   tr3_discover [PORT...] [--timeout MS] [--parallel N]
+//
+// PORT を省くと enum_serial_ports() の全ポートを探す。前回の接続プロファイル（TR3_PROFILE）があれば
+// その速度から試す。見つかったリーダ（ポート・速度・ROM バージョン・動作モード）と、応答しなかった
+// ポートを表示する。1 台も見つからなければ終了コード 1。
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../include/reader_discovery.hpp"
+#include "../include/log.hpp"
+
+int main(int argc, char** argv) {
+    tr3::DiscoveryOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            opt.probe_timeout_ms = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            opt.max_parallel = size_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argv[i][0] == '-') {
+            std::fprintf(stderr, "使い方: tr3_discover [PORT...] [--timeout MS] [--parallel N]\n");
+            return 2;
+        } else {
+            opt.ports.push_back(argv[i]);
+        }
+    }
+    // 速度違いの試行は失敗して当然なので、既定ではログを出さない（TR3_LOG で指定すればそれに従う）
+    if (!std::getenv("TR3_LOG")) tr3::set_log_level(tr3::LogLevel::Off);
+
+    tr3::ProfileStore profiles(tr3::default_profile_path());
+    profiles.load();
+    opt.profiles = &profiles;
+
+    const auto res = tr3::discover_readers(opt);
+    tr3::log_flush();
+    for (const auto& r : res.readers) {
+        std::string mode;
+        static const char* HEX = "0123456789ABCDEF";
+        for (uint8_t b : r.mode.bytes) { mode += HEX[b >> 4]; mode += HEX[b & 0x0F]; }
+        std::printf("%-16s  %6u bps  ROM %-12s  mode=%s%s  (%u ms)\n", r.port.c_str(), unsigned(r.baud),
+                    r.rom_version.c_str(), r.mode_ok ? mode.c_str() : "?",
+                    r.mode_ok && tr3::is_command_mode(r.mode) ? " [command]" : "", unsigned(r.elapsed_ms));
+    }
+    for (const auto& f : res.failed) std::printf("%-16s  -- %s\n", f.port.c_str(), f.error.c_str());
+    std::printf("# readers=%zu  ports=%zu  elapsed=%u ms\n", res.readers.size(), res.probed, unsigned(res.elapsed_ms));
+    return res.readers.empty() ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+// 多数のリーダを 1 スレッドで並行に動かす（コルーチン版の手順。Linux のみ・C++20）
+//   tr3_fleet [--baud B] [--cycles N] [--interval-ms M] PORT...
+//   tr3_fleet --sim N [--tags T] [--sum-error P] [--baud B] [--cycles N] [--interval-ms M]
+//
+// 各リーダで main.cpp と同じ手順（ROM 確認 → 動作モード読み取り → 必要ならコマンドモードへ設定 →
+// Inventory2 を N 回。結果に応じてブザー）を co_await で書き、EventLoop 1 本で並行に進める。
+// --sim では擬似端末上のシミュレータを N 台起動して相手にする（シミュレータは台数分のスレッドを使う）。
+// 終了時に合計と、イベントループのスレッドの CPU 時間・最大常駐メモリを表示する。
+#include <sys/resource.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/async_reader.hpp"
+#include "../include/sim_pty.hpp"
+#include "../include/log.hpp"
+
+using namespace std::chrono;
+
+struct FleetArgs {
+    std::vector<std::string> ports;
+    uint32_t baud        = 19200;
+    uint32_t cycles      = 10;
+    uint32_t interval_ms = 100;     // main.cpp の試行間隔
+    size_t   sims        = 0;
+    size_t   tags        = 5;
+    double   sum_error   = 0.0;
+};
+
+struct ReaderResult {
+    bool     ready  = false;   // ROM 確認まで通ったか
+    uint64_t cycles = 0, uids = 0, errors = 0;
+};
+
+static tr3::EventLoop* g_loop = nullptr;
+static void on_signal(int) { if (g_loop) g_loop->stop(); }
+
+// main.cpp の手順（::Sleep の代わりに sleep_for で待つ）
+static tr3::Task<void> workflow(tr3::EventLoop& loop, tr3::AsyncReader& rd, const FleetArgs& a, ReaderResult& out) {
+    if ((co_await rd.rom_version()).empty()) co_return;
+    out.ready = true;
+
+    tr3::ReaderModeRaw raw;
+    if (co_await rd.read_mode(raw)) {
+        if (!tr3::is_command_mode(raw) && !co_await rd.write_mode(raw, 0x00)) ++out.errors;   // 既にコマンドモードなら省く
+    } else {
+        ++out.errors;
+    }
+
+    for (uint32_t t = 1; t <= a.cycles; ++t) {
+        const tr3::InventoryResult r = co_await rd.inventory2(2000);
+        ++out.cycles;
+        out.uids += r.items.size();
+        if (!r.error_message.empty()) ++out.errors;
+        // タグが1件以上 → ピー、0件・エラー → ピッピッピ
+        co_await rd.buzzer(0x01, (r.error_message.empty() && !r.items.empty()) ? 0x00 : 0x01);
+        if (t < a.cycles) co_await loop.sleep_for(milliseconds(a.interval_ms));
+    }
+}
+
+static void usage() {
+    std::fprintf(stderr,
+        "使い方: tr3_fleet [オプション] PORT...\n"
+        "        tr3_fleet --sim N [オプション]\n"
+        "  --baud B         ボーレート（既定 19200）\n"
+        "  --cycles N       リーダ毎の Inventory2 回数（既定 10）\n"
+        "  --interval-ms M  試行間隔（既定 100）\n"
+        "  --sim N          シミュレータを N 台起動して相手にする\n"
+        "  --tags T         シミュレータのタグ数（既定 5）\n"
+        "  --sum-error P    シミュレータの SUM 破損確率\n");
+}
+
+int main(int argc, char** argv) {
+    FleetArgs a;
+    for (int i = 1; i < argc; ++i) {
+        const std::string k = argv[i];
+        auto val = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "%s に値がありません\n", name); std::exit(2); }
+            return argv[++i];
+        };
+        if      (k == "--baud")        a.baud        = uint32_t(std::strtoul(val("--baud"), nullptr, 10));
+        else if (k == "--cycles")      a.cycles      = uint32_t(std::strtoul(val("--cycles"), nullptr, 10));
+        else if (k == "--interval-ms") a.interval_ms = uint32_t(std::strtoul(val("--interval-ms"), nullptr, 10));
+        else if (k == "--sim")         a.sims        = std::strtoul(val("--sim"), nullptr, 10);
+        else if (k == "--tags")        a.tags        = std::strtoul(val("--tags"), nullptr, 10);
+        else if (k == "--sum-error")   a.sum_error   = std::strtod(val("--sum-error"), nullptr);
+        else if (!k.empty() && k[0] == '-') { usage(); return 2; }
+        else a.ports.push_back(k);
+    }
+    if (a.ports.empty() && a.sims == 0) { usage(); return 2; }
+    tr3::set_log_level(tr3::LogLevel::Error);
+
+    std::vector<std::unique_ptr<tr3::PtySimulator>> sims;
+    for (size_t i = 0; i < a.sims; ++i) {
+        tr3::SimConfig cfg; cfg.tag_count = a.tags; cfg.seed = uint32_t(i + 1); cfg.sum_error_rate = a.sum_error;
+        tr3::PtySimOptions opt; opt.baud = a.baud;
+        sims.push_back(std::make_unique<tr3::PtySimulator>(cfg, opt));
+        if (!sims.back()->start()) { std::fprintf(stderr, "tr3_fleet: %s\n", sims.back()->last_error().c_str()); return 1; }
+        a.ports.push_back(sims.back()->slave_path());
+    }
+
+    tr3::EventLoop loop;
+    if (!loop.ok()) { std::fprintf(stderr, "tr3_fleet: %s\n", loop.last_error().c_str()); return 1; }
+    g_loop = &loop;
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::vector<std::unique_ptr<tr3::AsyncReader>> readers;
+    std::vector<ReaderResult> results(a.ports.size());
+    for (size_t i = 0; i < a.ports.size(); ++i) {
+        readers.push_back(std::make_unique<tr3::AsyncReader>(loop, a.ports[i], a.baud));
+        if (!readers.back()->open()) {
+            std::fprintf(stderr, "tr3_fleet: %s: %s\n", a.ports[i].c_str(), readers.back()->last_error().c_str());
+            continue;
+        }
+        loop.spawn(workflow(loop, *readers.back(), a, results[i]));
+    }
+
+    // CPU 時間はイベントループのスレッドのみ（シミュレータのスレッドは含まない）
+    rusage r0{}; ::getrusage(RUSAGE_THREAD, &r0);
+    const auto t0 = steady_clock::now();
+    loop.run();
+    const double dt = duration<double>(steady_clock::now() - t0).count();
+    rusage r1{}; ::getrusage(RUSAGE_THREAD, &r1);
+    auto secs = [](const timeval& tv) { return double(tv.tv_sec) + double(tv.tv_usec) / 1e6; };
+    const double cpu = (secs(r1.ru_utime) - secs(r0.ru_utime)) + (secs(r1.ru_stime) - secs(r0.ru_stime));
+
+    ReaderResult sum;
+    size_t ready = 0;
+    uint64_t timeouts = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        ready      += results[i].ready;
+        sum.cycles += results[i].cycles;
+        sum.uids   += results[i].uids;
+        sum.errors += results[i].errors;
+        timeouts   += readers[i]->stats().timeouts;
+    }
+    rusage ru{}; ::getrusage(RUSAGE_SELF, &ru);
+    std::printf("readers=%zu ready=%zu cycles=%llu uids=%llu errors=%llu timeouts=%llu  elapsed=%.2fs  loop_cpu=%.1f%%  max_rss=%ldKiB\n",
+                a.ports.size(), ready, (unsigned long long)sum.cycles, (unsigned long long)sum.uids,
+                (unsigned long long)sum.errors, (unsigned long long)timeouts, dt, dt > 0 ? 100.0 * cpu / dt : 0.0, ru.ru_maxrss);
+
+    g_loop = nullptr;
+    readers.clear();
+    for (auto& s : sims) s->stop();
+    return 0;
+}
@@ -0,0 +1,93 @@
+// TR3 リーダライタ シミュレータ（擬似端末 pty 上で応答する）
+//   tr3_sim [--tags N] [--baud B] [--noise P] [--sum-error P] [--seed S]
+//           [--latency-us U] [--scan-ms M] [--link PATH] [--no-pace] [--strict-baud]
+// 起動すると pty のスレーブ側パス（/dev/pts/N）を表示する。--link を指定すると
+// そのパスへシンボリックリンクを張るので、クライアントはそこを開けばよい。
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../include/sim_pty.hpp"
+#include "../include/tr3_protocol.hpp"
+
+static volatile std::sig_atomic_t g_stop = 0;
+static void on_signal(int) { g_stop = 1; }
+
+static void usage() {
+    std::fprintf(stderr,
+        "使い方: tr3_sim [オプション]\n"
+        "  --tags N        視野内のタグ数 0〜1000（既定 1）\n"
+        "  --baud B        送信ペースのボーレート（既定 19200）\n"
+        "  --no-pace       ボーレートによる送信ペース制御を行わない\n"
+        "  --strict-baud   クライアントの速度がリーダの通信速度と違えば受信を捨てる\n"
+        "                  （--baud が初期の通信速度。速度の書き込みで切り替わる）\n"
+        "  --latency-us U  コマンド受信から応答開始までの処理遅延（既定 2000）\n"
+        "  --noise P       応答前にゴミバイトを挿入する確率 0〜1\n"
+        "  --sum-error P   応答フレームの SUM を壊す確率 0〜1\n"
+        "  --seed S        乱数種（UID 集合もこれで決まる）\n"
+        "  --scan-ms M     自律動作モードでの UID 送出周期（既定 50）\n"
+        "  --link PATH     pty スレーブへのシンボリックリンクを作成\n");
+}
+
+int main(int argc, char** argv) {
+    tr3::SimConfig     cfg;
+    tr3::PtySimOptions opt;
+    std::string        link;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        auto val = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "%s に値がありません\n", name); std::exit(2); }
+            return argv[++i];
+        };
+        if      (a == "--tags")       cfg.tag_count        = std::strtoul(val("--tags"), nullptr, 10);
+        else if (a == "--baud")       opt.baud             = uint32_t(std::strtoul(val("--baud"), nullptr, 10));
+        else if (a == "--no-pace")    opt.pace             = false;
+        else if (a == "--strict-baud") opt.check_baud      = true;
+        else if (a == "--latency-us") opt.latency_us       = uint32_t(std::strtoul(val("--latency-us"), nullptr, 10));
+        else if (a == "--noise")      cfg.noise_rate       = std::strtod(val("--noise"), nullptr);
+        else if (a == "--sum-error")  cfg.sum_error_rate   = std::strtod(val("--sum-error"), nullptr);
+        else if (a == "--seed")       cfg.seed             = uint32_t(std::strtoul(val("--seed"), nullptr, 10));
+        else if (a == "--scan-ms")    cfg.scan_interval_ms = uint32_t(std::strtoul(val("--scan-ms"), nullptr, 10));
+        else if (a == "--link")       link                 = val("--link");
+        else { usage(); return 2; }
+    }
+    if (opt.baud == 0) { usage(); return 2; }
+    if (cfg.tag_count > tr3::SimReader::MAX_TAGS) cfg.tag_count = tr3::SimReader::MAX_TAGS;
+
+    tr3::PtySimulator sim(cfg, opt);
+    if (!sim.start()) { std::fprintf(stderr, "tr3_sim: %s\n", sim.last_error().c_str()); return 1; }
+    if (!link.empty()) {
+        ::unlink(link.c_str());
+        if (::symlink(sim.slave_path().c_str(), link.c_str()) != 0) std::perror("symlink");
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::printf("%s\n", sim.slave_path().c_str());
+    std::fprintf(stderr, "tr3_sim: %s  tags=%zu baud=%u%s%s noise=%.3f sum_error=%.3f\n",
+                 sim.slave_path().c_str(), cfg.tag_count, opt.baud, opt.pace ? "" : "(no-pace)",
+                 opt.check_baud ? "(strict)" : "",
+                 cfg.noise_rate, cfg.sum_error_rate);
+    std::fflush(stdout);
+
+    while (!g_stop) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sim.stop();
+
+    const auto& st = sim.reader().stats();
+    std::fprintf(stderr, "tr3_sim: commands=%llu inventories=%llu uids=%llu nacks=%llu rx_sum_errors=%llu\n",
+                 (unsigned long long)st.commands, (unsigned long long)st.inventories,
+                 (unsigned long long)st.uids_sent, (unsigned long long)st.nacks,
+                 (unsigned long long)st.rx_sum_errors);
+    if (opt.check_baud)
+        std::fprintf(stderr, "tr3_sim: baud=%u baud_mismatch_bytes=%llu\n",
+                     tr3::baud_from_speed_bits(sim.reader().speed_bits()),
+                     (unsigned long long)sim.baud_mismatch_bytes());
+    if (!link.empty()) ::unlink(link.c_str());
+    return 0;
+}
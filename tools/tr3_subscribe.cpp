@@ -0,0 +1,95 @@
+// 共有メモリのイベントを購読して表示する（POSIX のみ）
+//   tr3_subscribe [NAME] [--oldest] [--count N] [--quiet]
+//
+// NAME（既定 /tr3_events）のリングを読み、1 イベント 1 行で表示する（時刻 リーダ 種別 UID DSFID seq）。
+// 追い越されて読めなかった分は "# lost" 行で知らせる。発行側が閉じたら開き直しを待つ。
+// --oldest はリングに残っている最古から、--quiet は 1 秒ごとの件数だけを表示する。
+#include <signal.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+#include "../include/event_ring.hpp"
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void print_event(const tr3::RingEvent& e) {
+    const std::time_t sec = std::time_t(e.t_wall_ns / 1000000000);
+    std::tm tm{};
+    localtime_r(&sec, &tm);
+    char ts[32];
+    std::strftime(ts, sizeof(ts), "%H:%M:%S", &tm);
+    std::printf("%s.%03d  reader=%u  %-6s  %02X%02X%02X%02X%02X%02X%02X%02X  dsfid=%02X  seq=%llu\n",
+                ts, int(e.t_wall_ns / 1000000 % 1000), unsigned(e.reader_id),
+                tr3::ring_event_kind_name(tr3::RingEventKind(e.kind)),
+                e.uid[0], e.uid[1], e.uid[2], e.uid[3], e.uid[4], e.uid[5], e.uid[6], e.uid[7],
+                unsigned(e.dsfid), (unsigned long long)e.seq);
+}
+
+int main(int argc, char** argv) {
+    std::string name = "/tr3_events";
+    bool oldest = false, quiet = false;
+    uint64_t count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if      (std::strcmp(argv[i], "--oldest") == 0) oldest = true;
+        else if (std::strcmp(argv[i], "--quiet") == 0)  quiet = true;
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = std::strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] == '/') name = argv[i];
+        else {
+            std::fprintf(stderr, "使い方: tr3_subscribe [NAME] [--oldest] [--count N] [--quiet]\n");
+            return 2;
+        }
+    }
+    ::signal(SIGINT,  [](int) { g_stop = 1; });
+    ::signal(SIGTERM, [](int) { g_stop = 1; });
+
+    tr3::EventRingSubscriber sub;
+    uint64_t total = 0, lost = 0, shown_lost = 0, last_total = 0;
+    auto t_report = std::chrono::steady_clock::now();
+    auto all_lost = [&] { return lost + (sub.is_open() ? sub.stats().lost : 0); };   // 開き直す前の分を含む
+    while (!g_stop && (count == 0 || total < count)) {
+        if (!sub.is_open()) {
+            // 発行側の起動・再起動を待つ
+            if (!sub.open(name, oldest)) { std::this_thread::sleep_for(std::chrono::milliseconds(200)); continue; }
+            std::fprintf(stderr, "# %s を購読\n", name.c_str());
+        }
+        const bool gone = sub.publisher_gone();   // 閉じる前に出した分まで読んでから開き直す
+
+        tr3::RingEvent e;
+        size_t n = 0;
+        while (n < 4096 && (count == 0 || total < count) && sub.next(e)) {
+            if (!quiet) print_event(e);
+            ++n; ++total;
+        }
+        if (sub.stats().lost != shown_lost) {
+            std::printf("# lost %llu\n", (unsigned long long)(sub.stats().lost - shown_lost));
+            shown_lost = sub.stats().lost;
+        }
+        if (quiet) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now - t_report >= std::chrono::seconds(1)) {
+                std::printf("# %llu 件/秒  累計 %llu  取りこぼし %llu\n", (unsigned long long)(total - last_total),
+                            (unsigned long long)total, (unsigned long long)all_lost());
+                last_total = total;
+                t_report = now;
+            }
+        }
+        if (n == 0 && gone) {
+            lost += sub.stats().lost;
+            shown_lost = 0;
+            sub.close();
+            std::fprintf(stderr, "# 発行側が閉じました\n");
+        } else if (n == 0) {
+            std::fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));   // 発行側は起こさないので間隔を置いて見に行く
+        }
+    }
+    std::fflush(stdout);
+    std::fprintf(stderr, "# received=%llu lost=%llu\n", (unsigned long long)total,
+                 (unsigned long long)all_lost());
+    return 0;
+}